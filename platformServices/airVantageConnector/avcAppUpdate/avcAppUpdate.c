@@ -18,6 +18,8 @@
 #include "packageDownloader.h"
 #include "avcAppUpdate.h"
 #include "avcFsConfig.h"
+#include "cfgBatch.h"
+#include "deltaPatch.h"
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -41,6 +43,13 @@
 //--------------------------------------------------------------------------------------------------
 #define NAME_DOWNLOAD_FILE          "/download.update"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Name of the temporary file where the package rebuilt from a delta package is stored
+ */
+//--------------------------------------------------------------------------------------------------
+#define NAME_DELTA_TARGET_FILE      "/download.update.delta"
+
 //--------------------------------------------------------------------------------------------------
 /**
  *  Maximum allowed size for lwm2m object list strings.
@@ -71,6 +80,13 @@
 //--------------------------------------------------------------------------------------------------
 #define CFG_OBJECT_MAP    "objectMap"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ *  Size of the path of an application instance id, relative to the objectMap node.
+ */
+//--------------------------------------------------------------------------------------------------
+#define CFG_OIID_PATH_BYTES (MAX_APP_NAME_BYTES + sizeof("/oiid"))
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Buffer size for package store.
@@ -196,6 +212,13 @@ static le_event_Id_t UpdateEndEventId;
 //--------------------------------------------------------------------------------------------------
 static le_event_Id_t InstallResumeEventId;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read cache of the object 9 instance mapping, created on first use.
+ */
+//--------------------------------------------------------------------------------------------------
+static cfgBatch_CacheRef_t ObjectMapCacheRef = NULL;
+
 //--------------------------------------------------------------------------------------------------
 /**
  *  Convert an UpdateState value to a string for debugging.
@@ -445,6 +468,24 @@ static void SetObj9State_
                                                           __FUNCTION__, \
                                                           __LINE__)
 
+//--------------------------------------------------------------------------------------------------
+/**
+ *  Get the read cache of the object 9 instance mapping.
+ */
+//--------------------------------------------------------------------------------------------------
+static cfgBatch_CacheRef_t GetObjectMapCache
+(
+    void
+)
+{
+    if (NULL == ObjectMapCacheRef)
+    {
+        LE_ASSERT_OK(cfgBatch_CreateCache(CFG_OBJECT_INFO_PATH, &ObjectMapCacheRef));
+    }
+
+    return ObjectMapCacheRef;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  *  Set the LWM2M object 9 instance mapping for the application. If NULL is passed for the instance
@@ -458,25 +499,28 @@ static void SetObject9InstanceForApp
                                               ///< if the link is to be cleared.
 )
 {
-    le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(CFG_OBJECT_INFO_PATH);
+    // The batch also drops the outdated mapping from the read cache.
+    cfgBatch_WriteRef_t writeRef;
+    LE_ASSERT_OK(cfgBatch_CreateWrite(CFG_OBJECT_INFO_PATH, &writeRef));
 
     if (instanceRef != NULL)
     {
         int instanceId;
+        char oiidPath[CFG_OIID_PATH_BYTES];
         LE_ASSERT_OK(assetData_GetInstanceId(instanceRef, &instanceId));
 
-        le_cfg_GoToNode(iterRef, appNamePtr);
-        le_cfg_SetInt(iterRef, "oiid", instanceId);
+        snprintf(oiidPath, sizeof(oiidPath), "%s/oiid", appNamePtr);
+        cfgBatch_SetInt(writeRef, oiidPath, instanceId);
 
         LE_DEBUG("Application '%s' mapped to instance %d.", appNamePtr, instanceId);
     }
     else
     {
-        le_cfg_DeleteNode(iterRef, appNamePtr);
+        cfgBatch_DeleteNode(writeRef, appNamePtr);
         LE_DEBUG("Deletion of '%s' from cfgTree %s successful", appNamePtr, CFG_OBJECT_INFO_PATH);
     }
 
-    le_cfg_CommitTxn(iterRef);
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -527,11 +571,13 @@ static assetData_InstanceDataRef_t GetObject9InstanceForApp
 
     // Attempt to read the mapping from the configuration.
     assetData_InstanceDataRef_t instanceRef = NULL;
-    le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(CFG_OBJECT_INFO_PATH);
+    char oiidPath[CFG_OIID_PATH_BYTES];
+
+    snprintf(oiidPath, sizeof(oiidPath), "%s/oiid", appNamePtr);
 
-    le_cfg_GoToNode(iterRef, appNamePtr);
-    int instanceId = le_cfg_GetInt(iterRef, "oiid", -1);
-    le_cfg_CancelTxn(iterRef);
+    cfgBatch_ReadEntry_t entry = { .path = oiidPath, .type = LE_CFG_TYPE_INT, .intValue = -1 };
+    LE_ASSERT_OK(cfgBatch_CacheRead(GetObjectMapCache(), &entry, 1));
+    int instanceId = entry.intValue;
 
     if (instanceId != -1)
     {
@@ -632,6 +678,48 @@ static void NotifyObj9List
     avcClient_SendList(obj9List, obj9ListLen);
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ *  Load the object 9 instance mapping of all the installed applications in the cache, so that
+ *  GetObject9InstanceForApp() is then served locally. The whole map is exported in a single
+ *  request, the applications which are not in it are then looked up in a single transaction.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PrefetchObject9Instances
+(
+    void
+)
+{
+    static char oiidPaths[MAX_OBJ9_NUM][CFG_OIID_PATH_BYTES];
+    static cfgBatch_ReadEntry_t entries[MAX_OBJ9_NUM];
+    appCfg_Iter_t appIterRef = appCfg_CreateAppsIter();
+    char appName[MAX_APP_NAME_BYTES] = "";
+    size_t count = 0;
+
+    while ((count < MAX_OBJ9_NUM) && (LE_OK == appCfg_GetNextItem(appIterRef)))
+    {
+        if (   (LE_OK == appCfg_GetAppName(appIterRef, appName, sizeof(appName)))
+            && (false == IsHiddenApp(appName)))
+        {
+            snprintf(oiidPaths[count], sizeof(oiidPaths[count]), "%s/oiid", appName);
+
+            entries[count].path = oiidPaths[count];
+            entries[count].type = LE_CFG_TYPE_INT;
+            entries[count].intValue = -1;
+            count++;
+        }
+    }
+
+    appCfg_DeleteIter(appIterRef);
+
+    if (LE_OK != cfgBatch_LoadCache(GetObjectMapCache()))
+    {
+        LE_WARN("Can't export the object map, reading it node by node");
+    }
+
+    LE_ASSERT_OK(cfgBatch_CacheRead(GetObjectMapCache(), entries, count));
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  *  Create instances of object 9 and the Legato objects for all currently installed applications.
@@ -649,6 +737,8 @@ static void PopulateAppInfoObjects
 
     int foundAppCount = 0;
 
+    PrefetchObject9Instances();
+
     result = appCfg_GetNextItem(appIterRef);
 
     while (result == LE_OK)
@@ -703,10 +793,10 @@ static void PopulateAppInfoObjects
 
     LE_INFO("Found %d app.", foundAppCount);
 
-    // Now cleanup the lwm2m/objectMap config tree
-    le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(CFG_OBJECT_PATH);
-    le_cfg_DeleteNode(iterRef, CFG_OBJECT_MAP);
-    le_cfg_CommitTxn(iterRef);
+    // Now rebuild the lwm2m/objectMap config tree, in a single transaction
+    cfgBatch_WriteRef_t writeRef;
+    LE_ASSERT_OK(cfgBatch_CreateWrite(CFG_OBJECT_PATH, &writeRef));
+    cfgBatch_DeleteNode(writeRef, CFG_OBJECT_MAP);
 
     while (foundAppCount > 0)
     {
@@ -723,13 +813,20 @@ static void PopulateAppInfoObjects
 
             LE_DEBUG("Mapping app '%s'.", appName);
 
-            SetObject9InstanceForApp(appName, instanceRef);
+            int instanceId;
+            char oiidPath[sizeof(CFG_OBJECT_MAP) + CFG_OIID_PATH_BYTES];
+            LE_ASSERT_OK(assetData_GetInstanceId(instanceRef, &instanceId));
+
+            snprintf(oiidPath, sizeof(oiidPath), CFG_OBJECT_MAP "/%s/oiid", appName);
+            cfgBatch_SetInt(writeRef, oiidPath, instanceId);
             foundAppCount--;
         }
 
         index++;
     }
 
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
+
     // Notify lwm2mcore the list of app objects
     NotifyObj9List();
 }
@@ -1561,6 +1658,13 @@ static void StopStoringPackage
                     LWM2MCORE_SW_UPDATE_RESULT_DOWNLOADED);
        LE_INFO("Download successful");
     }
+    else if (result == LE_FORMAT_ERROR)
+    {
+        SetObj9State(CurrentObj9,
+                     LWM2MCORE_SW_UPDATE_STATE_INITIAL,
+                     LWM2MCORE_SW_UPDATE_RESULT_CHECK_FAILURE);
+        LE_INFO("Download rejected");
+    }
     else
     {
         SetObj9State(CurrentObj9,
@@ -1751,6 +1855,16 @@ static le_result_t StartStoringPackage
             return LE_FAULT;
         }
 
+        // A download file with other links is a complete package kept as a delta base, not an
+        // interrupted download: writing to it would corrupt the base
+        struct stat fileStat;
+        if ((0 != fstat(UpdateStoreFd, &fileStat)) || (fileStat.st_nlink > 1))
+        {
+            LE_ERROR("'%s' is not an interrupted download", downloadFile);
+            fd_Close(UpdateStoreFd);
+            return LE_FAULT;
+        }
+
         // Read the resume offset from the workspace
         result = GetSwUpdateBytesDownloaded(&offset);
 
@@ -1776,11 +1890,10 @@ static le_result_t StartStoringPackage
         // Make a directory
         PrepareDownloadDirectory(AppDownloadPath);
 
-        // Create new download file
-        UpdateStoreFd = open(downloadFile, O_WRONLY | O_TRUNC | O_CREAT, 0);
+        // Create new download file, without truncating a delta base linked to the previous one
+        UpdateStoreFd = deltaPatch_CreateFile(downloadFile, 0);
         if (UpdateStoreFd == -1)
         {
-            LE_ERROR("Unable to open file '%s' for writing (%m).", downloadFile);
             return LE_FAULT;
         }
     }
@@ -1868,6 +1981,74 @@ static void DownloadHandler
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rebuild the complete package if a delta package was downloaded, then keep the complete package
+ * as a base for the next delta packages.
+ *
+ * The delta is applied once downloaded rather than as it is received, so that an interrupted
+ * download can still be resumed from the number of bytes stored.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the delta doesn't apply or the rebuilt package doesn't match its hash
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ExpandDeltaPackage
+(
+    void
+)
+{
+    char downloadFile[MAX_FILE_PATH_BYTES];
+    char targetFile[MAX_FILE_PATH_BYTES];
+    uint8_t magic[DELTAPATCH_MAGIC_LEN];
+    deltaPatch_Stats_t stats;
+    le_result_t result;
+    ssize_t count;
+    int fd;
+
+    le_utf8_Copy(downloadFile, AppDownloadPath, sizeof(downloadFile), NULL);
+    le_utf8_Append(downloadFile, NAME_DOWNLOAD_FILE, sizeof(downloadFile), NULL);
+
+    fd = open(downloadFile, O_RDONLY);
+    if (-1 == fd)
+    {
+        LE_ERROR("Unable to open file '%s' for reading (%m).", downloadFile);
+        return LE_FAULT;
+    }
+    count = read(fd, magic, sizeof(magic));
+    fd_Close(fd);
+
+    if ((count > 0) && deltaPatch_IsDelta(magic, count))
+    {
+        le_utf8_Copy(targetFile, AppDownloadPath, sizeof(targetFile), NULL);
+        le_utf8_Append(targetFile, NAME_DELTA_TARGET_FILE, sizeof(targetFile), NULL);
+
+        result = deltaPatch_ApplyFile(downloadFile, targetFile, SW_DELTA_BASE_DIR, &stats);
+        if (LE_OK != result)
+        {
+            LE_ERROR("Failed to apply delta package: %s", LE_RESULT_TXT(result));
+            unlink(targetFile);
+            return (LE_FAULT == result) ? LE_FAULT : LE_FORMAT_ERROR;
+        }
+
+        LE_INFO("Delta package of %" PRIu64 " bytes applied: %" PRIu64 " bytes copied, %"
+                PRIu64 " bytes added", stats.deltaBytes, stats.copyBytes, stats.addBytes);
+
+        if (-1 == rename(targetFile, downloadFile))
+        {
+            LE_ERROR("Failed to rename '%s' (%m).", targetFile);
+            return LE_FAULT;
+        }
+    }
+
+    // Failing to keep the package only prevents the next delta packages from using it
+    deltaPatch_KeepBase(downloadFile, SW_DELTA_BASE_DIR, SW_DELTA_MAX_BASES);
+
+    return LE_OK;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  *  Handler to start unpack once download completes.
@@ -1878,8 +2059,15 @@ static void UnpackStartHandler
      void* contextPtr
 )
 {
+    le_result_t result = ExpandDeltaPackage();
+
     LE_DEBUG("Stop package store");
-    StopStoringPackage(LE_OK);
+    StopStoringPackage(result);
+
+    if (LE_OK != result)
+    {
+        return;
+    }
 
     LE_DEBUG("Start package unpack");
     avcApp_StartUpdate();
@@ -2682,11 +2870,10 @@ le_result_t avcApp_GetResumePosition
 
         PrepareDownloadDirectory(AppDownloadPath);
 
-        storeFd = open(downloadFile, O_WRONLY | O_TRUNC | O_CREAT, 0);
+        storeFd = deltaPatch_CreateFile(downloadFile, 0);
 
         if (storeFd == -1)
         {
-            LE_ERROR("Unable to open file '%s' for writing (%m).", downloadFile);
             return LE_FAULT;
         }
 
@@ -126,4 +126,40 @@ void avcClient_Init
    void
 );
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the device inventory cache of the LWM2M device object. Should be called only once.
+ */
+//--------------------------------------------------------------------------------------------------
+void avcClient_InitDeviceInventory
+(
+   void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Invalidate the device inventory cache, so that the device object values are read again from the
+ * system
+ */
+//--------------------------------------------------------------------------------------------------
+void avcClient_InvalidateDeviceInventory
+(
+   void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save the LWM2M packets recorded while the packet trace is enabled to a file
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if no packet was recorded
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avcClient_SavePacketTrace
+(
+    const char* pathPtr             ///< [IN] File path
+);
+
 #endif // LEGATO_AVC_CLIENT_INCLUDE_GUARD
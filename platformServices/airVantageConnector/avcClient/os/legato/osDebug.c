@@ -10,6 +10,9 @@
  */
 
 #include "legato.h"
+#include "interfaces.h"
+#include <lwm2mcore/lwm2mcore.h>
+#include "avcClient.h"
 #include "dtls_debug.h"
 
 //--------------------------------------------------------------------------------------------------
@@ -19,6 +22,13 @@
 //--------------------------------------------------------------------------------------------------
 #define DUMP_BUFFER_LEN 80
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of data bytes in a data dump line
+ */
+//--------------------------------------------------------------------------------------------------
+#define DUMP_LINE_BYTES 16
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Define buffer length for log
@@ -26,6 +36,193 @@
 //--------------------------------------------------------------------------------------------------
 #define LOG_BUFFER_LEN 255
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Trace keyword enabling the record of the dumped data (packets) in the trace ring
+ */
+//--------------------------------------------------------------------------------------------------
+#define PACKET_TRACE_KEYWORD "lwm2mPackets"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of records of the trace ring: the oldest records are overwritten
+ */
+//--------------------------------------------------------------------------------------------------
+#define TRACE_RING_COUNT 64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum description length of a trace record, including the final \0
+ */
+//--------------------------------------------------------------------------------------------------
+#define TRACE_DESC_LEN 32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum data length of a trace record: longer data are truncated
+ */
+//--------------------------------------------------------------------------------------------------
+#define TRACE_DATA_LEN 1280
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Magic number at the beginning of a saved trace file.
+ *
+ * The file is made of this magic number, the number of records (uint32_t) and 4 reserved bytes,
+ * followed by the records from the oldest to the newest. Each record is made of the time in ms
+ * (uint64_t), the data length (uint32_t), the recorded data length (uint32_t), the description
+ * (TRACE_DESC_LEN bytes, null-padded) and the recorded data. The integers are little-endian,
+ * whatever the device byte order. The file can be decoded by tools/scripts/avctrace.
+ */
+//--------------------------------------------------------------------------------------------------
+#define TRACE_FILE_MAGIC "LWM2MTR1"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the debug messages of this component are logged: the debug messages are only
+ * formatted if they are not filtered out.
+ */
+//--------------------------------------------------------------------------------------------------
+#define IS_DEBUG_ENABLED()  ((NULL == LE_LOG_LEVEL_FILTER_PTR) || \
+                             (LE_LOG_DEBUG >= *LE_LOG_LEVEL_FILTER_PTR))
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Trace record
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t timeMs;                    ///< Relative time of the record, in ms
+    uint32_t len;                       ///< Data length
+    uint32_t dataLen;                   ///< Recorded data length
+    char     desc[TRACE_DESC_LEN];      ///< Data description
+    uint8_t  data[TRACE_DATA_LEN];      ///< Recorded data
+}
+TraceRecord_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Trace ring, allocated when the first packet is recorded
+ */
+//--------------------------------------------------------------------------------------------------
+static TraceRecord_t* TraceRingPtr;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Total number of records written in the trace ring
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t TraceRecordCount;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Packet trace reference
+ */
+//--------------------------------------------------------------------------------------------------
+static le_log_TraceRef_t PacketTraceRef;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the trace ring, the data can be dumped by several threads
+ */
+//--------------------------------------------------------------------------------------------------
+static pthread_mutex_t TraceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Macros to lock and unlock the trace ring
+ */
+//--------------------------------------------------------------------------------------------------
+#define LOCK()    LE_FATAL_IF((pthread_mutex_lock(&TraceMutex)!=0), \
+                               "Could not lock the mutex")
+#define UNLOCK()  LE_FATAL_IF((pthread_mutex_unlock(&TraceMutex)!=0), \
+                               "Could not unlock the mutex")
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the packet trace is enabled
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsPacketTraceEnabled
+(
+    void
+)
+{
+    if (NULL == PacketTraceRef)
+    {
+        PacketTraceRef = le_log_GetTraceRef(PACKET_TRACE_KEYWORD);
+    }
+    return LE_IS_TRACE_ENABLED(PacketTraceRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record raw data in the trace ring, without any formatting
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordPacket
+(
+    const char* descPtr,            ///< [IN] data description
+    const uint8_t* dataPtr,         ///< [IN] data
+    uint32_t len                    ///< [IN] data length
+)
+{
+    TraceRecord_t* recordPtr;
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    LOCK();
+
+    if (NULL == TraceRingPtr)
+    {
+        TraceRingPtr = calloc(TRACE_RING_COUNT, sizeof(TraceRecord_t));
+        if (NULL == TraceRingPtr)
+        {
+            UNLOCK();
+            LE_ERROR("Unable to allocate the trace ring");
+            return;
+        }
+    }
+
+    recordPtr = &TraceRingPtr[TraceRecordCount % TRACE_RING_COUNT];
+    recordPtr->timeMs = ((uint64_t)now.sec * 1000) + (now.usec / 1000);
+    recordPtr->len = len;
+    recordPtr->dataLen = (len < TRACE_DATA_LEN) ? len : TRACE_DATA_LEN;
+    memset(recordPtr->desc, 0, sizeof(recordPtr->desc));
+    if (NULL != descPtr)
+    {
+        strncpy(recordPtr->desc, descPtr, sizeof(recordPtr->desc) - 1);
+    }
+    memcpy(recordPtr->data, dataPtr, recordPtr->dataLen);
+    TraceRecordCount++;
+
+    UNLOCK();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a little-endian integer to a trace file
+ *
+ * @return true on success
+ */
+//--------------------------------------------------------------------------------------------------
+static bool WriteLittleEndian
+(
+    FILE* filePtr,                  ///< [IN] trace file
+    uint64_t value,                 ///< [IN] integer
+    size_t size                     ///< [IN] integer size in bytes
+)
+{
+    uint8_t bytes[sizeof(uint64_t)];
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+    return (1 == fwrite(bytes, size, 1, filePtr));
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Function for assert
@@ -53,7 +250,7 @@ void lwm2mcore_Assert
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Adaptation function for log
+ * Adaptation function for log. The message is only formatted if the debug messages are logged.
  */
 //--------------------------------------------------------------------------------------------------
 void lwm2m_printf
@@ -65,15 +262,29 @@ void lwm2m_printf
     va_list ap;
     int ret;
     static char strBuffer[LOG_BUFFER_LEN];
-    memset(strBuffer, 0, LOG_BUFFER_LEN);
+
+    if (!IS_DEBUG_ENABLED())
+    {
+        return;
+    }
 
     va_start(ap, format);
     ret = vsnprintf(strBuffer, LOG_BUFFER_LEN, format, ap);
     va_end(ap);
+    if (0 >= ret)
+    {
+        return;
+    }
+    if (LOG_BUFFER_LEN <= ret)
+    {
+        // Truncated message
+        ret = LOG_BUFFER_LEN - 1;
+    }
+
     /* LOG and LOG_ARG macros sets <CR><LF> at the end: remove it */
     if (strBuffer[ret-1] == '\n')
     {
-        if (strBuffer[ret-2] == '\r')
+        if ((ret > 1) && (strBuffer[ret-2] == '\r'))
         {
              strBuffer[ret-2] = '\0';
         }
@@ -87,7 +298,10 @@ void lwm2m_printf
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Adaptation function for log: dump data
+ * Adaptation function for log: dump data.
+ *
+ * The data is recorded in the trace ring if the packet trace is enabled, and dumped in hexadecimal
+ * if the debug messages are logged.
  */
 //--------------------------------------------------------------------------------------------------
 void lwm2mcore_DataDump
@@ -97,12 +311,23 @@ void lwm2mcore_DataDump
     int len                         ///< [IN] Data length
 )
 {
-    int i;
-    unsigned char buffPtr[17];
+    static const char hexDigits[] = "0123456789abcdef";
     unsigned char *pcPtr = (unsigned char*)addrPtr;
-    static char strBuffer[DUMP_BUFFER_LEN];
-    memset(strBuffer, 0, DUMP_BUFFER_LEN);
+    char strBuffer[DUMP_BUFFER_LEN];
+    char* linePtr;
+    int offset;
+    int lineLen;
+    int i;
 
+    if ((NULL != addrPtr) && (0 < len) && IsPacketTraceEnabled())
+    {
+        RecordPacket(descPtr, pcPtr, (uint32_t)len);
+    }
+
+    if (!IS_DEBUG_ENABLED())
+    {
+        return;
+    }
 
     // Output description if given.
     if (NULL != descPtr)
@@ -128,55 +353,142 @@ void lwm2mcore_DataDump
         return;
     }
 
-    // Process every byte in the data.
-    for (i = 0; i < len; i++)
+    // Each line is built in a single pass: offset, hex codes padded to a full line, ASCII bytes.
+    for (offset = 0; offset < len; offset += DUMP_LINE_BYTES)
     {
-        // Multiple of 16 means new line (with line offset).
-        if ((i % 16) == 0)
+        lineLen = ((len - offset) < DUMP_LINE_BYTES) ? (len - offset) : DUMP_LINE_BYTES;
+        linePtr = strBuffer + snprintf(strBuffer, sizeof(strBuffer), "  %04x ", offset);
+
+        for (i = 0; i < DUMP_LINE_BYTES; i++)
         {
-            // Just don't print ASCII for the zeroth line.
-            if (i != 0)
+            *linePtr++ = ' ';
+            if (i < lineLen)
             {
-                snprintf(strBuffer + strlen(strBuffer),
-                         DUMP_BUFFER_LEN - strlen(strBuffer),
-                         "  %s", buffPtr);
-                LE_DEBUG("%s", strBuffer);
-                memset(strBuffer, 0, DUMP_BUFFER_LEN);
+                *linePtr++ = hexDigits[pcPtr[offset + i] >> 4];
+                *linePtr++ = hexDigits[pcPtr[offset + i] & 0x0F];
+            }
+            else
+            {
+                *linePtr++ = ' ';
+                *linePtr++ = ' ';
             }
-
-            // Output the offset.
-            snprintf(strBuffer + strlen(strBuffer),
-                     DUMP_BUFFER_LEN - strlen(strBuffer),
-                     "  %04x ", i);
         }
-        // Now the hex code for the specific character.
-        snprintf(strBuffer + strlen(strBuffer),
-                 DUMP_BUFFER_LEN - strlen(strBuffer),
-                 " %02x", pcPtr[i]);
 
-        // And store a printable ASCII character for later.
-        if ((pcPtr[i] < 0x20) || (pcPtr[i] > 0x7e))
+        *linePtr++ = ' ';
+        *linePtr++ = ' ';
+        for (i = 0; i < lineLen; i++)
         {
-            buffPtr[i % 16] = '.';
+            // Store a printable ASCII character
+            if ((pcPtr[offset + i] < 0x20) || (pcPtr[offset + i] > 0x7e))
+            {
+                *linePtr++ = '.';
+            }
+            else
+            {
+                *linePtr++ = pcPtr[offset + i];
+            }
         }
-        else
+        *linePtr = '\0';
+
+        LE_DEBUG("%s", strBuffer);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save the packets recorded in the trace ring to a file, from the oldest to the newest. See
+ * TRACE_FILE_MAGIC for the file format.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if no packet was recorded
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avcClient_SavePacketTrace
+(
+    const char* pathPtr             ///< [IN] File path
+)
+{
+    le_result_t result = LE_OK;
+    TraceRecord_t* recordPtr;
+    uint32_t count;
+    uint32_t first;
+    uint32_t i;
+    FILE* filePtr;
+    int fd;
+
+    LOCK();
+
+    if (0 == TraceRecordCount)
+    {
+        UNLOCK();
+        return LE_NOT_FOUND;
+    }
+
+    // The packets hold the session data: the file is only readable by the service, and a link
+    // planted at its path is not followed
+    fd = open(pathPtr, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (-1 == fd)
+    {
+        UNLOCK();
+        LE_ERROR("Unable to open %s: %m", pathPtr);
+        return LE_FAULT;
+    }
+
+    // The mode is only set on creation: restrict a file saved before
+    if (0 != fchmod(fd, S_IRUSR | S_IWUSR))
+    {
+        LE_WARN("Unable to restrict the permissions of %s: %m", pathPtr);
+    }
+
+    filePtr = fdopen(fd, "w");
+    if (NULL == filePtr)
+    {
+        UNLOCK();
+        LE_ERROR("Unable to open %s: %m", pathPtr);
+        close(fd);
+        return LE_FAULT;
+    }
+
+    first = (TraceRecordCount > TRACE_RING_COUNT) ? (TraceRecordCount - TRACE_RING_COUNT) : 0;
+    count = TraceRecordCount - first;
+
+    if (   (1 != fwrite(TRACE_FILE_MAGIC, strlen(TRACE_FILE_MAGIC), 1, filePtr))
+        || (!WriteLittleEndian(filePtr, count, sizeof(uint32_t)))
+        || (!WriteLittleEndian(filePtr, 0, sizeof(uint32_t))))
+    {
+        result = LE_FAULT;
+    }
+
+    for (i = first; (LE_OK == result) && (i < TraceRecordCount); i++)
+    {
+        recordPtr = &TraceRingPtr[i % TRACE_RING_COUNT];
+        if (   (!WriteLittleEndian(filePtr, recordPtr->timeMs, sizeof(recordPtr->timeMs)))
+            || (!WriteLittleEndian(filePtr, recordPtr->len, sizeof(recordPtr->len)))
+            || (!WriteLittleEndian(filePtr, recordPtr->dataLen, sizeof(recordPtr->dataLen)))
+            || (1 != fwrite(recordPtr->desc, sizeof(recordPtr->desc), 1, filePtr))
+            || (   (0 != recordPtr->dataLen)
+                && (1 != fwrite(recordPtr->data, recordPtr->dataLen, 1, filePtr))))
         {
-            buffPtr[i % 16] = pcPtr[i];
+            result = LE_FAULT;
         }
-        buffPtr[(i % 16) + 1] = '\0';
     }
 
-    // Pad out last line if not exactly 16 characters.
-    while ((i % 16) != 0)
+    UNLOCK();
+
+    if (0 != fclose(filePtr))
     {
-        snprintf(strBuffer + strlen (strBuffer), DUMP_BUFFER_LEN - strlen(strBuffer), "   ");
-        i++;
+        result = LE_FAULT;
     }
 
-    // And print the final ASCII bit.
-    snprintf(strBuffer + strlen (strBuffer),
-             DUMP_BUFFER_LEN - strlen(strBuffer),
-             "  %s", buffPtr);
-    LE_DEBUG("%s", strBuffer);
+    if (LE_OK != result)
+    {
+        LE_ERROR("Unable to write %s", pathPtr);
+    }
+    else
+    {
+        LE_INFO("%u packets saved to %s", count, pathPtr);
+    }
+    return result;
 }
-
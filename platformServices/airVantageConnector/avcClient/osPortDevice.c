@@ -3,14 +3,21 @@
  *
  * Porting layer for device parameters
  *
+ * The identity and version values of the device object almost never change: they are kept in an
+ * inventory cache, filled at startup, so that a read of the device object is answered from memory
+ * instead of version files and modem requests. An entry is invalidated only by the events which
+ * can change it: SIM state change, radio access technology change or package install.
+ *
  * Copyright (C) Sierra Wireless Inc.
  *
  */
 
+#include <lwm2mcore/lwm2mcore.h>
 #include <lwm2mcore/device.h>
 #include <sys/reboot.h>
 #include "legato.h"
 #include "interfaces.h"
+#include "avcClient.h"
 #include "assetData.h"
 #include <sys/utsname.h>
 #include "avcAppUpdate.h"
@@ -148,6 +155,142 @@
 //--------------------------------------------------------------------------------------------------
 static le_timer_Ref_t LaunchRebootTimer;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Entries of the device inventory cache
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    INVENTORY_FIRMWARE_VERSION,     ///< Composite firmware version
+    INVENTORY_IMEI,                 ///< Module identity
+    INVENTORY_ICCID,                ///< SIM card identifier
+    INVENTORY_SUBSCRIPTION_ID,      ///< Subscription identity (MEID/ESN/IMSI)
+    INVENTORY_MSISDN,               ///< Phone number
+    INVENTORY_MAX
+}
+InventoryEntry_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cached value of an inventory entry
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool    isValid;                    ///< Is the value valid?
+    size_t  len;                        ///< Value length
+    char    value[FW_BUFFER_LENGTH];    ///< Value, null-terminated
+}
+InventoryValue_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Device inventory cache
+ */
+//--------------------------------------------------------------------------------------------------
+static InventoryValue_t Inventory[INVENTORY_MAX];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function pointer to read an inventory entry from the system
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ *      - other lwm2mcore_Sid_t value if the value is not available
+ */
+//--------------------------------------------------------------------------------------------------
+typedef lwm2mcore_Sid_t (*ReadInventory_t)
+(
+    char*   bufferPtr,  ///< [IN]    data buffer pointer
+    size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an inventory entry, from the cache if it is valid, or else from the system.
+ *
+ * Only values which were successfully read are cached: a value not available yet (e.g. SIM not
+ * ready) is read again at the next request.
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ *      - other lwm2mcore_Sid_t value returned by the read function
+ */
+//--------------------------------------------------------------------------------------------------
+static lwm2mcore_Sid_t GetInventoryValue
+(
+    InventoryEntry_t entry,     ///< [IN]    inventory entry
+    ReadInventory_t readFunc,   ///< [IN]    function to read the entry from the system
+    char*   bufferPtr,          ///< [IN]    data buffer pointer
+    size_t* lenPtr              ///< [INOUT] length of input buffer and length of the returned data
+)
+{
+    InventoryValue_t* cachePtr = &Inventory[entry];
+    lwm2mcore_Sid_t sID;
+
+    if ((!bufferPtr) || (!lenPtr))
+    {
+        return LWM2MCORE_ERR_INVALID_ARG;
+    }
+
+    if (!cachePtr->isValid)
+    {
+        // Keep one byte for the final \0
+        cachePtr->len = sizeof(cachePtr->value) - 1;
+        memset(cachePtr->value, 0, sizeof(cachePtr->value));
+
+        sID = readFunc(cachePtr->value, &cachePtr->len);
+        if (LWM2MCORE_ERR_OVERFLOW == sID)
+        {
+            // Value too long to be cached, read it directly in the caller buffer
+            LE_WARN("Inventory entry %d too long to be cached", entry);
+            return readFunc(bufferPtr, lenPtr);
+        }
+        if (LWM2MCORE_ERR_COMPLETED_OK != sID)
+        {
+            return sID;
+        }
+
+        cachePtr->value[cachePtr->len] = '\0';
+        cachePtr->isValid = true;
+    }
+
+    if (*lenPtr < cachePtr->len)
+    {
+        return LWM2MCORE_ERR_OVERFLOW;
+    }
+
+    memcpy(bufferPtr, cachePtr->value, cachePtr->len);
+    if (*lenPtr > cachePtr->len)
+    {
+        bufferPtr[cachePtr->len] = '\0';
+    }
+    *lenPtr = cachePtr->len;
+
+    return LWM2MCORE_ERR_COMPLETED_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Invalidate an inventory entry: it is read again from the system at the next request
+ */
+//--------------------------------------------------------------------------------------------------
+static void InvalidateInventoryValue
+(
+    InventoryEntry_t entry      ///< [IN] inventory entry
+)
+{
+    if (Inventory[entry].isValid)
+    {
+        LE_DEBUG("Invalidate inventory entry %d", entry);
+        Inventory[entry].isValid = false;
+    }
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Function pointer to get a component version
@@ -576,6 +719,41 @@ static size_t GetMcuVersion
     return returnedLen;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler for SIM state changes: the SIM related inventory entries may have changed
+ */
+//--------------------------------------------------------------------------------------------------
+static void SimStateHandler
+(
+    le_sim_Id_t simId,          ///< [IN] SIM identifier
+    le_sim_States_t simState,   ///< [IN] SIM state
+    void* contextPtr            ///< [IN] Context
+)
+{
+    LE_DEBUG("SIM %d state %d", simId, simState);
+
+    InvalidateInventoryValue(INVENTORY_ICCID);
+    InvalidateInventoryValue(INVENTORY_SUBSCRIPTION_ID);
+    InvalidateInventoryValue(INVENTORY_MSISDN);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler for radio access technology changes: the subscription identity depends on it
+ */
+//--------------------------------------------------------------------------------------------------
+static void RatChangeHandler
+(
+    le_mrc_Rat_t rat,           ///< [IN] Radio access technology in use
+    void* contextPtr            ///< [IN] Context
+)
+{
+    LE_DEBUG("RAT %d", rat);
+
+    InvalidateInventoryValue(INVENTORY_SUBSCRIPTION_ID);
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Launch device reboot.
@@ -770,21 +948,16 @@ lwm2mcore_Sid_t lwm2mcore_GetDeviceSerialNumber
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve the device firmware version
- * This API needs to have a procedural treatment
+ * Read the device firmware version from the component version files and the modem
  *
  * @return
  *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
  *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
- *      - LWM2MCORE_ERR_INCORRECT_RANGE if the provided parameters (WRITE operation) is incorrect
- *      - LWM2MCORE_ERR_NOT_YET_IMPLEMENTED if the resource is not yet implemented
- *      - LWM2MCORE_ERR_OP_NOT_SUPPORTED  if the resource is not supported
- *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid in resource handler
- *      - LWM2MCORE_ERR_INVALID_STATE in case of invalid state to treat the resource handler
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid
  *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
  */
 //--------------------------------------------------------------------------------------------------
-lwm2mcore_Sid_t lwm2mcore_GetDeviceFirmwareVersion
+static lwm2mcore_Sid_t ReadFirmwareVersion
 (
     char*   bufferPtr,  ///< [IN]    data buffer pointer
     size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
@@ -813,12 +986,14 @@ lwm2mcore_Sid_t lwm2mcore_GetDeviceFirmwareVersion
     }
 
     LE_DEBUG("remainingLen %d", remainingLen);
+    bufferPtr[0] = '\0';
 
     for (i = 0; i < NUM_ARRAY_MEMBERS(versionInfo); i++)
     {
         if (NULL != versionInfo[i].funcPtr)
         {
             len = versionInfo[i].funcPtr(tmpBufferPtr, FW_BUFFER_LENGTH);
+            len += strlen(versionInfo[i].tagPtr);
             LE_DEBUG("len %d - remainingLen %d", len, remainingLen);
             /* len doesn't contain the final \0
              * remainingLen contains the final \0
@@ -847,6 +1022,31 @@ lwm2mcore_Sid_t lwm2mcore_GetDeviceFirmwareVersion
     return LWM2MCORE_ERR_COMPLETED_OK;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve the device firmware version
+ * This API needs to have a procedural treatment
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
+ *      - LWM2MCORE_ERR_INCORRECT_RANGE if the provided parameters (WRITE operation) is incorrect
+ *      - LWM2MCORE_ERR_NOT_YET_IMPLEMENTED if the resource is not yet implemented
+ *      - LWM2MCORE_ERR_OP_NOT_SUPPORTED  if the resource is not supported
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid in resource handler
+ *      - LWM2MCORE_ERR_INVALID_STATE in case of invalid state to treat the resource handler
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ */
+//--------------------------------------------------------------------------------------------------
+lwm2mcore_Sid_t lwm2mcore_GetDeviceFirmwareVersion
+(
+    char*   bufferPtr,  ///< [IN]    data buffer pointer
+    size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
+)
+{
+    return GetInventoryValue(INVENTORY_FIRMWARE_VERSION, ReadFirmwareVersion, bufferPtr, lenPtr);
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Retrieve the battery level (percentage)
@@ -939,21 +1139,16 @@ lwm2mcore_Sid_t lwm2mcore_GetDeviceCurrentTime
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve the module identity (IMEI)
- * This API needs to have a procedural treatment
+ * Read the module identity (IMEI) from the modem
  *
  * @return
  *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
  *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
- *      - LWM2MCORE_ERR_INCORRECT_RANGE if the provided parameters (WRITE operation) is incorrect
- *      - LWM2MCORE_ERR_NOT_YET_IMPLEMENTED if the resource is not yet implemented
- *      - LWM2MCORE_ERR_OP_NOT_SUPPORTED  if the resource is not supported
- *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid in resource handler
- *      - LWM2MCORE_ERR_INVALID_STATE in case of invalid state to treat the resource handler
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid
  *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
  */
 //--------------------------------------------------------------------------------------------------
-lwm2mcore_Sid_t lwm2mcore_GetDeviceImei
+static lwm2mcore_Sid_t ReadImei
 (
     char*   bufferPtr,  ///< [IN]    data buffer pointer
     size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
@@ -1005,7 +1200,7 @@ lwm2mcore_Sid_t lwm2mcore_GetDeviceImei
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve the SIM card identifier (ICCID)
+ * Retrieve the module identity (IMEI)
  * This API needs to have a procedural treatment
  *
  * @return
@@ -1019,7 +1214,27 @@ lwm2mcore_Sid_t lwm2mcore_GetDeviceImei
  *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
  */
 //--------------------------------------------------------------------------------------------------
-lwm2mcore_Sid_t lwm2mcore_GetIccid
+lwm2mcore_Sid_t lwm2mcore_GetDeviceImei
+(
+    char*   bufferPtr,  ///< [IN]    data buffer pointer
+    size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
+)
+{
+    return GetInventoryValue(INVENTORY_IMEI, ReadImei, bufferPtr, lenPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the SIM card identifier (ICCID) from the modem
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ */
+//--------------------------------------------------------------------------------------------------
+static lwm2mcore_Sid_t ReadIccid
 (
     char*   bufferPtr,  ///< [IN]    data buffer pointer
     size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
@@ -1075,7 +1290,7 @@ lwm2mcore_Sid_t lwm2mcore_GetIccid
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve the subscription identity (MEID/ESN/IMSI)
+ * Retrieve the SIM card identifier (ICCID)
  * This API needs to have a procedural treatment
  *
  * @return
@@ -1089,7 +1304,27 @@ lwm2mcore_Sid_t lwm2mcore_GetIccid
  *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
  */
 //--------------------------------------------------------------------------------------------------
-lwm2mcore_Sid_t lwm2mcore_GetSubscriptionIdentity
+lwm2mcore_Sid_t lwm2mcore_GetIccid
+(
+    char*   bufferPtr,  ///< [IN]    data buffer pointer
+    size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
+)
+{
+    return GetInventoryValue(INVENTORY_ICCID, ReadIccid, bufferPtr, lenPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the subscription identity (MEID/ESN/IMSI) from the modem
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ */
+//--------------------------------------------------------------------------------------------------
+static lwm2mcore_Sid_t ReadSubscriptionIdentity
 (
     char*   bufferPtr,  ///< [IN]    data buffer pointer
     size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
@@ -1223,7 +1458,7 @@ lwm2mcore_Sid_t lwm2mcore_GetSubscriptionIdentity
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve the phone number (MSISDN)
+ * Retrieve the subscription identity (MEID/ESN/IMSI)
  * This API needs to have a procedural treatment
  *
  * @return
@@ -1237,7 +1472,28 @@ lwm2mcore_Sid_t lwm2mcore_GetSubscriptionIdentity
  *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
  */
 //--------------------------------------------------------------------------------------------------
-lwm2mcore_Sid_t lwm2mcore_GetMsisdn
+lwm2mcore_Sid_t lwm2mcore_GetSubscriptionIdentity
+(
+    char*   bufferPtr,  ///< [IN]    data buffer pointer
+    size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
+)
+{
+    return GetInventoryValue(INVENTORY_SUBSCRIPTION_ID, ReadSubscriptionIdentity,
+                             bufferPtr, lenPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the phone number (MSISDN) from the modem
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ */
+//--------------------------------------------------------------------------------------------------
+static lwm2mcore_Sid_t ReadMsisdn
 (
     char*   bufferPtr,  ///< [IN]    data buffer pointer
     size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
@@ -1291,6 +1547,31 @@ lwm2mcore_Sid_t lwm2mcore_GetMsisdn
     return sID;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve the phone number (MSISDN)
+ * This API needs to have a procedural treatment
+ *
+ * @return
+ *      - LWM2MCORE_ERR_COMPLETED_OK if the treatment succeeds
+ *      - LWM2MCORE_ERR_GENERAL_ERROR if the treatment fails
+ *      - LWM2MCORE_ERR_INCORRECT_RANGE if the provided parameters (WRITE operation) is incorrect
+ *      - LWM2MCORE_ERR_NOT_YET_IMPLEMENTED if the resource is not yet implemented
+ *      - LWM2MCORE_ERR_OP_NOT_SUPPORTED  if the resource is not supported
+ *      - LWM2MCORE_ERR_INVALID_ARG if a parameter is invalid in resource handler
+ *      - LWM2MCORE_ERR_INVALID_STATE in case of invalid state to treat the resource handler
+ *      - LWM2MCORE_ERR_OVERFLOW in case of buffer overflow
+ */
+//--------------------------------------------------------------------------------------------------
+lwm2mcore_Sid_t lwm2mcore_GetMsisdn
+(
+    char*   bufferPtr,  ///< [IN]    data buffer pointer
+    size_t* lenPtr      ///< [INOUT] length of input buffer and length of the returned data
+)
+{
+    return GetInventoryValue(INVENTORY_MSISDN, ReadMsisdn, bufferPtr, lenPtr);
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Retrieve the device temperature (in °C)
@@ -1440,3 +1721,56 @@ lwm2mcore_Sid_t lwm2mcore_RebootDevice
 
     return LWM2MCORE_ERR_COMPLETED_OK;
 }
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Invalidate the whole device inventory cache, e.g. after a package install: all the entries are
+ * read again from the system at the next request.
+ */
+//--------------------------------------------------------------------------------------------------
+void avcClient_InvalidateDeviceInventory
+(
+    void
+)
+{
+    InventoryEntry_t entry;
+
+    for (entry = 0; entry < INVENTORY_MAX; entry++)
+    {
+        InvalidateInventoryValue(entry);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the device inventory cache: subscribe to the events invalidating its entries and
+ * collect the entries. Should be called only once.
+ */
+//--------------------------------------------------------------------------------------------------
+void avcClient_InitDeviceInventory
+(
+    void
+)
+{
+    char buffer[FW_BUFFER_LENGTH];
+    size_t len;
+    InventoryEntry_t entry;
+    ReadInventory_t readFunc[INVENTORY_MAX] =
+    {
+        [INVENTORY_FIRMWARE_VERSION] = ReadFirmwareVersion,
+        [INVENTORY_IMEI]             = ReadImei,
+        [INVENTORY_ICCID]            = ReadIccid,
+        [INVENTORY_SUBSCRIPTION_ID]  = ReadSubscriptionIdentity,
+        [INVENTORY_MSISDN]           = ReadMsisdn
+    };
+
+    le_sim_AddNewStateHandler(SimStateHandler, NULL);
+    le_mrc_AddRatChangeHandler(RatChangeHandler, NULL);
+
+    // Entries not available yet are collected at the first request
+    for (entry = 0; entry < INVENTORY_MAX; entry++)
+    {
+        len = sizeof(buffer);
+        GetInventoryValue(entry, readFunc[entry], buffer, &len);
+    }
+}
@@ -3,6 +3,9 @@
  *
  * Porting layer for location parameters
  *
+ * The location resources are served from a snapshot of a single GNSS fix, so that the values of a
+ * location object read are consistent and don't cost one positioning request each.
+ *
  * Copyright (C) Sierra Wireless Inc.
  *
  */
@@ -11,6 +14,106 @@
 #include "legato.h"
 #include "interfaces.h"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Validity of a location snapshot in milliseconds. The resources of a location object read are
+ * requested one after the other: they are all served from the same snapshot.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNAPSHOT_VALIDITY_MS    1000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Location snapshot: all the location resources, taken from a single GNSS fix. The values use the
+ * le_gnss units, and are INT32_MAX or UINT32_MAX when they are not available.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool            isValid;            ///< Snapshot taken
+    le_clk_Time_t   time;               ///< Relative time of the snapshot
+    le_result_t     locationResult;     ///< Result of the latitude and longitude
+    int32_t         latitude;           ///< Latitude, degrees with 6 decimal places
+    int32_t         longitude;          ///< Longitude, degrees with 6 decimal places
+    le_result_t     altitudeResult;     ///< Result of the altitude
+    int32_t         altitude;           ///< Altitude, meters with 3 decimal places
+    le_result_t     directionResult;    ///< Result of the direction
+    uint32_t        direction;          ///< Direction, degrees with 1 decimal place
+    le_result_t     hSpeedResult;       ///< Result of the horizontal speed
+    uint32_t        hSpeed;             ///< Horizontal speed, m/s with 2 decimal places
+    le_result_t     vSpeedResult;       ///< Result of the vertical speed
+    int32_t         vSpeed;             ///< Vertical speed, m/s with 2 decimal places
+    le_result_t     timeResult;         ///< Result of the timestamp
+    uint64_t        epochTime;          ///< Epoch time of the fix in milliseconds
+}
+LocationSnapshot_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last location snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+static LocationSnapshot_t Snapshot;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the location snapshot, taking a new one from the last GNSS fix if the current one is too old
+ *
+ * @return the location snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+static const LocationSnapshot_t* GetSnapshot
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+    le_clk_Time_t validity = { .sec = 0, .usec = SNAPSHOT_VALIDITY_MS * 1000 };
+    le_gnss_SampleRef_t sampleRef;
+    int32_t hAccuracy;
+    int32_t vAccuracy;
+    uint32_t directionAccuracy;
+    uint32_t hSpeedAccuracy;
+    int32_t vSpeedAccuracy;
+
+    if (Snapshot.isValid && le_clk_GreaterThan(le_clk_Add(Snapshot.time, validity), now))
+    {
+        return &Snapshot;
+    }
+
+    Snapshot.time = now;
+    Snapshot.isValid = true;
+
+    sampleRef = le_gnss_GetLastSampleRef();
+    if (!sampleRef)
+    {
+        LE_ERROR("No GNSS sample available");
+        Snapshot.locationResult = LE_FAULT;
+        Snapshot.altitudeResult = LE_FAULT;
+        Snapshot.directionResult = LE_FAULT;
+        Snapshot.hSpeedResult = LE_FAULT;
+        Snapshot.vSpeedResult = LE_FAULT;
+        Snapshot.timeResult = LE_FAULT;
+        return &Snapshot;
+    }
+
+    Snapshot.locationResult = le_gnss_GetLocation(sampleRef, &Snapshot.latitude,
+                                                  &Snapshot.longitude, &hAccuracy);
+    Snapshot.altitudeResult = le_gnss_GetAltitude(sampleRef, &Snapshot.altitude, &vAccuracy);
+    Snapshot.directionResult = le_gnss_GetDirection(sampleRef, &Snapshot.direction,
+                                                    &directionAccuracy);
+    Snapshot.hSpeedResult = le_gnss_GetHorizontalSpeed(sampleRef, &Snapshot.hSpeed,
+                                                       &hSpeedAccuracy);
+    Snapshot.vSpeedResult = le_gnss_GetVerticalSpeed(sampleRef, &Snapshot.vSpeed,
+                                                     &vSpeedAccuracy);
+    Snapshot.timeResult = le_gnss_GetEpochTime(sampleRef, &Snapshot.epochTime);
+
+    // Release provided position sample reference
+    le_gnss_ReleaseSampleRef(sampleRef);
+
+    return &Snapshot;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Retrieve the WSG84 latitude
@@ -34,10 +137,7 @@ lwm2mcore_Sid_t lwm2mcore_GetLatitude
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    int32_t latitude;
-    int32_t longitude;
-    int32_t hAccuracy;
+    const LocationSnapshot_t* snapshotPtr;
     size_t latitudeLen;
 
     if ((!bufferPtr) || (!lenPtr))
@@ -45,14 +145,15 @@ lwm2mcore_Sid_t lwm2mcore_GetLatitude
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    result = le_pos_Get2DLocation(&latitude, &longitude, &hAccuracy);
-    switch (result)
+    snapshotPtr = GetSnapshot();
+    switch (snapshotPtr->locationResult)
     {
         case LE_OK:
         case LE_OUT_OF_RANGE:
-            if (INT32_MAX != latitude)
+            if (INT32_MAX != snapshotPtr->latitude)
             {
-                latitudeLen = snprintf(bufferPtr, *lenPtr, "%.6f", (float)latitude/1e6);
+                latitudeLen = snprintf(bufferPtr, *lenPtr, "%.6f",
+                                       (float)snapshotPtr->latitude/1e6);
                 if (*lenPtr < latitudeLen)
                 {
                     sID = LWM2MCORE_ERR_OVERFLOW;
@@ -101,10 +202,7 @@ lwm2mcore_Sid_t lwm2mcore_GetLongitude
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    int32_t latitude;
-    int32_t longitude;
-    int32_t hAccuracy;
+    const LocationSnapshot_t* snapshotPtr;
     size_t longitudeLen;
 
     if ((!bufferPtr) || (!lenPtr))
@@ -112,14 +210,15 @@ lwm2mcore_Sid_t lwm2mcore_GetLongitude
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    result = le_pos_Get2DLocation(&latitude, &longitude, &hAccuracy);
-    switch (result)
+    snapshotPtr = GetSnapshot();
+    switch (snapshotPtr->locationResult)
     {
         case LE_OK:
         case LE_OUT_OF_RANGE:
-            if (INT32_MAX != longitude)
+            if (INT32_MAX != snapshotPtr->longitude)
             {
-                longitudeLen = snprintf(bufferPtr, *lenPtr, "%.6f", (float)longitude/1e6);
+                longitudeLen = snprintf(bufferPtr, *lenPtr, "%.6f",
+                                        (float)snapshotPtr->longitude/1e6);
                 if (*lenPtr < longitudeLen)
                 {
                     sID = LWM2MCORE_ERR_OVERFLOW;
@@ -168,12 +267,7 @@ lwm2mcore_Sid_t lwm2mcore_GetAltitude
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    int32_t latitude;
-    int32_t longitude;
-    int32_t altitude;
-    int32_t hAccuracy;
-    int32_t vAccuracy;
+    const LocationSnapshot_t* snapshotPtr;
     size_t altitudeLen;
 
     if ((!bufferPtr) || (!lenPtr))
@@ -181,14 +275,15 @@ lwm2mcore_Sid_t lwm2mcore_GetAltitude
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    result = le_pos_Get3DLocation(&latitude, &longitude, &hAccuracy, &altitude, &vAccuracy);
-    switch (result)
+    snapshotPtr = GetSnapshot();
+    switch (snapshotPtr->altitudeResult)
     {
         case LE_OK:
         case LE_OUT_OF_RANGE:
-            if (INT32_MAX != altitude)
+            if (INT32_MAX != snapshotPtr->altitude)
             {
-                altitudeLen = snprintf(bufferPtr, *lenPtr, "%d", altitude);
+                // Altitude in meters
+                altitudeLen = snprintf(bufferPtr, *lenPtr, "%d", snapshotPtr->altitude/1000);
                 if (*lenPtr < altitudeLen)
                 {
                     sID = LWM2MCORE_ERR_OVERFLOW;
@@ -236,23 +331,22 @@ lwm2mcore_Sid_t lwm2mcore_GetDirection
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    uint32_t direction;
-    uint32_t directionAccuracy;
+    const LocationSnapshot_t* snapshotPtr;
 
     if (!valuePtr)
     {
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    result = le_pos_GetDirection(&direction, &directionAccuracy);
-    switch (result)
+    snapshotPtr = GetSnapshot();
+    switch (snapshotPtr->directionResult)
     {
         case LE_OK:
         case LE_OUT_OF_RANGE:
-            if (UINT32_MAX != direction)
+            if (UINT32_MAX != snapshotPtr->direction)
             {
-                *valuePtr = direction;
+                // Direction in degrees
+                *valuePtr = snapshotPtr->direction/10;
                 sID = LWM2MCORE_ERR_COMPLETED_OK;
             }
             else
@@ -293,25 +387,22 @@ lwm2mcore_Sid_t lwm2mcore_GetHorizontalSpeed
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    uint32_t hSpeed;
-    uint32_t hSpeedAccuracy;
-    int32_t  vSpeed;
-    int32_t  vSpeedAccuracy;
+    const LocationSnapshot_t* snapshotPtr;
 
     if (!valuePtr)
     {
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    result = le_pos_GetMotion(&hSpeed, &hSpeedAccuracy, &vSpeed, &vSpeedAccuracy);
-    switch (result)
+    snapshotPtr = GetSnapshot();
+    switch (snapshotPtr->hSpeedResult)
     {
         case LE_OK:
         case LE_OUT_OF_RANGE:
-            if (UINT32_MAX != hSpeed)
+            if (UINT32_MAX != snapshotPtr->hSpeed)
             {
-                *valuePtr = hSpeed;
+                // Horizontal speed in m/s
+                *valuePtr = snapshotPtr->hSpeed/100;
                 sID = LWM2MCORE_ERR_COMPLETED_OK;
             }
             else
@@ -352,25 +443,22 @@ lwm2mcore_Sid_t lwm2mcore_GetVerticalSpeed
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    uint32_t hSpeed;
-    uint32_t hSpeedAccuracy;
-    int32_t  vSpeed;
-    int32_t  vSpeedAccuracy;
+    const LocationSnapshot_t* snapshotPtr;
 
     if (!valuePtr)
     {
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    result = le_pos_GetMotion(&hSpeed, &hSpeedAccuracy, &vSpeed, &vSpeedAccuracy);
-    switch (result)
+    snapshotPtr = GetSnapshot();
+    switch (snapshotPtr->vSpeedResult)
     {
         case LE_OK:
         case LE_OUT_OF_RANGE:
-            if (INT32_MAX != vSpeed)
+            if (INT32_MAX != snapshotPtr->vSpeed)
             {
-                *valuePtr = vSpeed;
+                // Vertical speed in m/s
+                *valuePtr = snapshotPtr->vSpeed/100;
                 sID = LWM2MCORE_ERR_COMPLETED_OK;
             }
             else
@@ -410,21 +498,19 @@ lwm2mcore_Sid_t lwm2mcore_GetLocationTimestamp
 )
 {
     lwm2mcore_Sid_t sID;
-    le_result_t result;
-    uint64_t milliseconds;
+    const LocationSnapshot_t* snapshotPtr;
 
     if (!valuePtr)
     {
         return LWM2MCORE_ERR_INVALID_ARG;
     }
 
-    // Get Epoch time of last position sample
-    le_gnss_SampleRef_t positionSampleRef = le_gnss_GetLastSampleRef();
-    result = le_gnss_GetEpochTime(positionSampleRef, &milliseconds);
-    if (LE_OK == result)
+    // Get Epoch time of the snapshot position sample
+    snapshotPtr = GetSnapshot();
+    if (LE_OK == snapshotPtr->timeResult)
     {
         // Convert value to seconds
-        *valuePtr = milliseconds / 1000;
+        *valuePtr = snapshotPtr->epochTime / 1000;
         sID = LWM2MCORE_ERR_COMPLETED_OK;
     }
     else
@@ -432,9 +518,6 @@ lwm2mcore_Sid_t lwm2mcore_GetLocationTimestamp
         sID = LWM2MCORE_ERR_NOT_YET_IMPLEMENTED;
     }
 
-    // Release provided position sample reference
-    le_gnss_ReleaseSampleRef(positionSampleRef);
-
     LE_DEBUG("lwm2mcore_LocationTimestamp result: %d", sID);
     return sID;
 }
@@ -670,22 +670,30 @@ lwm2mcore_Sid_t lwm2mcore_UpdateSslCertificate
             LE_ERROR("Failed to delete certificate file");
             return LWM2MCORE_ERR_GENERAL_ERROR;
         }
-        return LWM2MCORE_ERR_COMPLETED_OK;
     }
+    else
+    {
+        memcpy(cert, certPtr, len);
 
-    memcpy(cert, certPtr, len);
+        len = ssl_LayOutPEM(cert, len);
+        if (-1 == len)
+        {
+            LE_ERROR("ssl_LayOutPEM failed");
+            return LWM2MCORE_ERR_GENERAL_ERROR;
+        }
 
-    len = ssl_LayOutPEM(cert, len);
-    if (-1 == len)
-    {
-        LE_ERROR("ssl_LayOutPEM failed");
-        return LWM2MCORE_ERR_GENERAL_ERROR;
+        result = WriteFs(SSLCERT_PATH, cert, len);
+        if (LE_OK != result)
+        {
+            LE_ERROR("Failed to update certificate file");
+            return LWM2MCORE_ERR_GENERAL_ERROR;
+        }
     }
 
-    result = WriteFs(SSLCERT_PATH, cert, len);
-    if (LE_OK != result)
+    // Reload the trust anchors kept in memory by the package downloader
+    if (LE_OK != ssl_CheckCertificate())
     {
-        LE_ERROR("Failed to update certificate file");
+        LE_ERROR("Failed to load the updated certificate");
         return LWM2MCORE_ERR_GENERAL_ERROR;
     }
 
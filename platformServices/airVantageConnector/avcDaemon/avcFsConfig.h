@@ -68,6 +68,13 @@
 //--------------------------------------------------------------------------------------------------
 #define FW_UPDATE_INSTALL_PENDING_PATH      FW_UPDATE_INFO_DIR "/" "isInstallPending"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Firmware update delta package path: present while a delta package is downloaded
+ */
+//--------------------------------------------------------------------------------------------------
+#define FW_UPDATE_DELTA_PATH                FW_UPDATE_INFO_DIR "/" "isDelta"
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Software update state path
@@ -147,9 +154,31 @@
 
 //--------------------------------------------------------------------------------------------------
 /**
- * PEM certificate file path
+ * Delta package base directory. It must be on the file system of the application download
+ * directory, so that the downloaded packages can be kept as bases by hard links.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DELTA_BASE_DIR                      "/legato/deltaBase"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Firmware delta package base directory, provisioned with the installed firmware package
+ */
+//--------------------------------------------------------------------------------------------------
+#define FW_DELTA_BASE_DIR                   DELTA_BASE_DIR "/" "fw"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Application delta package base directory, holding the last application packages downloaded
+ */
+//--------------------------------------------------------------------------------------------------
+#define SW_DELTA_BASE_DIR                   DELTA_BASE_DIR "/" "sw"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of application packages kept as delta bases
  */
 //--------------------------------------------------------------------------------------------------
-#define PEMCERT_PATH                        PKGDWL_TMP_PATH "/" "cert.pem"
+#define SW_DELTA_MAX_BASES                  8
 
 #endif /* _AVCFSCONFIG_H */
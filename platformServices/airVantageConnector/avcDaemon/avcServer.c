@@ -22,6 +22,7 @@
 #include "avcAppUpdate.h"
 #include "packageDownloader.h"
 #include "packageDownloaderCallbacks.h"
+#include "cfgBatch.h"
 
 //--------------------------------------------------------------------------------------------------
 // Definitions
@@ -69,6 +70,13 @@
 //--------------------------------------------------------------------------------------------------
 #define SECONDS_IN_A_MIN 60
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * File where the LWM2M packets recorded by the packet trace are saved at the end of a session
+ */
+//--------------------------------------------------------------------------------------------------
+#define PACKET_TRACE_PATH "/tmp/avcPacketTrace.bin"
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Current internal state.
@@ -405,12 +413,37 @@ static uint16_t RetryTimers[LE_AVC_NUM_RETRY_TIMERS] = {15, 60, 240, 480, 1440,
 // ------------------------------------------------------------------------------------------------
 static le_timer_Ref_t PollingTimerRef = NULL;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ *  Read cache of the AVC configuration, created on first use and deleted when the daemon stops.
+ */
+//--------------------------------------------------------------------------------------------------
+static cfgBatch_CacheRef_t ConfigCacheRef = NULL;
+
 
 //--------------------------------------------------------------------------------------------------
 // Local functions
 //--------------------------------------------------------------------------------------------------
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the read cache of the AVC configuration
+ */
+//--------------------------------------------------------------------------------------------------
+static cfgBatch_CacheRef_t GetConfigCache
+(
+    void
+)
+{
+    if (NULL == ConfigCacheRef)
+    {
+        LE_ASSERT_OK(cfgBatch_CreateCache(CFG_AVC_CONFIG_PATH, &ConfigCacheRef));
+    }
+
+    return ConfigCacheRef;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Check to see if le_avc is bound to a client.
@@ -839,9 +872,16 @@ void avcServer_UpdateHandler
             break;
 
         case LE_AVC_NO_UPDATE:
+            // There is no longer any current update, so go back to idle
+            CurrentState = AVC_IDLE;
+            break;
+
         case LE_AVC_INSTALL_COMPLETE:
             // There is no longer any current update, so go back to idle
             CurrentState = AVC_IDLE;
+
+            // The installed package may have changed the device versions
+            avcClient_InvalidateDeviceInventory();
             break;
 
         case LE_AVC_DOWNLOAD_FAILED:
@@ -868,6 +908,12 @@ void avcServer_UpdateHandler
             avcClient_StopActivityTimer();
             // These events do not cause a state transition
             avData_ReportSessionState(LE_AVDATA_SESSION_STOPPED);
+
+            if (LE_AVC_SESSION_STOPPED == updateStatus)
+            {
+                // Keep the packets of the session, if they were recorded
+                avcClient_SavePacketTrace(PACKET_TRACE_PATH);
+            }
             break;
 
         default:
@@ -1381,17 +1427,34 @@ static void StartPollingTimer
     // Polling timer, in minutes.
     uint32_t pollingTimer = 0;
 
+    // Read both nodes in one transaction, or from the cache if they didn't change since the last
+    // time. le_avc_GetPollingTimer() is then served from the cache.
+    cfgBatch_ReadEntry_t entries[] =
+    {
+        { .path = "pollingTimer", .type = LE_CFG_TYPE_INT },
+        { .path = "pollingTimerSavedTimeSinceEpoch", .type = LE_CFG_TYPE_INT },
+    };
+    cfgBatch_ReadEntry_t* savedTimePtr = &entries[1];
+
+    LE_ASSERT_OK(cfgBatch_CacheRead(GetConfigCache(), entries, NUM_ARRAY_MEMBERS(entries)));
+
     // Since SetDefaultAVMSConfig() has already been called prior to StartPollingTimer(),
     // GetPollingTimer must return LE_OK.
     LE_ASSERT(LE_OK == le_avc_GetPollingTimer(&pollingTimer));
 
+    // The writes are grouped in one transaction, which is not created if there is nothing to
+    // write.
+    cfgBatch_WriteRef_t writeRef;
+    LE_ASSERT_OK(cfgBatch_CreateWrite(CFG_AVC_CONFIG_PATH, &writeRef));
+
     if (0 == pollingTimer)
     {
         LE_INFO("Polling Timer disabled. AVC session will not be started periodically.");
 
-        le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(CFG_AVC_CONFIG_PATH);
-        le_cfg_DeleteNode(iterRef, "pollingTimerSavedTimeSinceEpoch");
-        le_cfg_CommitTxn(iterRef);
+        if (LE_NOT_FOUND != savedTimePtr->result)
+        {
+            cfgBatch_DeleteNode(writeRef, "pollingTimerSavedTimeSinceEpoch");
+        }
     }
     else
     {
@@ -1402,20 +1465,17 @@ static void StartPollingTimer
         // Time elapsed since last poll
         time_t timeElapsed = 0;
 
-        le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(CFG_AVC_CONFIG_PATH);
-
         // This is the first time ever, since no saved time can be found.
-        if (le_cfg_IsEmpty(iterRef, "pollingTimerSavedTimeSinceEpoch"))
+        if (LE_NOT_FOUND == savedTimePtr->result)
         {
             // Save the current time.
-            le_cfg_SetInt(iterRef, "pollingTimerSavedTimeSinceEpoch", currentTime);
+            cfgBatch_SetInt(writeRef, "pollingTimerSavedTimeSinceEpoch", currentTime);
             // Start a session.
             avcClient_Connect();
         }
         else
         {
-            timeElapsed = currentTime - le_cfg_GetInt(iterRef,
-                                                      "pollingTimerSavedTimeSinceEpoch", 0);
+            timeElapsed = currentTime - savedTimePtr->intValue;
 
             // If time difference is negative, maybe the system time was altered.
             // If the time difference exceeds the polling timer, then that means the current polling
@@ -1426,7 +1486,7 @@ static void StartPollingTimer
                 timeElapsed = 0;
 
                 // Save the current time.
-                le_cfg_SetInt(iterRef, "pollingTimerSavedTimeSinceEpoch", currentTime);
+                cfgBatch_SetInt(writeRef, "pollingTimerSavedTimeSinceEpoch", currentTime);
                 // Start a session.
                 avcClient_Connect();
             }
@@ -1444,9 +1504,9 @@ static void StartPollingTimer
         LE_ASSERT(LE_OK == le_timer_SetInterval(PollingTimerRef, interval));
         LE_ASSERT(LE_OK == le_timer_SetHandler(PollingTimerRef, StartPollingTimer));
         LE_ASSERT(LE_OK == le_timer_Start(PollingTimerRef));
-
-        le_cfg_CommitTxn(iterRef);
     }
+
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -2815,17 +2875,16 @@ le_result_t le_avc_GetPollingTimer
     uint32_t* pollingTimerPtr  ///< [OUT] Polling timer
 )
 {
-    le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(CFG_AVC_CONFIG_PATH);
+    cfgBatch_ReadEntry_t entry = { .path = "pollingTimer", .type = LE_CFG_TYPE_INT };
+
+    LE_ASSERT_OK(cfgBatch_CacheRead(GetConfigCache(), &entry, 1));
 
-    if (le_cfg_IsEmpty(iterRef, "pollingTimer"))
+    if (LE_OK != entry.result)
     {
-        le_cfg_CancelTxn(iterRef);
         return LE_FAULT;
     }
 
-    uint32_t pollingTimerCfg = le_cfg_GetInt(iterRef, "pollingTimer", 0);
-
-    le_cfg_CancelTxn(iterRef);
+    uint32_t pollingTimerCfg = entry.intValue;
 
     if ((pollingTimerCfg < LE_AVC_POLLING_TIMER_MIN_VAL) ||
         (pollingTimerCfg > LE_AVC_POLLING_TIMER_MAX_VAL))
@@ -2864,11 +2923,18 @@ le_result_t le_avc_SetPollingTimer
         return LE_OUT_OF_RANGE;
     }
 
+    // Read the previous value in the write transaction: the cached one may be outdated by a
+    // change which is not notified yet.
     le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(CFG_AVC_CONFIG_PATH);
     uint32_t existingPollingTimerCfg = le_cfg_GetInt(iterRef, "pollingTimer", 0);
     le_cfg_SetInt(iterRef, "pollingTimer", pollingTimer);
     le_cfg_CommitTxn(iterRef);
 
+    if (NULL != ConfigCacheRef)
+    {
+        cfgBatch_FlushCache(ConfigCacheRef);
+    }
+
     // Start the polling timer if the config transitions from 0 to non-0. Note that we can't look at
     // if the timer is running, because it's possible that this function is called at the small
     // window between the current polling timer stopping and the next polling timer starting.
@@ -3048,6 +3114,25 @@ bool IsDownloadAccepted
     return DownloadAgreement;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * SIGTERM handler: the daemon is being stopped, drop the configuration cache along with its change
+ * notifications before exiting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SigTermHandler
+(
+    int sigNum
+)
+{
+    LE_INFO("AVC daemon stopping");
+
+    cfgBatch_DeleteCache(ConfigCacheRef);
+    ConfigCacheRef = NULL;
+
+    exit(EXIT_SUCCESS);
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Initialization function for AVC Daemon
@@ -3065,6 +3150,10 @@ COMPONENT_INIT
     // Add a handler for client session closes
     le_msg_AddServiceCloseHandler( le_avc_GetServiceRef(), ClientCloseSessionHandler, NULL );
 
+    // The configuration cache lives as long as the daemon
+    le_sig_Block(SIGTERM);
+    le_sig_SetEventHandler(SIGTERM, SigTermHandler);
+
     // Init shared timer for deferring app install
     InstallDeferTimer = le_timer_Create("install defer timer");
     le_timer_SetHandler(InstallDeferTimer, InstallTimerExpiryHandler);
@@ -3089,6 +3178,7 @@ COMPONENT_INIT
     timeSeries_Init();
     push_Init();
     avcClient_Init();
+    avcClient_InitDeviceInventory();
 
     // Read the user defined timeout from config tree @ /apps/avcService/activityTimeout
     le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(AVC_SERVICE_CFG);
@@ -0,0 +1,1174 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Batched config tree transactions and client-side read cache.
+ *
+ * A config tree transaction costs a request to create it and one to commit or cancel it, and a
+ * committed write transaction is saved by the config tree. Grouping the accesses to a subtree in
+ * one transaction removes those costs for all but the first access; each node read or written
+ * is still one request. The cache removes the requests entirely for the nodes read again while
+ * the subtree is unchanged.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "cfgBatch.h"
+#include "cfgBatchLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of nodes in a cache. When it is full, the least recently used node is evicted.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_CACHED_NODES    512
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Operation recorded in a write batch
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_dls_Link_t     link;                         ///< Link in the batch operation list
+    le_cfg_nodeType_t type;                         ///< Type of the value, empty to delete
+    char              path[CFGBATCH_PATH_MAX_BYTES];///< Node path
+    int32_t           intValue;                     ///< Integer value
+    bool              boolValue;                    ///< Boolean value
+    double            floatValue;                   ///< Floating point value
+    char*             strPtr;                       ///< String value, from the string pool
+}
+WriteOp_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write batch
+ */
+//--------------------------------------------------------------------------------------------------
+struct cfgBatch_Write
+{
+    char          basePath[LE_CFG_STR_LEN_BYTES];   ///< Base path of the transaction
+    le_dls_List_t opList;                           ///< Operations, in recording order
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Node stored in a cache
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_dls_Link_t     link;                         ///< Link in the cache node list
+    char              path[CFGBATCH_PATH_MAX_BYTES];///< Node path, key in the node map
+    le_cfg_nodeType_t type;                         ///< Type the node was read as
+    le_result_t       result;                       ///< LE_OK, LE_NOT_FOUND or LE_FORMAT_ERROR
+    int32_t           intValue;                     ///< Integer value
+    bool              boolValue;                    ///< Boolean value
+    double            floatValue;                   ///< Floating point value
+    char*             strPtr;                       ///< String value, from the string pool
+}
+CachedNode_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read cache
+ */
+//--------------------------------------------------------------------------------------------------
+struct cfgBatch_Cache
+{
+    le_dls_Link_t             link;                             ///< Link in the cache list
+    char                      basePath[LE_CFG_STR_LEN_BYTES];   ///< Base path of the nodes
+    le_hashmap_Ref_t          nodeMap;                          ///< Cached nodes by path
+    le_dls_List_t             nodeList;                         ///< Cached nodes, least
+                                                                ///< recently used first
+    size_t                    nodeCount;                        ///< Number of cached nodes
+    le_cfg_ChangeHandlerRef_t handlerRef;                       ///< Change notification handler
+    cfgBatch_CacheStats_t     stats;                            ///< Statistics
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for write batches
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t WritePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for write batch operations
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t WriteOpPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for caches
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t CachePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for cached nodes
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t CachedNodePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for string values, only allocated for string nodes
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t StringPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Caches of this client, flushed by the write batches committed under their base path
+ */
+//--------------------------------------------------------------------------------------------------
+static le_dls_List_t CacheList = LE_DLS_LIST_INIT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deleted caches, reused by the next caches created: a hashmap can't be deleted
+ */
+//--------------------------------------------------------------------------------------------------
+static le_dls_List_t FreeCacheList = LE_DLS_LIST_INIT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the memory pools on first use
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitPools
+(
+    void
+)
+{
+    if (NULL == WritePool)
+    {
+        WritePool = le_mem_CreatePool("CfgBatchWritePool", sizeof(struct cfgBatch_Write));
+        WriteOpPool = le_mem_CreatePool("CfgBatchWriteOpPool", sizeof(WriteOp_t));
+        CachePool = le_mem_CreatePool("CfgBatchCachePool", sizeof(struct cfgBatch_Cache));
+        CachedNodePool = le_mem_CreatePool("CfgBatchCachedNodePool", sizeof(CachedNode_t));
+        StringPool = le_mem_CreatePool("CfgBatchStringPool", LE_CFG_STR_LEN_BYTES);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Length of a path without its trailing separators
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t TrimmedPathLen
+(
+    const char* pathPtr
+)
+{
+    size_t len = strlen(pathPtr);
+
+    while ((len > 0) && ('/' == pathPtr[len - 1]))
+    {
+        len--;
+    }
+
+    return len;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a path is the parent, a child or the same node as another one
+ *
+ * @return true if the subtrees overlap
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PathsOverlap
+(
+    const char* path1Ptr,
+    const char* path2Ptr
+)
+{
+    // A path naming its tree and one using the default tree can't be compared.
+    if ((NULL != strchr(path1Ptr, ':')) != (NULL != strchr(path2Ptr, ':')))
+    {
+        return true;
+    }
+
+    size_t len1 = TrimmedPathLen(path1Ptr);
+    size_t len2 = TrimmedPathLen(path2Ptr);
+    size_t len = (len1 < len2) ? len1 : len2;
+
+    if (0 != strncmp(path1Ptr, path2Ptr, len))
+    {
+        return false;
+    }
+
+    // The shorter path must end on a node boundary of the longer one.
+    return (len1 == len2) || ('/' == ((len1 > len2) ? path1Ptr[len] : path2Ptr[len]));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a read entry before submitting it
+ *
+ * @return true if the entry can be read
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsValidEntry
+(
+    const cfgBatch_ReadEntry_t* entryPtr
+)
+{
+    if (NULL == entryPtr->path)
+    {
+        return false;
+    }
+
+    switch (entryPtr->type)
+    {
+        case LE_CFG_TYPE_INT:
+        case LE_CFG_TYPE_BOOL:
+        case LE_CFG_TYPE_FLOAT:
+            return true;
+
+        case LE_CFG_TYPE_STRING:
+            return (NULL != entryPtr->strPtr) && (0 != entryPtr->strSize);
+
+        default:
+            return false;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a node can be read as a given type. Otherwise the config tree would return the
+ * default value given by the reader.
+ *
+ * @return true if the value can be read
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsConvertible
+(
+    le_cfg_nodeType_t readType,     ///< Type the node is read as
+    le_cfg_nodeType_t nodeType      ///< Type of the node in the tree
+)
+{
+    switch (nodeType)
+    {
+        case LE_CFG_TYPE_INT:
+        case LE_CFG_TYPE_FLOAT:
+            // Numbers are converted to each other, and any value can be read as a string.
+            return (LE_CFG_TYPE_INT == readType) || (LE_CFG_TYPE_FLOAT == readType) ||
+                   (LE_CFG_TYPE_STRING == readType);
+
+        case LE_CFG_TYPE_STEM:
+            return false;
+
+        default:
+            return (nodeType == readType) || (LE_CFG_TYPE_STRING == readType);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a node in an open transaction
+ *
+ * The entry result is LE_FORMAT_ERROR, and its value is left untouched, if the node can't be read
+ * as the entry type.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadNode
+(
+    le_cfg_IteratorRef_t  iterRef,
+    cfgBatch_ReadEntry_t* entryPtr
+)
+{
+    le_cfg_nodeType_t nodeType = le_cfg_GetNodeType(iterRef, entryPtr->path);
+
+    switch (nodeType)
+    {
+        case LE_CFG_TYPE_EMPTY:
+        case LE_CFG_TYPE_DOESNT_EXIST:
+            entryPtr->result = LE_NOT_FOUND;
+            return;
+
+        default:
+            break;
+    }
+
+    if (!IsConvertible(entryPtr->type, nodeType))
+    {
+        entryPtr->result = LE_FORMAT_ERROR;
+        return;
+    }
+
+    entryPtr->result = LE_OK;
+
+    switch (entryPtr->type)
+    {
+        case LE_CFG_TYPE_INT:
+            entryPtr->intValue = le_cfg_GetInt(iterRef, entryPtr->path, entryPtr->intValue);
+            break;
+
+        case LE_CFG_TYPE_BOOL:
+            entryPtr->boolValue = le_cfg_GetBool(iterRef, entryPtr->path, entryPtr->boolValue);
+            break;
+
+        case LE_CFG_TYPE_FLOAT:
+            entryPtr->floatValue = le_cfg_GetFloat(iterRef, entryPtr->path, entryPtr->floatValue);
+            break;
+
+        case LE_CFG_TYPE_STRING:
+            entryPtr->result = le_cfg_GetString(iterRef,
+                                                entryPtr->path,
+                                                entryPtr->strPtr,
+                                                entryPtr->strSize,
+                                                "");
+            break;
+
+        default:
+            entryPtr->result = LE_BAD_PARAMETER;
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy a cached node to a read entry
+ */
+//--------------------------------------------------------------------------------------------------
+static void CopyCachedNode
+(
+    const CachedNode_t*   nodePtr,
+    cfgBatch_ReadEntry_t* entryPtr
+)
+{
+    if (LE_OK != nodePtr->result)
+    {
+        entryPtr->result = nodePtr->result;
+        return;
+    }
+
+    entryPtr->result = LE_OK;
+
+    switch (entryPtr->type)
+    {
+        case LE_CFG_TYPE_INT:
+            entryPtr->intValue = nodePtr->intValue;
+            break;
+
+        case LE_CFG_TYPE_BOOL:
+            entryPtr->boolValue = nodePtr->boolValue;
+            break;
+
+        case LE_CFG_TYPE_FLOAT:
+            entryPtr->floatValue = nodePtr->floatValue;
+            break;
+
+        default:
+            entryPtr->result = le_utf8_Copy(entryPtr->strPtr,
+                                            nodePtr->strPtr,
+                                            entryPtr->strSize,
+                                            NULL);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a cached node and its string value
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReleaseCachedNode
+(
+    CachedNode_t* nodePtr
+)
+{
+    if (NULL != nodePtr->strPtr)
+    {
+        le_mem_Release(nodePtr->strPtr);
+    }
+
+    le_mem_Release(nodePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a node from a cache and release it
+ */
+//--------------------------------------------------------------------------------------------------
+static void RemoveCachedNode
+(
+    cfgBatch_CacheRef_t cacheRef,
+    CachedNode_t*       nodePtr
+)
+{
+    le_hashmap_Remove(cacheRef->nodeMap, nodePtr->path);
+    le_dls_Remove(&cacheRef->nodeList, &nodePtr->link);
+    cacheRef->nodeCount--;
+    ReleaseCachedNode(nodePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a write operation and its string value
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReleaseWriteOp
+(
+    WriteOp_t* opPtr
+)
+{
+    if (NULL != opPtr->strPtr)
+    {
+        le_mem_Release(opPtr->strPtr);
+    }
+
+    le_mem_Release(opPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Config tree change notification: the cached nodes may be outdated
+ */
+//--------------------------------------------------------------------------------------------------
+static void CacheChangeHandler
+(
+    void* contextPtr
+)
+{
+    cfgBatch_FlushCache(contextPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate a write operation and append it to a batch
+ *
+ * @return the operation, NULL if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+static WriteOp_t* AddWriteOp
+(
+    cfgBatch_WriteRef_t writeRef,
+    const char*         pathPtr,
+    le_cfg_nodeType_t   type
+)
+{
+    LE_ASSERT(writeRef != NULL);
+    LE_ASSERT(pathPtr != NULL);
+
+    WriteOp_t* opPtr = le_mem_ForceAlloc(WriteOpPool);
+
+    if (LE_OK != le_utf8_Copy(opPtr->path, pathPtr, sizeof(opPtr->path), NULL))
+    {
+        le_mem_Release(opPtr);
+        return NULL;
+    }
+
+    opPtr->link = LE_DLS_LINK_INIT;
+    opPtr->type = type;
+    opPtr->strPtr = NULL;
+    le_dls_Queue(&writeRef->opList, &opPtr->link);
+
+    return opPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the leaves of a snapshot node to a cache, until it is full
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadSnapshotNode
+(
+    cfgBatch_CacheRef_t        cacheRef,
+    cfgBatch_SnapshotNodeRef_t snapshotNodeRef,
+    char*                      pathPtr,         ///< Path of the node, extended for its children
+    size_t                     pathLen
+)
+{
+    cfgBatch_SnapshotNodeRef_t childRef;
+
+    for (childRef = cfgBatch_GetFirstChild(snapshotNodeRef);
+         (NULL != childRef) && (cacheRef->nodeCount < MAX_CACHED_NODES);
+         childRef = cfgBatch_GetNextSibling(childRef))
+    {
+        int len = snprintf(pathPtr + pathLen,
+                           CFGBATCH_PATH_MAX_BYTES - pathLen,
+                           "%s%s",
+                           (0 == pathLen) ? "" : "/",
+                           cfgBatch_GetNodeName(childRef));
+
+        if ((len < 0) || (pathLen + len >= CFGBATCH_PATH_MAX_BYTES))
+        {
+            // Too long to be cached.
+            continue;
+        }
+
+        le_cfg_nodeType_t type = cfgBatch_GetNodeType(childRef);
+
+        if (LE_CFG_TYPE_STEM == type)
+        {
+            LoadSnapshotNode(cacheRef, childRef, pathPtr, pathLen + len);
+            continue;
+        }
+
+        if (   (LE_CFG_TYPE_EMPTY == type)
+            || (NULL != le_hashmap_Get(cacheRef->nodeMap, pathPtr)))
+        {
+            continue;
+        }
+
+        CachedNode_t* nodePtr = le_mem_ForceAlloc(CachedNodePool);
+        LE_ASSERT_OK(le_utf8_Copy(nodePtr->path, pathPtr, sizeof(nodePtr->path), NULL));
+        nodePtr->type = type;
+        nodePtr->result = LE_OK;
+        nodePtr->intValue = cfgBatch_GetNodeInt(childRef, 0);
+        nodePtr->boolValue = cfgBatch_GetNodeBool(childRef, false);
+        nodePtr->floatValue = cfgBatch_GetNodeFloat(childRef, 0.0);
+        nodePtr->strPtr = NULL;
+
+        if (LE_CFG_TYPE_STRING == type)
+        {
+            nodePtr->strPtr = le_mem_ForceAlloc(StringPool);
+            LE_ASSERT_OK(le_utf8_Copy(nodePtr->strPtr,
+                                      cfgBatch_GetNodeString(childRef, ""),
+                                      LE_CFG_STR_LEN_BYTES,
+                                      NULL));
+        }
+
+        nodePtr->link = LE_DLS_LINK_INIT;
+        le_dls_Queue(&cacheRef->nodeList, &nodePtr->link);
+        le_hashmap_Put(cacheRef->nodeMap, nodePtr->path, nodePtr);
+        cacheRef->nodeCount++;
+    }
+
+    pathPtr[pathLen] = '\0';
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush the caches of this client overlapping a subtree which was just written
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_FlushOverlappingCaches
+(
+    const char* basePathPtr     ///< [IN] Root of the subtree written
+)
+{
+    // The change notification comes later: don't serve the old values meanwhile.
+    le_dls_Link_t* linkPtr = le_dls_Peek(&CacheList);
+
+    while (NULL != linkPtr)
+    {
+        cfgBatch_CacheRef_t cacheRef = CONTAINER_OF(linkPtr, struct cfgBatch_Cache, link);
+
+        if (PathsOverlap(cacheRef->basePath, basePathPtr))
+        {
+            cfgBatch_FlushCache(cacheRef);
+        }
+
+        linkPtr = le_dls_PeekNext(&CacheList, linkPtr);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read several nodes in a single read transaction
+ *
+ * @return
+ *      - LE_OK if the transaction was run, the result of each node is in its entry
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the base path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_Read
+(
+    const char*           basePathPtr,  ///< [IN] Base path of the transaction
+    cfgBatch_ReadEntry_t* entriesPtr,   ///< [IN/OUT] Nodes to read
+    size_t                count         ///< [IN] Number of nodes
+)
+{
+    size_t i;
+
+    if ((NULL == basePathPtr) || ((NULL == entriesPtr) && (count > 0)))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    if (strlen(basePathPtr) >= LE_CFG_STR_LEN_BYTES)
+    {
+        return LE_OVERFLOW;
+    }
+
+    le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(basePathPtr);
+
+    for (i = 0; i < count; i++)
+    {
+        if (IsValidEntry(&entriesPtr[i]))
+        {
+            ReadNode(iterRef, &entriesPtr[i]);
+        }
+        else
+        {
+            entriesPtr[i].result = LE_BAD_PARAMETER;
+        }
+    }
+
+    le_cfg_CancelTxn(iterRef);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a write batch. Nothing is sent to the config tree until the batch is committed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the base path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_CreateWrite
+(
+    const char*          basePathPtr,   ///< [IN] Base path of the transaction
+    cfgBatch_WriteRef_t* writeRefPtr    ///< [OUT] Batch, to be committed or cancelled
+)
+{
+    if ((NULL == basePathPtr) || (NULL == writeRefPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    InitPools();
+
+    cfgBatch_WriteRef_t writeRef = le_mem_ForceAlloc(WritePool);
+
+    if (LE_OK != le_utf8_Copy(writeRef->basePath, basePathPtr, sizeof(writeRef->basePath), NULL))
+    {
+        LE_ERROR("Base path too long: '%s'", basePathPtr);
+        le_mem_Release(writeRef);
+        return LE_OVERFLOW;
+    }
+
+    writeRef->opList = LE_DLS_LIST_INIT;
+    *writeRefPtr = writeRef;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record an integer value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetInt
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    int32_t             value       ///< [IN] Value to set
+)
+{
+    WriteOp_t* opPtr = AddWriteOp(writeRef, pathPtr, LE_CFG_TYPE_INT);
+
+    if (NULL == opPtr)
+    {
+        return LE_OVERFLOW;
+    }
+
+    opPtr->intValue = value;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a boolean value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetBool
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    bool                value       ///< [IN] Value to set
+)
+{
+    WriteOp_t* opPtr = AddWriteOp(writeRef, pathPtr, LE_CFG_TYPE_BOOL);
+
+    if (NULL == opPtr)
+    {
+        return LE_OVERFLOW;
+    }
+
+    opPtr->boolValue = value;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a floating point value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetFloat
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    double              value       ///< [IN] Value to set
+)
+{
+    WriteOp_t* opPtr = AddWriteOp(writeRef, pathPtr, LE_CFG_TYPE_FLOAT);
+
+    if (NULL == opPtr)
+    {
+        return LE_OVERFLOW;
+    }
+
+    opPtr->floatValue = value;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a string value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path or the value is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetString
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    const char*         valuePtr    ///< [IN] Value to set
+)
+{
+    LE_ASSERT(valuePtr != NULL);
+
+    WriteOp_t* opPtr = AddWriteOp(writeRef, pathPtr, LE_CFG_TYPE_STRING);
+
+    if (NULL == opPtr)
+    {
+        return LE_OVERFLOW;
+    }
+
+    opPtr->strPtr = le_mem_ForceAlloc(StringPool);
+
+    if (LE_OK != le_utf8_Copy(opPtr->strPtr, valuePtr, LE_CFG_STR_LEN_BYTES, NULL))
+    {
+        le_dls_Remove(&writeRef->opList, &opPtr->link);
+        ReleaseWriteOp(opPtr);
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a node to delete, along with its children
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_DeleteNode
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr     ///< [IN] Node path, relative to the base path
+)
+{
+    return (NULL == AddWriteOp(writeRef, pathPtr, LE_CFG_TYPE_EMPTY)) ? LE_OVERFLOW : LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply the recorded operations, in order, in a single write transaction and delete the batch.
+ * The caches of this client overlapping the base path are flushed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the batch reference is invalid
+ *      - LE_FAULT if the write transaction can't be created
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_Commit
+(
+    cfgBatch_WriteRef_t writeRef    ///< [IN] Write batch
+)
+{
+    le_dls_Link_t* linkPtr;
+
+    if (NULL == writeRef)
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    // Nothing to write: don't make the config tree save an unchanged tree.
+    if (le_dls_IsEmpty(&writeRef->opList))
+    {
+        le_mem_Release(writeRef);
+        return LE_OK;
+    }
+
+    le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(writeRef->basePath);
+
+    if (NULL == iterRef)
+    {
+        cfgBatch_Cancel(writeRef);
+        return LE_FAULT;
+    }
+
+    while (NULL != (linkPtr = le_dls_Pop(&writeRef->opList)))
+    {
+        WriteOp_t* opPtr = CONTAINER_OF(linkPtr, WriteOp_t, link);
+
+        switch (opPtr->type)
+        {
+            case LE_CFG_TYPE_INT:
+                le_cfg_SetInt(iterRef, opPtr->path, opPtr->intValue);
+                break;
+
+            case LE_CFG_TYPE_BOOL:
+                le_cfg_SetBool(iterRef, opPtr->path, opPtr->boolValue);
+                break;
+
+            case LE_CFG_TYPE_FLOAT:
+                le_cfg_SetFloat(iterRef, opPtr->path, opPtr->floatValue);
+                break;
+
+            case LE_CFG_TYPE_STRING:
+                le_cfg_SetString(iterRef, opPtr->path, opPtr->strPtr);
+                break;
+
+            default:
+                le_cfg_DeleteNode(iterRef, opPtr->path);
+                break;
+        }
+
+        ReleaseWriteOp(opPtr);
+    }
+
+    le_cfg_CommitTxn(iterRef);
+    cfgBatch_FlushOverlappingCaches(writeRef->basePath);
+
+    le_mem_Release(writeRef);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a write batch without applying it
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_Cancel
+(
+    cfgBatch_WriteRef_t writeRef    ///< [IN] Write batch
+)
+{
+    le_dls_Link_t* linkPtr;
+
+    if (NULL == writeRef)
+    {
+        return;
+    }
+
+    while (NULL != (linkPtr = le_dls_Pop(&writeRef->opList)))
+    {
+        ReleaseWriteOp(CONTAINER_OF(linkPtr, WriteOp_t, link));
+    }
+
+    le_mem_Release(writeRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a read cache for the nodes under a base path. When it is full, the least recently used
+ * node is evicted.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the base path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_CreateCache
+(
+    const char*          basePathPtr,   ///< [IN] Base path of the cached nodes
+    cfgBatch_CacheRef_t* cacheRefPtr    ///< [OUT] Cache, to be deleted by the caller
+)
+{
+    if ((NULL == basePathPtr) || (NULL == cacheRefPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    if (strlen(basePathPtr) >= LE_CFG_STR_LEN_BYTES)
+    {
+        LE_ERROR("Base path too long: '%s'", basePathPtr);
+        return LE_OVERFLOW;
+    }
+
+    InitPools();
+
+    cfgBatch_CacheRef_t cacheRef;
+    le_dls_Link_t* linkPtr = le_dls_Pop(&FreeCacheList);
+
+    if (NULL != linkPtr)
+    {
+        // Reuse the empty map of a deleted cache.
+        cacheRef = CONTAINER_OF(linkPtr, struct cfgBatch_Cache, link);
+        memset(&cacheRef->stats, 0, sizeof(cacheRef->stats));
+    }
+    else
+    {
+        cacheRef = le_mem_ForceAlloc(CachePool);
+        memset(cacheRef, 0, sizeof(struct cfgBatch_Cache));
+        cacheRef->nodeMap = le_hashmap_Create("CfgBatchCache",
+                                              MAX_CACHED_NODES,
+                                              le_hashmap_HashString,
+                                              le_hashmap_EqualsString);
+    }
+
+    LE_ASSERT_OK(le_utf8_Copy(cacheRef->basePath, basePathPtr, sizeof(cacheRef->basePath), NULL));
+    cacheRef->nodeList = LE_DLS_LIST_INIT;
+    cacheRef->handlerRef = le_cfg_AddChangeHandler(basePathPtr, CacheChangeHandler, cacheRef);
+
+    cacheRef->link = LE_DLS_LINK_INIT;
+    le_dls_Queue(&CacheList, &cacheRef->link);
+    *cacheRefPtr = cacheRef;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a read cache, its nodes and its change notification handler
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_DeleteCache
+(
+    cfgBatch_CacheRef_t cacheRef        ///< [IN] Cache
+)
+{
+    if (NULL == cacheRef)
+    {
+        return;
+    }
+
+    le_cfg_RemoveChangeHandler(cacheRef->handlerRef);
+    cfgBatch_FlushCache(cacheRef);
+    le_dls_Remove(&CacheList, &cacheRef->link);
+
+    cacheRef->handlerRef = NULL;
+    le_dls_Queue(&FreeCacheList, &cacheRef->link);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read several nodes through a cache. The nodes found in the cache are served locally, the other
+ * ones are read in a single read transaction and added to the cache. The node paths are the cache
+ * keys: the same node must always be read with the same path.
+ *
+ * @return
+ *      - LE_OK on success, the result of each node is in its entry
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_CacheRead
+(
+    cfgBatch_CacheRef_t   cacheRef,     ///< [IN] Cache
+    cfgBatch_ReadEntry_t* entriesPtr,   ///< [IN/OUT] Nodes to read, relative to the base path
+    size_t                count         ///< [IN] Number of nodes
+)
+{
+    le_cfg_IteratorRef_t iterRef = NULL;
+    size_t i;
+
+    if ((NULL == cacheRef) || ((NULL == entriesPtr) && (count > 0)))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        cfgBatch_ReadEntry_t* entryPtr = &entriesPtr[i];
+
+        if (!IsValidEntry(entryPtr))
+        {
+            entryPtr->result = LE_BAD_PARAMETER;
+            continue;
+        }
+
+        CachedNode_t* nodePtr = le_hashmap_Get(cacheRef->nodeMap, entryPtr->path);
+
+        if (   (NULL != nodePtr)
+            && ((LE_NOT_FOUND == nodePtr->result) || (nodePtr->type == entryPtr->type)))
+        {
+            // Keep the most recently used nodes at the end of the list.
+            le_dls_Remove(&cacheRef->nodeList, &nodePtr->link);
+            le_dls_Queue(&cacheRef->nodeList, &nodePtr->link);
+
+            cacheRef->stats.hits++;
+            CopyCachedNode(nodePtr, entryPtr);
+            continue;
+        }
+
+        cacheRef->stats.misses++;
+
+        if (NULL == iterRef)
+        {
+            iterRef = le_cfg_CreateReadTxn(cacheRef->basePath);
+        }
+
+        if (strlen(entryPtr->path) >= CFGBATCH_PATH_MAX_BYTES)
+        {
+            // Too long to be cached.
+            ReadNode(iterRef, entryPtr);
+            continue;
+        }
+
+        if (NULL != nodePtr)
+        {
+            // Cached with another type: read it again.
+            RemoveCachedNode(cacheRef, nodePtr);
+        }
+
+        nodePtr = le_mem_ForceAlloc(CachedNodePool);
+        LE_ASSERT_OK(le_utf8_Copy(nodePtr->path, entryPtr->path, sizeof(nodePtr->path), NULL));
+        nodePtr->strPtr = NULL;
+
+        // Read the full value into the node, with the defaults of the entry, then serve the entry
+        // from it.
+        cfgBatch_ReadEntry_t nodeEntry = *entryPtr;
+        nodeEntry.path = nodePtr->path;
+
+        if (LE_CFG_TYPE_STRING == entryPtr->type)
+        {
+            nodePtr->strPtr = le_mem_ForceAlloc(StringPool);
+            nodeEntry.strPtr = nodePtr->strPtr;
+            nodeEntry.strSize = LE_CFG_STR_LEN_BYTES;
+        }
+
+        ReadNode(iterRef, &nodeEntry);
+
+        nodePtr->type = nodeEntry.type;
+        nodePtr->result = nodeEntry.result;
+        nodePtr->intValue = nodeEntry.intValue;
+        nodePtr->boolValue = nodeEntry.boolValue;
+        nodePtr->floatValue = nodeEntry.floatValue;
+
+        CopyCachedNode(nodePtr, entryPtr);
+
+        if (cacheRef->nodeCount >= MAX_CACHED_NODES)
+        {
+            RemoveCachedNode(cacheRef,
+                             CONTAINER_OF(le_dls_Peek(&cacheRef->nodeList), CachedNode_t, link));
+            cacheRef->stats.evictions++;
+        }
+
+        nodePtr->link = LE_DLS_LINK_INIT;
+        le_dls_Queue(&cacheRef->nodeList, &nodePtr->link);
+        le_hashmap_Put(cacheRef->nodeMap, nodePtr->path, nodePtr);
+        cacheRef->nodeCount++;
+    }
+
+    if (NULL != iterRef)
+    {
+        le_cfg_CancelTxn(iterRef);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the cached nodes
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_FlushCache
+(
+    cfgBatch_CacheRef_t cacheRef        ///< [IN] Cache
+)
+{
+    le_dls_Link_t* linkPtr;
+
+    LE_ASSERT(cacheRef != NULL);
+
+    le_hashmap_RemoveAll(cacheRef->nodeMap);
+
+    while (NULL != (linkPtr = le_dls_Pop(&cacheRef->nodeList)))
+    {
+        ReleaseCachedNode(CONTAINER_OF(linkPtr, CachedNode_t, link));
+    }
+
+    cacheRef->nodeCount = 0;
+    cacheRef->stats.flushes++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the cache statistics
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_GetCacheStats
+(
+    cfgBatch_CacheRef_t    cacheRef,    ///< [IN] Cache
+    cfgBatch_CacheStats_t* statsPtr     ///< [OUT] Statistics
+)
+{
+    LE_ASSERT(cacheRef != NULL);
+    LE_ASSERT(statsPtr != NULL);
+
+    *statsPtr = cacheRef->stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill a cache with all the values under its base path, exported in a single request. The values
+ * which don't fit in the cache are read on demand.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT if the subtree can't be exported
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_LoadCache
+(
+    cfgBatch_CacheRef_t cacheRef        ///< [IN] Cache
+)
+{
+    cfgBatch_SnapshotRef_t snapshotRef;
+    char path[CFGBATCH_PATH_MAX_BYTES] = "";
+
+    LE_ASSERT(cacheRef != NULL);
+
+    if (LE_OK != cfgBatch_ExportSubtree(cacheRef->basePath, &snapshotRef))
+    {
+        return LE_FAULT;
+    }
+
+    // Start from a clean cache, nodes cached earlier may have been deleted since.
+    cfgBatch_FlushCache(cacheRef);
+    LoadSnapshotNode(cacheRef, cfgBatch_GetSnapshotNode(snapshotRef, ""), path, 0);
+    cfgBatch_DeleteSnapshot(snapshotRef);
+
+    return LE_OK;
+}
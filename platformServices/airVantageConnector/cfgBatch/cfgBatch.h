@@ -0,0 +1,573 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file cfgBatch.h
+ *
+ * Batched access to the config tree, on top of the le_cfg API:
+ *  - a read batch gets several nodes in a single read transaction, still one request per node,
+ *  - a write batch records several sets and deletions and applies them in a single write
+ *    transaction, so the tree is committed (and saved) once,
+ *  - an optional read-through cache serves the nodes already read under a base path without any
+ *    request to the config tree. It is flushed when the config tree notifies a change under its
+ *    base path, and when a write batch of this client is committed under it,
+ *  - a snapshot holds a whole subtree in memory. It is exported by the config tree, serialized
+ *    once, in a single request, and a subtree is replaced by a snapshot the same way. This uses
+ *    the le_cfgAdmin export and import through a temporary file in the /tmp of the client, which
+ *    the config tree reaches through /proc/<pid>/root: it works for sandboxed clients too.
+ *
+ * The cache is per client: a change made by another client is only seen once its notification is
+ * received, i.e. after the current event handler returns.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef LEGATO_CFG_BATCH_INCLUDE_GUARD
+#define LEGATO_CFG_BATCH_INCLUDE_GUARD
+
+#include "legato.h"
+#include "interfaces.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum size of a node path in a write batch or a cache, including the terminating null
+ * character. Longer paths are read without being cached.
+ */
+//--------------------------------------------------------------------------------------------------
+#define CFGBATCH_PATH_MAX_BYTES     128
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Node read by a read batch.
+ *
+ * The value fields hold the default value when the batch is submitted. They are left untouched
+ * when the node is empty, doesn't exist or holds a value of another type. Numbers are converted
+ * to each other, and any value but a stem can be read as a string.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char*       path;         ///< [IN] Node path, relative to the base path
+    le_cfg_nodeType_t type;         ///< [IN] LE_CFG_TYPE_INT, LE_CFG_TYPE_BOOL, LE_CFG_TYPE_FLOAT
+                                    ///<      or LE_CFG_TYPE_STRING
+    int32_t           intValue;     ///< [IN/OUT] Value of an integer node
+    bool              boolValue;    ///< [IN/OUT] Value of a boolean node
+    double            floatValue;   ///< [IN/OUT] Value of a floating point node
+    char*             strPtr;       ///< [IN/OUT] Buffer receiving the value of a string node
+    size_t            strSize;      ///< [IN] Size of the string buffer
+    le_result_t       result;       ///< [OUT] LE_OK if the node was read, LE_NOT_FOUND if it is
+                                    ///<       empty or doesn't exist, LE_FORMAT_ERROR if it can't
+                                    ///<       be read as the given type, LE_OVERFLOW if the string
+                                    ///<       was truncated, LE_BAD_PARAMETER if the type is
+                                    ///<       not supported
+}
+cfgBatch_ReadEntry_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a write batch
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct cfgBatch_Write* cfgBatch_WriteRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a read cache
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct cfgBatch_Cache* cfgBatch_CacheRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache statistics
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t hits;          ///< Nodes served from the cache
+    uint32_t misses;        ///< Nodes read from the config tree
+    uint32_t flushes;       ///< Number of times the cache was flushed
+    uint32_t evictions;     ///< Nodes evicted to make room for a new one
+}
+cfgBatch_CacheStats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a subtree snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct cfgBatch_Snapshot* cfgBatch_SnapshotRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a node of a subtree snapshot, valid until the snapshot is deleted
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct cfgBatch_SnapshotNode* cfgBatch_SnapshotNodeRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read several nodes in a single read transaction
+ *
+ * @return
+ *      - LE_OK if the transaction was run, the result of each node is in its entry
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the base path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_Read
+(
+    const char*           basePathPtr,  ///< [IN] Base path of the transaction
+    cfgBatch_ReadEntry_t* entriesPtr,   ///< [IN/OUT] Nodes to read
+    size_t                count         ///< [IN] Number of nodes
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a write batch. Nothing is sent to the config tree until the batch is committed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the base path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_CreateWrite
+(
+    const char*          basePathPtr,   ///< [IN] Base path of the transaction
+    cfgBatch_WriteRef_t* writeRefPtr    ///< [OUT] Batch, to be committed or cancelled
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record an integer value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetInt
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    int32_t             value       ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a boolean value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetBool
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    bool                value       ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a floating point value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetFloat
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    double              value       ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a string value to set
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path or the value is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SetString
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr,    ///< [IN] Node path, relative to the base path
+    const char*         valuePtr    ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a node to delete, along with its children
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_DeleteNode
+(
+    cfgBatch_WriteRef_t writeRef,   ///< [IN] Write batch
+    const char*         pathPtr     ///< [IN] Node path, relative to the base path
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply the recorded operations, in order, in a single write transaction and delete the batch.
+ * The caches of this client overlapping the base path are flushed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the batch reference is invalid
+ *      - LE_FAULT if the write transaction can't be created
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_Commit
+(
+    cfgBatch_WriteRef_t writeRef    ///< [IN] Write batch
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a write batch without applying it
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_Cancel
+(
+    cfgBatch_WriteRef_t writeRef    ///< [IN] Write batch
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a read cache for the nodes under a base path. When it is full, the least recently used
+ * node is evicted.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the base path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_CreateCache
+(
+    const char*          basePathPtr,   ///< [IN] Base path of the cached nodes
+    cfgBatch_CacheRef_t* cacheRefPtr    ///< [OUT] Cache, to be deleted by the caller
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a read cache, its nodes and its change notification handler
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_DeleteCache
+(
+    cfgBatch_CacheRef_t cacheRef        ///< [IN] Cache
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read several nodes through a cache. The nodes found in the cache are served locally, the other
+ * ones are read in a single read transaction and added to the cache. The node paths are the cache
+ * keys: the same node must always be read with the same path.
+ *
+ * @return
+ *      - LE_OK on success, the result of each node is in its entry
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_CacheRead
+(
+    cfgBatch_CacheRef_t   cacheRef,     ///< [IN] Cache
+    cfgBatch_ReadEntry_t* entriesPtr,   ///< [IN/OUT] Nodes to read, relative to the base path
+    size_t                count         ///< [IN] Number of nodes
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the cached nodes
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_FlushCache
+(
+    cfgBatch_CacheRef_t cacheRef        ///< [IN] Cache
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the cache statistics
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_GetCacheStats
+(
+    cfgBatch_CacheRef_t    cacheRef,    ///< [IN] Cache
+    cfgBatch_CacheStats_t* statsPtr     ///< [OUT] Statistics
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill a cache with all the values under its base path, exported in a single request. The values
+ * which don't fit in the cache are read on demand.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT if the subtree can't be exported
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_LoadCache
+(
+    cfgBatch_CacheRef_t cacheRef        ///< [IN] Cache
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an empty snapshot, e.g. to build a subtree to import
+ *
+ * @return the snapshot reference
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotRef_t cfgBatch_CreateSnapshot
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Export a subtree in a single request to the config tree
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_FORMAT_ERROR if the exported data can't be parsed
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_ExportSubtree
+(
+    const char*             basePathPtr,    ///< [IN] Root of the subtree
+    cfgBatch_SnapshotRef_t* snapshotRefPtr  ///< [OUT] Snapshot, to be deleted by the caller
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Replace a subtree by a snapshot, atomically, in a single write transaction. The caches of this
+ * client overlapping the subtree are flushed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_FAULT on any other error, the subtree is then unchanged
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_ImportSubtree
+(
+    const char*            basePathPtr,     ///< [IN] Root of the subtree
+    cfgBatch_SnapshotRef_t snapshotRef      ///< [IN] Snapshot
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a snapshot and all its nodes
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_DeleteSnapshot
+(
+    cfgBatch_SnapshotRef_t snapshotRef      ///< [IN] Snapshot
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a node of a snapshot
+ *
+ * @return the node, NULL if it doesn't exist
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotNodeRef_t cfgBatch_GetSnapshotNode
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr          ///< [IN] Node path, relative to the subtree root. An
+                                            ///<      empty path is the root.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the first child of a stem node
+ *
+ * @return the child, NULL if the node has no children
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotNodeRef_t cfgBatch_GetFirstChild
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next sibling of a node
+ *
+ * @return the sibling, NULL if the node is the last child of its parent
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotNodeRef_t cfgBatch_GetNextSibling
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a node, empty for the root
+ *
+ * @return the name, valid as long as the snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+const char* cfgBatch_GetNodeName
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the type of a node
+ *
+ * @return the node type
+ */
+//--------------------------------------------------------------------------------------------------
+le_cfg_nodeType_t cfgBatch_GetNodeType
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of an integer node. A floating point value is rounded.
+ *
+ * @return the value, or the default value if the node is not a number
+ */
+//--------------------------------------------------------------------------------------------------
+int32_t cfgBatch_GetNodeInt
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    int32_t                    defaultValue ///< [IN] Default value
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of a boolean node
+ *
+ * @return the value, or the default value if the node is not a boolean
+ */
+//--------------------------------------------------------------------------------------------------
+bool cfgBatch_GetNodeBool
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    bool                       defaultValue ///< [IN] Default value
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of a floating point node. An integer value is converted.
+ *
+ * @return the value, or the default value if the node is not a number
+ */
+//--------------------------------------------------------------------------------------------------
+double cfgBatch_GetNodeFloat
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    double                     defaultValue ///< [IN] Default value
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of a string node
+ *
+ * @return the value, valid as long as the snapshot, or the default value if the node is not a
+ *         string
+ */
+//--------------------------------------------------------------------------------------------------
+const char* cfgBatch_GetNodeString
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    const char*                defaultPtr   ///< [IN] Default value
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set an integer node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetInt
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    int32_t                value            ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a boolean node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetBool
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    bool                   value            ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a floating point node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetFloat
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    double                 value            ///< [IN] Value to set
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a string node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name or the value is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetString
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    const char*            valuePtr         ///< [IN] Value to set
+);
+
+#endif // LEGATO_CFG_BATCH_INCLUDE_GUARD
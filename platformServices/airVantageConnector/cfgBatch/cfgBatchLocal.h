@@ -0,0 +1,24 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file cfgBatchLocal.h
+ *
+ * Functions shared between the modules of the cfgBatch component.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef LEGATO_CFG_BATCH_LOCAL_INCLUDE_GUARD
+#define LEGATO_CFG_BATCH_LOCAL_INCLUDE_GUARD
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush the caches of this client overlapping a subtree which was just written
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_FlushOverlappingCaches
+(
+    const char* basePathPtr     ///< [IN] Root of the subtree written
+);
+
+#endif // LEGATO_CFG_BATCH_LOCAL_INCLUDE_GUARD
@@ -0,0 +1,1222 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * Config subtree snapshots.
+ *
+ * Walking a subtree with the le_cfg iterator costs a request per step and per value. A snapshot is
+ * exported by the config tree in a single request, as a file in the config tree text format, and
+ * is parsed here into an in-memory tree. An import goes the other way: the snapshot is written in
+ * the same format and the config tree replaces the subtree with it in one write transaction.
+ *
+ * The file is created in the /tmp of the client, and the config tree daemon is given its path
+ * through the root of the client process, /proc/<pid>/root, so that it reaches the same file
+ * whether the client is sandboxed or not.
+ *
+ * The format, as written by the config tree, is:
+ *  - a stem is { "name" value "name" value ... }
+ *  - a string is "value", with '"' and '\' escaped by a '\'
+ *  - an integer is [value], a floating point number is (value)
+ *  - a boolean is !t or !f, an empty node is ~
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "cfgBatch.h"
+#include "cfgBatchLocal.h"
+#include <sys/mman.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Template of the temporary files exchanged with the config tree
+ */
+//--------------------------------------------------------------------------------------------------
+#define TMP_FILE_TEMPLATE   "/tmp/cfgBatchXXXXXX"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum depth of a parsed subtree
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_DEPTH           64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Snapshot node
+ */
+//--------------------------------------------------------------------------------------------------
+struct cfgBatch_SnapshotNode
+{
+    char                          name[LE_CFG_NAME_LEN_BYTES];  ///< Node name
+    le_cfg_nodeType_t             type;                         ///< Node type
+    int32_t                       intValue;                     ///< Integer value
+    bool                          boolValue;                    ///< Boolean value
+    double                        floatValue;                   ///< Floating point value
+    char*                         strPtr;                       ///< String value, from the pool
+    struct cfgBatch_SnapshotNode* firstChildPtr;                ///< First child of a stem
+    struct cfgBatch_SnapshotNode* lastChildPtr;                 ///< Last child of a stem
+    struct cfgBatch_SnapshotNode* nextSiblingPtr;               ///< Next child of the parent
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+struct cfgBatch_Snapshot
+{
+    struct cfgBatch_SnapshotNode* rootPtr;      ///< Root of the subtree
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parser state
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* curPtr;     ///< Next character to parse
+    const char* endPtr;     ///< End of the data
+}
+Parser_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for snapshots
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t SnapshotPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for snapshot nodes
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t SnapshotNodePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for string values, only allocated for string nodes
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t SnapshotStringPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the memory pools on first use
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitPools
+(
+    void
+)
+{
+    if (NULL == SnapshotPool)
+    {
+        SnapshotPool = le_mem_CreatePool("CfgBatchSnapshotPool", sizeof(struct cfgBatch_Snapshot));
+        SnapshotNodePool = le_mem_CreatePool("CfgBatchSnapshotNodePool",
+                                             sizeof(struct cfgBatch_SnapshotNode));
+        SnapshotStringPool = le_mem_CreatePool("CfgBatchSnapshotStringPool",
+                                               LE_CFG_STR_LEN_BYTES);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate an empty node
+ *
+ * @return the node
+ */
+//--------------------------------------------------------------------------------------------------
+static cfgBatch_SnapshotNodeRef_t CreateNode
+(
+    void
+)
+{
+    cfgBatch_SnapshotNodeRef_t nodePtr = le_mem_ForceAlloc(SnapshotNodePool);
+
+    memset(nodePtr, 0, sizeof(*nodePtr));
+    nodePtr->type = LE_CFG_TYPE_EMPTY;
+
+    return nodePtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the value and the children of a node, leaving it empty
+ */
+//--------------------------------------------------------------------------------------------------
+static void ClearNode
+(
+    cfgBatch_SnapshotNodeRef_t nodePtr
+)
+{
+    cfgBatch_SnapshotNodeRef_t childPtr = nodePtr->firstChildPtr;
+
+    while (NULL != childPtr)
+    {
+        cfgBatch_SnapshotNodeRef_t nextPtr = childPtr->nextSiblingPtr;
+
+        ClearNode(childPtr);
+        le_mem_Release(childPtr);
+        childPtr = nextPtr;
+    }
+
+    if (NULL != nodePtr->strPtr)
+    {
+        le_mem_Release(nodePtr->strPtr);
+    }
+
+    nodePtr->strPtr = NULL;
+    nodePtr->firstChildPtr = NULL;
+    nodePtr->lastChildPtr = NULL;
+    nodePtr->type = LE_CFG_TYPE_EMPTY;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a child to a stem node
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddChild
+(
+    cfgBatch_SnapshotNodeRef_t parentPtr,
+    cfgBatch_SnapshotNodeRef_t childPtr
+)
+{
+    if (NULL == parentPtr->lastChildPtr)
+    {
+        parentPtr->firstChildPtr = childPtr;
+    }
+    else
+    {
+        parentPtr->lastChildPtr->nextSiblingPtr = childPtr;
+    }
+
+    parentPtr->lastChildPtr = childPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skip the white spaces
+ *
+ * @return true if there is a character left to parse
+ */
+//--------------------------------------------------------------------------------------------------
+static bool SkipSpaces
+(
+    Parser_t* parserPtr
+)
+{
+    while (   (parserPtr->curPtr < parserPtr->endPtr)
+           && isspace((unsigned char)*parserPtr->curPtr))
+    {
+        parserPtr->curPtr++;
+    }
+
+    return (parserPtr->curPtr < parserPtr->endPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a quoted string
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the string is not terminated or doesn't fit in the buffer
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseString
+(
+    Parser_t* parserPtr,
+    char*     bufPtr,
+    size_t    bufSize
+)
+{
+    size_t len = 0;
+
+    // Skip the opening quote.
+    parserPtr->curPtr++;
+
+    while (parserPtr->curPtr < parserPtr->endPtr)
+    {
+        char c = *parserPtr->curPtr++;
+
+        if ('"' == c)
+        {
+            bufPtr[len] = '\0';
+            return LE_OK;
+        }
+
+        if ('\\' == c)
+        {
+            if (parserPtr->curPtr >= parserPtr->endPtr)
+            {
+                break;
+            }
+            c = *parserPtr->curPtr++;
+        }
+
+        if (len + 1 >= bufSize)
+        {
+            break;
+        }
+        bufPtr[len++] = c;
+    }
+
+    return LE_FORMAT_ERROR;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a number enclosed in delimiters
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the number is invalid
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseNumber
+(
+    Parser_t*                  parserPtr,
+    char                       closing,
+    cfgBatch_SnapshotNodeRef_t nodePtr
+)
+{
+    char numberStr[64];
+    size_t len = 0;
+    char* endPtr;
+
+    // Skip the opening delimiter.
+    parserPtr->curPtr++;
+
+    while ((parserPtr->curPtr < parserPtr->endPtr) && (closing != *parserPtr->curPtr))
+    {
+        if (len + 1 >= sizeof(numberStr))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        numberStr[len++] = *parserPtr->curPtr++;
+    }
+
+    if ((parserPtr->curPtr >= parserPtr->endPtr) || (0 == len))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    parserPtr->curPtr++;
+    numberStr[len] = '\0';
+    errno = 0;
+
+    if (']' == closing)
+    {
+        long value = strtol(numberStr, &endPtr, 10);
+
+        if ((value < INT32_MIN) || (value > INT32_MAX))
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        nodePtr->type = LE_CFG_TYPE_INT;
+        nodePtr->intValue = (int32_t)value;
+    }
+    else
+    {
+        nodePtr->type = LE_CFG_TYPE_FLOAT;
+        nodePtr->floatValue = strtod(numberStr, &endPtr);
+    }
+
+    return (('\0' == *endPtr) && (0 == errno)) ? LE_OK : LE_FORMAT_ERROR;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the value of a node, and its children for a stem
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the data is invalid
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseValue
+(
+    Parser_t*                  parserPtr,
+    cfgBatch_SnapshotNodeRef_t nodePtr,
+    int                        depth
+)
+{
+    if ((depth > MAX_DEPTH) || !SkipSpaces(parserPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    switch (*parserPtr->curPtr)
+    {
+        case '{':
+            parserPtr->curPtr++;
+            nodePtr->type = LE_CFG_TYPE_STEM;
+
+            while (SkipSpaces(parserPtr))
+            {
+                if ('}' == *parserPtr->curPtr)
+                {
+                    parserPtr->curPtr++;
+                    return LE_OK;
+                }
+
+                if ('"' != *parserPtr->curPtr)
+                {
+                    return LE_FORMAT_ERROR;
+                }
+
+                cfgBatch_SnapshotNodeRef_t childPtr = CreateNode();
+                AddChild(nodePtr, childPtr);
+
+                if (   (LE_OK != ParseString(parserPtr, childPtr->name, sizeof(childPtr->name)))
+                    || (LE_OK != ParseValue(parserPtr, childPtr, depth + 1)))
+                {
+                    return LE_FORMAT_ERROR;
+                }
+            }
+            return LE_FORMAT_ERROR;
+
+        case '"':
+            nodePtr->type = LE_CFG_TYPE_STRING;
+            nodePtr->strPtr = le_mem_ForceAlloc(SnapshotStringPool);
+            return ParseString(parserPtr, nodePtr->strPtr, LE_CFG_STR_LEN_BYTES);
+
+        case '[':
+            return ParseNumber(parserPtr, ']', nodePtr);
+
+        case '(':
+            return ParseNumber(parserPtr, ')', nodePtr);
+
+        case '!':
+            if (   (parserPtr->curPtr + 1 >= parserPtr->endPtr)
+                || (('t' != parserPtr->curPtr[1]) && ('f' != parserPtr->curPtr[1])))
+            {
+                return LE_FORMAT_ERROR;
+            }
+            nodePtr->type = LE_CFG_TYPE_BOOL;
+            nodePtr->boolValue = ('t' == parserPtr->curPtr[1]);
+            parserPtr->curPtr += 2;
+            return LE_OK;
+
+        case '~':
+            parserPtr->curPtr++;
+            nodePtr->type = LE_CFG_TYPE_EMPTY;
+            return LE_OK;
+
+        default:
+            return LE_FORMAT_ERROR;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a file exported by the config tree into a snapshot
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the data is invalid
+ *      - LE_FAULT if the file can't be read
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseFile
+(
+    const char*             filePathPtr,
+    cfgBatch_SnapshotRef_t* snapshotRefPtr
+)
+{
+    struct stat st;
+    le_result_t result;
+    int fd = open(filePathPtr, O_RDONLY);
+
+    if (-1 == fd)
+    {
+        LE_ERROR("Can't open '%s': %m", filePathPtr);
+        return LE_FAULT;
+    }
+
+    if ((-1 == fstat(fd, &st)) || (0 == st.st_size))
+    {
+        LE_ERROR("Can't get the content of '%s'", filePathPtr);
+        close(fd);
+        return LE_FAULT;
+    }
+
+    const char* dataPtr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (MAP_FAILED == dataPtr)
+    {
+        LE_ERROR("Can't map '%s': %m", filePathPtr);
+        return LE_FAULT;
+    }
+
+    Parser_t parser = { .curPtr = dataPtr, .endPtr = dataPtr + st.st_size };
+    cfgBatch_SnapshotRef_t snapshotRef = cfgBatch_CreateSnapshot();
+
+    result = ParseValue(&parser, snapshotRef->rootPtr, 0);
+
+    if ((LE_OK == result) && SkipSpaces(&parser))
+    {
+        // Trailing data
+        result = LE_FORMAT_ERROR;
+    }
+
+    munmap((void*)dataPtr, st.st_size);
+
+    if (LE_OK != result)
+    {
+        LE_ERROR("Invalid data at offset %zd of '%s'", parser.curPtr - dataPtr, filePathPtr);
+        cfgBatch_DeleteSnapshot(snapshotRef);
+        return result;
+    }
+
+    *snapshotRefPtr = snapshotRef;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a quoted and escaped string
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteString
+(
+    FILE*       filePtr,
+    const char* strPtr
+)
+{
+    fputc('"', filePtr);
+
+    for (; '\0' != *strPtr; strPtr++)
+    {
+        if (('"' == *strPtr) || ('\\' == *strPtr))
+        {
+            fputc('\\', filePtr);
+        }
+        fputc(*strPtr, filePtr);
+    }
+
+    fputs("\" ", filePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the value of a node, and its children for a stem
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteValue
+(
+    FILE*                      filePtr,
+    cfgBatch_SnapshotNodeRef_t nodePtr
+)
+{
+    cfgBatch_SnapshotNodeRef_t childPtr;
+
+    switch (nodePtr->type)
+    {
+        case LE_CFG_TYPE_STEM:
+            fputs("{ ", filePtr);
+            for (childPtr = nodePtr->firstChildPtr; NULL != childPtr;
+                 childPtr = childPtr->nextSiblingPtr)
+            {
+                WriteString(filePtr, childPtr->name);
+                WriteValue(filePtr, childPtr);
+            }
+            fputs("} ", filePtr);
+            break;
+
+        case LE_CFG_TYPE_STRING:
+            WriteString(filePtr, nodePtr->strPtr);
+            break;
+
+        case LE_CFG_TYPE_INT:
+            fprintf(filePtr, "[%"PRId32"] ", nodePtr->intValue);
+            break;
+
+        case LE_CFG_TYPE_FLOAT:
+            fprintf(filePtr, "(%.17g) ", nodePtr->floatValue);
+            break;
+
+        case LE_CFG_TYPE_BOOL:
+            fputs(nodePtr->boolValue ? "!t " : "!f ", filePtr);
+            break;
+
+        default:
+            fputs("~ ", filePtr);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a child by name
+ *
+ * @return the child, NULL if not found
+ */
+//--------------------------------------------------------------------------------------------------
+static cfgBatch_SnapshotNodeRef_t FindChild
+(
+    cfgBatch_SnapshotNodeRef_t nodePtr,
+    const char*                namePtr,
+    size_t                     nameLen
+)
+{
+    cfgBatch_SnapshotNodeRef_t childPtr;
+
+    for (childPtr = nodePtr->firstChildPtr; NULL != childPtr; childPtr = childPtr->nextSiblingPtr)
+    {
+        if ((0 == strncmp(childPtr->name, namePtr, nameLen)) && ('\0' == childPtr->name[nameLen]))
+        {
+            return childPtr;
+        }
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a path to set before creating any node, so that a failed set leaves the snapshot unchanged
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CheckPathToSet
+(
+    cfgBatch_SnapshotRef_t snapshotRef,
+    const char*            pathPtr
+)
+{
+    cfgBatch_SnapshotNodeRef_t nodePtr = snapshotRef->rootPtr;
+    bool isRoot = true;
+
+    while ('\0' != *pathPtr)
+    {
+        size_t nameLen = strcspn(pathPtr, "/");
+
+        if (0 != nameLen)
+        {
+            if (nameLen >= LE_CFG_NAME_LEN_BYTES)
+            {
+                return LE_OVERFLOW;
+            }
+
+            // Past the existing nodes, all the stems are created.
+            if (NULL != nodePtr)
+            {
+                if ((LE_CFG_TYPE_EMPTY != nodePtr->type) && (LE_CFG_TYPE_STEM != nodePtr->type))
+                {
+                    return LE_BAD_PARAMETER;
+                }
+
+                nodePtr = FindChild(nodePtr, pathPtr, nameLen);
+            }
+
+            isRoot = false;
+        }
+
+        pathPtr += nameLen;
+        if ('/' == *pathPtr)
+        {
+            pathPtr++;
+        }
+    }
+
+    return isRoot ? LE_BAD_PARAMETER : LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the node of a path to set, creating the missing stems, and clear its current value
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetNodeToSet
+(
+    cfgBatch_SnapshotRef_t      snapshotRef,
+    const char*                 pathPtr,
+    cfgBatch_SnapshotNodeRef_t* nodePtrPtr
+)
+{
+    LE_ASSERT(snapshotRef != NULL);
+    LE_ASSERT(pathPtr != NULL);
+
+    le_result_t result = CheckPathToSet(snapshotRef, pathPtr);
+
+    if (LE_OK != result)
+    {
+        return result;
+    }
+
+    cfgBatch_SnapshotNodeRef_t nodePtr = snapshotRef->rootPtr;
+
+    while ('\0' != *pathPtr)
+    {
+        size_t nameLen = strcspn(pathPtr, "/");
+
+        if (0 != nameLen)
+        {
+            nodePtr->type = LE_CFG_TYPE_STEM;
+
+            cfgBatch_SnapshotNodeRef_t childPtr = FindChild(nodePtr, pathPtr, nameLen);
+
+            if (NULL == childPtr)
+            {
+                childPtr = CreateNode();
+                memcpy(childPtr->name, pathPtr, nameLen);
+                AddChild(nodePtr, childPtr);
+            }
+
+            nodePtr = childPtr;
+        }
+
+        pathPtr += nameLen;
+        if ('/' == *pathPtr)
+        {
+            pathPtr++;
+        }
+    }
+
+    ClearNode(nodePtr);
+    *nodePtrPtr = nodePtr;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an empty snapshot, e.g. to build a subtree to import
+ *
+ * @return the snapshot reference
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotRef_t cfgBatch_CreateSnapshot
+(
+    void
+)
+{
+    InitPools();
+
+    cfgBatch_SnapshotRef_t snapshotRef = le_mem_ForceAlloc(SnapshotPool);
+    snapshotRef->rootPtr = CreateNode();
+
+    return snapshotRef;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a temporary file to exchange with the config tree
+ *
+ * @return
+ *      - the file descriptor, the file paths are filled in
+ *      - -1 on error
+ */
+//--------------------------------------------------------------------------------------------------
+static int CreateExchangeFile
+(
+    char*  localPathPtr,    ///< [IN/OUT] TMP_FILE_TEMPLATE, replaced by the path of the file
+    char*  serverPathPtr,   ///< [OUT] Path of the file for the config tree daemon
+    size_t serverPathSize
+)
+{
+    int fd = mkstemp(localPathPtr);
+    if (-1 == fd)
+    {
+        LE_ERROR("Can't create the exchange file: %m");
+        return -1;
+    }
+
+    // The config tree daemon resolves the path in its own file system.
+    int len = snprintf(serverPathPtr, serverPathSize, "/proc/%d/root%s",
+                       (int)getpid(), localPathPtr);
+    LE_ASSERT((len > 0) && ((size_t)len < serverPathSize));
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Export a subtree in a single request to the config tree
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_FORMAT_ERROR if the exported data can't be parsed
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_ExportSubtree
+(
+    const char*             basePathPtr,    ///< [IN] Root of the subtree
+    cfgBatch_SnapshotRef_t* snapshotRefPtr  ///< [OUT] Snapshot, to be deleted by the caller
+)
+{
+    char filePath[] = TMP_FILE_TEMPLATE;
+    char serverFilePath[PATH_MAX];
+    le_result_t result;
+
+    if ((NULL == basePathPtr) || (NULL == snapshotRefPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    int fd = CreateExchangeFile(filePath, serverFilePath, sizeof(serverFilePath));
+    if (-1 == fd)
+    {
+        return LE_FAULT;
+    }
+    close(fd);
+
+    le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(basePathPtr);
+    result = le_cfgAdmin_ExportTree(iterRef, serverFilePath, "");
+    le_cfg_CancelTxn(iterRef);
+
+    if (LE_OK == result)
+    {
+        result = ParseFile(filePath, snapshotRefPtr);
+    }
+    else
+    {
+        LE_ERROR("Can't export '%s': %s", basePathPtr, LE_RESULT_TXT(result));
+        result = LE_FAULT;
+    }
+
+    unlink(filePath);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Replace a subtree by a snapshot, atomically, in a single write transaction. The caches of this
+ * client overlapping the subtree are flushed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_ImportSubtree
+(
+    const char*            basePathPtr,     ///< [IN] Root of the subtree
+    cfgBatch_SnapshotRef_t snapshotRef      ///< [IN] Snapshot
+)
+{
+    char filePath[] = TMP_FILE_TEMPLATE;
+    char serverFilePath[PATH_MAX];
+    le_result_t result;
+
+    if ((NULL == basePathPtr) || (NULL == snapshotRef))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    int fd = CreateExchangeFile(filePath, serverFilePath, sizeof(serverFilePath));
+    if (-1 == fd)
+    {
+        return LE_FAULT;
+    }
+
+    FILE* filePtr = fdopen(fd, "w");
+    if (NULL == filePtr)
+    {
+        LE_ERROR("Can't open the import file: %m");
+        close(fd);
+        unlink(filePath);
+        return LE_FAULT;
+    }
+
+    WriteValue(filePtr, snapshotRef->rootPtr);
+
+    if ((0 != ferror(filePtr)) | (0 != fclose(filePtr)))
+    {
+        LE_ERROR("Can't write the import file");
+        unlink(filePath);
+        return LE_FAULT;
+    }
+
+    le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(basePathPtr);
+    result = le_cfgAdmin_ImportTree(iterRef, serverFilePath, "");
+
+    if (LE_OK == result)
+    {
+        le_cfg_CommitTxn(iterRef);
+        cfgBatch_FlushOverlappingCaches(basePathPtr);
+    }
+    else
+    {
+        LE_ERROR("Can't import '%s': %s", basePathPtr, LE_RESULT_TXT(result));
+        le_cfg_CancelTxn(iterRef);
+        result = LE_FAULT;
+    }
+
+    unlink(filePath);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a snapshot and all its nodes
+ */
+//--------------------------------------------------------------------------------------------------
+void cfgBatch_DeleteSnapshot
+(
+    cfgBatch_SnapshotRef_t snapshotRef      ///< [IN] Snapshot
+)
+{
+    if (NULL == snapshotRef)
+    {
+        return;
+    }
+
+    ClearNode(snapshotRef->rootPtr);
+    le_mem_Release(snapshotRef->rootPtr);
+    le_mem_Release(snapshotRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a node of a snapshot
+ *
+ * @return the node, NULL if it doesn't exist
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotNodeRef_t cfgBatch_GetSnapshotNode
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr          ///< [IN] Node path, relative to the subtree root. An
+                                            ///<      empty path is the root.
+)
+{
+    LE_ASSERT(snapshotRef != NULL);
+    LE_ASSERT(pathPtr != NULL);
+
+    cfgBatch_SnapshotNodeRef_t nodePtr = snapshotRef->rootPtr;
+
+    while ((NULL != nodePtr) && ('\0' != *pathPtr))
+    {
+        size_t nameLen = strcspn(pathPtr, "/");
+
+        if (0 != nameLen)
+        {
+            nodePtr = FindChild(nodePtr, pathPtr, nameLen);
+        }
+
+        pathPtr += nameLen;
+        if ('/' == *pathPtr)
+        {
+            pathPtr++;
+        }
+    }
+
+    return nodePtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the first child of a stem node
+ *
+ * @return the child, NULL if the node has no children
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotNodeRef_t cfgBatch_GetFirstChild
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    return nodeRef->firstChildPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next sibling of a node
+ *
+ * @return the sibling, NULL if the node is the last child of its parent
+ */
+//--------------------------------------------------------------------------------------------------
+cfgBatch_SnapshotNodeRef_t cfgBatch_GetNextSibling
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    return nodeRef->nextSiblingPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a node, empty for the root
+ *
+ * @return the name, valid as long as the snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+const char* cfgBatch_GetNodeName
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    return nodeRef->name;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the type of a node
+ *
+ * @return the node type
+ */
+//--------------------------------------------------------------------------------------------------
+le_cfg_nodeType_t cfgBatch_GetNodeType
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef      ///< [IN] Node
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    return nodeRef->type;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of an integer node. A floating point value is rounded.
+ *
+ * @return the value, or the default value if the node is not a number
+ */
+//--------------------------------------------------------------------------------------------------
+int32_t cfgBatch_GetNodeInt
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    int32_t                    defaultValue ///< [IN] Default value
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    switch (nodeRef->type)
+    {
+        case LE_CFG_TYPE_INT:
+            return nodeRef->intValue;
+
+        case LE_CFG_TYPE_FLOAT:
+            return (int32_t)lround(nodeRef->floatValue);
+
+        default:
+            return defaultValue;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of a boolean node
+ *
+ * @return the value, or the default value if the node is not a boolean
+ */
+//--------------------------------------------------------------------------------------------------
+bool cfgBatch_GetNodeBool
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    bool                       defaultValue ///< [IN] Default value
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    return (LE_CFG_TYPE_BOOL == nodeRef->type) ? nodeRef->boolValue : defaultValue;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of a floating point node. An integer value is converted.
+ *
+ * @return the value, or the default value if the node is not a number
+ */
+//--------------------------------------------------------------------------------------------------
+double cfgBatch_GetNodeFloat
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    double                     defaultValue ///< [IN] Default value
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    switch (nodeRef->type)
+    {
+        case LE_CFG_TYPE_FLOAT:
+            return nodeRef->floatValue;
+
+        case LE_CFG_TYPE_INT:
+            return nodeRef->intValue;
+
+        default:
+            return defaultValue;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of a string node
+ *
+ * @return the value, valid as long as the snapshot, or the default value if the node is not a
+ *         string
+ */
+//--------------------------------------------------------------------------------------------------
+const char* cfgBatch_GetNodeString
+(
+    cfgBatch_SnapshotNodeRef_t nodeRef,     ///< [IN] Node
+    const char*                defaultPtr   ///< [IN] Default value
+)
+{
+    LE_ASSERT(nodeRef != NULL);
+
+    return (LE_CFG_TYPE_STRING == nodeRef->type) ? nodeRef->strPtr : defaultPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set an integer node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetInt
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    int32_t                value            ///< [IN] Value to set
+)
+{
+    cfgBatch_SnapshotNodeRef_t nodePtr;
+    le_result_t result = GetNodeToSet(snapshotRef, pathPtr, &nodePtr);
+
+    if (LE_OK == result)
+    {
+        nodePtr->type = LE_CFG_TYPE_INT;
+        nodePtr->intValue = value;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a boolean node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetBool
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    bool                   value            ///< [IN] Value to set
+)
+{
+    cfgBatch_SnapshotNodeRef_t nodePtr;
+    le_result_t result = GetNodeToSet(snapshotRef, pathPtr, &nodePtr);
+
+    if (LE_OK == result)
+    {
+        nodePtr->type = LE_CFG_TYPE_BOOL;
+        nodePtr->boolValue = value;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a floating point node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetFloat
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    double                 value            ///< [IN] Value to set
+)
+{
+    cfgBatch_SnapshotNodeRef_t nodePtr;
+    le_result_t result = GetNodeToSet(snapshotRef, pathPtr, &nodePtr);
+
+    if (LE_OK == result)
+    {
+        nodePtr->type = LE_CFG_TYPE_FLOAT;
+        nodePtr->floatValue = value;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a string node in a snapshot, creating the missing parent stems
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if a node name or the value is too long
+ *      - LE_BAD_PARAMETER if the path is empty or goes through a node which is not a stem
+ *
+ * On error, the snapshot is unchanged.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t cfgBatch_SnapshotSetString
+(
+    cfgBatch_SnapshotRef_t snapshotRef,     ///< [IN] Snapshot
+    const char*            pathPtr,         ///< [IN] Node path, relative to the subtree root
+    const char*            valuePtr         ///< [IN] Value to set
+)
+{
+    cfgBatch_SnapshotNodeRef_t nodePtr;
+
+    LE_ASSERT(valuePtr != NULL);
+
+    if (strlen(valuePtr) >= LE_CFG_STR_LEN_BYTES)
+    {
+        return LE_OVERFLOW;
+    }
+
+    le_result_t result = GetNodeToSet(snapshotRef, pathPtr, &nodePtr);
+
+    if (LE_OK == result)
+    {
+        nodePtr->type = LE_CFG_TYPE_STRING;
+        nodePtr->strPtr = le_mem_ForceAlloc(SnapshotStringPool);
+        LE_ASSERT_OK(le_utf8_Copy(nodePtr->strPtr, valuePtr, LE_CFG_STR_LEN_BYTES, NULL));
+    }
+
+    return result;
+}
@@ -0,0 +1,973 @@
+/**
+ * @file deltaPatch.c
+ *
+ * Binary delta packages
+ *
+ * <HR>
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+
+#include <legato.h>
+#include <dirent.h>
+#include <openssl/sha.h>
+#include "deltaPatch.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Header length: magic, base size and hash, target size and hash
+ */
+//--------------------------------------------------------------------------------------------------
+#define HEADER_LEN          (DELTAPATCH_MAGIC_LEN + 8 + SHA256_DIGEST_LENGTH \
+                             + 8 + SHA256_DIGEST_LENGTH)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Commands
+ */
+//--------------------------------------------------------------------------------------------------
+#define CMD_END             0x00
+#define CMD_COPY            0x01
+#define CMD_ADD             0x02
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Argument lengths of the COPY and ADD commands
+ */
+//--------------------------------------------------------------------------------------------------
+#define COPY_ARGS_LEN       12
+#define ADD_ARGS_LEN        4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer used to copy the base, and to read delta files
+ */
+//--------------------------------------------------------------------------------------------------
+#define COPY_BUF_SIZE       (16*1024)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum length of a base path, including the terminating null character
+ */
+//--------------------------------------------------------------------------------------------------
+#define PATH_MAX_BYTES      256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Length of a base name: hexadecimal SHA-256
+ */
+//--------------------------------------------------------------------------------------------------
+#define BASE_NAME_LEN       (2 * SHA256_DIGEST_LENGTH)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parsing states
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    STATE_HEADER,           ///< Receiving the header
+    STATE_COMMAND,          ///< Waiting for a command
+    STATE_ARGS,             ///< Receiving the arguments of a command
+    STATE_ADD_DATA,         ///< Receiving the data of an ADD command
+    STATE_END,              ///< END command received
+    STATE_FAILED            ///< An error occurred
+}
+State_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delta being applied
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct deltaPatch_Ctx
+{
+    State_t             state;                          ///< Parsing state
+    int                 outFd;                          ///< Target file descriptor
+    int                 baseFd;                         ///< Base file descriptor
+    char                baseDir[PATH_MAX_BYTES];        ///< Directory holding the bases
+    uint8_t             header[HEADER_LEN];             ///< Header, then command arguments
+    size_t              headerLen;                      ///< Bytes received in header
+    size_t              argsLen;                        ///< Expected argument bytes
+    uint8_t             command;                        ///< Current command
+    uint32_t            addLeft;                        ///< Bytes left in the current ADD
+    uint64_t            baseSize;                       ///< Base size
+    uint64_t            targetSize;                     ///< Target size
+    uint64_t            outSize;                        ///< Target bytes produced
+    uint8_t             targetHash[SHA256_DIGEST_LENGTH];   ///< Expected target hash
+    SHA256_CTX          sha;                            ///< Target hash being computed
+    size_t              tailLen;                        ///< Bytes in tail
+    deltaPatch_Stats_t  stats;                          ///< Statistics
+    uint8_t             tail[DELTAPATCH_TAIL_BYTES];    ///< Held back end of the target
+    uint8_t             copyBuf[COPY_BUF_SIZE];         ///< Base copy buffer
+}
+DeltaCtx_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of delta contexts, created on first use
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t DeltaPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a big-endian integer
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetBe
+(
+    const uint8_t*  bufPtr,     ///< [IN] Integer bytes
+    size_t          len         ///< [IN] Integer length
+)
+{
+    uint64_t value = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        value = (value << 8) | bufPtr[i];
+    }
+
+    return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Format a SHA-256 in hexadecimal
+ */
+//--------------------------------------------------------------------------------------------------
+static void HashToHex
+(
+    const uint8_t*  hashPtr,    ///< [IN] Hash
+    char*           hexPtr      ///< [OUT] Hexadecimal string, BASE_NAME_LEN + 1 bytes
+)
+{
+    static const char digits[] = "0123456789abcdef";
+    int i;
+
+    for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+        hexPtr[2 * i] = digits[hashPtr[i] >> 4];
+        hexPtr[2 * i + 1] = digits[hashPtr[i] & 0x0F];
+    }
+    hexPtr[BASE_NAME_LEN] = '\0';
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a whole buffer, retrying on signals and partial writes
+ *
+ * @return LE_OK on success, LE_FAULT otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteAll
+(
+    int             fd,         ///< [IN] File descriptor
+    const uint8_t*  bufPtr,     ///< [IN] Data
+    size_t          len         ///< [IN] Data length
+)
+{
+    while (len > 0)
+    {
+        ssize_t count = write(fd, bufPtr, len);
+
+        if (-1 == count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            LE_ERROR("Failed to write target: %m");
+            return LE_FAULT;
+        }
+        bufPtr += count;
+        len -= count;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Produce target bytes: hash them, then write them or hold them back if they belong to the tail
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the target exceeds its size
+ *      - LE_FAULT if the target can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Emit
+(
+    DeltaCtx_t*     ctxPtr,     ///< [IN] Delta context
+    const uint8_t*  bufPtr,     ///< [IN] Target bytes
+    size_t          len         ///< [IN] Number of bytes
+)
+{
+    uint64_t tailStart;
+    size_t directLen = len;
+
+    if (len > ctxPtr->targetSize - ctxPtr->outSize)
+    {
+        LE_ERROR("Delta produces more than %" PRIu64 " bytes", ctxPtr->targetSize);
+        return LE_FORMAT_ERROR;
+    }
+
+    SHA256_Update(&ctxPtr->sha, bufPtr, len);
+
+    tailStart = (ctxPtr->targetSize > DELTAPATCH_TAIL_BYTES) ?
+                ctxPtr->targetSize - DELTAPATCH_TAIL_BYTES : 0;
+    if (ctxPtr->outSize + len > tailStart)
+    {
+        directLen = (ctxPtr->outSize < tailStart) ? (size_t)(tailStart - ctxPtr->outSize) : 0;
+    }
+
+    if ((directLen > 0) && (LE_OK != WriteAll(ctxPtr->outFd, bufPtr, directLen)))
+    {
+        return LE_FAULT;
+    }
+
+    memcpy(ctxPtr->tail + ctxPtr->tailLen, bufPtr + directLen, len - directLen);
+    ctxPtr->tailLen += len - directLen;
+    ctxPtr->outSize += len;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the header and open the base
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the magic is wrong
+ *      - LE_NOT_FOUND if the base is not available
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseHeader
+(
+    DeltaCtx_t*     ctxPtr      ///< [IN] Delta context
+)
+{
+    const uint8_t* hdrPtr = ctxPtr->header;
+    char baseName[BASE_NAME_LEN + 1];
+    char basePath[PATH_MAX_BYTES];
+    struct stat st;
+
+    if (!deltaPatch_IsDelta(hdrPtr, HEADER_LEN))
+    {
+        LE_ERROR("Not a delta package");
+        return LE_FORMAT_ERROR;
+    }
+    hdrPtr += DELTAPATCH_MAGIC_LEN;
+
+    ctxPtr->baseSize = GetBe(hdrPtr, 8);
+    hdrPtr += 8;
+    HashToHex(hdrPtr, baseName);
+    hdrPtr += SHA256_DIGEST_LENGTH;
+    ctxPtr->targetSize = GetBe(hdrPtr, 8);
+    hdrPtr += 8;
+    memcpy(ctxPtr->targetHash, hdrPtr, SHA256_DIGEST_LENGTH);
+
+    if (snprintf(basePath, sizeof(basePath), "%s/%s", ctxPtr->baseDir, baseName)
+        >= sizeof(basePath))
+    {
+        LE_ERROR("Base path too long");
+        return LE_NOT_FOUND;
+    }
+
+    ctxPtr->baseFd = open(basePath, O_RDONLY);
+    if (-1 == ctxPtr->baseFd)
+    {
+        LE_ERROR("Delta base %s not available: %m", baseName);
+        return LE_NOT_FOUND;
+    }
+
+    if ((0 != fstat(ctxPtr->baseFd, &st)) || ((uint64_t)st.st_size != ctxPtr->baseSize))
+    {
+        LE_ERROR("Delta base %s doesn't have the expected size %" PRIu64,
+                 baseName, ctxPtr->baseSize);
+        return LE_NOT_FOUND;
+    }
+
+    // Mark the base as recently used, so that it is not evicted by deltaPatch_KeepBase()
+    futimens(ctxPtr->baseFd, NULL);
+
+    LE_INFO("Applying delta on base %s: %" PRIu64 " -> %" PRIu64 " bytes",
+            baseName, ctxPtr->baseSize, ctxPtr->targetSize);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy a range of the base to the target
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the range is outside of the base or the target
+ *      - LE_FAULT if the base can't be read or the target can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CopyBase
+(
+    DeltaCtx_t*     ctxPtr,     ///< [IN] Delta context
+    uint64_t        offset,     ///< [IN] Base offset
+    uint32_t        len         ///< [IN] Number of bytes
+)
+{
+    le_result_t result;
+
+    if ((offset > ctxPtr->baseSize) || (len > ctxPtr->baseSize - offset))
+    {
+        LE_ERROR("COPY %" PRIu64 "+%" PRIu32 " outside of the base", offset, len);
+        return LE_FORMAT_ERROR;
+    }
+
+    ctxPtr->stats.copyBytes += len;
+
+    while (len > 0)
+    {
+        size_t chunk = (len < sizeof(ctxPtr->copyBuf)) ? len : sizeof(ctxPtr->copyBuf);
+        ssize_t count = pread(ctxPtr->baseFd, ctxPtr->copyBuf, chunk, offset);
+
+        if (-1 == count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            LE_ERROR("Failed to read the base: %m");
+            return LE_FAULT;
+        }
+        if (0 == count)
+        {
+            LE_ERROR("Base truncated at %" PRIu64, offset);
+            return LE_FAULT;
+        }
+
+        result = Emit(ctxPtr, ctxPtr->copyBuf, count);
+        if (LE_OK != result)
+        {
+            return result;
+        }
+        offset += count;
+        len -= count;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the arguments of the current command
+ *
+ * @return LE_OK on success, or the error of the command
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunCommand
+(
+    DeltaCtx_t*     ctxPtr      ///< [IN] Delta context
+)
+{
+    ctxPtr->stats.commands++;
+
+    if (CMD_COPY == ctxPtr->command)
+    {
+        ctxPtr->state = STATE_COMMAND;
+        return CopyBase(ctxPtr, GetBe(ctxPtr->header, 8), (uint32_t)GetBe(ctxPtr->header + 8, 4));
+    }
+
+    ctxPtr->addLeft = (uint32_t)GetBe(ctxPtr->header, 4);
+    ctxPtr->stats.addBytes += ctxPtr->addLeft;
+    ctxPtr->state = (ctxPtr->addLeft > 0) ? STATE_ADD_DATA : STATE_COMMAND;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a delta context
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeleteCtx
+(
+    DeltaCtx_t*     ctxPtr      ///< [IN] Delta context
+)
+{
+    if (-1 != ctxPtr->baseFd)
+    {
+        close(ctxPtr->baseFd);
+    }
+    le_mem_Release(ctxPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hash a whole file
+ *
+ * @return LE_OK on success, LE_FAULT otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t HashFile
+(
+    const char*     pathPtr,    ///< [IN] File path
+    uint8_t*        hashPtr     ///< [OUT] SHA-256 of the file
+)
+{
+    uint8_t buf[COPY_BUF_SIZE];
+    SHA256_CTX sha;
+    ssize_t count;
+    int fd;
+
+    fd = open(pathPtr, O_RDONLY);
+    if (-1 == fd)
+    {
+        LE_ERROR("Failed to open %s: %m", pathPtr);
+        return LE_FAULT;
+    }
+
+    SHA256_Init(&sha);
+    do
+    {
+        count = read(fd, buf, sizeof(buf));
+        if (count > 0)
+        {
+            SHA256_Update(&sha, buf, count);
+        }
+    }
+    while ((count > 0) || ((-1 == count) && (EINTR == errno)));
+    close(fd);
+
+    if (-1 == count)
+    {
+        LE_ERROR("Failed to read %s: %m", pathPtr);
+        return LE_FAULT;
+    }
+
+    SHA256_Final(hashPtr, &sha);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the least recently used bases to keep at most maxBases of them
+ */
+//--------------------------------------------------------------------------------------------------
+static void EvictBases
+(
+    const char*     baseDirPtr,     ///< [IN] Directory holding the bases
+    uint32_t        maxBases        ///< [IN] Maximum number of bases kept
+)
+{
+    char path[PATH_MAX_BYTES];
+    char oldestName[BASE_NAME_LEN + 1];
+    time_t oldestTime;
+    uint32_t count;
+
+    do
+    {
+        DIR* dirPtr = opendir(baseDirPtr);
+        struct dirent* entryPtr;
+
+        if (NULL == dirPtr)
+        {
+            return;
+        }
+
+        count = 0;
+        oldestTime = 0;
+        while (NULL != (entryPtr = readdir(dirPtr)))
+        {
+            struct stat st;
+
+            if ((BASE_NAME_LEN != strlen(entryPtr->d_name))
+                || (snprintf(path, sizeof(path), "%s/%s", baseDirPtr, entryPtr->d_name)
+                    >= sizeof(path))
+                || (0 != stat(path, &st)) || !S_ISREG(st.st_mode))
+            {
+                continue;
+            }
+
+            if ((0 == count) || (st.st_mtime < oldestTime))
+            {
+                oldestTime = st.st_mtime;
+                le_utf8_Copy(oldestName, entryPtr->d_name, sizeof(oldestName), NULL);
+            }
+            count++;
+        }
+        closedir(dirPtr);
+
+        if (count > maxBases)
+        {
+            snprintf(path, sizeof(path), "%s/%s", baseDirPtr, oldestName);
+            LE_INFO("Removing delta base %s", oldestName);
+            if (0 != unlink(path))
+            {
+                LE_ERROR("Failed to remove %s: %m", path);
+                return;
+            }
+        }
+    }
+    while (count > maxBases + 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if a package starts with the delta magic
+ *
+ * @return true if the package is a delta
+ */
+//--------------------------------------------------------------------------------------------------
+bool deltaPatch_IsDelta
+(
+    const uint8_t*  bufPtr,         ///< [IN] Start of the package
+    size_t          len             ///< [IN] Number of bytes available
+)
+{
+    return (len >= DELTAPATCH_MAGIC_LEN)
+           && (0 == memcmp(bufPtr, DELTAPATCH_MAGIC, DELTAPATCH_MAGIC_LEN));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start applying a delta
+ *
+ * @return the delta reference, NULL if the base directory path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+deltaPatch_Ref_t deltaPatch_Start
+(
+    const char*     baseDirPtr,     ///< [IN] Directory holding the bases
+    int             outFd           ///< [IN] File descriptor receiving the target
+)
+{
+    DeltaCtx_t* ctxPtr;
+
+    if (NULL == DeltaPool)
+    {
+        DeltaPool = le_mem_CreatePool("DeltaPatch", sizeof(DeltaCtx_t));
+    }
+
+    ctxPtr = le_mem_ForceAlloc(DeltaPool);
+    memset(ctxPtr, 0, offsetof(DeltaCtx_t, tail));
+    ctxPtr->state = STATE_HEADER;
+    ctxPtr->outFd = outFd;
+    ctxPtr->baseFd = -1;
+    SHA256_Init(&ctxPtr->sha);
+
+    if (LE_OK != le_utf8_Copy(ctxPtr->baseDir, baseDirPtr, sizeof(ctxPtr->baseDir), NULL))
+    {
+        LE_ERROR("Base directory path too long");
+        le_mem_Release(ctxPtr);
+        return NULL;
+    }
+
+    return ctxPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply the next bytes of a delta. Any error is final: the following calls fail.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if the base is not available, or doesn't have the expected size
+ *      - LE_FORMAT_ERROR if the delta is malformed
+ *      - LE_FAULT if the base can't be read or the target can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_Write
+(
+    deltaPatch_Ref_t    deltaRef,   ///< [IN] Delta reference
+    const uint8_t*      bufPtr,     ///< [IN] Delta bytes
+    size_t              len         ///< [IN] Number of bytes
+)
+{
+    le_result_t result = LE_OK;
+    size_t count;
+
+    if (STATE_FAILED == deltaRef->state)
+    {
+        return LE_FAULT;
+    }
+
+    deltaRef->stats.deltaBytes += len;
+
+    while ((len > 0) && (LE_OK == result))
+    {
+        switch (deltaRef->state)
+        {
+            case STATE_HEADER:
+            case STATE_ARGS:
+                count = ((STATE_HEADER == deltaRef->state) ? HEADER_LEN : deltaRef->argsLen)
+                        - deltaRef->headerLen;
+                count = (len < count) ? len : count;
+                memcpy(deltaRef->header + deltaRef->headerLen, bufPtr, count);
+                deltaRef->headerLen += count;
+
+                if (STATE_HEADER == deltaRef->state)
+                {
+                    if (HEADER_LEN == deltaRef->headerLen)
+                    {
+                        result = ParseHeader(deltaRef);
+                        deltaRef->state = STATE_COMMAND;
+                    }
+                }
+                else if (deltaRef->argsLen == deltaRef->headerLen)
+                {
+                    result = RunCommand(deltaRef);
+                }
+                break;
+
+            case STATE_COMMAND:
+                count = 1;
+                deltaRef->command = *bufPtr;
+                deltaRef->headerLen = 0;
+                switch (deltaRef->command)
+                {
+                    case CMD_END:
+                        deltaRef->state = STATE_END;
+                        break;
+
+                    case CMD_COPY:
+                        deltaRef->argsLen = COPY_ARGS_LEN;
+                        deltaRef->state = STATE_ARGS;
+                        break;
+
+                    case CMD_ADD:
+                        deltaRef->argsLen = ADD_ARGS_LEN;
+                        deltaRef->state = STATE_ARGS;
+                        break;
+
+                    default:
+                        LE_ERROR("Unknown delta command 0x%02x", deltaRef->command);
+                        result = LE_FORMAT_ERROR;
+                        break;
+                }
+                break;
+
+            case STATE_ADD_DATA:
+                count = (len < deltaRef->addLeft) ? len : deltaRef->addLeft;
+                result = Emit(deltaRef, bufPtr, count);
+                deltaRef->addLeft -= count;
+                if (0 == deltaRef->addLeft)
+                {
+                    deltaRef->state = STATE_COMMAND;
+                }
+                break;
+
+            default:
+                LE_ERROR("%zu bytes after the end of the delta", len);
+                count = len;
+                result = LE_FORMAT_ERROR;
+                break;
+        }
+
+        bufPtr += count;
+        len -= count;
+    }
+
+    if (LE_OK != result)
+    {
+        deltaRef->state = STATE_FAILED;
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the whole delta was received, up to its END command
+ *
+ * @return true if the delta is complete
+ */
+//--------------------------------------------------------------------------------------------------
+bool deltaPatch_IsComplete
+(
+    deltaPatch_Ref_t    deltaRef    ///< [IN] Delta reference
+)
+{
+    return (STATE_END == deltaRef->state);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of a delta application
+ */
+//--------------------------------------------------------------------------------------------------
+void deltaPatch_GetStats
+(
+    deltaPatch_Ref_t    deltaRef,   ///< [IN] Delta reference
+    deltaPatch_Stats_t* statsPtr    ///< [OUT] Statistics
+)
+{
+    *statsPtr = deltaRef->stats;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Verify the target and write its last bytes, then release the delta
+ *
+ * @return
+ *      - LE_OK if the target is complete and matches the target hash
+ *      - LE_FORMAT_ERROR if the delta is truncated or the target doesn't match its size or hash
+ *      - LE_FAULT if the delta already failed or the target can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_Finish
+(
+    deltaPatch_Ref_t    deltaRef    ///< [IN] Delta reference
+)
+{
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    le_result_t result = LE_OK;
+
+    switch (deltaRef->state)
+    {
+        case STATE_END:
+            SHA256_Final(hash, &deltaRef->sha);
+            if (deltaRef->outSize != deltaRef->targetSize)
+            {
+                LE_ERROR("Target has %" PRIu64 " bytes, expected %" PRIu64,
+                         deltaRef->outSize, deltaRef->targetSize);
+                result = LE_FORMAT_ERROR;
+            }
+            else if (0 != memcmp(hash, deltaRef->targetHash, sizeof(hash)))
+            {
+                LE_ERROR("Target hash mismatch");
+                result = LE_FORMAT_ERROR;
+            }
+            else
+            {
+                result = WriteAll(deltaRef->outFd, deltaRef->tail, deltaRef->tailLen);
+            }
+            break;
+
+        case STATE_FAILED:
+            result = LE_FAULT;
+            break;
+
+        default:
+            LE_ERROR("Delta truncated after %" PRIu64 " bytes", deltaRef->stats.deltaBytes);
+            result = LE_FORMAT_ERROR;
+            break;
+    }
+
+    DeleteCtx(deltaRef);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a delta without verifying the target. The held back bytes are not written.
+ */
+//--------------------------------------------------------------------------------------------------
+void deltaPatch_Abort
+(
+    deltaPatch_Ref_t    deltaRef    ///< [IN] Delta reference
+)
+{
+    DeleteCtx(deltaRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a new empty package file, replacing the file at this path if any. The previous file is
+ * unlinked rather than truncated: it may be a base kept by deltaPatch_KeepBase(), which shares its
+ * content.
+ *
+ * @return the file descriptor open for writing, -1 on error
+ */
+//--------------------------------------------------------------------------------------------------
+int deltaPatch_CreateFile
+(
+    const char*     pathPtr,        ///< [IN] Package file
+    mode_t          mode            ///< [IN] Mode of the new file
+)
+{
+    int fd;
+
+    if ((0 != unlink(pathPtr)) && (ENOENT != errno))
+    {
+        LE_ERROR("Failed to remove %s: %m", pathPtr);
+        return -1;
+    }
+
+    fd = open(pathPtr, O_WRONLY | O_CREAT | O_EXCL, mode);
+    if (-1 == fd)
+    {
+        LE_ERROR("Failed to create %s: %m", pathPtr);
+    }
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a delta file, replacing the target file
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if the base is not available
+ *      - LE_FORMAT_ERROR if the delta is malformed or the target doesn't match
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_ApplyFile
+(
+    const char*         deltaPathPtr,   ///< [IN] Delta file
+    const char*         targetPathPtr,  ///< [IN] Target file
+    const char*         baseDirPtr,     ///< [IN] Directory holding the bases
+    deltaPatch_Stats_t* statsPtr        ///< [OUT] Statistics, may be NULL
+)
+{
+    uint8_t buf[COPY_BUF_SIZE];
+    deltaPatch_Ref_t deltaRef;
+    le_result_t result = LE_OK;
+    ssize_t count;
+    int deltaFd;
+    int targetFd;
+
+    deltaFd = open(deltaPathPtr, O_RDONLY);
+    if (-1 == deltaFd)
+    {
+        LE_ERROR("Failed to open %s: %m", deltaPathPtr);
+        return LE_FAULT;
+    }
+
+    targetFd = deltaPatch_CreateFile(targetPathPtr, S_IRUSR | S_IWUSR);
+    if (-1 == targetFd)
+    {
+        close(deltaFd);
+        return LE_FAULT;
+    }
+
+    deltaRef = deltaPatch_Start(baseDirPtr, targetFd);
+    if (NULL == deltaRef)
+    {
+        close(targetFd);
+        close(deltaFd);
+        return LE_FAULT;
+    }
+
+    do
+    {
+        count = read(deltaFd, buf, sizeof(buf));
+        if (count > 0)
+        {
+            result = deltaPatch_Write(deltaRef, buf, count);
+        }
+    }
+    while ((LE_OK == result) && ((count > 0) || ((-1 == count) && (EINTR == errno))));
+
+    if (-1 == count)
+    {
+        LE_ERROR("Failed to read %s: %m", deltaPathPtr);
+        result = LE_FAULT;
+    }
+
+    if (NULL != statsPtr)
+    {
+        deltaPatch_GetStats(deltaRef, statsPtr);
+    }
+
+    if (LE_OK == result)
+    {
+        result = deltaPatch_Finish(deltaRef);
+    }
+    else
+    {
+        deltaPatch_Abort(deltaRef);
+    }
+
+    // The target replaces a package on flash: make sure it is complete before it is used
+    if ((LE_OK == result) && (0 != fsync(targetFd)))
+    {
+        LE_ERROR("Failed to sync %s: %m", targetPathPtr);
+        result = LE_FAULT;
+    }
+
+    close(targetFd);
+    close(deltaFd);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep a complete package as a base for the next deltas. The package is hard linked into the base
+ * directory under the name of its SHA-256, and the least recently used bases are removed to keep
+ * at most maxBases of them.
+ *
+ * The package file must not be written in place afterwards: a new package is created at its path
+ * with deltaPatch_CreateFile().
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_UNSUPPORTED if the package and the base directory are not on the same file system
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_KeepBase
+(
+    const char*     pathPtr,        ///< [IN] Package
+    const char*     baseDirPtr,     ///< [IN] Directory holding the bases
+    uint32_t        maxBases        ///< [IN] Maximum number of bases kept
+)
+{
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    char baseName[BASE_NAME_LEN + 1];
+    char basePath[PATH_MAX_BYTES];
+
+    if (LE_OK != HashFile(pathPtr, hash))
+    {
+        return LE_FAULT;
+    }
+    HashToHex(hash, baseName);
+
+    if (snprintf(basePath, sizeof(basePath), "%s/%s", baseDirPtr, baseName) >= sizeof(basePath))
+    {
+        LE_ERROR("Base path too long");
+        return LE_FAULT;
+    }
+
+    if (LE_OK != le_dir_MakePath(baseDirPtr, S_IRWXU))
+    {
+        LE_ERROR("Failed to create %s", baseDirPtr);
+        return LE_FAULT;
+    }
+
+    if (0 != link(pathPtr, basePath))
+    {
+        if (EEXIST == errno)
+        {
+            // Already kept: mark it as recently used
+            utimensat(AT_FDCWD, basePath, NULL, 0);
+        }
+        else if (EXDEV == errno)
+        {
+            LE_ERROR("%s is not on the file system of %s", pathPtr, baseDirPtr);
+            return LE_UNSUPPORTED;
+        }
+        else
+        {
+            LE_ERROR("Failed to link %s to %s: %m", pathPtr, basePath);
+            return LE_FAULT;
+        }
+    }
+    else
+    {
+        // The link shares the times of the package: mark it as the most recently used base
+        utimensat(AT_FDCWD, basePath, NULL, 0);
+        LE_INFO("Keeping delta base %s", baseName);
+    }
+
+    EvictBases(baseDirPtr, maxBases);
+
+    return LE_OK;
+}
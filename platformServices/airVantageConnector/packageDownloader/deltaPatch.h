@@ -0,0 +1,226 @@
+/**
+ * @file deltaPatch.h
+ *
+ * Binary delta packages.
+ *
+ * A delta package rebuilds an update package (the target) from a package already present on the
+ * device (the base), by copying ranges of the base and adding the new bytes it carries. Its
+ * integers are big-endian:
+ *
+ * @verbatim
+ *  Header:  "LEDELTA1" baseSize(8) baseSha256(32) targetSize(8) targetSha256(32)
+ *  END:     0x00
+ *  COPY:    0x01 offset(8) length(4)       copy length bytes of the base from offset
+ *  ADD:     0x02 length(4) data(length)    add the following length bytes
+ * @endverbatim
+ *
+ * The delta is applied as it is received: the base is looked up in a base directory, where it
+ * is named by the hexadecimal SHA-256 of its content, and the target is written to a file
+ * descriptor while its SHA-256 is computed. The last DELTAPATCH_TAIL_BYTES of the target are only
+ * written once its size and hash are verified, so that a consumer of the output never receives a
+ * complete image which doesn't match the target hash.
+ *
+ * Deltas are generated by the mkdelta tool.
+ *
+ * <HR>
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+
+#ifndef _DELTAPATCH_H
+#define _DELTAPATCH_H
+
+#include <legato.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delta package magic, at the start of the header
+ */
+//--------------------------------------------------------------------------------------------------
+#define DELTAPATCH_MAGIC            "LEDELTA1"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delta package magic length
+ */
+//--------------------------------------------------------------------------------------------------
+#define DELTAPATCH_MAGIC_LEN        8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of bytes at the end of the target held back until the target is verified
+ */
+//--------------------------------------------------------------------------------------------------
+#define DELTAPATCH_TAIL_BYTES       4096
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a delta being applied
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct deltaPatch_Ctx* deltaPatch_Ref_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of a delta application
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t deltaBytes;        ///< Number of delta bytes received
+    uint64_t copyBytes;         ///< Number of target bytes copied from the base
+    uint64_t addBytes;          ///< Number of target bytes added by the delta
+    uint32_t commands;          ///< Number of COPY and ADD commands
+}
+deltaPatch_Stats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if a package starts with the delta magic
+ *
+ * @return true if the package is a delta
+ */
+//--------------------------------------------------------------------------------------------------
+bool deltaPatch_IsDelta
+(
+    const uint8_t*  bufPtr,         ///< [IN] Start of the package
+    size_t          len             ///< [IN] Number of bytes available
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start applying a delta
+ *
+ * @return the delta reference, NULL if the base directory path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+deltaPatch_Ref_t deltaPatch_Start
+(
+    const char*     baseDirPtr,     ///< [IN] Directory holding the bases
+    int             outFd           ///< [IN] File descriptor receiving the target
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply the next bytes of a delta. Any error is final: the following calls fail.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if the base is not available, or doesn't have the expected size
+ *      - LE_FORMAT_ERROR if the delta is malformed
+ *      - LE_FAULT if the base can't be read or the target can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_Write
+(
+    deltaPatch_Ref_t    deltaRef,   ///< [IN] Delta reference
+    const uint8_t*      bufPtr,     ///< [IN] Delta bytes
+    size_t              len         ///< [IN] Number of bytes
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the whole delta was received, up to its END command
+ *
+ * @return true if the delta is complete
+ */
+//--------------------------------------------------------------------------------------------------
+bool deltaPatch_IsComplete
+(
+    deltaPatch_Ref_t    deltaRef    ///< [IN] Delta reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of a delta application
+ */
+//--------------------------------------------------------------------------------------------------
+void deltaPatch_GetStats
+(
+    deltaPatch_Ref_t    deltaRef,   ///< [IN] Delta reference
+    deltaPatch_Stats_t* statsPtr    ///< [OUT] Statistics
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Verify the target and write its last bytes, then release the delta
+ *
+ * @return
+ *      - LE_OK if the target is complete and matches the target hash
+ *      - LE_FORMAT_ERROR if the delta is truncated or the target doesn't match its size or hash
+ *      - LE_FAULT if the delta already failed or the target can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_Finish
+(
+    deltaPatch_Ref_t    deltaRef    ///< [IN] Delta reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a delta without verifying the target. The held back bytes are not written.
+ */
+//--------------------------------------------------------------------------------------------------
+void deltaPatch_Abort
+(
+    deltaPatch_Ref_t    deltaRef    ///< [IN] Delta reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a new empty package file, replacing the file at this path if any. The previous file is
+ * unlinked rather than truncated: it may be a base kept by deltaPatch_KeepBase(), which shares its
+ * content.
+ *
+ * @return the file descriptor open for writing, -1 on error
+ */
+//--------------------------------------------------------------------------------------------------
+int deltaPatch_CreateFile
+(
+    const char*     pathPtr,        ///< [IN] Package file
+    mode_t          mode            ///< [IN] Mode of the new file
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a delta file, replacing the target file
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if the base is not available
+ *      - LE_FORMAT_ERROR if the delta is malformed or the target doesn't match
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_ApplyFile
+(
+    const char*         deltaPathPtr,   ///< [IN] Delta file
+    const char*         targetPathPtr,  ///< [IN] Target file
+    const char*         baseDirPtr,     ///< [IN] Directory holding the bases
+    deltaPatch_Stats_t* statsPtr        ///< [OUT] Statistics, may be NULL
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep a complete package as a base for the next deltas. The package is hard linked into the base
+ * directory under the name of its SHA-256, and the least recently used bases are removed to keep
+ * at most maxBases of them.
+ *
+ * The package file must not be written in place afterwards: a new package is created at its path
+ * with deltaPatch_CreateFile().
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_UNSUPPORTED if the package and the base directory are not on the same file system
+ *      - LE_FAULT on any other error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t deltaPatch_KeepBase
+(
+    const char*     pathPtr,        ///< [IN] Package
+    const char*     baseDirPtr,     ///< [IN] Directory holding the bases
+    uint32_t        maxBases        ///< [IN] Maximum number of bases kept
+);
+
+#endif /* _DELTAPATCH_H */
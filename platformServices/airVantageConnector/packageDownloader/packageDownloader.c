@@ -9,6 +9,7 @@
 
 #include <legato.h>
 #include <interfaces.h>
+#include <sys/eventfd.h>
 #include <lwm2mcorePackageDownloader.h>
 #include <lwm2mcore/update.h>
 #include <lwm2mcore/security.h>
@@ -18,6 +19,7 @@
 #include "avcFs.h"
 #include "avcFsConfig.h"
 #include "sslUtilities.h"
+#include "deltaPatch.h"
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -83,6 +85,37 @@ static pthread_mutex_t DownloadStatusMutex = PTHREAD_MUTEX_INITIALIZER;
 //--------------------------------------------------------------------------------------------------
 static le_sem_Ref_t DownloadAbortSemaphore = NULL;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer used to read a FW delta package
+ */
+//--------------------------------------------------------------------------------------------------
+#define FW_DELTA_BUF_SIZE           (16*1024)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delay before peeking again at the beginning of a package received in several parts, in ms
+ */
+//--------------------------------------------------------------------------------------------------
+#define PEEK_RETRY_DELAY            10
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * FW delta package application: the delta is read from the download FIFO, and the rebuilt package
+ * is written to a pipe read by the FW update process.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int             fifoFd;         ///< Download FIFO, providing the delta package
+    int             readFd;         ///< Read end of the pipe to the FW update process
+    int             outFd;          ///< Write end of the pipe, receiving the rebuilt package
+    int             stopFd;         ///< Event stopping the delta application
+    le_thread_Ref_t threadRef;      ///< Delta application thread, NULL if not started
+    le_result_t     result;         ///< Result of the delta application
+}
+FwDelta_t;
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Send a registration update to the server in order to follow the update treatment
@@ -980,6 +1013,320 @@ void* packageDownloader_DownloadPackage
     return (void*)&ret;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the FW package being downloaded is a delta package
+ *
+ * @return true if it is a delta package
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsFwDeltaDownload
+(
+    void
+)
+{
+    bool isDelta = false;
+    size_t size = sizeof(isDelta);
+
+    if (LE_OK != ReadFs(FW_UPDATE_DELTA_PATH, (uint8_t*)&isDelta, &size))
+    {
+        return false;
+    }
+
+    return isDelta;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the first bytes of the package from the download FIFO, without consuming them
+ *
+ * @return the number of bytes read, less than len if the download ended before, -1 on error
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t PeekPackage
+(
+    int         fd,         ///< [IN] Download FIFO
+    uint8_t*    bufPtr,     ///< [OUT] First bytes of the package
+    size_t      len         ///< [IN] Number of bytes to read
+)
+{
+    struct pollfd pollFd = { .fd = fd, .events = POLLIN };
+    int pipeFds[2];
+    ssize_t count;
+    bool hangUp;
+
+    if (-1 == pipe(pipeFds))
+    {
+        LE_ERROR("Failed to create pipe: %m");
+        return -1;
+    }
+
+    // Duplicate the beginning of the FIFO content in a pipe: it is left in the FIFO for the
+    // FW update process
+    for (;;)
+    {
+        hangUp = (1 == poll(&pollFd, 1, 0)) && (pollFd.revents & POLLHUP);
+
+        count = tee(fd, pipeFds[1], len, SPLICE_F_NONBLOCK);
+        if ((count >= (ssize_t)len) || (0 == count) || hangUp
+            || ((-1 == count) && (EAGAIN != errno) && (EINTR != errno)))
+        {
+            break;
+        }
+
+        if (-1 == count)
+        {
+            // Nothing received yet
+            poll(&pollFd, 1, -1);
+        }
+        else
+        {
+            // Only a part of the beginning was received
+            usleep(PEEK_RETRY_DELAY * 1000);
+        }
+    }
+
+    if (count > 0)
+    {
+        count = read(pipeFds[0], bufPtr, count);
+    }
+    else if (-1 == count)
+    {
+        LE_ERROR("Failed to peek at the package: %m");
+    }
+
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    return (count > 0) ? count : ((0 == count) ? 0 : -1);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the delta package from the download FIFO, until the delta application is stopped
+ *
+ * @return the number of bytes read, 0 at the end of the download, -1 on error or stop
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t ReadFwDelta
+(
+    FwDelta_t*  fwDeltaPtr,     ///< [IN] FW delta package application
+    uint8_t*    bufPtr,         ///< [OUT] Buffer
+    size_t      len             ///< [IN] Buffer size
+)
+{
+    struct pollfd pollFds[2] =
+    {
+        { .fd = fwDeltaPtr->fifoFd, .events = POLLIN },
+        { .fd = fwDeltaPtr->stopFd, .events = POLLIN },
+    };
+    ssize_t count;
+
+    for (;;)
+    {
+        if (-1 == poll(pollFds, 2, -1))
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        if (pollFds[1].revents & POLLIN)
+        {
+            errno = ECANCELED;
+            return -1;
+        }
+
+        count = read(fwDeltaPtr->fifoFd, bufPtr, len);
+        if ((-1 == count) && ((EAGAIN == errno) || (EINTR == errno)))
+        {
+            continue;
+        }
+
+        return count;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * FW delta package application thread function
+ */
+//--------------------------------------------------------------------------------------------------
+static void* ApplyFwDelta
+(
+    void* ctxPtr    ///< FW delta package application
+)
+{
+    FwDelta_t* fwDeltaPtr = (FwDelta_t*)ctxPtr;
+    uint8_t buf[FW_DELTA_BUF_SIZE];
+    deltaPatch_Ref_t deltaRef;
+    deltaPatch_Stats_t stats;
+    le_result_t result;
+    ssize_t count;
+
+    deltaRef = deltaPatch_Start(FW_DELTA_BASE_DIR, fwDeltaPtr->outFd);
+    result = (NULL != deltaRef) ? LE_OK : LE_FAULT;
+
+    // The download FIFO is closed once the FW update process is done: stop at the end of the delta
+    while ((LE_OK == result) && !deltaPatch_IsComplete(deltaRef))
+    {
+        count = ReadFwDelta(fwDeltaPtr, buf, sizeof(buf));
+        if (count > 0)
+        {
+            result = deltaPatch_Write(deltaRef, buf, count);
+        }
+        else if (0 == count)
+        {
+            LE_ERROR("Delta FW package download interrupted");
+            result = LE_CLOSED;
+        }
+        else
+        {
+            LE_ERROR("Failed to read delta FW package: %m");
+            result = LE_FAULT;
+        }
+    }
+
+    if (NULL != deltaRef)
+    {
+        deltaPatch_GetStats(deltaRef, &stats);
+        if (LE_OK == result)
+        {
+            result = deltaPatch_Finish(deltaRef);
+        }
+        else
+        {
+            deltaPatch_Abort(deltaRef);
+        }
+    }
+
+    if (LE_OK == result)
+    {
+        LE_INFO("Delta FW package of %" PRIu64 " bytes applied: %" PRIu64 " bytes copied, %"
+                PRIu64 " bytes added", stats.deltaBytes, stats.copyBytes, stats.addBytes);
+    }
+
+    // Signal the end of the package to the FW update process
+    close(fwDeltaPtr->outFd);
+    fwDeltaPtr->outFd = -1;
+
+    // After an error, discard the rest of the download until it is aborted
+    while ((LE_OK != result) && (ReadFwDelta(fwDeltaPtr, buf, sizeof(buf)) > 0))
+    {
+    }
+
+    fwDeltaPtr->result = result;
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start applying the FW package if it is a delta package
+ *
+ * @return
+ *  - LE_OK             The package is a delta package, to be read from fwDeltaPtr->readFd
+ *  - LE_NOT_FOUND      The package is a complete package, to be read from the download FIFO
+ *  - LE_FAULT          The function failed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartFwDelta
+(
+    FwDelta_t*  fwDeltaPtr,     ///< [OUT] FW delta package application
+    int         fifoFd          ///< [IN] Download FIFO
+)
+{
+    uint8_t magic[DELTAPATCH_MAGIC_LEN];
+    int pipeFds[2];
+    ssize_t count;
+    bool isDelta;
+
+    fwDeltaPtr->threadRef = NULL;
+
+    count = PeekPackage(fifoFd, magic, sizeof(magic));
+    if (-1 == count)
+    {
+        return LE_FAULT;
+    }
+
+    // Remember the package type: a delta package download can't be resumed
+    isDelta = deltaPatch_IsDelta(magic, count);
+    if (LE_OK != WriteFs(FW_UPDATE_DELTA_PATH, (uint8_t*)&isDelta, sizeof(isDelta)))
+    {
+        LE_ERROR("Failed to save the FW package type");
+        return LE_FAULT;
+    }
+
+    if (!isDelta)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    LE_INFO("Downloading a delta FW package");
+
+    if (-1 == pipe(pipeFds))
+    {
+        LE_ERROR("Failed to create pipe: %m");
+        return LE_FAULT;
+    }
+
+    fwDeltaPtr->stopFd = eventfd(0, 0);
+    if (-1 == fwDeltaPtr->stopFd)
+    {
+        LE_ERROR("Failed to create eventfd: %m");
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return LE_FAULT;
+    }
+
+    // Provide the rebuilt package to the FW update process in non blocking mode, like the FIFO
+    fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL) | O_NONBLOCK);
+
+    fwDeltaPtr->fifoFd = fifoFd;
+    fwDeltaPtr->readFd = pipeFds[0];
+    fwDeltaPtr->outFd = pipeFds[1];
+    fwDeltaPtr->result = LE_OK;
+    fwDeltaPtr->threadRef = le_thread_Create("FwDelta", ApplyFwDelta, fwDeltaPtr);
+    le_thread_SetJoinable(fwDeltaPtr->threadRef);
+    le_thread_Start(fwDeltaPtr->threadRef);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the FW delta package application, if started
+ *
+ * @return the result of the delta application, LE_OK if there is none
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StopFwDelta
+(
+    FwDelta_t*  fwDeltaPtr      ///< [IN] FW delta package application
+)
+{
+    uint64_t event = 1;
+
+    if (NULL == fwDeltaPtr->threadRef)
+    {
+        return fwDeltaPtr->result;
+    }
+
+    // Unblock the thread if it is still reading the download
+    if (-1 == write(fwDeltaPtr->stopFd, &event, sizeof(event)))
+    {
+        LE_ERROR("Failed to stop the delta FW package application: %m");
+    }
+
+    le_thread_Join(fwDeltaPtr->threadRef, NULL);
+    fwDeltaPtr->threadRef = NULL;
+    close(fwDeltaPtr->stopFd);
+
+    return fwDeltaPtr->result;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Store FW package thread function
@@ -992,6 +1339,8 @@ void* packageDownloader_StoreFwPackage
 {
     lwm2mcore_PackageDownloader_t* pkgDwlPtr;
     packageDownloader_DownloadCtx_t* dwlCtxPtr;
+    FwDelta_t fwDelta = { .threadRef = NULL, .result = LE_OK };
+    le_result_t deltaStartResult;
     le_result_t result;
     int fd;
     int ret = 0;
@@ -1050,7 +1399,37 @@ void* packageDownloader_StoreFwPackage
     // started and not before the user agreed to the download.
     le_sem_Wait(dwlCtxPtr->semRef);
 
-    result = le_fwupdate_Download(fd);
+    // A delta package is rebuilt by a dedicated thread between the download FIFO and the FW update
+    // process. A resumed download is never a delta package, see packageDownloader_StartDownload().
+    deltaStartResult = dwlCtxPtr->resume ? LE_NOT_FOUND : StartFwDelta(&fwDelta, fd);
+
+    switch (deltaStartResult)
+    {
+        case LE_OK:
+            result = le_fwupdate_Download(fwDelta.readFd);
+
+            // The FW update process is done with the rebuilt package: unblock the delta
+            // application if it is still writing
+            close(fwDelta.readFd);
+            break;
+
+        case LE_NOT_FOUND:
+            result = le_fwupdate_Download(fd);
+            break;
+
+        default:
+            // The package type is unknown: a delta package must not reach the FW update process
+            LE_ERROR("Failed to check the FW package type");
+            result = LE_FAULT;
+            break;
+    }
+
+    // The delta application stops before the end of the package if the delta doesn't match
+    if ((LE_OK == result) && (LE_OK != StopFwDelta(&fwDelta)))
+    {
+        result = LE_FORMAT_ERROR;
+    }
+
     if (LE_OK != result)
     {
         LE_ERROR("Failed to update firmware: %s", LE_RESULT_TXT(result));
@@ -1061,13 +1440,26 @@ void* packageDownloader_StoreFwPackage
          && (DOWNLOAD_STATUS_SUSPEND != GetDownloadStatus()))
         {
             lwm2mcore_FwUpdateResult_t fwUpdateResult;
+            le_result_t deltaResult;
 
             // Abort active download
             AbortDownload();
+            deltaResult = StopFwDelta(&fwDelta);
 
             // Set the update state and update
             packageDownloader_SetFwUpdateState(LWM2MCORE_FW_UPDATE_STATE_IDLE);
-            if (LE_CLOSED == result)
+            if (LE_FAULT == deltaStartResult)
+            {
+                // The package was not checked, like a failed FW update initialization
+                fwUpdateResult = LWM2MCORE_FW_UPDATE_RESULT_COMMUNICATION_ERROR;
+            }
+            else if ((LE_FORMAT_ERROR == deltaResult) || (LE_NOT_FOUND == deltaResult))
+            {
+                // The delta package doesn't apply to the provisioned base, or the rebuilt
+                // package doesn't match its hash
+                fwUpdateResult = LWM2MCORE_FW_UPDATE_RESULT_UNSUPPORTED_PKG_TYPE;
+            }
+            else if (LE_CLOSED == result)
             {
                 // File descriptor has been closed before all data have been received,
                 // this is a communication error
@@ -1081,6 +1473,7 @@ void* packageDownloader_StoreFwPackage
             packageDownloader_SetFwUpdateResult(fwUpdateResult);
         }
 
+        StopFwDelta(&fwDelta);
         close(fd);
         return (void*)-1;
     }
@@ -1110,6 +1503,14 @@ le_result_t packageDownloader_StartDownload
 
     LE_DEBUG("downloading a `%s'", dwlType[type]);
 
+    if ((LWM2MCORE_FW_UPDATE_TYPE == type) && resume && IsFwDeltaDownload())
+    {
+        // The state of the delta application is lost with the interrupted download, and the
+        // FW update resume position is an offset in the rebuilt package: start again
+        LE_WARN("A delta FW package download can't be resumed, restarting it");
+        resume = false;
+    }
+
     avcServer_InitUserAgreement();
 
     // Stop activity timer to prevent NO_UPDATE notification
@@ -1144,7 +1545,6 @@ le_result_t packageDownloader_StartDownload
 
     dwlCtx.fifoPtr = FIFO_PATH;
     dwlCtx.mainRef = le_thread_GetCurrent();
-    dwlCtx.certPtr = PEMCERT_PATH;
     dwlCtx.downloadPackage = (void*)packageDownloader_DownloadPackage;
     switch (type)
     {
@@ -1177,6 +1577,7 @@ le_result_t packageDownloader_StartDownload
             return LE_FAULT;
     }
     dwlCtx.resume = resume;
+    dwlCtx.startOffset = PkgDwl.data.updateOffset;
     PkgDwl.ctxPtr = (void*)&dwlCtx;
 
     DownloaderRef = le_thread_Create("Downloader", (void*)dwlCtx.downloadPackage, (void*)&PkgDwl);
@@ -26,10 +26,10 @@ typedef struct
     void*            ctxPtr;                ///< Context pointer
     le_thread_Ref_t  mainRef;               ///< Main thread reference
     le_thread_Ref_t  storeRef;              ///< Store thread reference
-    const char*      certPtr;               ///< PEM certificate path
     void (*downloadPackage)(void *ctxPtr);  ///< Download package callback
     void (*storePackage)(void *ctxPtr);     ///< Store package callback
     bool             resume;                ///< Indicates if it is a download resume
+    uint64_t         startOffset;           ///< Expected download start offset
     le_sem_Ref_t     semRef;                ///< Semaphore synchronizing download and store for FOTA
 }
 packageDownloader_DownloadCtx_t;
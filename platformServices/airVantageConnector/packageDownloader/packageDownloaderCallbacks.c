@@ -9,6 +9,7 @@
 
 #include <legato.h>
 #include <curl/curl.h>
+#include <openssl/ssl.h>
 #include <lwm2mcore/update.h>
 #include <lwm2mcorePackageDownloader.h>
 #include <interfaces.h>
@@ -17,6 +18,7 @@
 #include "packageDownloader.h"
 #include "packageDownloaderCallbacks.h"
 #include "avcServer.h"
+#include "sslUtilities.h"
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -42,6 +44,13 @@
 //--------------------------------------------------------------------------------------------------
 #define BUF_SIZE  512
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum time to wait for activity on the download connection, in milliseconds
+ */
+//--------------------------------------------------------------------------------------------------
+#define WAIT_TIMEOUT_MS     1000
+
 //--------------------------------------------------------------------------------------------------
 /**
  * PackageInfo data structure.
@@ -57,41 +66,47 @@ PackageInfo_t;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Package data structure
+ * Package data structure.
+ *
+ * The curl handles are kept from one download to the next: the multi handle keeps the connection
+ * open and the share handle keeps the TLS session, so that a resume or a retry doesn't go through
+ * a new TCP and TLS handshake.
+ *
+ * A single GET request is used: pkgDwlCb_InitDownload() sends it and stops at the response
+ * headers to get the package size, its body is paused until pkgDwlCb_Download() is called.
  */
 //--------------------------------------------------------------------------------------------------
 typedef struct
 {
-    CURL*           curlPtr;    ///< curl pointer
-    const char*     uriPtr;     ///< package URI pointer
-    PackageInfo_t   pkgInfo;    ///< package information
+    CURL*                   curlPtr;        ///< curl pointer
+    CURLM*                  multiPtr;       ///< curl multi handle, keeping the connection
+    CURLSH*                 sharePtr;       ///< curl share handle, keeping the TLS session
+    uint32_t                trustVersion;   ///< Version of the trust anchors of the handles
+    bool                    isStarted;      ///< A request is started
+    bool                    headersDone;    ///< The response headers are received
+    bool                    isStreaming;    ///< The response body is passed to the parser
+    uint64_t                offset;         ///< Start offset of the request
+    uint64_t                bodySize;       ///< Number of body bytes passed to the parser
+    double                  rangeTotal;     ///< Total size from Content-Range, -1 if absent
+    lwm2mcore_DwlResult_t   result;         ///< Download result
+    const char*             uriPtr;         ///< package URI pointer
+    PackageInfo_t           pkgInfo;        ///< package information
 }
 Package_t;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * HTTP response code
+ * Package being downloaded
  */
 //--------------------------------------------------------------------------------------------------
-static long HttpRespCode = LE_AVC_HTTP_STATUS_INVALID;
+static Package_t Pkg;
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Dummy write callback
+ * HTTP response code
  */
 //--------------------------------------------------------------------------------------------------
-static size_t WriteDummy
-(
-    void*   contentsPtr,
-    size_t  size,
-    size_t  nmemb,
-    void*   streamPtr
-)
-{
-    size_t count = size * nmemb;
-
-    return count;
-}
+static long HttpRespCode = LE_AVC_HTTP_STATUS_INVALID;
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -107,10 +122,18 @@ static size_t Write
 )
 {
     size_t count = size * nmemb;
+    Package_t* pkgPtr;
     lwm2mcore_DwlResult_t *result;
 
+    pkgPtr = (Package_t*)contextPtr;
+
+    // Hold the response body until the download is accepted, curl delivers it again when resumed
+    if (!pkgPtr->isStreaming)
+    {
+        return CURL_WRITEFUNC_PAUSE;
+    }
 
-    result = (lwm2mcore_DwlResult_t *)contextPtr;
+    result = &pkgPtr->result;
     *result = DWL_FAULT;
 
     // Check if the download should be aborted
@@ -139,10 +162,81 @@ static size_t Write
     {
         *result = DWL_OK;
     }
+    pkgPtr->bodySize += count;
 
     return count;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the response headers
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t WriteHeader
+(
+    char*   bufferPtr,
+    size_t  size,
+    size_t  nmemb,
+    void*   contextPtr
+)
+{
+    size_t count = size * nmemb;
+    Package_t* pkgPtr;
+    char line[BUF_SIZE];
+    unsigned long long first;
+    unsigned long long last;
+    unsigned long long total;
+    long code = 0;
+
+    pkgPtr = (Package_t*)contextPtr;
+
+    memcpy(line, bufferPtr, (count < BUF_SIZE) ? count : (BUF_SIZE - 1));
+    line[(count < BUF_SIZE) ? count : (BUF_SIZE - 1)] = '\0';
+
+    if (0 == strncasecmp(line, "Content-Range:", strlen("Content-Range:")))
+    {
+        // Content-Range: bytes <first>-<last>/<total>
+        if (3 == sscanf(line + strlen("Content-Range:"), " bytes %llu-%llu/%llu",
+                        &first, &last, &total))
+        {
+            pkgPtr->rangeTotal = (double)total;
+        }
+    }
+    else if ((0 == strcmp(line, "\r\n")) || (0 == strcmp(line, "\n")))
+    {
+        // End of the headers, unless they belong to an interim response
+        curl_easy_getinfo(pkgPtr->curlPtr, CURLINFO_RESPONSE_CODE, &code);
+        if (code >= 200)
+        {
+            pkgPtr->headersDone = true;
+        }
+    }
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the trust anchors to the SSL context of a new connection. They are parsed once by
+ * ssl_CheckCertificate(), instead of being read from a CA file at each connection.
+ */
+//--------------------------------------------------------------------------------------------------
+static CURLcode SetSslContext
+(
+    CURL*   curlPtr,
+    void*   sslCtxPtr,
+    void*   contextPtr
+)
+{
+    if (!ssl_AddTrustAnchors(SSL_CTX_get_cert_store((SSL_CTX*)sslCtxPtr)))
+    {
+        LE_ERROR("no trust anchor available");
+        return CURLE_SSL_CACERT_BADFILE;
+    }
+
+    return CURLE_OK;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Check HTTP status codes
@@ -181,7 +275,233 @@ static int CheckHttpStatusCode
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Get download information
+ * Release the curl handles, closing the kept connection
+ */
+//--------------------------------------------------------------------------------------------------
+static void DestroyHandles
+(
+    Package_t* pkgPtr
+)
+{
+    if (pkgPtr->curlPtr)
+    {
+        if (pkgPtr->isStarted)
+        {
+            curl_multi_remove_handle(pkgPtr->multiPtr, pkgPtr->curlPtr);
+            pkgPtr->isStarted = false;
+        }
+        curl_easy_cleanup(pkgPtr->curlPtr);
+        pkgPtr->curlPtr = NULL;
+    }
+    if (pkgPtr->multiPtr)
+    {
+        curl_multi_cleanup(pkgPtr->multiPtr);
+        pkgPtr->multiPtr = NULL;
+    }
+    if (pkgPtr->sharePtr)
+    {
+        curl_share_cleanup(pkgPtr->sharePtr);
+        pkgPtr->sharePtr = NULL;
+    }
+    curl_global_cleanup();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the curl handles, kept for the next downloads. They are created again when the trust
+ * anchors change, to drop the connection and the TLS session established with the previous ones.
+ */
+//--------------------------------------------------------------------------------------------------
+static int CreateHandles
+(
+    Package_t* pkgPtr
+)
+{
+    CURLcode rc;
+    uint32_t trustVersion;
+
+    trustVersion = ssl_GetTrustAnchorVersion();
+    if (pkgPtr->curlPtr)
+    {
+        if (trustVersion == pkgPtr->trustVersion)
+        {
+            return 0;
+        }
+        LE_INFO("Trust anchors changed, closing the download connection");
+        DestroyHandles(pkgPtr);
+    }
+
+    // initialize everything possible
+    rc = curl_global_init(CURL_GLOBAL_ALL);
+    if (CURLE_OK != rc)
+    {
+        LE_ERROR("failed to initialize libcurl: %s", curl_easy_strerror(rc));
+        return -1;
+    }
+
+    pkgPtr->curlPtr = curl_easy_init();
+    pkgPtr->multiPtr = curl_multi_init();
+    pkgPtr->sharePtr = curl_share_init();
+    if ((!pkgPtr->curlPtr) || (!pkgPtr->multiPtr) || (!pkgPtr->sharePtr))
+    {
+        LE_ERROR("failed to initialize the curl session");
+        goto err;
+    }
+
+    if (   (CURLSHE_OK != curl_share_setopt(pkgPtr->sharePtr, CURLSHOPT_SHARE,
+                                            CURL_LOCK_DATA_SSL_SESSION))
+        || (CURLSHE_OK != curl_share_setopt(pkgPtr->sharePtr, CURLSHOPT_SHARE,
+                                            CURL_LOCK_DATA_DNS)))
+    {
+        LE_ERROR("failed to set up the curl share");
+        goto err;
+    }
+
+    // The CA bundle is not read from a file, the trust anchors are loaded in memory
+    if (   (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_SHARE, pkgPtr->sharePtr))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_WRITEFUNCTION, Write))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_WRITEDATA, (void*)pkgPtr))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_HEADERFUNCTION, WriteHeader))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_HEADERDATA, (void*)pkgPtr))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_CAINFO, NULL))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_CAPATH, NULL))
+        || (CURLE_OK != curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_SSL_CTX_FUNCTION,
+                                         SetSslContext)))
+    {
+        LE_ERROR("failed to set up the curl session");
+        goto err;
+    }
+
+    memset(pkgPtr->pkgInfo.curlVersion, 0, BUF_SIZE);
+    strncpy(pkgPtr->pkgInfo.curlVersion, curl_version(), BUF_SIZE - 1);
+    pkgPtr->trustVersion = trustVersion;
+
+    return 0;
+
+err:
+    DestroyHandles(pkgPtr);
+    return -1;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the current request. The connection stays in the multi handle cache for the next one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StopRequest
+(
+    Package_t* pkgPtr
+)
+{
+    if (pkgPtr->isStarted)
+    {
+        curl_multi_remove_handle(pkgPtr->multiPtr, pkgPtr->curlPtr);
+        pkgPtr->isStarted = false;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a GET request at the given offset
+ */
+//--------------------------------------------------------------------------------------------------
+static int StartRequest
+(
+    Package_t*  pkgPtr,
+    uint64_t    offset
+)
+{
+    char buf[BUF_SIZE];
+    CURLMcode mrc;
+
+    StopRequest(pkgPtr);
+
+    pkgPtr->headersDone = false;
+    pkgPtr->isStreaming = false;
+    pkgPtr->offset = offset;
+    pkgPtr->bodySize = 0;
+    pkgPtr->rangeTotal = -1;
+    pkgPtr->result = DWL_FAULT;
+
+    // Request the package from the given offset
+    if (offset)
+    {
+        snprintf(buf, BUF_SIZE, "%llu-", (unsigned long long)offset);
+        curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_RANGE, buf);
+    }
+    else
+    {
+        curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_RANGE, NULL);
+    }
+
+    mrc = curl_multi_add_handle(pkgPtr->multiPtr, pkgPtr->curlPtr);
+    if (CURLM_OK != mrc)
+    {
+        LE_ERROR("failed to start curl request: %s", curl_multi_strerror(mrc));
+        return -1;
+    }
+    pkgPtr->isStarted = true;
+
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the current request until it ends, or until its response headers are received
+ *
+ * @return the curl result of the request, CURLE_OK if it is stopped after the headers
+ */
+//--------------------------------------------------------------------------------------------------
+static CURLcode Perform
+(
+    Package_t*  pkgPtr,
+    bool        untilHeaders
+)
+{
+    CURLMcode mrc;
+    CURLMsg* msgPtr;
+    int running = 1;
+    int msgCount;
+
+    while (running)
+    {
+        mrc = curl_multi_perform(pkgPtr->multiPtr, &running);
+        if (CURLM_OK != mrc)
+        {
+            LE_ERROR("curl_multi_perform failed: %s", curl_multi_strerror(mrc));
+            return CURLE_FAILED_INIT;
+        }
+
+        if (untilHeaders && pkgPtr->headersDone)
+        {
+            return CURLE_OK;
+        }
+
+        if (running)
+        {
+            mrc = curl_multi_wait(pkgPtr->multiPtr, NULL, 0, WAIT_TIMEOUT_MS, NULL);
+            if (CURLM_OK != mrc)
+            {
+                LE_ERROR("curl_multi_wait failed: %s", curl_multi_strerror(mrc));
+                return CURLE_FAILED_INIT;
+            }
+        }
+    }
+
+    while (NULL != (msgPtr = curl_multi_info_read(pkgPtr->multiPtr, &msgCount)))
+    {
+        if ((CURLMSG_DONE == msgPtr->msg) && (pkgPtr->curlPtr == msgPtr->easy_handle))
+        {
+            return msgPtr->data.result;
+        }
+    }
+
+    return CURLE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get download information from the response headers
  */
 //--------------------------------------------------------------------------------------------------
 static int GetDownloadInfo
@@ -194,11 +514,7 @@ static int GetDownloadInfo
 
     pkgInfoPtr = &pkgPtr->pkgInfo;
 
-    // just get the header, will always succeed
-    curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_NOBODY, 1L);
-    curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_WRITEFUNCTION, WriteDummy);
-
-    rc = curl_easy_perform(pkgPtr->curlPtr);
+    rc = Perform(pkgPtr, true);
     if (CURLE_OK != rc)
     {
         LE_ERROR("failed to perform curl request: %s", curl_easy_strerror(rc));
@@ -213,6 +529,13 @@ static int GetDownloadInfo
         return -1;
     }
 
+    // The size of a partial response is in Content-Range, Content-Length is the remaining size
+    if (0 <= pkgPtr->rangeTotal)
+    {
+        pkgInfoPtr->totalSize = pkgPtr->rangeTotal;
+        return 0;
+    }
+
     rc = curl_easy_getinfo(pkgPtr->curlPtr, CURLINFO_CONTENT_LENGTH_DOWNLOAD,
                            &pkgInfoPtr->totalSize);
     if (CURLE_OK != rc)
@@ -221,9 +544,6 @@ static int GetDownloadInfo
         return -1;
     }
 
-    memset(pkgInfoPtr->curlVersion, 0, BUF_SIZE);
-    memcpy(pkgInfoPtr->curlVersion, curl_version(), BUF_SIZE);
-
     return 0;
 }
 
@@ -255,15 +575,12 @@ lwm2mcore_DwlResult_t pkgDwlCb_InitDownload
     void* ctxPtr
 )
 {
-    static Package_t pkg;
     CURLcode rc;
     packageDownloader_DownloadCtx_t* dwlCtxPtr;
 
     dwlCtxPtr = (packageDownloader_DownloadCtx_t*)ctxPtr;
 
-    pkg.curlPtr = NULL;
-
-    dwlCtxPtr->ctxPtr = (void *)&pkg;
+    dwlCtxPtr->ctxPtr = (void *)&Pkg;
 
     LE_DEBUG("Initialize package downloader");
 
@@ -273,50 +590,40 @@ lwm2mcore_DwlResult_t pkgDwlCb_InitDownload
         return DWL_FAULT;
     }
 
-    // initialize everything possible
-    rc = curl_global_init(CURL_GLOBAL_ALL);
-    if (CURLE_OK != rc)
-    {
-        LE_ERROR("failed to initialize libcurl: %s", curl_easy_strerror(rc));
-        return DWL_FAULT;
-    }
-
-    // init the curl session
-    pkg.curlPtr = curl_easy_init();
-    if (!pkg.curlPtr)
+    if (-1 == CreateHandles(&Pkg))
     {
-        LE_ERROR("failed to initialize the curl session");
         return DWL_FAULT;
     }
 
     // set URL to get here
-    rc= curl_easy_setopt(pkg.curlPtr, CURLOPT_URL, uriPtr);
+    StopRequest(&Pkg);
+    rc= curl_easy_setopt(Pkg.curlPtr, CURLOPT_URL, uriPtr);
     if (CURLE_OK != rc)
     {
         LE_ERROR("failed to set URI: %s", curl_easy_strerror(rc));
         return DWL_FAULT;
     }
 
-    // set the path to CA bundle
-    rc= curl_easy_setopt(pkg.curlPtr, CURLOPT_CAINFO, dwlCtxPtr->certPtr);
-    if (CURLE_OK != rc)
+    // Send the GET request now, its body is held until the download is accepted
+    if (-1 == StartRequest(&Pkg, dwlCtxPtr->startOffset))
     {
-        LE_ERROR("failed to set CA path: %s", curl_easy_strerror(rc));
         return DWL_FAULT;
     }
 
-    if (-1 == GetDownloadInfo(&pkg))
+    if (-1 == GetDownloadInfo(&Pkg))
     {
+        StopRequest(&Pkg);
         return DWL_FAULT;
     }
 
-    if (-1 == CheckHttpStatusCode(pkg.pkgInfo.httpRespCode))
+    if (-1 == CheckHttpStatusCode(Pkg.pkgInfo.httpRespCode))
     {
-        LE_ERROR("HTTP error %ld", pkg.pkgInfo.httpRespCode);
+        LE_ERROR("HTTP error %ld", Pkg.pkgInfo.httpRespCode);
+        StopRequest(&Pkg);
         return DWL_FAULT;
     }
 
-    pkg.uriPtr = uriPtr;
+    Pkg.uriPtr = uriPtr;
 
     return DWL_OK;
 }
@@ -466,21 +773,17 @@ lwm2mcore_DwlResult_t pkgDwlCb_Download
     packageDownloader_DownloadCtx_t* dwlCtxPtr;
     Package_t* pkgPtr;
     CURLcode rc;
-    static lwm2mcore_DwlResult_t result;
+    bool isPending;
 
     dwlCtxPtr = (packageDownloader_DownloadCtx_t*)ctxPtr;
     pkgPtr = (Package_t*)dwlCtxPtr->ctxPtr;
 
-    curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_NOBODY, 0L);
-    curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_WRITEFUNCTION, Write);
-    curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_WRITEDATA, (void *)&result);
-
-    // Start download at offset given by startOffset
-    if (startOffset)
+    // Continue the request sent by pkgDwlCb_InitDownload() if it starts at the right offset,
+    // otherwise send a new one on the same connection
+    isPending = (pkgPtr->isStarted) && (startOffset == pkgPtr->offset);
+    if ((!isPending) && (-1 == StartRequest(pkgPtr, startOffset)))
     {
-        char buf[BUF_SIZE];
-        snprintf(buf, BUF_SIZE, "%llu-", (unsigned long long)startOffset);
-        curl_easy_setopt(pkgPtr->curlPtr, CURLOPT_RANGE, buf);
+        return DWL_FAULT;
     }
 
     if (dwlCtxPtr->semRef)
@@ -489,10 +792,29 @@ lwm2mcore_DwlResult_t pkgDwlCb_Download
         le_sem_Post(dwlCtxPtr->semRef);
     }
 
-    rc = curl_easy_perform(pkgPtr->curlPtr);
+    pkgPtr->isStreaming = true;
+    curl_easy_pause(pkgPtr->curlPtr, CURLPAUSE_CONT);
+    rc = Perform(pkgPtr, false);
+
+    // The server may close the connection of a request held while the download was not accepted:
+    // send the request again if nothing was received
+    if (   (CURLE_OK != rc) && (isPending) && (0 == pkgPtr->bodySize)
+        && (false == packageDownloader_CurrentDownloadToAbort())
+        && (false == packageDownloader_CheckDownloadToSuspend()))
+    {
+        LE_WARN("curl request failed before receiving data: %s, retrying",
+                curl_easy_strerror(rc));
+        if (-1 == StartRequest(pkgPtr, startOffset))
+        {
+            return DWL_FAULT;
+        }
+        pkgPtr->isStreaming = true;
+        rc = Perform(pkgPtr, false);
+    }
+
     if (CURLE_OK != rc)
     {
-        LE_ERROR("curl_easy_perform failed: %s", curl_easy_strerror(rc));
+        LE_ERROR("curl request failed: %s", curl_easy_strerror(rc));
     }
 
     rc = curl_easy_getinfo(pkgPtr->curlPtr, CURLINFO_RESPONSE_CODE, &HttpRespCode);
@@ -501,7 +823,9 @@ lwm2mcore_DwlResult_t pkgDwlCb_Download
         LE_ERROR("failed to get response code: %s", curl_easy_strerror(rc));
     }
 
-    return result;
+    StopRequest(pkgPtr);
+
+    return pkgPtr->result;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -561,9 +885,8 @@ lwm2mcore_DwlResult_t pkgDwlCb_EndDownload
         le_sem_Post(dwlCtxPtr->semRef);
     }
 
-    curl_easy_cleanup(pkgPtr->curlPtr);
-
-    curl_global_cleanup();
+    // Keep the curl handles, with the connection and the TLS session, for the next download
+    StopRequest(pkgPtr);
 
     return DWL_OK;
 }
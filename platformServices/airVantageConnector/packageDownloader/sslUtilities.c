@@ -42,6 +42,46 @@
 //--------------------------------------------------------------------------------------------------
 #define PEM_CERT_FOOTER     "-----END CERTIFICATE-----"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of trust anchors loaded from the certificate file
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_TRUST_ANCHORS   8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Trust anchors, parsed once from the certificate file. They are loaded by the main thread and
+ * used by the download thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static X509* TrustAnchors[MAX_TRUST_ANCHORS];
+static int TrustAnchorCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Trust anchors version, incremented each time they are loaded
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t TrustAnchorVersion = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the trust anchors
+ */
+//--------------------------------------------------------------------------------------------------
+static pthread_mutex_t TrustAnchorMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Macros to lock and unlock the trust anchors
+ */
+//--------------------------------------------------------------------------------------------------
+#define LOCK()    LE_FATAL_IF((pthread_mutex_lock(&TrustAnchorMutex)!=0), \
+                               "Could not lock the mutex")
+#define UNLOCK()  LE_FATAL_IF((pthread_mutex_unlock(&TrustAnchorMutex)!=0), \
+                               "Could not unlock the mutex")
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Insert a character val at position pos
@@ -196,46 +236,59 @@ static le_result_t LoadDefaultCertificate
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Write PEM key to default certificate file path
+ * Load the trust anchors of a PEM certificate file content, replacing the current ones
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t WritePEMCertificate
+static le_result_t LoadTrustAnchors
 (
-    const char*     certPtr,
-    unsigned char*  pemKeyPtr,
-    int             pemKeyLen
+    const uint8_t*  pemPtr,     ///< [IN] PEM certificates
+    size_t          pemLen      ///< [IN] PEM certificates length
 )
 {
-    int fd;
-    ssize_t count;
-    mode_t mode = 0;
+    X509* anchors[MAX_TRUST_ANCHORS];
+    X509* certPtr;
+    BIO* memPtr;
+    int count = 0;
+    int i;
 
-    mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-    fd = open(certPtr, O_WRONLY | O_CREAT | O_TRUNC, mode);
-    if (!fd)
+    memPtr = BIO_new_mem_buf((void*)pemPtr, pemLen);
+    if (!memPtr)
     {
-        LE_ERROR("failed to open %s: %m", certPtr);
+        LE_ERROR("failed to create BIO: %lu", ERR_get_error());
         return LE_FAULT;
     }
 
-    while (pemKeyLen)
+    while (count < MAX_TRUST_ANCHORS)
     {
-        count = write(fd, pemKeyPtr, pemKeyLen);
-        if (count == -1)
+        certPtr = PEM_read_bio_X509(memPtr, NULL, NULL, NULL);
+        if (!certPtr)
         {
-            LE_ERROR("failed to write PEM cert: %m");
-            close(fd);
-            return LE_FAULT;
-        }
-        if (0 <= count)
-        {
-            pemKeyLen -= count;
-            pemKeyPtr += count;
+            break;
         }
+        anchors[count++] = certPtr;
+    }
+
+    // Reaching the end of the data is reported as an error
+    ERR_clear_error();
+    BIO_free(memPtr);
+
+    if (!count)
+    {
+        LE_ERROR("no certificate found");
+        return LE_FAULT;
+    }
 
+    LOCK();
+    for (i = 0; i < TrustAnchorCount; i++)
+    {
+        X509_free(TrustAnchors[i]);
     }
+    memcpy(TrustAnchors, anchors, count * sizeof(X509*));
+    TrustAnchorCount = count;
+    TrustAnchorVersion++;
+    UNLOCK();
 
-    close(fd);
+    LE_INFO("%d trust anchor(s) loaded", count);
 
     return LE_OK;
 }
@@ -282,7 +335,8 @@ int ssl_LayOutPEM
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Check if SSL certificate exists and load it
+ * Check if SSL certificate exists and load it in memory as the trust anchors of the package
+ * downloads. It is called again when the certificate is updated.
  */
 //--------------------------------------------------------------------------------------------------
 le_result_t ssl_CheckCertificate
@@ -292,7 +346,6 @@ le_result_t ssl_CheckCertificate
 {
     uint8_t buf[MAX_CERT_LEN] = {0};
     size_t size = MAX_CERT_LEN;
-    int fd;
     le_result_t result;
 
     if (LE_OK != ExistsFs(SSLCERT_PATH))
@@ -315,5 +368,65 @@ le_result_t ssl_CheckCertificate
         return result;
     }
 
-    return WritePEMCertificate(PEMCERT_PATH, buf, size);
+    return LoadTrustAnchors(buf, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the loaded trust anchors to an X509 store, typically the store of a new SSL context
+ *
+ * @return the number of trust anchors added
+ */
+//--------------------------------------------------------------------------------------------------
+int ssl_AddTrustAnchors
+(
+    X509_STORE* storePtr        ///< [IN] X509 store
+)
+{
+    int count = 0;
+    int i;
+
+    LOCK();
+    for (i = 0; i < TrustAnchorCount; i++)
+    {
+        // The certificate is reference counted, it is not copied
+        if (X509_STORE_add_cert(storePtr, TrustAnchors[i]))
+        {
+            count++;
+        }
+        else if (X509_R_CERT_ALREADY_IN_HASH_TABLE == ERR_GET_REASON(ERR_peek_last_error()))
+        {
+            ERR_clear_error();
+            count++;
+        }
+        else
+        {
+            LE_ERROR("failed to add trust anchor: %lu", ERR_get_error());
+        }
+    }
+    UNLOCK();
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the version of the trust anchors. It changes each time they are loaded, so that connections
+ * and TLS sessions established with the previous ones can be dropped.
+ *
+ * @return the trust anchors version
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t ssl_GetTrustAnchorVersion
+(
+    void
+)
+{
+    uint32_t version;
+
+    LOCK();
+    version = TrustAnchorVersion;
+    UNLOCK();
+
+    return version;
 }
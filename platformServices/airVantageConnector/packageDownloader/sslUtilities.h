@@ -11,6 +11,7 @@
 #define _SSLUTILITIES_H
 
 #include <stddef.h>
+#include <openssl/x509.h>
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -37,7 +38,8 @@ int ssl_LayOutPEM
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Check if SSL certificate exists and load it
+ * Check if SSL certificate exists and load it in memory as the trust anchors of the package
+ * downloads. It is called again when the certificate is updated.
  */
 //--------------------------------------------------------------------------------------------------
 le_result_t ssl_CheckCertificate
@@ -45,4 +47,29 @@ le_result_t ssl_CheckCertificate
     void
 );
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the loaded trust anchors to an X509 store, typically the store of a new SSL context
+ *
+ * @return the number of trust anchors added
+ */
+//--------------------------------------------------------------------------------------------------
+int ssl_AddTrustAnchors
+(
+    X509_STORE* storePtr        ///< [IN] X509 store
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the version of the trust anchors. It changes each time they are loaded, so that connections
+ * and TLS sessions established with the previous ones can be dropped.
+ *
+ * @return the trust anchors version
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t ssl_GetTrustAnchorVersion
+(
+    void
+);
+
 #endif /* _SSLUTILITIES_H */
@@ -0,0 +1,376 @@
+//--------------------------------------------------------------------------------------------------
+/** @file smsQueue.c
+ *
+ * Outbound SMS queue.
+ *
+ * Sending a message with le_sms_Create, le_sms_SetDestination, le_sms_SetText and le_sms_Send costs
+ * four IPCs and blocks the caller until the network acknowledges the SMS, so an app alerting many
+ * recipients sends its messages one after the other. This queue returns to the caller as soon as
+ * the message is queued, submits each SMS with a single le_sms_SendText call, and keeps up to
+ * SMS_QUEUE_MAX_IN_FLIGHT SMS submitted to the modem. The results are reported per message through
+ * the handler given to smsQueue_Send.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "smsQueue.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Length of the "<part>/<count> " number at the beginning of each part of a split text
+ */
+//--------------------------------------------------------------------------------------------------
+#define PART_NUMBER_LEN     4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Characters of the GSM 7-bit default alphabet extension table, encoded with two septets
+ */
+//--------------------------------------------------------------------------------------------------
+#define GSM_EXTENSION_CHARS "^{}\\[~]|"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Message queued by smsQueue_Send
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char                         dest[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];  ///< Destination
+    smsQueue_ResultHandlerFunc_t handlerPtr;                            ///< Result handler
+    void*                        contextPtr;                            ///< Handler context
+    uint32_t                     partCount;                             ///< Number of SMS
+    uint32_t                     doneCount;                             ///< SMS sent or failed
+    le_result_t                  result;                                ///< Message result
+}
+Message_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SMS of a message
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_dls_Link_t link;                         ///< Link in PartList
+    Message_t*    msgPtr;                       ///< Message the SMS belongs to
+    uint32_t      partId;                       ///< Number of the SMS in the message
+    char          text[LE_SMS_TEXT_MAX_BYTES];  ///< SMS text
+}
+Part_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pools of the messages and SMS
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t MessagePool;
+static le_mem_PoolRef_t PartPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SMS waiting to be submitted to the modem, in the order of submission
+ */
+//--------------------------------------------------------------------------------------------------
+static le_dls_List_t PartList = LE_DLS_LIST_INIT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of SMS submitted to the modem and not yet acknowledged
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t InFlightCount;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of messages queued and not yet reported
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t PendingCount;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Whether the submission of the queued SMS is already scheduled in the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsSubmitScheduled;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the length in bytes of the next SMS of a text: as many characters as fit in the given number
+ * of septets, split after a space when one is found in the second half of the SMS.
+ *
+ * @return
+ *      Length of the SMS text
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetPartLength
+(
+    const char* textPtr,    ///< [IN] Remaining text
+    size_t      maxSeptets  ///< [IN] Maximum number of septets of the SMS text
+)
+{
+    size_t septets = 0;
+    size_t len = 0;
+    size_t spaceLen = 0;
+
+    while (textPtr[len] != '\0')
+    {
+        size_t charSeptets = (NULL != strchr(GSM_EXTENSION_CHARS, textPtr[len])) ? 2 : 1;
+
+        if ((septets + charSeptets) > maxSeptets)
+        {
+            if (spaceLen > (len / 2))
+            {
+                return spaceLen;
+            }
+
+            // Do not split a UTF-8 character
+            while ((len > 1) && (0x80 == (textPtr[len] & 0xC0)))
+            {
+                len--;
+            }
+            return len;
+        }
+
+        septets += charSeptets;
+        len++;
+
+        if (' ' == textPtr[len - 1])
+        {
+            spaceLen = len;
+        }
+    }
+
+    return len;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the result of a message once all its SMS are done
+ */
+//--------------------------------------------------------------------------------------------------
+static void PartDone
+(
+    Part_t*     partPtr,    ///< [IN] SMS sent or failed
+    le_result_t result      ///< [IN] SMS result
+)
+{
+    Message_t* msgPtr = partPtr->msgPtr;
+
+    if (LE_OK != result)
+    {
+        LE_ERROR("SMS %"PRIu32"/%"PRIu32" to %s failed",
+                 partPtr->partId, msgPtr->partCount, msgPtr->dest);
+        msgPtr->result = LE_FAULT;
+    }
+    le_mem_Release(partPtr);
+
+    msgPtr->doneCount++;
+    if (msgPtr->doneCount < msgPtr->partCount)
+    {
+        return;
+    }
+
+    PendingCount--;
+    if (NULL != msgPtr->handlerPtr)
+    {
+        msgPtr->handlerPtr(msgPtr->dest, msgPtr->result, msgPtr->contextPtr);
+    }
+    le_mem_Release(msgPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Submit the queued SMS to the modem, up to SMS_QUEUE_MAX_IN_FLIGHT at the same time
+ */
+//--------------------------------------------------------------------------------------------------
+static void SubmitParts
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SMS send result handler
+ */
+//--------------------------------------------------------------------------------------------------
+static void SendHandler
+(
+    le_sms_MsgRef_t msgRef,     ///< [IN] SMS reference
+    le_sms_Status_t status,     ///< [IN] SMS status
+    void*           contextPtr  ///< [IN] SMS
+)
+{
+    le_sms_Delete(msgRef);
+
+    InFlightCount--;
+    PartDone((Part_t*)contextPtr, (LE_SMS_SENT == status) ? LE_OK : LE_FAULT);
+
+    SubmitParts();
+}
+
+static void SubmitParts
+(
+    void
+)
+{
+    while ((InFlightCount < SMS_QUEUE_MAX_IN_FLIGHT) && (!le_dls_IsEmpty(&PartList)))
+    {
+        Part_t* partPtr = CONTAINER_OF(le_dls_Pop(&PartList), Part_t, link);
+
+        if (NULL == le_sms_SendText(partPtr->msgPtr->dest, partPtr->text, SendHandler, partPtr))
+        {
+            PartDone(partPtr, LE_FAULT);
+            continue;
+        }
+        InFlightCount++;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Submit the queued SMS from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+static void SubmitScheduledParts
+(
+    void* param1Ptr,    ///< [IN] Unused
+    void* param2Ptr     ///< [IN] Unused
+)
+{
+    IsSubmitScheduled = false;
+    SubmitParts();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue a text message. The function returns immediately, the result is reported through the
+ * handler from the event loop.
+ *
+ * @return
+ *      - LE_OK if the message is queued
+ *      - LE_BAD_PARAMETER if the destination is invalid or the text is empty
+ *      - LE_OVERFLOW if the text needs more than SMS_QUEUE_MAX_PARTS SMS
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t smsQueue_Send
+(
+    const char*                  destPtr,       ///< [IN] Destination phone number
+    const char*                  textPtr,       ///< [IN] Message text
+    smsQueue_ResultHandlerFunc_t handlerPtr,    ///< [IN] Result handler, can be NULL
+    void*                        contextPtr     ///< [IN] Context given to the handler
+)
+{
+    size_t destLen;
+    size_t textLen;
+    size_t offset;
+    size_t partLen;
+    uint32_t partCount;
+    uint32_t partId;
+    Message_t* msgPtr;
+
+    if ((NULL == destPtr) || (NULL == textPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    destLen = strlen(destPtr);
+    textLen = strlen(textPtr);
+    if ((0 == destLen) || (destLen >= LE_MDMDEFS_PHONE_NUM_MAX_BYTES) || (0 == textLen))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    // A text which does not fit in a single SMS is split into numbered parts
+    if (GetPartLength(textPtr, LE_SMS_TEXT_MAX_LEN) == textLen)
+    {
+        partCount = 1;
+    }
+    else
+    {
+        partCount = 0;
+        for (offset = 0; offset < textLen; offset += partLen)
+        {
+            partLen = GetPartLength(textPtr + offset, LE_SMS_TEXT_MAX_LEN - PART_NUMBER_LEN);
+            if (++partCount > SMS_QUEUE_MAX_PARTS)
+            {
+                return LE_OVERFLOW;
+            }
+        }
+    }
+
+    msgPtr = le_mem_ForceAlloc(MessagePool);
+    memcpy(msgPtr->dest, destPtr, destLen + 1);
+    msgPtr->handlerPtr = handlerPtr;
+    msgPtr->contextPtr = contextPtr;
+    msgPtr->partCount = partCount;
+    msgPtr->doneCount = 0;
+    msgPtr->result = LE_OK;
+
+    for (offset = 0, partId = 1; partId <= partCount; partId++, offset += partLen)
+    {
+        Part_t* partPtr = le_mem_ForceAlloc(PartPool);
+
+        partPtr->link = LE_DLS_LINK_INIT;
+        partPtr->msgPtr = msgPtr;
+        partPtr->partId = partId;
+
+        if (1 == partCount)
+        {
+            partLen = textLen;
+            memcpy(partPtr->text, textPtr, textLen + 1);
+        }
+        else
+        {
+            partLen = GetPartLength(textPtr + offset, LE_SMS_TEXT_MAX_LEN - PART_NUMBER_LEN);
+            snprintf(partPtr->text, sizeof(partPtr->text), "%"PRIu32"/%"PRIu32" %.*s",
+                     partId, partCount, (int)partLen, textPtr + offset);
+        }
+
+        le_dls_Queue(&PartList, &partPtr->link);
+    }
+
+    PendingCount++;
+
+    if (!IsSubmitScheduled)
+    {
+        IsSubmitScheduled = true;
+        le_event_QueueFunction(SubmitScheduledParts, NULL, NULL);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of messages queued and not yet reported.
+ *
+ * @return
+ *      Number of pending messages
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t smsQueue_GetPendingCount
+(
+    void
+)
+{
+    return PendingCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the SMS queue
+ */
+//--------------------------------------------------------------------------------------------------
+void smsQueue_Init
+(
+    void
+)
+{
+    MessagePool = le_mem_CreatePool("SmsQueueMessagePool", sizeof(Message_t));
+    PartPool = le_mem_CreatePool("SmsQueuePartPool", sizeof(Part_t));
+}
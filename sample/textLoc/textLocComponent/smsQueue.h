@@ -0,0 +1,89 @@
+/**
+ * @file smsQueue.h
+ *
+ * Outbound SMS queue: messages are queued without blocking the caller, long texts are split into
+ * several SMS, and up to SMS_QUEUE_MAX_IN_FLIGHT SMS are submitted to the modem at the same time.
+ *
+ * <hr>
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+
+#ifndef LEGATO_SMS_QUEUE_INCLUDE_GUARD
+#define LEGATO_SMS_QUEUE_INCLUDE_GUARD
+
+#include "legato.h"
+#include "interfaces.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of SMS submitted to the modem and not yet acknowledged.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SMS_QUEUE_MAX_IN_FLIGHT     4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of SMS a text can be split into. Each part of a split text starts with its
+ * "<part>/<count> " number.
+ */
+//--------------------------------------------------------------------------------------------------
+#define SMS_QUEUE_MAX_PARTS         9
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called once all the SMS of a message have been acknowledged by the network, or have
+ * failed.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*smsQueue_ResultHandlerFunc_t)
+(
+    const char* destPtr,    ///< [IN] Destination of the message
+    le_result_t result,     ///< [IN] LE_OK if all the SMS were sent, LE_FAULT otherwise
+    void*       contextPtr  ///< [IN] Context given to smsQueue_Send
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the SMS queue
+ */
+//--------------------------------------------------------------------------------------------------
+void smsQueue_Init
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue a text message. The function returns immediately, the result is reported through the
+ * handler from the event loop.
+ *
+ * @return
+ *      - LE_OK if the message is queued
+ *      - LE_BAD_PARAMETER if the destination is invalid or the text is empty
+ *      - LE_OVERFLOW if the text needs more than SMS_QUEUE_MAX_PARTS SMS
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t smsQueue_Send
+(
+    const char*                  destPtr,       ///< [IN] Destination phone number
+    const char*                  textPtr,       ///< [IN] Message text
+    smsQueue_ResultHandlerFunc_t handlerPtr,    ///< [IN] Result handler, can be NULL
+    void*                        contextPtr     ///< [IN] Context given to the handler
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of messages queued and not yet reported.
+ *
+ * @return
+ *      Number of pending messages
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t smsQueue_GetPendingCount
+(
+    void
+);
+
+#endif /* LEGATO_SMS_QUEUE_INCLUDE_GUARD */
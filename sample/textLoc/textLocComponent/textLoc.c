@@ -2,13 +2,13 @@
 /** @file textLoc.c
  *
  * This app illustrates a sample usage of ultra low power mode API. This app reads the current gps
- * location and then sends it as a text message to a destination cell phone number.  Once the text
- * message has been sent, the device enters ultra low power mode.  The device will wake up from
- * ultra low power mode after a configurable delay.
+ * location and then sends it as a text message to one or more destination cell phone numbers.  Once
+ * the text messages have been sent, the device enters ultra low power mode.  The device will wake
+ * up from ultra low power mode after a configurable delay.
  *
- * @note This app expects destination cell number to be specified in environment variable section
- * of adef file. If nothing specified in environment variable, it will send message to a default
- * non-existent phone number.
+ * @note This app expects destination cell numbers to be specified, separated by commas, in
+ * environment variable section of adef file. If nothing specified in environment variable, it will
+ * send message to a default non-existent phone number.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -17,6 +17,7 @@
 #include "legato.h"
 /* IPC APIs */
 #include "interfaces.h"
+#include "smsQueue.h"
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -37,6 +38,13 @@
 //--------------------------------------------------------------------------------------------------
 #define DEFAULT_PHONE_NO "8005550101"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum size of the comma-separated list of destination phone numbers.
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEST_LIST_MAX_BYTES 256
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Timer interval(in seconds) to exit from shutdown/ultralow-power state.
@@ -62,6 +70,14 @@
 //--------------------------------------------------------------------------------------------------
 static const char *DestPhoneNumberPtr;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Whether the location has already been sent. The text messages are sent asynchronously, so the
+ * device can register again before it is shut down.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsLocationSent;
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Attempts to use the GPS to find the current latitude, longitude and horizontal accuracy within
@@ -123,58 +139,71 @@ static le_result_t GetCurrentLocation(
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sends an SMS text message to the given destination with the given message content.
- *
- * @return
- *      - LE_OK on success
- *      - LE_FAULT on failure
+ * Configure the boot source and shutdown MDM.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t SendTextMessage(
-    const char *destinationNumberPtr, ///< [IN] Phone number to send the text message to as ASCII
-                                      ///< values
-    const char *messageBodyPtr        ///< [IN] Text message body content
+static void CfgShutDown
+(
+    void
 )
 {
-    le_result_t result = LE_OK;
-    LE_INFO("Sending SMS");
-
-    le_sms_MsgRef_t sms = le_sms_Create();
-
-    if (le_sms_SetDestination(sms, destinationNumberPtr) != LE_OK)
+    // Boot after specified interval.
+    if (le_ulpm_BootOnTimer(ULPM_EXIT_INTERVAL) != LE_OK)
     {
-        result = LE_FAULT;
-        LE_ERROR("Could not set destination phone number");
-        goto sms_done;
+        LE_ERROR("Can't set timer as boot source");
+        return;
     }
 
-    if (le_sms_SetText(sms, messageBodyPtr) != LE_OK)
+    // Boot on gpio. Please note this is platform dependent, change it when needed.
+    if (le_ulpm_BootOnGpio(WAKEUP_GPIO_NUM, LE_ULPM_GPIO_LOW) != LE_OK)
     {
-        result = LE_FAULT;
-        LE_ERROR("Could not set text message body");
-        goto sms_done;
+        LE_ERROR("Can't set gpio: %d as boot source", WAKEUP_GPIO_NUM);
+        return;
     }
 
-    if (le_sms_Send(sms) != LE_OK)
+    // Initiate shutdown.
+    if (le_ulpm_ShutDown() != LE_OK)
     {
-        result = LE_FAULT;
-        LE_ERROR("Could not send SMS message");
-        goto sms_done;
+        LE_ERROR("Can't initiate shutdown.");
     }
+}
 
-    LE_INFO("SMS Message sent");
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handles the result of a location text message. Once all the text messages are sent, the device
+ * is shut down.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SmsResultHandler
+(
+    const char *destinationNumberPtr, ///< [IN] Phone number the text message was sent to
+    le_result_t result,               ///< [IN] Result of the text message
+    void *contextPtr                  ///< [IN] Context pointer
+)
+{
+    if (result == LE_OK)
+    {
+        LE_INFO("SMS Message sent to %s", destinationNumberPtr);
+    }
+    else
+    {
+        LE_ERROR("Could not send SMS message to %s", destinationNumberPtr);
+    }
 
-sms_done:
-    le_sms_Delete(sms);
-    return result;
+    if (smsQueue_GetPendingCount() == 0)
+    {
+        LE_INFO("Now configure boot source and shutdown MDM");
+        CfgShutDown();
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
 /**
  * Send the device location as a text message
  *
- * Attempts to send an SMS text message containing the current device location to the destination
- * phone number.
+ * Attempts to send an SMS text message containing the current device location to each destination
+ * phone number. The messages are all queued at once and sent by the modem one after the other, the
+ * device is shut down once they have all been sent.
  *
  * @note
  *      No failure notification is provided if location services or SMS send are unsuccessful.
@@ -184,7 +213,10 @@ static void SendSmsCurrentLocation(
     void
 )
 {
-    char smsBody[LE_SMS_TEXT_MAX_LEN];
+    char smsBody[LE_SMS_TEXT_MAX_BYTES];
+    char destinations[DEST_LIST_MAX_BYTES];
+    char *destinationPtr;
+    char *savePtr;
     int32_t latitude;
     int32_t longitude;
     int32_t horizontalAccuracy;
@@ -199,37 +231,25 @@ static void SendSmsCurrentLocation(
     {
         strncpy(smsBody, "Loc:unknown", sizeof(smsBody));
     }
-    SendTextMessage(DestPhoneNumberPtr, smsBody);
-}
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Configure the boot source and shutdown MDM.
- */
-//--------------------------------------------------------------------------------------------------
-static void CfgShutDown
-(
-    void
-)
-{
-    // Boot after specified interval.
-    if (le_ulpm_BootOnTimer(ULPM_EXIT_INTERVAL) != LE_OK)
-    {
-        LE_ERROR("Can't set timer as boot source");
-        return;
-    }
+    LE_INFO("Sending SMS");
+    strncpy(destinations, DestPhoneNumberPtr, sizeof(destinations) - 1);
+    destinations[sizeof(destinations) - 1] = '\0';
 
-    // Boot on gpio. Please note this is platform dependent, change it when needed.
-    if (le_ulpm_BootOnGpio(WAKEUP_GPIO_NUM, LE_ULPM_GPIO_LOW) != LE_OK)
+    for (destinationPtr = strtok_r(destinations, ", ", &savePtr);
+         destinationPtr != NULL;
+         destinationPtr = strtok_r(NULL, ", ", &savePtr))
     {
-        LE_ERROR("Can't set gpio: %d as boot source", WAKEUP_GPIO_NUM);
-        return;
+        if (smsQueue_Send(destinationPtr, smsBody, SmsResultHandler, NULL) != LE_OK)
+        {
+            LE_ERROR("Could not queue SMS message to %s", destinationPtr);
+        }
     }
 
-    // Initiate shutdown.
-    if (le_ulpm_ShutDown() != LE_OK)
+    if (smsQueue_GetPendingCount() == 0)
     {
-        LE_ERROR("Can't initiate shutdown.");
+        LE_INFO("Now configure boot source and shutdown MDM");
+        CfgShutDown();
     }
 }
 
@@ -249,9 +269,11 @@ static void RegistrationStateHandler
         case LE_MRC_REG_HOME:
         case LE_MRC_REG_ROAMING:
             LE_INFO("Registered");
-            SendSmsCurrentLocation();
-            LE_INFO("Now configure boot source and shutdown MDM");
-            CfgShutDown();
+            if (!IsLocationSent)
+            {
+                IsLocationSent = true;
+                SendSmsCurrentLocation();
+            }
             break;
         case LE_MRC_REG_SEARCHING:
             LE_INFO("Searching...");
@@ -316,6 +338,8 @@ COMPONENT_INIT
 
     LE_INFO("TextLoc started");
 
+    smsQueue_Init();
+
     // Get ultra low power manager firmware version
     LE_FATAL_IF(
         le_ulpm_GetFirmwareVersion(version, sizeof(version)) != LE_OK,
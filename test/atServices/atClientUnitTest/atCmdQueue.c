@@ -0,0 +1,305 @@
+/**
+ * atCmdQueue.c implements the asynchronous AT commands submission
+ *
+ * Each queue owns a worker thread which takes the pending commands by priority and sends them
+ * back-to-back on the device. The result is then queued to the submitter thread, where the
+ * handler is called.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+#include "legato.h"
+#include "atCmdQueue.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queued command definition
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_dls_Link_t                  link;                                  ///< Link in queue list
+    char                           command[LE_ATDEFS_COMMAND_MAX_BYTES];  ///< AT command
+    char                           interRsp[LE_ATDEFS_RESPONSE_MAX_BYTES];///< Intermediate pattern
+    char                           finalRsp[LE_ATDEFS_RESPONSE_MAX_BYTES];///< Final pattern
+    uint32_t                       timeout;                               ///< Timeout in ms
+    atCmdQueue_ResultHandlerFunc_t handlerFunc;                           ///< Result handler
+    void*                          contextPtr;                            ///< Handler context
+    le_thread_Ref_t                threadRef;                             ///< Submitter thread
+    le_result_t                    result;                                ///< Sending result
+    le_atClient_CmdRef_t           cmdRef;                                ///< Command reference
+}
+QueuedCmd_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command queue definition
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+struct atCmdQueue
+{
+    le_atClient_DeviceRef_t devRef;                         ///< Device reference
+    le_mutex_Ref_t          mutexRef;                       ///< Protects the pending lists
+    le_sem_Ref_t            semRef;                         ///< Number of pending commands
+    le_dls_List_t           pendingList[ATCMDQUEUE_PRIORITY_MAX]; ///< Pending commands
+    le_thread_Ref_t         threadRef;                      ///< Worker thread
+    bool                    stopRequested;                  ///< Worker thread must stop
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for queued commands
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t QueuedCmdPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for queues
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t QueuePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Deliver a command result in the submitter thread
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeliverResult
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    QueuedCmd_t* cmdPtr = param1Ptr;
+
+    cmdPtr->handlerFunc(cmdPtr->result, cmdPtr->cmdRef, cmdPtr->contextPtr);
+
+    if (cmdPtr->cmdRef)
+    {
+        le_atClient_Delete(cmdPtr->cmdRef);
+    }
+
+    le_mem_Release(cmdPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take the next command to send, by priority then in submission order
+ *
+ * @return the command, or NULL when the worker thread must stop
+ */
+//--------------------------------------------------------------------------------------------------
+static QueuedCmd_t* PopNextCommand
+(
+    struct atCmdQueue* queuePtr
+)
+{
+    le_dls_Link_t* linkPtr = NULL;
+    int priority;
+
+    le_mutex_Lock(queuePtr->mutexRef);
+
+    if (queuePtr->stopRequested)
+    {
+        le_mutex_Unlock(queuePtr->mutexRef);
+        return NULL;
+    }
+
+    for (priority = 0; (priority < ATCMDQUEUE_PRIORITY_MAX) && (NULL == linkPtr); priority++)
+    {
+        linkPtr = le_dls_Pop(&queuePtr->pendingList[priority]);
+    }
+
+    le_mutex_Unlock(queuePtr->mutexRef);
+
+    LE_ASSERT(linkPtr != NULL);
+
+    return CONTAINER_OF(linkPtr, QueuedCmd_t, link);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Worker thread: send the pending commands as soon as the previous one is completed
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void* WorkerThread
+(
+    void* contextPtr
+)
+{
+    struct atCmdQueue* queuePtr = contextPtr;
+
+    while (1)
+    {
+        QueuedCmd_t* cmdPtr;
+
+        le_sem_Wait(queuePtr->semRef);
+
+        cmdPtr = PopNextCommand(queuePtr);
+        if (NULL == cmdPtr)
+        {
+            break;
+        }
+
+        cmdPtr->result = le_atClient_SetCommandAndSend(&cmdPtr->cmdRef,
+                                                       queuePtr->devRef,
+                                                       cmdPtr->command,
+                                                       cmdPtr->interRsp,
+                                                       cmdPtr->finalRsp,
+                                                       cmdPtr->timeout);
+        if (LE_OK != cmdPtr->result)
+        {
+            // The command reference is deleted by the AT client on failure
+            cmdPtr->cmdRef = NULL;
+        }
+
+        le_event_QueueFunctionToThread(cmdPtr->threadRef, DeliverResult, cmdPtr, NULL);
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a command queue for a device
+ *
+ * @return the queue reference
+ */
+//--------------------------------------------------------------------------------------------------
+atCmdQueue_Ref_t atCmdQueue_Create
+(
+    le_atClient_DeviceRef_t devRef      ///< [IN] Device the commands are sent to
+)
+{
+    struct atCmdQueue* queuePtr;
+    int priority;
+
+    if (NULL == QueuedCmdPool)
+    {
+        QueuedCmdPool = le_mem_CreatePool("AtQueuedCmdPool", sizeof(QueuedCmd_t));
+        QueuePool = le_mem_CreatePool("AtCmdQueuePool", sizeof(struct atCmdQueue));
+    }
+
+    queuePtr = le_mem_ForceAlloc(QueuePool);
+    queuePtr->devRef = devRef;
+    queuePtr->mutexRef = le_mutex_CreateNonRecursive("AtCmdQueueMutex");
+    queuePtr->semRef = le_sem_Create("AtCmdQueueSem", 0);
+    queuePtr->stopRequested = false;
+
+    for (priority = 0; priority < ATCMDQUEUE_PRIORITY_MAX; priority++)
+    {
+        queuePtr->pendingList[priority] = LE_DLS_LIST_INIT;
+    }
+
+    queuePtr->threadRef = le_thread_Create("AtCmdQueue", WorkerThread, queuePtr);
+    le_thread_SetJoinable(queuePtr->threadRef);
+    le_thread_Start(queuePtr->threadRef);
+
+    return queuePtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Submit a command to a queue
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_OVERFLOW when a string doesn't fit
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atCmdQueue_Submit
+(
+    atCmdQueue_Ref_t               queueRef,        ///< [IN] Queue reference
+    const char*                    commandPtr,      ///< [IN] AT command
+    const char*                    interRspPtr,     ///< [IN] Intermediate responses pattern
+    const char*                    finalRspPtr,     ///< [IN] Final responses pattern
+    uint32_t                       timeout,         ///< [IN] Timeout in milliseconds
+    atCmdQueue_Priority_t          priority,        ///< [IN] Command priority
+    atCmdQueue_ResultHandlerFunc_t handlerFunc,     ///< [IN] Result handler
+    void*                          contextPtr       ///< [IN] Handler context
+)
+{
+    QueuedCmd_t* cmdPtr;
+
+    if ((NULL == queueRef) || (NULL == commandPtr) || (NULL == interRspPtr) ||
+        (NULL == finalRspPtr) || (NULL == handlerFunc) || (priority >= ATCMDQUEUE_PRIORITY_MAX))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    cmdPtr = le_mem_ForceAlloc(QueuedCmdPool);
+    memset(cmdPtr, 0, sizeof(QueuedCmd_t));
+
+    if ((LE_OK != le_utf8_Copy(cmdPtr->command, commandPtr, sizeof(cmdPtr->command), NULL)) ||
+        (LE_OK != le_utf8_Copy(cmdPtr->interRsp, interRspPtr, sizeof(cmdPtr->interRsp), NULL)) ||
+        (LE_OK != le_utf8_Copy(cmdPtr->finalRsp, finalRspPtr, sizeof(cmdPtr->finalRsp), NULL)))
+    {
+        le_mem_Release(cmdPtr);
+        return LE_OVERFLOW;
+    }
+
+    cmdPtr->link = LE_DLS_LINK_INIT;
+    cmdPtr->timeout = timeout;
+    cmdPtr->handlerFunc = handlerFunc;
+    cmdPtr->contextPtr = contextPtr;
+    cmdPtr->threadRef = le_thread_GetCurrent();
+
+    le_mutex_Lock(queueRef->mutexRef);
+    le_dls_Queue(&queueRef->pendingList[priority], &cmdPtr->link);
+    le_mutex_Unlock(queueRef->mutexRef);
+
+    le_sem_Post(queueRef->semRef);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a command queue
+ *
+ * The command being sent, if any, is completed and its result is still delivered. The commands
+ * still pending are discarded without calling their handler.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void atCmdQueue_Delete
+(
+    atCmdQueue_Ref_t queueRef           ///< [IN] Queue reference
+)
+{
+    int priority;
+
+    if (NULL == queueRef)
+    {
+        return;
+    }
+
+    le_mutex_Lock(queueRef->mutexRef);
+    queueRef->stopRequested = true;
+    le_mutex_Unlock(queueRef->mutexRef);
+
+    le_sem_Post(queueRef->semRef);
+    LE_ASSERT_OK(le_thread_Join(queueRef->threadRef, NULL));
+
+    for (priority = 0; priority < ATCMDQUEUE_PRIORITY_MAX; priority++)
+    {
+        le_dls_Link_t* linkPtr;
+
+        while ((linkPtr = le_dls_Pop(&queueRef->pendingList[priority])) != NULL)
+        {
+            le_mem_Release(CONTAINER_OF(linkPtr, QueuedCmd_t, link));
+        }
+    }
+
+    le_sem_Delete(queueRef->semRef);
+    le_mutex_Delete(queueRef->mutexRef);
+    le_mem_Release(queueRef);
+}
@@ -0,0 +1,107 @@
+/**
+ * atCmdQueue.h
+ *
+ * Asynchronous AT commands submission on top of the AT client API.
+ *
+ * Commands are queued per device and sent by a device worker thread as soon as the final response
+ * of the previous one is received, so the submitter doesn't wait for a modem round trip per
+ * command. Results are delivered through a handler called in the submitter thread, which must run
+ * an event loop. Commands are sent by decreasing priority, then in submission order.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+#ifndef _ATCMDQUEUE_H
+#define _ATCMDQUEUE_H
+
+#include "legato.h"
+#include "interfaces.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command priorities
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    ATCMDQUEUE_PRIORITY_HIGH = 0,   ///< Sent before any other pending command
+    ATCMDQUEUE_PRIORITY_NORMAL,     ///< Default priority
+    ATCMDQUEUE_PRIORITY_LOW,        ///< Sent when no other command is pending
+    ATCMDQUEUE_PRIORITY_MAX
+}
+atCmdQueue_Priority_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a command queue
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct atCmdQueue* atCmdQueue_Ref_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Result handler
+ *
+ * The responses can be read with the AT client API from the command reference, which is deleted
+ * when the handler returns. The command reference is NULL when the sending failed.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*atCmdQueue_ResultHandlerFunc_t)
+(
+    le_result_t          result,        ///< [IN] Result of the command sending
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    void*                contextPtr     ///< [IN] Context given at submission
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a command queue for a device
+ *
+ * @return the queue reference
+ */
+//--------------------------------------------------------------------------------------------------
+atCmdQueue_Ref_t atCmdQueue_Create
+(
+    le_atClient_DeviceRef_t devRef      ///< [IN] Device the commands are sent to
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Submit a command to a queue
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_OVERFLOW when a string doesn't fit
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atCmdQueue_Submit
+(
+    atCmdQueue_Ref_t               queueRef,        ///< [IN] Queue reference
+    const char*                    commandPtr,      ///< [IN] AT command
+    const char*                    interRspPtr,     ///< [IN] Intermediate responses pattern
+    const char*                    finalRspPtr,     ///< [IN] Final responses pattern
+    uint32_t                       timeout,         ///< [IN] Timeout in milliseconds
+    atCmdQueue_Priority_t          priority,        ///< [IN] Command priority
+    atCmdQueue_ResultHandlerFunc_t handlerFunc,     ///< [IN] Result handler
+    void*                          contextPtr       ///< [IN] Handler context
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a command queue
+ *
+ * The command being sent, if any, is completed and its result is still delivered. The commands
+ * still pending are discarded without calling their handler.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void atCmdQueue_Delete
+(
+    atCmdQueue_Ref_t queueRef           ///< [IN] Queue reference
+);
+
+#endif /* atCmdQueue.h */
@@ -0,0 +1,490 @@
+/**
+ * atRsp.c implements the AT responses helpers
+ *
+ * The matchers of a device are kept in a name map, itself found from the device reference. A
+ * hashmap can't be deleted: the name map of a device is emptied when its matchers are deleted, and
+ * reused by the next matchers registered for it. A matcher keeps the final responses pattern to
+ * send it with the commands, and the offset and length of each alternative in it to classify a
+ * final response without parsing the pattern.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+#include "legato.h"
+#include "atRsp.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Expected number of devices, and of matchers per device
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define DEVICES_COUNT       4
+#define MATCHERS_COUNT      8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Alternatives separator in a final responses pattern
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define PATTERN_SEPARATOR   '|'
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Final response matcher definition
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+struct atRsp_Matcher
+{
+    char                    name[ATRSP_MATCHER_NAME_MAX_BYTES];     ///< Matcher name
+    le_atClient_DeviceRef_t devRef;                                 ///< Device reference
+    char                    pattern[LE_ATDEFS_RESPONSE_MAX_BYTES];  ///< Final responses pattern
+    int                     count;                                  ///< Number of alternatives
+    struct
+    {
+        size_t offset;                                              ///< Offset in the pattern
+        size_t length;                                              ///< Length
+    }
+    alternative[ATRSP_MATCHER_ALTERNATIVES_MAX];                    ///< Pattern alternatives
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Device matchers definition
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_atClient_DeviceRef_t devRef;         ///< Device reference
+    le_hashmap_Ref_t        matcherMap;     ///< Matchers by name
+}
+Device_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for matchers
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t MatcherPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for devices
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t DevicePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Devices by device reference
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_hashmap_Ref_t DeviceMap = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the matchers of a device
+ *
+ * @return the device, or NULL when no matcher was ever registered for the device
+ */
+//--------------------------------------------------------------------------------------------------
+static Device_t* FindDevice
+(
+    le_atClient_DeviceRef_t devRef
+)
+{
+    if (NULL == DeviceMap)
+    {
+        return NULL;
+    }
+
+    return le_hashmap_Get(DeviceMap, devRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Split a final responses pattern into its alternatives
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when an alternative is empty
+ *      - LE_OVERFLOW when there are too many alternatives
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CompilePattern
+(
+    struct atRsp_Matcher* matcherPtr
+)
+{
+    size_t offset = 0;
+
+    matcherPtr->count = 0;
+
+    while (1)
+    {
+        const char* separatorPtr = strchr(matcherPtr->pattern + offset, PATTERN_SEPARATOR);
+        size_t length = separatorPtr ? (size_t)(separatorPtr - (matcherPtr->pattern + offset))
+                                     : strlen(matcherPtr->pattern + offset);
+
+        if (0 == length)
+        {
+            return LE_BAD_PARAMETER;
+        }
+
+        if (ATRSP_MATCHER_ALTERNATIVES_MAX == matcherPtr->count)
+        {
+            return LE_OVERFLOW;
+        }
+
+        matcherPtr->alternative[matcherPtr->count].offset = offset;
+        matcherPtr->alternative[matcherPtr->count].length = length;
+        matcherPtr->count++;
+
+        if (NULL == separatorPtr)
+        {
+            return LE_OK;
+        }
+
+        offset += length + 1;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a final response matcher for a device
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid or the pattern has an empty alternative
+ *      - LE_DUPLICATE when a matcher with the same name is already registered for the device
+ *      - LE_OVERFLOW when the name or the pattern doesn't fit
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_RegisterMatcher
+(
+    le_atClient_DeviceRef_t devRef,     ///< [IN] Device reference
+    const char*             namePtr,    ///< [IN] Matcher name
+    const char*             patternPtr  ///< [IN] Final responses pattern, alternatives split by |
+)
+{
+    struct atRsp_Matcher* matcherPtr;
+    Device_t* devicePtr;
+    le_result_t result;
+
+    if ((NULL == devRef) || (NULL == namePtr) || (NULL == patternPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    if (NULL == DeviceMap)
+    {
+        MatcherPool = le_mem_CreatePool("AtRspMatcherPool", sizeof(struct atRsp_Matcher));
+        DevicePool = le_mem_CreatePool("AtRspDevicePool", sizeof(Device_t));
+        DeviceMap = le_hashmap_Create("AtRspDevices",
+                                      DEVICES_COUNT,
+                                      le_hashmap_HashVoidPointer,
+                                      le_hashmap_EqualsVoidPointer);
+    }
+
+    devicePtr = FindDevice(devRef);
+    if ((NULL != devicePtr) && (NULL != le_hashmap_Get(devicePtr->matcherMap, namePtr)))
+    {
+        return LE_DUPLICATE;
+    }
+
+    matcherPtr = le_mem_ForceAlloc(MatcherPool);
+    memset(matcherPtr, 0, sizeof(struct atRsp_Matcher));
+    matcherPtr->devRef = devRef;
+
+    if ((LE_OK != le_utf8_Copy(matcherPtr->name, namePtr, sizeof(matcherPtr->name), NULL)) ||
+        (LE_OK != le_utf8_Copy(matcherPtr->pattern,
+                               patternPtr,
+                               sizeof(matcherPtr->pattern),
+                               NULL)))
+    {
+        le_mem_Release(matcherPtr);
+        return LE_OVERFLOW;
+    }
+
+    result = CompilePattern(matcherPtr);
+    if (LE_OK != result)
+    {
+        le_mem_Release(matcherPtr);
+        return result;
+    }
+
+    if (NULL == devicePtr)
+    {
+        devicePtr = le_mem_ForceAlloc(DevicePool);
+        devicePtr->devRef = devRef;
+        devicePtr->matcherMap = le_hashmap_Create("AtRspMatchers",
+                                                  MATCHERS_COUNT,
+                                                  le_hashmap_HashString,
+                                                  le_hashmap_EqualsString);
+        le_hashmap_Put(DeviceMap, devRef, devicePtr);
+    }
+
+    le_hashmap_Put(devicePtr->matcherMap, matcherPtr->name, matcherPtr);
+
+    LE_DEBUG("Matcher '%s' registered with %d alternatives", matcherPtr->name, matcherPtr->count);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a final response matcher registered for a device
+ *
+ * @return the matcher reference, or NULL when there is no matcher with this name
+ */
+//--------------------------------------------------------------------------------------------------
+atRsp_MatcherRef_t atRsp_GetMatcher
+(
+    le_atClient_DeviceRef_t devRef,     ///< [IN] Device reference
+    const char*             namePtr     ///< [IN] Matcher name
+)
+{
+    Device_t* devicePtr = FindDevice(devRef);
+
+    if ((NULL == devicePtr) || (NULL == namePtr))
+    {
+        return NULL;
+    }
+
+    return le_hashmap_Get(devicePtr->matcherMap, namePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete all the final response matchers registered for a device
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void atRsp_DeleteMatchers
+(
+    le_atClient_DeviceRef_t devRef      ///< [IN] Device reference
+)
+{
+    Device_t* devicePtr = FindDevice(devRef);
+    le_hashmap_It_Ref_t iterRef;
+
+    if (NULL == devicePtr)
+    {
+        return;
+    }
+
+    iterRef = le_hashmap_GetIterator(devicePtr->matcherMap);
+    while (LE_OK == le_hashmap_NextNode(iterRef))
+    {
+        le_mem_Release((void*)le_hashmap_GetValue(iterRef));
+    }
+
+    le_hashmap_RemoveAll(devicePtr->matcherMap);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a command on the device of a matcher, with the matcher final responses
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - the le_atClient_SetCommandAndSend() error otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_SendCommand
+(
+    le_atClient_CmdRef_t* cmdRefPtr,    ///< [OUT] Command reference
+    atRsp_MatcherRef_t    matcherRef,   ///< [IN] Final response matcher
+    const char*           commandPtr,   ///< [IN] AT command
+    const char*           interRspPtr,  ///< [IN] Intermediate responses pattern
+    uint32_t              timeout       ///< [IN] Timeout in milliseconds
+)
+{
+    if ((NULL == cmdRefPtr) || (NULL == matcherRef) || (NULL == commandPtr) ||
+        (NULL == interRspPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    return le_atClient_SetCommandAndSend(cmdRefPtr,
+                                         matcherRef->devRef,
+                                         commandPtr,
+                                         interRspPtr,
+                                         matcherRef->pattern,
+                                         timeout);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get which alternative of a matcher the final response of a command matches
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_NOT_FOUND when the final response matches none of the alternatives
+ *      - the le_atClient_GetFinalResponse() error otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_GetFinalResponseIndex
+(
+    atRsp_MatcherRef_t   matcherRef,    ///< [IN] Final response matcher
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    int*                 indexPtr       ///< [OUT] Index of the alternative in the pattern
+)
+{
+    char finalRsp[LE_ATDEFS_RESPONSE_MAX_BYTES];
+    le_result_t result;
+    int i;
+
+    if ((NULL == matcherRef) || (NULL == cmdRef) || (NULL == indexPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    result = le_atClient_GetFinalResponse(cmdRef, finalRsp, sizeof(finalRsp));
+    if (LE_OK != result)
+    {
+        return result;
+    }
+
+    for (i = 0; i < matcherRef->count; i++)
+    {
+        if (0 == strncmp(finalRsp,
+                         matcherRef->pattern + matcherRef->alternative[i].offset,
+                         matcherRef->alternative[i].length))
+        {
+            *indexPtr = i;
+            return LE_OK;
+        }
+    }
+
+    return LE_NOT_FOUND;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get all the intermediate responses of a command, packed into a buffer
+ *
+ * The responses are separated by a '\n' and the buffer is null-terminated.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_OVERFLOW when the responses don't fit, the buffer then holds the first ones
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_GetIntermediateResponses
+(
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    char*                bufferPtr,     ///< [OUT] Packed responses
+    size_t               bufferSize,    ///< [IN] Buffer size
+    size_t*              countPtr       ///< [OUT] Number of responses in the buffer
+)
+{
+    char response[LE_ATDEFS_RESPONSE_MAX_BYTES];
+    size_t used = 0;
+    le_result_t result;
+
+    if ((NULL == cmdRef) || (NULL == bufferPtr) || (0 == bufferSize) || (NULL == countPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    *countPtr = 0;
+    bufferPtr[0] = '\0';
+
+    result = le_atClient_GetFirstIntermediateResponse(cmdRef, response, sizeof(response));
+    while (LE_OK == result)
+    {
+        size_t length = strlen(response);
+
+        // Room for the separator of the previous response and the null-terminator
+        if ((used + (used ? 1 : 0) + length + 1) > bufferSize)
+        {
+            return LE_OVERFLOW;
+        }
+
+        if (used)
+        {
+            bufferPtr[used++] = '\n';
+        }
+        memcpy(bufferPtr + used, response, length + 1);
+        used += length;
+        (*countPtr)++;
+
+        result = le_atClient_GetNextIntermediateResponse(cmdRef, response, sizeof(response));
+    }
+
+    return (LE_NOT_FOUND == result) ? LE_OK : result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write all the intermediate responses of a command to a file descriptor, one line each
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_IO_ERROR when writing fails
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_WriteIntermediateResponses
+(
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    int                  fd,            ///< [IN] File descriptor the responses are written to
+    size_t*              countPtr       ///< [OUT] Number of responses written
+)
+{
+    char response[LE_ATDEFS_RESPONSE_MAX_BYTES + 1];
+    le_result_t result;
+
+    if ((NULL == cmdRef) || (fd < 0) || (NULL == countPtr))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    *countPtr = 0;
+
+    result = le_atClient_GetFirstIntermediateResponse(cmdRef,
+                                                      response,
+                                                      LE_ATDEFS_RESPONSE_MAX_BYTES);
+    while (LE_OK == result)
+    {
+        size_t length = strlen(response);
+        size_t written = 0;
+
+        response[length++] = '\n';
+
+        while (written < length)
+        {
+            ssize_t size = write(fd, response + written, length - written);
+
+            if (-1 == size)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+
+                LE_ERROR("Cannot write the responses: %m");
+                return LE_IO_ERROR;
+            }
+
+            written += size;
+        }
+        (*countPtr)++;
+
+        result = le_atClient_GetNextIntermediateResponse(cmdRef,
+                                                         response,
+                                                         LE_ATDEFS_RESPONSE_MAX_BYTES);
+    }
+
+    return (LE_NOT_FOUND == result) ? LE_OK : result;
+}
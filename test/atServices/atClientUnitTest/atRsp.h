@@ -0,0 +1,163 @@
+/**
+ * atRsp.h
+ *
+ * AT responses helpers on top of the AT client API.
+ *
+ * - Final response matchers are registered once per device under a name. The final responses
+ *   pattern is split into its alternatives at registration, and commands then refer to the
+ *   matcher instead of passing and parsing the pattern string again.
+ * - All the intermediate responses of a command are retrieved in one call, packed into a single
+ *   buffer or written to a file descriptor, one line per response.
+ *
+ * These helpers are meant to be used from a single thread.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+#ifndef _ATRSP_H
+#define _ATRSP_H
+
+#include "legato.h"
+#include "interfaces.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of bytes in a matcher name, including the null-terminator
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define ATRSP_MATCHER_NAME_MAX_BYTES    32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of alternatives in a final responses pattern
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define ATRSP_MATCHER_ALTERNATIVES_MAX  8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a final response matcher
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct atRsp_Matcher* atRsp_MatcherRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a final response matcher for a device
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid or the pattern has an empty alternative
+ *      - LE_DUPLICATE when a matcher with the same name is already registered for the device
+ *      - LE_OVERFLOW when the name or the pattern doesn't fit
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_RegisterMatcher
+(
+    le_atClient_DeviceRef_t devRef,     ///< [IN] Device reference
+    const char*             namePtr,    ///< [IN] Matcher name
+    const char*             patternPtr  ///< [IN] Final responses pattern, alternatives split by |
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a final response matcher registered for a device
+ *
+ * @return the matcher reference, or NULL when there is no matcher with this name
+ */
+//--------------------------------------------------------------------------------------------------
+atRsp_MatcherRef_t atRsp_GetMatcher
+(
+    le_atClient_DeviceRef_t devRef,     ///< [IN] Device reference
+    const char*             namePtr     ///< [IN] Matcher name
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete all the final response matchers registered for a device
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void atRsp_DeleteMatchers
+(
+    le_atClient_DeviceRef_t devRef      ///< [IN] Device reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a command on the device of a matcher, with the matcher final responses
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - the le_atClient_SetCommandAndSend() error otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_SendCommand
+(
+    le_atClient_CmdRef_t* cmdRefPtr,    ///< [OUT] Command reference
+    atRsp_MatcherRef_t    matcherRef,   ///< [IN] Final response matcher
+    const char*           commandPtr,   ///< [IN] AT command
+    const char*           interRspPtr,  ///< [IN] Intermediate responses pattern
+    uint32_t              timeout       ///< [IN] Timeout in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get which alternative of a matcher the final response of a command matches
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_NOT_FOUND when the final response matches none of the alternatives
+ *      - the le_atClient_GetFinalResponse() error otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_GetFinalResponseIndex
+(
+    atRsp_MatcherRef_t   matcherRef,    ///< [IN] Final response matcher
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    int*                 indexPtr       ///< [OUT] Index of the alternative in the pattern
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get all the intermediate responses of a command, packed into a buffer
+ *
+ * The responses are separated by a '\n' and the buffer is null-terminated.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_OVERFLOW when the responses don't fit, the buffer then holds the first ones
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_GetIntermediateResponses
+(
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    char*                bufferPtr,     ///< [OUT] Packed responses
+    size_t               bufferSize,    ///< [IN] Buffer size
+    size_t*              countPtr       ///< [OUT] Number of responses in the buffer
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write all the intermediate responses of a command to a file descriptor, one line each
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER when a parameter is invalid
+ *      - LE_IO_ERROR when writing fails
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atRsp_WriteIntermediateResponses
+(
+    le_atClient_CmdRef_t cmdRef,        ///< [IN] Command reference
+    int                  fd,            ///< [IN] File descriptor the responses are written to
+    size_t*              countPtr       ///< [OUT] Number of responses written
+);
+
+#endif /* atRsp.h */
@@ -0,0 +1,59 @@
+/**
+ * defs.h implements shared definitions between main and the modem emulator
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+#ifndef _DEFS_H
+#define _DEFS_H
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of lines returned by the emulated modem to an AT+CMGL command
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define CMGL_LINES_COUNT    300
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the modem emulator on a file descriptor
+ *
+ * The emulator answers the AT commands received on the file descriptor from its own thread, like
+ * a modem connected to the AT client device would do.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void modem_Start
+(
+    int fd      ///< [IN] Modem side of the AT client device
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait until the modem receives an AT+HOLD command
+ *
+ * The modem doesn't answer an AT+HOLD command until modem_ReleaseHold() is called, which keeps the
+ * AT client device busy meanwhile.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void modem_WaitHold
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the AT+HOLD command in progress
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void modem_ReleaseHold
+(
+    void
+);
+
+#endif /* defs.h */
@@ -6,6 +6,589 @@
  */
 #include "legato.h"
 #include "interfaces.h"
+#include "defs.h"
+#include "atCmdQueue.h"
+#include "atRsp.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Final response pattern shared by all the commands of the test
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define FINAL_RSP_PATTERN   "OK|ERROR|+CME ERROR:|+CMS ERROR:"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Name of the final response matcher registered with FINAL_RSP_PATTERN, and the index of its
+ * alternatives
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define STD_MATCHER         "std"
+#define STD_MATCHER_OK      0
+#define STD_MATCHER_ERROR   1
+#define STD_MATCHER_CME     2
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer the AT+CMGL intermediate responses are packed into
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define CMGL_BUFFER_SIZE    (CMGL_LINES_COUNT * LE_ATDEFS_RESPONSE_MAX_BYTES)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of commands sent by the queue benchmark
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define QUEUE_BENCH_CMDS_COUNT  200
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AT client device used by the test
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_atClient_DeviceRef_t DevRef;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command queue used by the test
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static atCmdQueue_Ref_t QueueRef;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Commands submitted to the queue for the priority test, in submission order, and the order in
+ * which they are expected to complete.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static const struct
+{
+    const char*           commandPtr;
+    const char*           interRspPtr;
+    atCmdQueue_Priority_t priority;
+    int                   expectedRank;
+}
+PriorityCmds[] =
+{
+    // Sent right away as the queue is empty, and held by the modem while the others are queued
+    { "AT+HOLD",    "",         ATCMDQUEUE_PRIORITY_LOW,    0 },
+    { "AT+CSQ",     "+CSQ:",    ATCMDQUEUE_PRIORITY_LOW,    3 },
+    { "AT+CREG?",   "+CREG:",   ATCMDQUEUE_PRIORITY_NORMAL, 2 },
+    { "AT+CGSN",    "",         ATCMDQUEUE_PRIORITY_HIGH,   1 },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of results received by the queue tests
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static int QueueResultsCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue benchmark start time
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_clk_Time_t QueueStartTime;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test a command with a single intermediate response
+ *
+ * APIs tested:
+ * - le_atClient_SetCommandAndSend
+ * - le_atClient_GetFirstIntermediateResponse
+ * - le_atClient_GetNextIntermediateResponse
+ * - le_atClient_GetFinalResponse
+ * - le_atClient_Delete
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestIntermediateResponse
+(
+    void
+)
+{
+    le_atClient_CmdRef_t cmdRef;
+    char buffer[LE_ATDEFS_RESPONSE_MAX_BYTES];
+
+    LE_ASSERT_OK(le_atClient_SetCommandAndSend(&cmdRef,
+                                               DevRef,
+                                               "AT+CGSN",
+                                               "",
+                                               FINAL_RSP_PATTERN,
+                                               LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+
+    LE_ASSERT_OK(le_atClient_GetFinalResponse(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "OK"));
+
+    LE_ASSERT_OK(le_atClient_GetFirstIntermediateResponse(cmdRef,
+                                                          buffer,
+                                                          LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "359377060009700"));
+
+    LE_ASSERT(le_atClient_GetNextIntermediateResponse(cmdRef,
+                                                      buffer,
+                                                      LE_ATDEFS_RESPONSE_MAX_BYTES)
+              == LE_NOT_FOUND);
+
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the final response matching with the different patterns of the final response string
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestFinalResponses
+(
+    void
+)
+{
+    le_atClient_CmdRef_t cmdRef;
+    char buffer[LE_ATDEFS_RESPONSE_MAX_BYTES];
+
+    LE_ASSERT_OK(le_atClient_SetCommandAndSend(&cmdRef,
+                                               DevRef,
+                                               "AT+CPMS?",
+                                               "",
+                                               FINAL_RSP_PATTERN,
+                                               LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+    LE_ASSERT_OK(le_atClient_GetFinalResponse(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "+CME ERROR: 10"));
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+
+    LE_ASSERT_OK(le_atClient_SetCommandAndSend(&cmdRef,
+                                               DevRef,
+                                               "AT+UNKNOWN",
+                                               "",
+                                               FINAL_RSP_PATTERN,
+                                               LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+    LE_ASSERT_OK(le_atClient_GetFinalResponse(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "ERROR"));
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time elapsed since a given time, in microseconds
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static long GetElapsedUs
+(
+    le_clk_Time_t startTime
+)
+{
+    le_clk_Time_t elapsedTime = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    return (long)(elapsedTime.sec * 1000000 + elapsedTime.usec);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the retrieval of a long list of intermediate responses, and measure the cost of getting
+ * them one line at a time. TestPackedResponses() gets the same list in a single call.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestMultiLineResponse
+(
+    void
+)
+{
+    le_atClient_CmdRef_t cmdRef;
+    char buffer[LE_ATDEFS_RESPONSE_MAX_BYTES];
+    le_clk_Time_t startTime;
+    le_result_t res;
+    int linesCount = 0;
+
+    LE_ASSERT_OK(le_atClient_SetCommandAndSend(&cmdRef,
+                                               DevRef,
+                                               "AT+CMGF=1",
+                                               "",
+                                               FINAL_RSP_PATTERN,
+                                               LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+
+    startTime = le_clk_GetRelativeTime();
+
+    LE_ASSERT_OK(le_atClient_SetCommandAndSend(&cmdRef,
+                                               DevRef,
+                                               "AT+CMGL=\"REC READ\"",
+                                               "+CMGL:",
+                                               FINAL_RSP_PATTERN,
+                                               LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+
+    LE_ASSERT_OK(le_atClient_GetFinalResponse(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "OK"));
+
+    res = le_atClient_GetFirstIntermediateResponse(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES);
+    while (LE_OK == res)
+    {
+        char expected[LE_ATDEFS_RESPONSE_MAX_BYTES];
+
+        snprintf(expected, sizeof(expected), "+CMGL: %d,", linesCount);
+        LE_ASSERT(0 == strncmp(buffer, expected, strlen(expected)));
+        linesCount++;
+
+        res = le_atClient_GetNextIntermediateResponse(cmdRef,
+                                                      buffer,
+                                                      LE_ATDEFS_RESPONSE_MAX_BYTES);
+    }
+    LE_ASSERT(LE_NOT_FOUND == res);
+    LE_ASSERT(CMGL_LINES_COUNT == linesCount);
+
+    LE_INFO("%d intermediate responses retrieved in %ld us, %d retrieval calls",
+            linesCount, GetElapsedUs(startTime), linesCount + 1);
+
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check the AT+CMGL intermediate responses packed one per line
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckCmglLines
+(
+    char* bufferPtr
+)
+{
+    char* savePtr = NULL;
+    char* linePtr;
+    int linesCount = 0;
+
+    for (linePtr = strtok_r(bufferPtr, "\n", &savePtr);
+         linePtr != NULL;
+         linePtr = strtok_r(NULL, "\n", &savePtr))
+    {
+        char expected[LE_ATDEFS_RESPONSE_MAX_BYTES];
+
+        snprintf(expected, sizeof(expected), "+CMGL: %d,", linesCount);
+        LE_ASSERT(0 == strncmp(linePtr, expected, strlen(expected)));
+        linesCount++;
+    }
+
+    LE_ASSERT(CMGL_LINES_COUNT == linesCount);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the named final response matchers
+ *
+ * APIs tested:
+ * - atRsp_RegisterMatcher
+ * - atRsp_GetMatcher
+ * - atRsp_SendCommand
+ * - atRsp_GetFinalResponseIndex
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestMatchers
+(
+    void
+)
+{
+    static const struct
+    {
+        const char* commandPtr;
+        int         expectedIndex;
+    }
+    commands[] =
+    {
+        { "AT+CGSN",    STD_MATCHER_OK },
+        { "AT+UNKNOWN", STD_MATCHER_ERROR },
+        { "AT+CPMS?",   STD_MATCHER_CME },
+    };
+    atRsp_MatcherRef_t matcherRef;
+    le_atClient_CmdRef_t cmdRef;
+    int index;
+    int i;
+
+    LE_ASSERT(atRsp_RegisterMatcher(DevRef, "empty", "OK||ERROR") == LE_BAD_PARAMETER);
+    LE_ASSERT(atRsp_RegisterMatcher(DevRef, "many", "A|B|C|D|E|F|G|H|I") == LE_OVERFLOW);
+    LE_ASSERT(atRsp_GetMatcher(DevRef, STD_MATCHER) == NULL);
+
+    LE_ASSERT_OK(atRsp_RegisterMatcher(DevRef, STD_MATCHER, FINAL_RSP_PATTERN));
+    LE_ASSERT(atRsp_RegisterMatcher(DevRef, STD_MATCHER, "OK") == LE_DUPLICATE);
+    LE_ASSERT_OK(atRsp_RegisterMatcher(DevRef, "ok", "OK"));
+
+    matcherRef = atRsp_GetMatcher(DevRef, STD_MATCHER);
+    LE_ASSERT(matcherRef != NULL);
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(commands); i++)
+    {
+        LE_ASSERT_OK(atRsp_SendCommand(&cmdRef,
+                                       matcherRef,
+                                       commands[i].commandPtr,
+                                       "",
+                                       LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+        LE_ASSERT_OK(atRsp_GetFinalResponseIndex(matcherRef, cmdRef, &index));
+        LE_ASSERT(commands[i].expectedIndex == index);
+        LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+    }
+
+    // A final response matching none of the alternatives of another matcher
+    LE_ASSERT_OK(atRsp_SendCommand(&cmdRef,
+                                   matcherRef,
+                                   "AT+UNKNOWN",
+                                   "",
+                                   LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+    LE_ASSERT(atRsp_GetFinalResponseIndex(atRsp_GetMatcher(DevRef, "ok"), cmdRef, &index)
+              == LE_NOT_FOUND);
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the retrieval of a long list of intermediate responses in a single call, into a buffer
+ * then into a file descriptor.
+ *
+ * APIs tested:
+ * - atRsp_GetIntermediateResponses
+ * - atRsp_WriteIntermediateResponses
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestPackedResponses
+(
+    void
+)
+{
+    static char buffer[CMGL_BUFFER_SIZE];
+    atRsp_MatcherRef_t matcherRef = atRsp_GetMatcher(DevRef, STD_MATCHER);
+    le_atClient_CmdRef_t cmdRef;
+    le_clk_Time_t startTime;
+    size_t count;
+    size_t size = 0;
+    int fds[2];
+    int index;
+
+    LE_ASSERT(matcherRef != NULL);
+
+    startTime = le_clk_GetRelativeTime();
+
+    LE_ASSERT_OK(atRsp_SendCommand(&cmdRef,
+                                   matcherRef,
+                                   "AT+CMGL=\"REC READ\"",
+                                   "+CMGL:",
+                                   LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+    LE_ASSERT_OK(atRsp_GetFinalResponseIndex(matcherRef, cmdRef, &index));
+    LE_ASSERT(STD_MATCHER_OK == index);
+
+    LE_ASSERT_OK(atRsp_GetIntermediateResponses(cmdRef, buffer, sizeof(buffer), &count));
+    LE_ASSERT(CMGL_LINES_COUNT == count);
+
+    LE_INFO("%zu intermediate responses retrieved in %ld us, 1 retrieval call",
+            count, GetElapsedUs(startTime));
+
+    CheckCmglLines(buffer);
+
+    // A buffer too small keeps the first responses only
+    LE_ASSERT(atRsp_GetIntermediateResponses(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES, &count)
+              == LE_OVERFLOW);
+    LE_ASSERT((count > 0) && (count < CMGL_LINES_COUNT));
+    LE_ASSERT(0 == strncmp(buffer, "+CMGL: 0,", strlen("+CMGL: 0,")));
+
+    // The listing fits in the pipe buffer, it is read back once written
+    LE_ASSERT(0 == pipe(fds));
+    LE_ASSERT_OK(atRsp_WriteIntermediateResponses(cmdRef, fds[1], &count));
+    LE_ASSERT(CMGL_LINES_COUNT == count);
+    close(fds[1]);
+
+    while (1)
+    {
+        ssize_t readSize = read(fds[0], buffer + size, sizeof(buffer) - 1 - size);
+
+        LE_ASSERT(readSize >= 0);
+        if (0 == readSize)
+        {
+            break;
+        }
+        size += readSize;
+    }
+    close(fds[0]);
+    buffer[size] = '\0';
+
+    CheckCmglLines(buffer);
+
+    LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue benchmark result handler: the test ends with the last result
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchResultHandler
+(
+    le_result_t          result,
+    le_atClient_CmdRef_t cmdRef,
+    void*                contextPtr
+)
+{
+    char buffer[LE_ATDEFS_RESPONSE_MAX_BYTES];
+
+    LE_ASSERT_OK(result);
+    LE_ASSERT_OK(le_atClient_GetFirstIntermediateResponse(cmdRef,
+                                                          buffer,
+                                                          LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "+CSQ: 17,99"));
+
+    QueueResultsCount++;
+    if (QUEUE_BENCH_CMDS_COUNT != QueueResultsCount)
+    {
+        return;
+    }
+
+    LE_INFO("%d queued commands completed in %ld us", QUEUE_BENCH_CMDS_COUNT,
+            GetElapsedUs(QueueStartTime));
+
+    atCmdQueue_Delete(QueueRef);
+    LE_ASSERT_OK(le_atClient_Stop(DevRef));
+
+    LE_INFO("======== UnitTest of AT CLIENT API FINISHED ========");
+    exit(EXIT_SUCCESS);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare blocking sends and queued submissions of the same commands. The submitter is only
+ * blocked for the time needed to queue the commands.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchmarkCommandQueue
+(
+    void
+)
+{
+    le_atClient_CmdRef_t cmdRef;
+    le_clk_Time_t startTime;
+    int i;
+
+    startTime = le_clk_GetRelativeTime();
+    for (i = 0; i < QUEUE_BENCH_CMDS_COUNT; i++)
+    {
+        LE_ASSERT_OK(le_atClient_SetCommandAndSend(&cmdRef,
+                                                   DevRef,
+                                                   "AT+CSQ",
+                                                   "+CSQ:",
+                                                   FINAL_RSP_PATTERN,
+                                                   LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT));
+        LE_ASSERT_OK(le_atClient_Delete(cmdRef));
+    }
+    LE_INFO("%d blocking commands completed in %ld us", QUEUE_BENCH_CMDS_COUNT,
+            GetElapsedUs(startTime));
+
+    QueueResultsCount = 0;
+    QueueStartTime = le_clk_GetRelativeTime();
+    for (i = 0; i < QUEUE_BENCH_CMDS_COUNT; i++)
+    {
+        LE_ASSERT_OK(atCmdQueue_Submit(QueueRef,
+                                       "AT+CSQ",
+                                       "+CSQ:",
+                                       FINAL_RSP_PATTERN,
+                                       LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT,
+                                       ATCMDQUEUE_PRIORITY_NORMAL,
+                                       BenchResultHandler,
+                                       NULL));
+    }
+    LE_INFO("%d commands queued in %ld us", QUEUE_BENCH_CMDS_COUNT,
+            GetElapsedUs(QueueStartTime));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Priority test result handler: check that the commands completed in priority order
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void PriorityResultHandler
+(
+    le_result_t          result,
+    le_atClient_CmdRef_t cmdRef,
+    void*                contextPtr
+)
+{
+    int index = (int)(intptr_t)contextPtr;
+    char buffer[LE_ATDEFS_RESPONSE_MAX_BYTES];
+
+    LE_ASSERT_OK(result);
+    LE_ASSERT_OK(le_atClient_GetFinalResponse(cmdRef, buffer, LE_ATDEFS_RESPONSE_MAX_BYTES));
+    LE_ASSERT(0 == strcmp(buffer, "OK"));
+
+    LE_DEBUG("%s completed", PriorityCmds[index].commandPtr);
+    LE_ASSERT(PriorityCmds[index].expectedRank == QueueResultsCount);
+
+    QueueResultsCount++;
+    if (NUM_ARRAY_MEMBERS(PriorityCmds) == QueueResultsCount)
+    {
+        BenchmarkCommandQueue();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the asynchronous commands submission
+ *
+ * The results are delivered by the event loop, the test goes on in the result handlers.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestCommandQueue
+(
+    void
+)
+{
+    int i;
+
+    QueueRef = atCmdQueue_Create(DevRef);
+    LE_ASSERT(QueueRef != NULL);
+
+    LE_ASSERT(atCmdQueue_Submit(QueueRef, NULL, "", FINAL_RSP_PATTERN,
+                                LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT, ATCMDQUEUE_PRIORITY_NORMAL,
+                                PriorityResultHandler, NULL) == LE_BAD_PARAMETER);
+    LE_ASSERT(atCmdQueue_Submit(QueueRef, "AT", "", FINAL_RSP_PATTERN,
+                                LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT, ATCMDQUEUE_PRIORITY_MAX,
+                                PriorityResultHandler, NULL) == LE_BAD_PARAMETER);
+
+    QueueResultsCount = 0;
+    for (i = 0; i < NUM_ARRAY_MEMBERS(PriorityCmds); i++)
+    {
+        LE_ASSERT_OK(atCmdQueue_Submit(QueueRef,
+                                       PriorityCmds[i].commandPtr,
+                                       PriorityCmds[i].interRspPtr,
+                                       FINAL_RSP_PATTERN,
+                                       LE_ATDEFS_COMMAND_DEFAULT_TIMEOUT,
+                                       PriorityCmds[i].priority,
+                                       PriorityResultHandler,
+                                       (void*)(intptr_t)i));
+
+        // The worker thread is blocked on the first command until every command is queued
+        if (0 == i)
+        {
+            modem_WaitHold();
+        }
+    }
+
+    modem_ReleaseHold();
+}
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -15,11 +598,28 @@
 //--------------------------------------------------------------------------------------------------
 COMPONENT_INIT
 {
+    int fds[2];
+
     // To reactivate for all DEBUG logs
     //le_log_SetFilterLevel(LE_LOG_DEBUG);
 
     LE_INFO("======== START UnitTest of AT CLIENT API ========");
 
-    LE_INFO("======== UnitTest of AT CLIENT API FINISHED ========");
-    exit(EXIT_SUCCESS);
+    LE_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    modem_Start(fds[1]);
+
+    DevRef = le_atClient_Start(fds[0]);
+    LE_ASSERT(DevRef != NULL);
+
+    TestIntermediateResponse();
+    TestFinalResponses();
+    TestMultiLineResponse();
+    TestMatchers();
+    TestPackedResponses();
+    atRsp_DeleteMatchers(DevRef);
+    LE_ASSERT(atRsp_GetMatcher(DevRef, STD_MATCHER) == NULL);
+
+    // The queue test completes from the event loop, and ends the test
+    TestCommandQueue();
 }
@@ -0,0 +1,299 @@
+/**
+ * modem.c implements a modem emulator answering to the AT client unit test commands
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+#include "legato.h"
+#include "defs.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive buffer size
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define MODEM_BUFFER_SIZE   1024
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Response builder: write the response to a command on the file descriptor
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*ResponseFunc_t)
+(
+    int fd
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Emulated command definition
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char*    commandPtr;      ///< Command, without the trailing \r
+    const char*    responsePtr;     ///< Static response
+    ResponseFunc_t responseFunc;    ///< Response builder, used when there is no static response
+}
+ModemCmd_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Posted by the modem when an AT+HOLD command is received
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_sem_Ref_t HeldSemRef;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Posted by the test to answer the AT+HOLD command in progress
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_sem_Ref_t ReleaseSemRef;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a whole buffer on the modem file descriptor
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteResponse
+(
+    int         fd,
+    const char* rspPtr,
+    size_t      len
+)
+{
+    while (len > 0)
+    {
+        ssize_t size = write(fd, rspPtr, len);
+
+        if (-1 == size)
+        {
+            LE_ASSERT(EINTR == errno);
+            continue;
+        }
+
+        rspPtr += size;
+        len -= size;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AT+CMGL response: a long list of SMS, one intermediate response line each
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void CmglResponse
+(
+    int fd
+)
+{
+    char line[LE_ATDEFS_RESPONSE_MAX_BYTES];
+    int i;
+
+    for (i = 0; i < CMGL_LINES_COUNT; i++)
+    {
+        int len = snprintf(line, sizeof(line),
+                           "\r\n+CMGL: %d,\"REC READ\",\"+33600000000\",,\"17/01/01,00:00:00+04\"\r\n",
+                           i);
+        WriteResponse(fd, line, len);
+    }
+
+    WriteResponse(fd, "\r\nOK\r\n", strlen("\r\nOK\r\n"));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AT+HOLD response: a command which is only completed on the modem side when the test releases it
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void HoldResponse
+(
+    int fd
+)
+{
+    le_sem_Post(HeldSemRef);
+    le_sem_Wait(ReleaseSemRef);
+
+    WriteResponse(fd, "\r\nOK\r\n", strlen("\r\nOK\r\n"));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Commands known by the emulated modem
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static const ModemCmd_t ModemCmds[] =
+{
+    {
+        .commandPtr = "AT+CGSN",
+        .responsePtr = "\r\n359377060009700\r\n\r\nOK\r\n",
+    },
+    {
+        .commandPtr = "AT+CREG?",
+        .responsePtr = "\r\n+CREG: 0,1\r\n\r\nOK\r\n",
+    },
+    {
+        .commandPtr = "AT+CSQ",
+        .responsePtr = "\r\n+CSQ: 17,99\r\n\r\nOK\r\n",
+    },
+    {
+        .commandPtr = "AT+CMGF=1",
+        .responsePtr = "\r\nOK\r\n",
+    },
+    {
+        .commandPtr = "AT+CMGL=\"REC READ\"",
+        .responseFunc = CmglResponse,
+    },
+    {
+        .commandPtr = "AT+HOLD",
+        .responseFunc = HoldResponse,
+    },
+    {
+        .commandPtr = "AT+CPMS?",
+        .responsePtr = "\r\n+CME ERROR: 10\r\n",
+    },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer to one command line
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void ProcessCommand
+(
+    int         fd,
+    const char* cmdPtr
+)
+{
+    int i;
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(ModemCmds); i++)
+    {
+        if (0 == strcmp(ModemCmds[i].commandPtr, cmdPtr))
+        {
+            if (ModemCmds[i].responsePtr)
+            {
+                WriteResponse(fd, ModemCmds[i].responsePtr, strlen(ModemCmds[i].responsePtr));
+            }
+            else
+            {
+                ModemCmds[i].responseFunc(fd);
+            }
+            return;
+        }
+    }
+
+    LE_DEBUG("Unknown command %s", cmdPtr);
+    WriteResponse(fd, "\r\nERROR\r\n", strlen("\r\nERROR\r\n"));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Modem thread: read the command lines and answer them
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void* ModemThread
+(
+    void* contextPtr
+)
+{
+    int fd = (int)(intptr_t)contextPtr;
+    char buf[MODEM_BUFFER_SIZE];
+    size_t offset = 0;
+    ssize_t size;
+
+    LE_DEBUG("Modem started");
+
+    while ((size = read(fd, buf + offset, sizeof(buf) - offset - 1)) != 0)
+    {
+        char* linePtr = buf;
+        char* endPtr;
+
+        if (-1 == size)
+        {
+            LE_ASSERT(EINTR == errno);
+            continue;
+        }
+
+        offset += size;
+        buf[offset] = '\0';
+
+        // Several commands may have been received in one read
+        while ((endPtr = strchr(linePtr, '\r')) != NULL)
+        {
+            *endPtr = '\0';
+            ProcessCommand(fd, linePtr);
+            linePtr = endPtr + 1;
+        }
+
+        offset -= (linePtr - buf);
+        memmove(buf, linePtr, offset);
+        LE_ASSERT(offset < sizeof(buf) - 1);
+    }
+
+    LE_DEBUG("Modem stopped");
+    close(fd);
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the modem emulator on a file descriptor
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void modem_Start
+(
+    int fd      ///< [IN] Modem side of the AT client device
+)
+{
+    le_thread_Ref_t modemThread = le_thread_Create("ModemThread",
+                                                   ModemThread,
+                                                   (void*)(intptr_t)fd);
+
+    HeldSemRef = le_sem_Create("ModemHeldSem", 0);
+    ReleaseSemRef = le_sem_Create("ModemReleaseSem", 0);
+
+    le_thread_Start(modemThread);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait until the modem receives an AT+HOLD command
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void modem_WaitHold
+(
+    void
+)
+{
+    le_sem_Wait(HeldSemRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the AT+HOLD command in progress
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+void modem_ReleaseHold
+(
+    void
+)
+{
+    le_sem_Post(ReleaseSemRef);
+}
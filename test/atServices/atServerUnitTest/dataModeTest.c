@@ -0,0 +1,707 @@
+/** @file dataModeTest.c
+ *
+ * Unit tests for the transparent data mode relay used when a bridged device goes in data mode
+ * (PPP passthrough from the host to the modem).
+ *
+ * Bytes are moved between the two file descriptors with splice() through a pipe, so that they
+ * never get copied into userspace. When the kernel can't splice the file descriptors, the relay
+ * falls back to a copy loop with a large buffer.
+ *
+ * The relay only reads from the source when the pipe has been drained into the destination, so a
+ * slow destination throttles the source (flow control). The escape sequence (+++ surrounded by
+ * guard times) is detected on small idle reads which are the only ones that can carry it.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+#include "defs.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer used by the copy loop fallback and of the pipe used by splice
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define RELAY_BUFFER_SIZE       (64 * 1024)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Escape sequence and guard time (in milliseconds) surrounding it
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define ESCAPE_SEQUENCE         "+++"
+#define ESCAPE_SEQUENCE_LEN     (sizeof(ESCAPE_SEQUENCE) - 1)
+#define ESCAPE_GUARD_TIME_MS    100
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Amount of data sent through the relay by the throughput test
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define THROUGHPUT_DATA_SIZE    (64 * 1024 * 1024)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data mode relay context
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int           srcFd;                            ///< Host side file descriptor
+    int           dstFd;                            ///< Modem side file descriptor
+    int           pipeFds[2];                       ///< Pipe used by splice
+    bool          useSplice;                        ///< Use splice, or the copy loop
+    size_t        pendingBytes;                     ///< Bytes read but not written yet
+    char          buffer[RELAY_BUFFER_SIZE];        ///< Copy loop buffer
+    size_t        escapeCount;                      ///< Escape characters received so far
+    le_clk_Time_t lastRxTime;                       ///< Time of the last data received
+    uint64_t      relayedBytes;                     ///< Bytes written to the destination
+}
+DataRelay_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data writer context
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int    fd;                                      ///< File descriptor to write to
+    size_t size;                                    ///< Number of bytes to write
+    size_t escapeLen;                               ///< Escape characters sent at the end
+}
+DataWriter_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Relay context, static because of the size of the copy buffer
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static DataRelay_t DataRelay;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time elapsed since a given time, in milliseconds
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetElapsedMs
+(
+    le_clk_Time_t startTime
+)
+{
+    le_clk_Time_t elapsed = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    return (uint64_t)elapsed.sec * 1000 + elapsed.usec / 1000;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a whole buffer to a blocking file descriptor
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteAll
+(
+    int         fd,
+    const char* bufPtr,
+    size_t      size
+)
+{
+    while (size > 0)
+    {
+        ssize_t count = write(fd, bufPtr, size);
+
+        if (-1 == count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            LE_ERROR("write failed: %s", strerror(errno));
+            return LE_IO_ERROR;
+        }
+
+        bufPtr += count;
+        size -= count;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drain the pending bytes into the destination
+ *
+ * @return
+ *      - LE_OK          all pending bytes written
+ *      - LE_WOULD_BLOCK destination is full, pending bytes remain
+ *      - LE_IO_ERROR    write failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t FlushPending
+(
+    DataRelay_t* relayPtr
+)
+{
+    while (relayPtr->pendingBytes > 0)
+    {
+        ssize_t count;
+
+        if (relayPtr->useSplice)
+        {
+            count = splice(relayPtr->pipeFds[0], NULL, relayPtr->dstFd, NULL,
+                           relayPtr->pendingBytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        }
+        else
+        {
+            count = write(relayPtr->dstFd, relayPtr->buffer, relayPtr->pendingBytes);
+            if (count > 0)
+            {
+                memmove(relayPtr->buffer, relayPtr->buffer + count, relayPtr->pendingBytes - count);
+            }
+        }
+
+        if (-1 == count)
+        {
+            if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+            {
+                return LE_WOULD_BLOCK;
+            }
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            LE_ERROR("Relay write failed: %s", strerror(errno));
+            return LE_IO_ERROR;
+        }
+
+        relayPtr->pendingBytes -= count;
+        relayPtr->relayedBytes += count;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the source into the pipe, or the copy buffer
+ *
+ * @return
+ *      - LE_OK          data read
+ *      - LE_CLOSED      source closed
+ *      - LE_IO_ERROR    read failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadSource
+(
+    DataRelay_t* relayPtr
+)
+{
+    ssize_t count;
+
+    if (relayPtr->useSplice)
+    {
+        count = splice(relayPtr->srcFd, NULL, relayPtr->pipeFds[1], NULL,
+                       RELAY_BUFFER_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if ((-1 == count) && (EINVAL == errno))
+        {
+            // These file descriptors can't be spliced, fall back to the copy loop
+            LE_INFO("splice not supported, using copy loop");
+            relayPtr->useSplice = false;
+            return ReadSource(relayPtr);
+        }
+    }
+    else
+    {
+        count = read(relayPtr->srcFd, relayPtr->buffer, RELAY_BUFFER_SIZE);
+    }
+
+    if (0 == count)
+    {
+        return LE_CLOSED;
+    }
+
+    if (-1 == count)
+    {
+        if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))
+        {
+            return LE_OK;
+        }
+        LE_ERROR("Relay read failed: %s", strerror(errno));
+        return LE_IO_ERROR;
+    }
+
+    relayPtr->pendingBytes = count;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check for the escape sequence on an idle source
+ *
+ * The escape sequence must be preceded by a guard time, so only a few bytes received after a
+ * silence need to be inspected; bulk data keeps going through the zero-copy path. Escape
+ * characters are consumed and held back until either the trailing guard time expires or another
+ * byte shows they were payload.
+ *
+ * @return
+ *      - true if the source data has been consumed by the escape detection
+ *      - false if the data must go through the relay path
+ */
+//--------------------------------------------------------------------------------------------------
+static bool CheckEscape
+(
+    DataRelay_t* relayPtr
+)
+{
+    int available = 0;
+    char escapeBuf[ESCAPE_SEQUENCE_LEN];
+    ssize_t count;
+    ssize_t i;
+
+    if ((0 == relayPtr->escapeCount) &&
+        (GetElapsedMs(relayPtr->lastRxTime) < ESCAPE_GUARD_TIME_MS))
+    {
+        return false;
+    }
+
+    if ((-1 == ioctl(relayPtr->srcFd, FIONREAD, &available)) ||
+        (available > (int)(ESCAPE_SEQUENCE_LEN - relayPtr->escapeCount)))
+    {
+        return false;
+    }
+
+    count = recv(relayPtr->srcFd, escapeBuf, available, MSG_PEEK | MSG_DONTWAIT);
+    if (count <= 0)
+    {
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (escapeBuf[i] != ESCAPE_SEQUENCE[relayPtr->escapeCount + i])
+        {
+            return false;
+        }
+    }
+
+    // Consume the escape characters
+    LE_ASSERT(read(relayPtr->srcFd, escapeBuf, count) == count);
+    relayPtr->escapeCount += count;
+    relayPtr->lastRxTime = le_clk_GetRelativeTime();
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue held back escape characters which turned out to be payload, they are sent to the
+ * destination with the next flush.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReleaseEscape
+(
+    DataRelay_t* relayPtr
+)
+{
+    if (relayPtr->useSplice)
+    {
+        if (write(relayPtr->pipeFds[1], ESCAPE_SEQUENCE, relayPtr->escapeCount) !=
+            relayPtr->escapeCount)
+        {
+            LE_ERROR("pipe write failed: %s", strerror(errno));
+            return LE_IO_ERROR;
+        }
+    }
+    else
+    {
+        memcpy(relayPtr->buffer, ESCAPE_SEQUENCE, relayPtr->escapeCount);
+    }
+
+    relayPtr->pendingBytes = relayPtr->escapeCount;
+    relayPtr->escapeCount = 0;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the poll timeout: while escape characters are held back, the poll wakes up when their
+ * trailing guard time expires.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetPollTimeoutMs
+(
+    DataRelay_t* relayPtr
+)
+{
+    uint64_t elapsedMs;
+
+    if (0 == relayPtr->escapeCount)
+    {
+        return ESCAPE_GUARD_TIME_MS;
+    }
+
+    elapsedMs = GetElapsedMs(relayPtr->lastRxTime);
+
+    return (elapsedMs >= ESCAPE_GUARD_TIME_MS) ? 0 : (int)(ESCAPE_GUARD_TIME_MS - elapsedMs);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Relay the data from the source to the destination until the escape sequence is detected, or
+ * the source is closed.
+ *
+ * @return
+ *      - LE_TERMINATED  escape sequence detected
+ *      - LE_CLOSED      source closed
+ *      - LE_IO_ERROR    read or write failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RelayData
+(
+    DataRelay_t* relayPtr
+)
+{
+    struct pollfd fds[2];
+    le_result_t result;
+
+    relayPtr->lastRxTime = le_clk_GetRelativeTime();
+
+    while (1)
+    {
+        int ret;
+
+        fds[0].fd = relayPtr->srcFd;
+        fds[0].revents = 0;
+        fds[1].fd = relayPtr->dstFd;
+        fds[1].revents = 0;
+
+        // Flow control: stop reading the source while the destination is not drained
+        fds[0].events = relayPtr->pendingBytes ? 0 : POLLIN;
+        fds[1].events = relayPtr->pendingBytes ? POLLOUT : 0;
+
+        ret = poll(fds, NUM_ARRAY_MEMBERS(fds), GetPollTimeoutMs(relayPtr));
+        if (-1 == ret)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            LE_ERROR("poll failed: %s", strerror(errno));
+            return LE_IO_ERROR;
+        }
+
+        if ((relayPtr->escapeCount == ESCAPE_SEQUENCE_LEN) &&
+            (GetElapsedMs(relayPtr->lastRxTime) >= ESCAPE_GUARD_TIME_MS))
+        {
+            LE_INFO("Escape sequence detected");
+            return LE_TERMINATED;
+        }
+
+        if ((relayPtr->escapeCount > 0) && (0 == relayPtr->pendingBytes) &&
+            (GetElapsedMs(relayPtr->lastRxTime) >= ESCAPE_GUARD_TIME_MS))
+        {
+            // The source went idle on an incomplete escape sequence: the held back characters
+            // were payload
+            result = ReleaseEscape(relayPtr);
+            if (LE_OK != result)
+            {
+                return result;
+            }
+
+            result = FlushPending(relayPtr);
+            if ((LE_OK != result) && (LE_WOULD_BLOCK != result))
+            {
+                return result;
+            }
+        }
+
+        if (fds[1].revents & POLLOUT)
+        {
+            result = FlushPending(relayPtr);
+            if ((LE_OK != result) && (LE_WOULD_BLOCK != result))
+            {
+                return result;
+            }
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP))
+        {
+            if (CheckEscape(relayPtr))
+            {
+                continue;
+            }
+
+            if (relayPtr->escapeCount > 0)
+            {
+                // Send the held back characters first, the source is read again once they are
+                // flushed
+                result = ReleaseEscape(relayPtr);
+                if (LE_OK != result)
+                {
+                    return result;
+                }
+                continue;
+            }
+
+            result = ReadSource(relayPtr);
+            if (LE_OK != result)
+            {
+                return result;
+            }
+            relayPtr->lastRxTime = le_clk_GetRelativeTime();
+
+            result = FlushPending(relayPtr);
+            if ((LE_OK != result) && (LE_WOULD_BLOCK != result))
+            {
+                return result;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data writer thread: emulates the host sending data, then optionally the escape sequence
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void* DataWriter
+(
+    void* contextPtr
+)
+{
+    DataWriter_t* writerPtr = (DataWriter_t*)contextPtr;
+    static char buf[RELAY_BUFFER_SIZE];
+    size_t remaining = writerPtr->size;
+
+    memset(buf, 'D', sizeof(buf));
+
+    while (remaining > 0)
+    {
+        size_t size = (remaining < sizeof(buf)) ? remaining : sizeof(buf);
+
+        LE_ASSERT_OK(WriteAll(writerPtr->fd, buf, size));
+        remaining -= size;
+    }
+
+    if (writerPtr->escapeLen > 0)
+    {
+        usleep(2 * ESCAPE_GUARD_TIME_MS * 1000);
+        LE_ASSERT_OK(WriteAll(writerPtr->fd, ESCAPE_SEQUENCE, writerPtr->escapeLen));
+    }
+
+    if (0 == writerPtr->escapeLen)
+    {
+        shutdown(writerPtr->fd, SHUT_WR);
+    }
+    else if (writerPtr->escapeLen < ESCAPE_SEQUENCE_LEN)
+    {
+        // Stay idle after an incomplete escape sequence, it must be relayed as payload once the
+        // guard time expires. Then stop the relay with a complete escape sequence.
+        usleep(3 * ESCAPE_GUARD_TIME_MS * 1000);
+        LE_ASSERT_OK(WriteAll(writerPtr->fd, ESCAPE_SEQUENCE, ESCAPE_SEQUENCE_LEN));
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Data reader thread: emulates the modem, counts the bytes received until the relay closes
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void* DataReader
+(
+    void* contextPtr
+)
+{
+    int fd = *(int*)contextPtr;
+    static char buf[RELAY_BUFFER_SIZE];
+    uint64_t* countPtr = malloc(sizeof(uint64_t));
+    ssize_t size;
+
+    LE_ASSERT(countPtr != NULL);
+    *countPtr = 0;
+
+    while ((size = read(fd, buf, sizeof(buf))) != 0)
+    {
+        if (-1 == size)
+        {
+            LE_ASSERT(EINTR == errno);
+            continue;
+        }
+        *countPtr += size;
+    }
+
+    return countPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the relay between two socket pairs
+ *
+ * @return the relay result, the number of bytes received on the modem side is returned in
+ *         receivedPtr
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunRelay
+(
+    bool      useSplice,
+    size_t    size,
+    size_t    escapeLen,
+    uint64_t* receivedPtr,
+    uint64_t* elapsedMsPtr
+)
+{
+    int hostFds[2];
+    int modemFds[2];
+    DataWriter_t writer;
+    le_thread_Ref_t writerThread;
+    le_thread_Ref_t readerThread;
+    le_clk_Time_t startTime;
+    le_result_t result;
+    uint64_t* countPtr;
+    int pipeSize = RELAY_BUFFER_SIZE;
+
+    LE_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, hostFds) == 0);
+    LE_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, modemFds) == 0);
+    LE_ASSERT(pipe2(DataRelay.pipeFds, O_NONBLOCK) == 0);
+    fcntl(DataRelay.pipeFds[1], F_SETPIPE_SZ, pipeSize);
+
+    DataRelay.srcFd = hostFds[1];
+    DataRelay.dstFd = modemFds[0];
+    DataRelay.useSplice = useSplice;
+    DataRelay.pendingBytes = 0;
+    DataRelay.escapeCount = 0;
+    DataRelay.relayedBytes = 0;
+    LE_ASSERT(fcntl(DataRelay.srcFd, F_SETFL, O_NONBLOCK) == 0);
+    LE_ASSERT(fcntl(DataRelay.dstFd, F_SETFL, O_NONBLOCK) == 0);
+
+    writer.fd = hostFds[0];
+    writer.size = size;
+    writer.escapeLen = escapeLen;
+
+    writerThread = le_thread_Create("DataWriter", DataWriter, &writer);
+    readerThread = le_thread_Create("DataReader", DataReader, &modemFds[1]);
+    le_thread_SetJoinable(writerThread);
+    le_thread_SetJoinable(readerThread);
+
+    startTime = le_clk_GetRelativeTime();
+    le_thread_Start(readerThread);
+    le_thread_Start(writerThread);
+
+    result = RelayData(&DataRelay);
+
+    // Closing the relay side of the modem connection terminates the reader
+    close(DataRelay.dstFd);
+    LE_ASSERT_OK(le_thread_Join(writerThread, NULL));
+    LE_ASSERT_OK(le_thread_Join(readerThread, (void**)&countPtr));
+    *elapsedMsPtr = GetElapsedMs(startTime);
+    *receivedPtr = *countPtr;
+    free(countPtr);
+
+    close(DataRelay.srcFd);
+    close(hostFds[0]);
+    close(modemFds[1]);
+    close(DataRelay.pipeFds[0]);
+    close(DataRelay.pipeFds[1]);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the relay throughput
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestThroughput
+(
+    bool useSplice
+)
+{
+    uint64_t received = 0;
+    uint64_t elapsedMs = 0;
+
+    LE_ASSERT(RunRelay(useSplice, THROUGHPUT_DATA_SIZE, 0, &received, &elapsedMs)
+              == LE_CLOSED);
+    LE_ASSERT(received == THROUGHPUT_DATA_SIZE);
+
+    LE_INFO("Data mode relay (%s): %"PRIu64" bytes in %"PRIu64" ms, %"PRIu64" KB/s",
+            useSplice ? "splice" : "copy",
+            received,
+            elapsedMs,
+            elapsedMs ? (received * 1000) / (elapsedMs * 1024) : 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function must be called to test the bridge data mode relay.
+ *
+ * @return
+ *      - LE_FAULT when function failed
+ *      - LE_OK when function succeed
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t Testle_atServer_DataMode
+(
+    void
+)
+{
+    uint64_t received = 0;
+    uint64_t elapsedMs = 0;
+
+    LE_INFO("======== Test AT server data mode relay ========");
+
+    TestThroughput(true);
+    TestThroughput(false);
+
+    // The escape sequence must stop the relay and must not be forwarded
+    if (LE_TERMINATED != RunRelay(true, 1024, ESCAPE_SEQUENCE_LEN, &received, &elapsedMs))
+    {
+        LE_ERROR("Escape sequence not detected");
+        return LE_FAULT;
+    }
+
+    if (1024 != received)
+    {
+        LE_ERROR("Unexpected number of bytes relayed: %"PRIu64, received);
+        return LE_FAULT;
+    }
+
+    // Held back escape characters followed by an idle source are relayed once the guard time
+    // expires, they must not be merged with the escape sequence sent afterwards
+    if (LE_TERMINATED != RunRelay(true, 1024, ESCAPE_SEQUENCE_LEN - 1, &received, &elapsedMs))
+    {
+        LE_ERROR("Escape sequence not detected after an idle incomplete one");
+        return LE_FAULT;
+    }
+
+    if ((1024 + ESCAPE_SEQUENCE_LEN - 1) != received)
+    {
+        LE_ERROR("Held back escape characters not relayed: %"PRIu64" bytes", received);
+        return LE_FAULT;
+    }
+
+    LE_INFO("======== AT server data mode relay test success ========");
+
+    return LE_OK;
+}
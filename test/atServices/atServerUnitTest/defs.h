@@ -10,6 +10,25 @@
 #include "legato.h"
 #include "le_atServer_interface.h"
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of custom commands registered for the dispatch benchmark
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_CMDS_COUNT        150
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Benchmark command name format, indexed by two letters so that the names stay valid extended
+ * command names: AT+BNAA, AT+BNAB, ...
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_CMD_NAME_FMT      "AT+BN%c%c"
+#define BENCH_CMD_NAME_BYTES    sizeof("AT+BNAA")
+#define BENCH_CMD_NAME_ARGS(i)  ('A' + ((i) / 26)), ('A' + ((i) % 26))
+
 //--------------------------------------------------------------------------------------------------
 /**
  * SharedData_t definition
@@ -11,6 +11,16 @@
 #define DSIZE           512     // default buffer size
 #define SERVER_TIMEOUT  10000    // server timeout in milliseconds
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Dispatch benchmark parameters: number of commands concatenated on one line and number of lines
+ * sent back-to-back
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_CMDS_PER_LINE     10
+#define BENCH_LINES_COUNT       1000
+
 //--------------------------------------------------------------------------------------------------
 /**
  * shared data between threads
@@ -43,6 +53,17 @@ le_result_t Testle_atServer_Bridge
     SharedData_t* sharedDataPtr
 );
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function must be called to test the bridge data mode relay.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t Testle_atServer_DataMode
+(
+    void
+);
+
 //--------------------------------------------------------------------------------------------------
 /**
  * convert \r\n into <>
@@ -195,6 +216,74 @@ le_result_t SendCommandsAndTest
     return TestResponses(fd, epollFd, expectedResponsePtr);
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Dispatch throughput benchmark
+ *
+ * Send lines of concatenated benchmark commands (AT+BNAA;+BNAB;...) over the socket, the way a
+ * host MCU issues them back-to-back, and report the number of commands handled per second.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t BenchmarkCommandsDispatch
+(
+    int fd,
+    int epollFd
+)
+{
+    char buf[DSIZE];
+    char cmdName[BENCH_CMD_NAME_BYTES];
+    le_clk_Time_t startTime;
+    le_clk_Time_t elapsedTime;
+    uint64_t elapsedUs;
+    int cmdIdx = 0;
+    int line;
+    int i;
+
+    startTime = le_clk_GetRelativeTime();
+
+    for (line = 0; line < BENCH_LINES_COUNT; line++)
+    {
+        int len = snprintf(buf, sizeof(buf), "AT");
+
+        for (i = 0; i < BENCH_CMDS_PER_LINE; i++)
+        {
+            snprintf(cmdName, sizeof(cmdName), BENCH_CMD_NAME_FMT, BENCH_CMD_NAME_ARGS(cmdIdx));
+
+            // Skip the "AT" prefix of the command name, the line already starts with it
+            len += snprintf(buf + len, sizeof(buf) - len, "%s%s", (i ? ";" : ""), cmdName + 2);
+            cmdIdx = (cmdIdx + 1) % BENCH_CMDS_COUNT;
+        }
+        len += snprintf(buf + len, sizeof(buf) - len, "\r");
+        LE_ASSERT(len < sizeof(buf));
+
+        if (write(fd, buf, len) == -1)
+        {
+            LE_ERROR("write failed: %s", strerror(errno));
+            return LE_IO_ERROR;
+        }
+
+        if (LE_OK != TestResponses(fd, epollFd, "\r\nOK\r\n"))
+        {
+            LE_ERROR("Unexpected response to %s", PrettyPrint(buf));
+            return LE_FAULT;
+        }
+    }
+
+    elapsedTime = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+    elapsedUs = (uint64_t)elapsedTime.sec * 1000000 + elapsedTime.usec;
+
+    LE_INFO("Dispatch benchmark: %d commands registered, %d commands in %"PRIu64" us,"
+            " %"PRIu64" commands/s",
+            BENCH_CMDS_COUNT,
+            BENCH_LINES_COUNT * BENCH_CMDS_PER_LINE,
+            elapsedUs,
+            elapsedUs ? ((uint64_t)BENCH_LINES_COUNT * BENCH_CMDS_PER_LINE * 1000000) / elapsedUs
+                      : 0);
+
+    return LE_OK;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * host thread function
@@ -388,9 +477,15 @@ static void* AtHost
                 "\r\n+CBC: 1,70,4190\r\n"
                 "\r\n+CBC: 2,100,4190\r\n"));
 
+    // Measure commands dispatch throughput with all the custom commands registered
+    LE_ASSERT_OK(BenchmarkCommandsDispatch(socketFd, epollFd));
+
     // Test bridge feature
     LE_ASSERT_OK(Testle_atServer_Bridge(socketFd, epollFd, sharedDataPtr));
 
+    // Test bridge data mode relay
+    LE_ASSERT_OK(Testle_atServer_DataMode());
+
     LE_ASSERT_OK(SendCommandsAndTest(socketFd, epollFd, "AT+DEL="
                 "\"AT\",\"ATI\",\"AT+CBC\",\"AT+ABCD\",\"ATA\",\"AT&F\","
                 "\"ATS\",\"ATV\",\"AT&C\",\"AT&D\",\"ATE\",\"AT+DATA\"",
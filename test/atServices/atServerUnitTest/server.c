@@ -14,7 +14,7 @@
  * Maximum supported commands
  */
 //--------------------------------------------------------------------------------------------------
-#define COMMANDS_MAX    50
+#define COMMANDS_MAX    (50 + BENCH_CMDS_COUNT)
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -75,6 +75,7 @@ typedef struct
     int                     fd;
     int                     cmdsCount;
     AtCmd_t                 atCmds[COMMANDS_MAX];
+    le_hashmap_Ref_t        cmdsMap;                ///< command name => atCmds entry
 }
 AtSession_t;
 
@@ -99,6 +100,13 @@ static AtSession_t AtSession;
 //--------------------------------------------------------------------------------------------------
 static int ExtendedErrorCode = 0;
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Benchmark commands names storage
+ */
+//--------------------------------------------------------------------------------------------------
+static char BenchCmdNames[BENCH_CMDS_COUNT][BENCH_CMD_NAME_BYTES];
+
 //--------------------------------------------------------------------------------------------------
 /**
  * AT command handler
@@ -373,28 +381,73 @@ static void AtEchoCmdHandler
  * get command name refrence
  *
  * atServer API doesn't provide a way to get command's refrence directly
- * loop through the table, if it's a known command return its refrence
+ * look the name up in the session index, if it's a known command return its refrence
  *
  */
 //--------------------------------------------------------------------------------------------------
 static le_atServer_CmdRef_t GetRef
 (
-    AtCmd_t*    atCmdsPtr,
-    int         cmdsCount,
-    const char* cmdNamePtr
+    AtSession_t* atSessionPtr,
+    const char*  cmdNamePtr
 )
 {
-    int i = 0;
+    AtCmd_t* atCmdPtr = le_hashmap_Get(atSessionPtr->cmdsMap, cmdNamePtr);
 
-    for (i=0; i<cmdsCount; i++)
+    if (NULL == atCmdPtr)
     {
-        if ( ! (strcmp(atCmdsPtr[i].atCmdPtr, cmdNamePtr)) )
-        {
-            return atCmdsPtr[i].cmdRef;
-        }
+        return NULL;
     }
 
-    return NULL;
+    return atCmdPtr->cmdRef;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Benchmark command handler
+ *
+ * does the minimum a real handler does so that the dispatch cost dominates the measurement
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchCmdHandler
+(
+    le_atServer_CmdRef_t commandRef,
+    le_atServer_Type_t type,
+    uint32_t parametersNumber,
+    void* contextPtr
+)
+{
+    LE_ASSERT_OK(le_atServer_SendFinalResponse(commandRef, LE_ATSERVER_OK, false, ""));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a command within the server app and index it by name
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void RegisterCommand
+(
+    AtSession_t*   atSessionPtr,
+    const AtCmd_t* atCmdPtr
+)
+{
+    AtCmd_t* newCmdPtr;
+
+    LE_ASSERT(atSessionPtr->cmdsCount < COMMANDS_MAX);
+
+    newCmdPtr = &atSessionPtr->atCmds[atSessionPtr->cmdsCount];
+    *newCmdPtr = *atCmdPtr;
+
+    newCmdPtr->cmdRef = le_atServer_Create(newCmdPtr->atCmdPtr);
+    LE_ASSERT(newCmdPtr->cmdRef != NULL);
+
+    LE_ASSERT(le_atServer_AddCommandHandler(newCmdPtr->cmdRef,
+                                            newCmdPtr->handlerPtr,
+                                            (void *)atSessionPtr) != NULL);
+
+    le_hashmap_Put(atSessionPtr->cmdsMap, newCmdPtr->atCmdPtr, newCmdPtr);
+    atSessionPtr->cmdsCount++;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -439,7 +492,7 @@ static void DelCmdHandler
                                         LE_ATDEFS_PARAMETER_MAX_BYTES)
                                     == LE_OK);
                 // get its refrence
-                cmdRef = GetRef(atSessionPtr->atCmds, atSessionPtr->cmdsCount, param);
+                cmdRef = GetRef(atSessionPtr, param);
                 LE_DEBUG("Deleting %p => %s", cmdRef, param);
                 // delete the command
                 LE_ASSERT(le_atServer_Delete(cmdRef) == LE_OK);
@@ -905,22 +958,32 @@ void AtServer
     LE_ASSERT(AtSession.devRef != NULL);
     sharedDataPtr->devRef = AtSession.devRef;
 
-    // AT commands handling tests
-    AtSession.cmdsCount = NUM_ARRAY_MEMBERS(atCmdCreation);
+    AtSession.cmdsCount = 0;
+    AtSession.cmdsMap = le_hashmap_Create("AtCmdsMap",
+                                          COMMANDS_MAX,
+                                          le_hashmap_HashString,
+                                          le_hashmap_EqualsString);
 
     // AT commands subscriptions
-    while (i < AtSession.cmdsCount)
+    for (i = 0; i < NUM_ARRAY_MEMBERS(atCmdCreation); i++)
     {
-        atCmdCreation[i].cmdRef = le_atServer_Create(atCmdCreation[i].atCmdPtr);
-        LE_ASSERT(atCmdCreation[i].cmdRef != NULL);
-
-        AtSession.atCmds[i] = atCmdCreation[i];
+        RegisterCommand(&AtSession, &atCmdCreation[i]);
+    }
 
-        LE_ASSERT(le_atServer_AddCommandHandler(atCmdCreation[i].cmdRef,
-                                                atCmdCreation[i].handlerPtr,
-                                                (void *)&AtSession) != NULL);
+    // Custom commands used by the dispatch benchmark, a realistic number of commands is needed
+    // so that the command lookup cost shows up in the measurement
+    for (i = 0; i < BENCH_CMDS_COUNT; i++)
+    {
+        AtCmd_t benchCmd =
+        {
+            .atCmdPtr = BenchCmdNames[i],
+            .cmdRef = NULL,
+            .handlerPtr = BenchCmdHandler,
+        };
 
-        i++;
+        snprintf(BenchCmdNames[i], BENCH_CMD_NAME_BYTES, BENCH_CMD_NAME_FMT,
+                 BENCH_CMD_NAME_ARGS(i));
+        RegisterCommand(&AtSession, &benchCmd);
     }
 
     le_sem_Post(sharedDataPtr->semRef);
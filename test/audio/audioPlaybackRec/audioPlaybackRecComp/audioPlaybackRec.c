@@ -24,6 +24,8 @@
 #include <unistd.h>
 
 #include "interfaces.h"
+#include "pcmStream.h"
+#include "dtmfDetect.h"
 
 //--------------------------------------------------------------------------------------------------
 // Symbol and Enum definitions.
@@ -34,6 +36,9 @@
 #define ID_DATA    0x61746164
 #define FORMAT_PCM 1
 
+// Default period of the samples transfer, in milliseconds
+#define DEFAULT_PERIOD_MS 20
+
 //--------------------------------------------------------------------------------------------------
 // Data structures.
 //--------------------------------------------------------------------------------------------------
@@ -70,7 +75,7 @@ typedef struct {
 typedef struct
 {
     WavHeader_t hd;
-    uint32_t wroteLen;
+    pcmStream_Stats_t stats;
     int pipefd[2];
     le_thread_Ref_t mainThreadRef;
     bool playDone;
@@ -109,6 +114,9 @@ static le_thread_Ref_t RecPbThreadRef = NULL;
 static uint32_t ChannelsCount;
 static uint32_t SampleRate;
 static uint32_t BitsPerSample;
+static uint32_t PeriodMs = DEFAULT_PERIOD_MS;
+static bool DetectDtmf = false;
+static int16_t RecPeriod[PCMSTREAM_PERIOD_MAX_BYTES / sizeof(int16_t)];
 
 static void DisconnectAllAudio(void);
 static void PlaySamples(void* param1Ptr,void* param2Ptr);
@@ -217,10 +225,87 @@ static void DestroyRecThread
 {
     PbRecSamplesThreadCtx_t *threadCtxPtr = (PbRecSamplesThreadCtx_t*) contextPtr;
 
-    LE_INFO("wroteLen %d", threadCtxPtr->wroteLen);
+    LE_INFO("wroteLen %"PRIu64" in %"PRIu32" system calls",
+            threadCtxPtr->stats.bytes, threadCtxPtr->stats.syscalls);
     close(AudioFileFd);
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler for the DTMF detected in the recorded samples.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecDtmfHandler
+(
+    dtmfDetect_Ref_t detectorRef,
+    char dtmf,
+    void* contextPtr
+)
+{
+    LE_INFO("DTMF '%c' detected in the recorded samples", dtmf);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record the samples and detect the DTMF in the first channel.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecSamplesWithDtmf
+(
+    int pipeFd,
+    uint32_t periodBytes,
+    PbRecSamplesThreadCtx_t *threadCtxPtr
+)
+{
+    dtmfDetect_Ref_t detectorRef = dtmfDetect_Create(SampleRate, RecDtmfHandler, NULL);
+    size_t frameBytes = ChannelsCount * sizeof(int16_t);
+    uint8_t* periodPtr = (uint8_t*)RecPeriod;
+    size_t carryLen = 0;
+    ssize_t readLen;
+
+    if (NULL == detectorRef)
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    // The pipe may return a partial frame: it is kept at the beginning of the buffer and completed
+    // by the next read
+    while ((readLen = read(pipeFd, periodPtr + carryLen, periodBytes - carryLen)) > 0)
+    {
+        size_t framesCount = (carryLen + readLen) / frameBytes;
+        size_t i;
+
+        threadCtxPtr->stats.syscalls++;
+
+        if (write(AudioFileFd, periodPtr + carryLen, readLen) != readLen)
+        {
+            LE_ERROR("write error");
+            dtmfDetect_Delete(detectorRef);
+            return LE_FAULT;
+        }
+        threadCtxPtr->stats.syscalls++;
+        threadCtxPtr->stats.bytes += readLen;
+        threadCtxPtr->stats.periods++;
+
+        carryLen = (carryLen + readLen) % frameBytes;
+
+        // Keep the first channel in place, the partial frame is after the overwritten samples
+        for (i = 1; (ChannelsCount > 1) && (i < framesCount); i++)
+        {
+            RecPeriod[i] = RecPeriod[i * ChannelsCount];
+        }
+        dtmfDetect_Process(detectorRef, RecPeriod, framesCount);
+
+        memmove(periodPtr, periodPtr + (framesCount * frameBytes), carryLen);
+    }
+
+    dtmfDetect_Delete(detectorRef);
+
+    return (readLen < 0) ? LE_FAULT : LE_OK;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Rec Samples thread.
@@ -234,8 +319,7 @@ static void* RecSamplesThread
 )
 {
     int pipefd[2];
-    int32_t len = 1024;
-    char data[len];
+    uint32_t periodBytes;
     uint32_t channelsCount;
     uint32_t sampleRate;
     uint32_t bitsPerSample;
@@ -262,22 +346,24 @@ static void* RecSamplesThread
     LE_ASSERT(le_audio_GetSamplePcmSamplingResolution(FileAudioRef, &bitsPerSample) == LE_OK);
     LE_ASSERT(bitsPerSample == BitsPerSample);
 
-    LE_ASSERT(le_audio_GetSamples(FileAudioRef, pipefd[1]) == LE_OK);
-    LE_INFO("Start getting samples...");
+    periodBytes = pcmStream_GetPeriodBytes(SampleRate, ChannelsCount, BitsPerSample, PeriodMs);
+    LE_ASSERT(periodBytes != 0);
 
-    int32_t readLen;
+    LE_ASSERT(le_audio_GetSamples(FileAudioRef, pipefd[1]) == LE_OK);
+    LE_INFO("Start getting samples by periods of %d bytes...", periodBytes);
 
-    while ((readLen = read( pipefd[0], data, len )))
+    if (DetectDtmf)
     {
-        int32_t len = write( AudioFileFd, data, readLen );
-
-        if (len < 0)
+        // The samples go through user space to be analysed
+        if (RecSamplesWithDtmf(pipefd[0], periodBytes, threadCtxPtr) != LE_OK)
         {
-            LE_ERROR("write error %d %d", readLen, len);
-            break;
+            LE_ERROR("Samples recording error");
         }
-
-        threadCtxPtr->wroteLen += len;
+    }
+    // The samples are moved from the pipe to the file without going through user space
+    else if (pcmStream_Copy(pipefd[0], AudioFileFd, periodBytes, &threadCtxPtr->stats) != LE_OK)
+    {
+        LE_ERROR("Samples recording error");
     }
 
     return NULL;
@@ -341,8 +427,7 @@ static void* PlaySamplesThread
     void* contextPtr
 )
 {
-    char data[1024];
-    int32_t len = 1;
+    uint32_t periodBytes;
     uint32_t channelsCount;
     uint32_t sampleRate;
     uint32_t bitsPerSample;
@@ -375,17 +460,20 @@ static void* PlaySamplesThread
         LE_INFO("Start playing samples...");
     }
 
-    while ((len = read(AudioFileFd, data, 1024)) > 0)
-    {
-        int32_t wroteLen = write( threadCtxPtr->pipefd[1], data, len );
+    periodBytes = pcmStream_GetPeriodBytes(SampleRate, ChannelsCount, BitsPerSample, PeriodMs);
+    LE_ASSERT(periodBytes != 0);
 
-        if (wroteLen <= 0)
-        {
-            LE_ERROR("write error %d", wroteLen);
-            return NULL;
-        }
+    // The samples are moved from the file to the pipe without going through user space
+    if (pcmStream_Copy(AudioFileFd, threadCtxPtr->pipefd[1], periodBytes, &threadCtxPtr->stats)
+        != LE_OK)
+    {
+        LE_ERROR("Samples playback error");
+        return NULL;
     }
 
+    LE_INFO("Played %"PRIu64" bytes in %"PRIu32" system calls",
+            threadCtxPtr->stats.bytes, threadCtxPtr->stats.syscalls);
+
     threadCtxPtr->playDone = true;
 
     return NULL;
@@ -1206,6 +1294,10 @@ static void PrintUsage
             " - DISCONNECT=<timer value> (to disconnect connectors and streams"
               " after a delay) (optional)",
             " - MUTE (for playback MUTE testing)",
+            " - PERIOD=<milliseconds> (samples transfer period for PB_SAMPLES and REC_SAMPLES,"
+              " 20 ms by default, must follow BitsPerSample) (optional)",
+            " - DTMF (to detect the DTMF in the recorded samples, for REC_SAMPLES with 16-bit"
+              " samples, must follow BitsPerSample) (optional)",
             "",
             "File's name can be the complete file's path.",
     };
@@ -1312,6 +1404,38 @@ COMPONENT_INIT
             LE_INFO("   Get/Play PCM samples with ChannelsCount.%d SampleRate.%d BitsPerSample.%d",
                     ChannelsCount, SampleRate, BitsPerSample);
             NextOptionArg = 6;
+
+            // The samples options are needed before the samples thread is started
+            while (NextOptionArg < le_arg_NumArgs())
+            {
+                const char* samplesOptionPtr = le_arg_GetArg(NextOptionArg);
+
+                if ((NULL != samplesOptionPtr) && (strncmp(samplesOptionPtr, "PERIOD=", 7) == 0))
+                {
+                    PeriodMs = atoi(samplesOptionPtr + 7);
+                    if (0 == pcmStream_GetPeriodBytes(SampleRate, ChannelsCount, BitsPerSample,
+                                                      PeriodMs))
+                    {
+                        LE_ERROR("Invalid period %s", samplesOptionPtr);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                else if ((NULL != samplesOptionPtr) && (strcmp(samplesOptionPtr, "DTMF") == 0))
+                {
+                    if ((strncmp(AudioTestCase,"REC_SAMPLES",11) != 0) || (BitsPerSample != 16))
+                    {
+                        LE_ERROR("DTMF detection needs REC_SAMPLES with 16-bit samples");
+                        exit(EXIT_FAILURE);
+                    }
+                    DetectDtmf = true;
+                }
+                else
+                {
+                    break;
+                }
+                NextOptionArg++;
+            }
+            LE_INFO("   Samples transfer period.%d ms, DTMF detection.%d", PeriodMs, DetectDtmf);
         }
         else if (strncmp(AudioTestCase,"REC", 3)==0)
         {
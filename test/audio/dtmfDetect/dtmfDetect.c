@@ -0,0 +1,506 @@
+/**
+ * @file dtmfDetect.c
+ *
+ * Implementation of the DTMF detector.
+ *
+ * Each block is analysed as follows:
+ * - the strongest row frequency and the strongest column frequency are selected,
+ * - the block energy must be above a minimum level,
+ * - both frequencies must hold most of the block energy, which rejects speech and noise,
+ * - the twist between both frequencies must be within the ITU-T Q.24 limits,
+ * - the selected frequencies must be well above the other frequencies of their group.
+ *
+ * Build with DTMFDETECT_NO_VECTOR defined to only keep the scalar implementation.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "dtmfDetect.h"
+
+#include <math.h>
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of filters: 4 row frequencies followed by 4 column frequencies
+ */
+//--------------------------------------------------------------------------------------------------
+#define FILTERS_NB              8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Block size at 8 kHz, the block size is scaled with the sample rate
+ */
+//--------------------------------------------------------------------------------------------------
+#define BLOCK_SIZE_8KHZ         102
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Supported sample rates
+ */
+//--------------------------------------------------------------------------------------------------
+#define SAMPLE_RATE_MIN         8000
+#define SAMPLE_RATE_MAX         48000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimum mean power per sample of a tone: about -30 dBm0 per frequency
+ */
+//--------------------------------------------------------------------------------------------------
+#define MIN_POWER               20000.0f
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimum part of the block energy held by the row and column frequencies
+ */
+//--------------------------------------------------------------------------------------------------
+#define MIN_TONE_RATIO          0.75f
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum twist: column frequency stronger by 8 dB (normal) or weaker by 4 dB (reverse)
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_NORMAL_TWIST        6.31f
+#define MAX_REVERSE_TWIST       2.51f
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimum ratio between the selected frequency and the other frequencies of its group: 8 dB
+ */
+//--------------------------------------------------------------------------------------------------
+#define MIN_RELATIVE_PEAK       6.31f
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Vector implementation, updating the eight filters at once
+ */
+//--------------------------------------------------------------------------------------------------
+#if defined(__GNUC__) && !defined(DTMFDETECT_NO_VECTOR)
+#define HAS_VECTOR_IMPL         1
+typedef float Vector_t __attribute__((vector_size(FILTERS_NB * sizeof(float))));
+#else
+#define HAS_VECTOR_IMPL         0
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Data structures
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Detector
+ */
+//--------------------------------------------------------------------------------------------------
+struct dtmfDetect_Detector
+{
+    float                        coeff[FILTERS_NB]; ///< Goertzel coefficients
+    float                        s1[FILTERS_NB];    ///< Filters state, previous output
+    float                        s2[FILTERS_NB];    ///< Filters state, output before previous
+    float                        energy;            ///< Energy of the current block
+    uint32_t                     blockSize;         ///< Number of samples in a block
+    uint32_t                     blockIdx;          ///< Number of samples in the current block
+    char                         lastBlockTone;     ///< Tone of the previous block, 0 if none
+    char                         currentTone;       ///< Tone reported, 0 if none
+    dtmfDetect_Impl_t            impl;              ///< Goertzel bank implementation
+    dtmfDetect_ToneHandlerFunc_t handlerFunc;       ///< Tone handler
+    void*                        contextPtr;        ///< Handler context
+};
+
+//--------------------------------------------------------------------------------------------------
+// Static declarations
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * DTMF frequencies: rows then columns
+ */
+//--------------------------------------------------------------------------------------------------
+static const float Frequencies[FILTERS_NB] =
+{
+    697.0f, 770.0f, 852.0f, 941.0f, 1209.0f, 1336.0f, 1477.0f, 1633.0f
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tones by row and column
+ */
+//--------------------------------------------------------------------------------------------------
+static const char Tones[4][4] =
+{
+    { '1', '2', '3', 'A' },
+    { '4', '5', '6', 'B' },
+    { '7', '8', '9', 'C' },
+    { '*', '0', '#', 'D' }
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the detectors
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t DetectorPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the filters with the samples, one filter at a time
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateScalar
+(
+    struct dtmfDetect_Detector* detectorPtr,
+    const int16_t*              samplesPtr,
+    size_t                      samplesCount
+)
+{
+    float energy = detectorPtr->energy;
+    size_t i;
+    int k;
+
+    for (i = 0; i < samplesCount; i++)
+    {
+        energy += (float)samplesPtr[i] * (float)samplesPtr[i];
+    }
+    detectorPtr->energy = energy;
+
+    for (k = 0; k < FILTERS_NB; k++)
+    {
+        float coeff = detectorPtr->coeff[k];
+        float s1 = detectorPtr->s1[k];
+        float s2 = detectorPtr->s2[k];
+
+        for (i = 0; i < samplesCount; i++)
+        {
+            float s0 = coeff * s1 - s2 + (float)samplesPtr[i];
+            s2 = s1;
+            s1 = s0;
+        }
+
+        detectorPtr->s1[k] = s1;
+        detectorPtr->s2[k] = s2;
+    }
+}
+
+#if HAS_VECTOR_IMPL
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the filters with the samples, all the filters at once
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateVector
+(
+    struct dtmfDetect_Detector* detectorPtr,
+    const int16_t*              samplesPtr,
+    size_t                      samplesCount
+)
+{
+    Vector_t coeff, s1, s2;
+    float energy = detectorPtr->energy;
+    size_t i;
+
+    // The detector is not aligned on the vector size: copy the state
+    memcpy(&coeff, detectorPtr->coeff, sizeof(coeff));
+    memcpy(&s1, detectorPtr->s1, sizeof(s1));
+    memcpy(&s2, detectorPtr->s2, sizeof(s2));
+
+    for (i = 0; i < samplesCount; i++)
+    {
+        float sample = (float)samplesPtr[i];
+        Vector_t s0 = coeff * s1 - s2 + sample;
+
+        s2 = s1;
+        s1 = s0;
+        energy += sample * sample;
+    }
+
+    memcpy(detectorPtr->s1, &s1, sizeof(s1));
+    memcpy(detectorPtr->s2, &s2, sizeof(s2));
+    detectorPtr->energy = energy;
+}
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the strongest frequency of a group
+ *
+ * @return the frequency index in the group
+ */
+//--------------------------------------------------------------------------------------------------
+static int FindPeak
+(
+    const float* powerPtr
+)
+{
+    int peak = 0;
+    int i;
+
+    for (i = 1; i < 4; i++)
+    {
+        if (powerPtr[i] > powerPtr[peak])
+        {
+            peak = i;
+        }
+    }
+
+    return peak;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that the strongest frequency of a group is well above the other ones
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsPeakSharp
+(
+    const float* powerPtr,
+    int          peak
+)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        if ((i != peak) && ((powerPtr[i] * MIN_RELATIVE_PEAK) > powerPtr[peak]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Analyse a completed block
+ *
+ * @return the tone detected in the block, 0 if none
+ */
+//--------------------------------------------------------------------------------------------------
+static char AnalyseBlock
+(
+    struct dtmfDetect_Detector* detectorPtr
+)
+{
+    float power[FILTERS_NB];
+    float rowPower, colPower;
+    int row, col;
+    int k;
+
+    if (detectorPtr->energy < (MIN_POWER * detectorPtr->blockSize))
+    {
+        return 0;
+    }
+
+    for (k = 0; k < FILTERS_NB; k++)
+    {
+        float s1 = detectorPtr->s1[k];
+        float s2 = detectorPtr->s2[k];
+
+        power[k] = s1 * s1 + s2 * s2 - detectorPtr->coeff[k] * s1 * s2;
+    }
+
+    row = FindPeak(&power[0]);
+    col = FindPeak(&power[4]);
+    rowPower = power[row];
+    colPower = power[4 + col];
+
+    // A pure tone of amplitude A gives a power of (A.N/2)^2 for an energy of N.A^2/2
+    if (((rowPower + colPower) * 2.0f) <
+        (MIN_TONE_RATIO * detectorPtr->blockSize * detectorPtr->energy))
+    {
+        return 0;
+    }
+
+    if ((colPower > (rowPower * MAX_NORMAL_TWIST)) || (rowPower > (colPower * MAX_REVERSE_TWIST)))
+    {
+        return 0;
+    }
+
+    if (!IsPeakSharp(&power[0], row) || !IsPeakSharp(&power[4], col))
+    {
+        return 0;
+    }
+
+    return Tones[row][col];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the tone state with the result of a block and report a new tone
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompleteBlock
+(
+    struct dtmfDetect_Detector* detectorPtr
+)
+{
+    char tone = AnalyseBlock(detectorPtr);
+
+    if (tone == detectorPtr->lastBlockTone)
+    {
+        if (tone && (tone != detectorPtr->currentTone))
+        {
+            detectorPtr->currentTone = tone;
+            detectorPtr->handlerFunc(detectorPtr, tone, detectorPtr->contextPtr);
+        }
+        else if (0 == tone)
+        {
+            detectorPtr->currentTone = 0;
+        }
+    }
+
+    detectorPtr->lastBlockTone = tone;
+    detectorPtr->blockIdx = 0;
+    detectorPtr->energy = 0.0f;
+    memset(detectorPtr->s1, 0, sizeof(detectorPtr->s1));
+    memset(detectorPtr->s2, 0, sizeof(detectorPtr->s2));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a detector
+ *
+ * @return the detector reference, NULL if the sample rate is not supported
+ */
+//--------------------------------------------------------------------------------------------------
+dtmfDetect_Ref_t dtmfDetect_Create
+(
+    uint32_t                     sampleRate,    ///< [IN] Sample rate, from 8000 to 48000 Hz
+    dtmfDetect_ToneHandlerFunc_t handlerFunc,   ///< [IN] Tone handler
+    void*                        contextPtr     ///< [IN] Handler context
+)
+{
+    struct dtmfDetect_Detector* detectorPtr;
+    int k;
+
+    if ((sampleRate < SAMPLE_RATE_MIN) || (sampleRate > SAMPLE_RATE_MAX) || (NULL == handlerFunc))
+    {
+        LE_ERROR("Invalid parameter: sample rate %"PRIu32" Hz, handler %p", sampleRate,
+                 handlerFunc);
+        return NULL;
+    }
+
+    if (NULL == DetectorPool)
+    {
+        DetectorPool = le_mem_CreatePool("DtmfDetectorPool", sizeof(struct dtmfDetect_Detector));
+    }
+
+    detectorPtr = le_mem_ForceAlloc(DetectorPool);
+    memset(detectorPtr, 0, sizeof(struct dtmfDetect_Detector));
+
+    for (k = 0; k < FILTERS_NB; k++)
+    {
+        detectorPtr->coeff[k] = 2.0f * cosf(2.0f * (float)M_PI * Frequencies[k] / sampleRate);
+    }
+
+    detectorPtr->blockSize = (BLOCK_SIZE_8KHZ * sampleRate) / SAMPLE_RATE_MIN;
+    detectorPtr->impl = HAS_VECTOR_IMPL ? DTMFDETECT_IMPL_VECTOR : DTMFDETECT_IMPL_SCALAR;
+    detectorPtr->handlerFunc = handlerFunc;
+    detectorPtr->contextPtr = contextPtr;
+
+    return detectorPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a detector
+ */
+//--------------------------------------------------------------------------------------------------
+void dtmfDetect_Delete
+(
+    dtmfDetect_Ref_t detectorRef    ///< [IN] Detector reference
+)
+{
+    le_mem_Release(detectorRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the Goertzel bank implementation. The vector implementation is used by default when
+ * available.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_UNSUPPORTED if the vector implementation is not available in this build
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t dtmfDetect_SetImpl
+(
+    dtmfDetect_Ref_t  detectorRef,  ///< [IN] Detector reference
+    dtmfDetect_Impl_t impl          ///< [IN] Implementation
+)
+{
+    if ((DTMFDETECT_IMPL_VECTOR == impl) && !HAS_VECTOR_IMPL)
+    {
+        return LE_UNSUPPORTED;
+    }
+
+    detectorRef->impl = impl;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Process samples. The tone handler is called from this function.
+ */
+//--------------------------------------------------------------------------------------------------
+void dtmfDetect_Process
+(
+    dtmfDetect_Ref_t detectorRef,   ///< [IN] Detector reference
+    const int16_t*   samplesPtr,    ///< [IN] Samples
+    size_t           samplesCount   ///< [IN] Number of samples
+)
+{
+    while (samplesCount)
+    {
+        size_t count = detectorRef->blockSize - detectorRef->blockIdx;
+
+        if (count > samplesCount)
+        {
+            count = samplesCount;
+        }
+
+#if HAS_VECTOR_IMPL
+        if (DTMFDETECT_IMPL_VECTOR == detectorRef->impl)
+        {
+            UpdateVector(detectorRef, samplesPtr, count);
+        }
+        else
+#endif
+        {
+            UpdateScalar(detectorRef, samplesPtr, count);
+        }
+
+        detectorRef->blockIdx += count;
+        samplesPtr += count;
+        samplesCount -= count;
+
+        if (detectorRef->blockIdx == detectorRef->blockSize)
+        {
+            CompleteBlock(detectorRef);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reset a detector, e.g. at the beginning of a new stream
+ */
+//--------------------------------------------------------------------------------------------------
+void dtmfDetect_Reset
+(
+    dtmfDetect_Ref_t detectorRef    ///< [IN] Detector reference
+)
+{
+    detectorRef->blockIdx = 0;
+    detectorRef->energy = 0.0f;
+    detectorRef->lastBlockTone = 0;
+    detectorRef->currentTone = 0;
+    memset(detectorRef->s1, 0, sizeof(detectorRef->s1));
+    memset(detectorRef->s2, 0, sizeof(detectorRef->s2));
+}
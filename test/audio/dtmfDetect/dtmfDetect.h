@@ -0,0 +1,116 @@
+/**
+ * @file dtmfDetect.h
+ *
+ * DTMF detector for 16-bit PCM streams.
+ *
+ * The samples are processed by blocks of 12.75 ms with a bank of eight Goertzel filters, one per
+ * DTMF frequency. The eight filters are updated together with vector instructions when the
+ * compiler supports them, a scalar implementation is used otherwise.
+ *
+ * A tone is reported when it is detected in two consecutive blocks, i.e. after 25.5 ms, and can be
+ * reported again once it has been absent from two consecutive blocks.
+ *
+ * A detector processes one channel: a detector is created for each call or stream to decode.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#ifndef DTMFDETECT_H_INCLUDE_GUARD
+#define DTMFDETECT_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a detector
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct dtmfDetect_Detector* dtmfDetect_Ref_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Goertzel bank implementation
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    DTMFDETECT_IMPL_VECTOR,     ///< Filters updated with vector instructions
+    DTMFDETECT_IMPL_SCALAR      ///< Filters updated one by one
+}
+dtmfDetect_Impl_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called when a tone is detected
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*dtmfDetect_ToneHandlerFunc_t)
+(
+    dtmfDetect_Ref_t detectorRef,   ///< [IN] Detector reference
+    char             dtmf,          ///< [IN] Detected tone: 0-9, A-D, * or #
+    void*            contextPtr     ///< [IN] Handler context
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a detector
+ *
+ * @return the detector reference, NULL if the sample rate is not supported
+ */
+//--------------------------------------------------------------------------------------------------
+dtmfDetect_Ref_t dtmfDetect_Create
+(
+    uint32_t                     sampleRate,    ///< [IN] Sample rate, from 8000 to 48000 Hz
+    dtmfDetect_ToneHandlerFunc_t handlerFunc,   ///< [IN] Tone handler
+    void*                        contextPtr     ///< [IN] Handler context
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a detector
+ */
+//--------------------------------------------------------------------------------------------------
+void dtmfDetect_Delete
+(
+    dtmfDetect_Ref_t detectorRef    ///< [IN] Detector reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the Goertzel bank implementation. The vector implementation is used by default when
+ * available.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_UNSUPPORTED if the vector implementation is not available in this build
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t dtmfDetect_SetImpl
+(
+    dtmfDetect_Ref_t  detectorRef,  ///< [IN] Detector reference
+    dtmfDetect_Impl_t impl          ///< [IN] Implementation
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Process samples. The tone handler is called from this function.
+ */
+//--------------------------------------------------------------------------------------------------
+void dtmfDetect_Process
+(
+    dtmfDetect_Ref_t detectorRef,   ///< [IN] Detector reference
+    const int16_t*   samplesPtr,    ///< [IN] Samples
+    size_t           samplesCount   ///< [IN] Number of samples
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reset a detector, e.g. at the beginning of a new stream
+ */
+//--------------------------------------------------------------------------------------------------
+void dtmfDetect_Reset
+(
+    dtmfDetect_Ref_t detectorRef    ///< [IN] Detector reference
+);
+
+#endif // DTMFDETECT_H_INCLUDE_GUARD
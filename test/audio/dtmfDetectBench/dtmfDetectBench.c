@@ -0,0 +1,270 @@
+/**
+ * This module implements a benchmark of the DTMF detector.
+ *
+ * Many channels are decoded on a single thread, each one by its own detector fed with 20 ms
+ * chunks as done for streamed calls. The CPU time gives the number of channels which can be
+ * decoded continuously by a CPU core, for both Goertzel bank implementations. Results are written
+ * on the standard output as a JSON document, "ops" being the number of samples processed:
+ *
+ * @code
+ * {
+ *   "results": [
+ *     { "suite": "dtmfDetect", "test": "vector", "ops": 5120000, "elapsedUs": 30000,
+ *       "opsPerSec": 170666666, "sampleRate": 8000, "channels": 64, "channelsPerCore": 21333 },
+ *     ...
+ *   ]
+ * }
+ * @endcode
+ *
+ * The audio duration in seconds can be given as argument (10 by default).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "dtmfDetect.h"
+
+#include <math.h>
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of channels decoded together
+ */
+//--------------------------------------------------------------------------------------------------
+#define CHANNELS_NB             64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Chunk duration
+ */
+//--------------------------------------------------------------------------------------------------
+#define CHUNK_MS                20
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of samples of the signal: one second at the highest sample rate
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIGNAL_MAX_SAMPLES      48000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Signal: one tone of 100 ms followed by a pause of 100 ms, five times per second
+ */
+//--------------------------------------------------------------------------------------------------
+static int16_t Signal[SIGNAL_MAX_SAMPLES];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Detectors
+ */
+//--------------------------------------------------------------------------------------------------
+static dtmfDetect_Ref_t Detectors[CHANNELS_NB];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of tones detected
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t TonesCount;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of results reported so far
+ */
+//--------------------------------------------------------------------------------------------------
+static unsigned int ReportCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the CPU time of the process
+ *
+ * @return the CPU time in microseconds
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetCpuUs
+(
+    void
+)
+{
+    struct timespec ts;
+
+    LE_ASSERT(0 == clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts));
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Synthesize one second of signal: tone '5' (770 Hz + 1336 Hz) in noise
+ */
+//--------------------------------------------------------------------------------------------------
+static void Synthesize
+(
+    uint32_t sampleRate
+)
+{
+    uint32_t seed = 1;
+    uint32_t i;
+
+    for (i = 0; i < sampleRate; i++)
+    {
+        double t = (double)i / sampleRate;
+        double value = 0.0;
+
+        if (((i * 10) / sampleRate) % 2 == 0)
+        {
+            value = 3000.0 * sin(2.0 * M_PI * 770.0 * t) + 3000.0 * sin(2.0 * M_PI * 1336.0 * t);
+        }
+
+        seed = seed * 1103515245 + 12345;
+        value += 100.0 * ((double)(seed >> 16) / 32768.0 - 1.0);
+
+        Signal[i] = (int16_t)lrint(value);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tone handler: count the tones
+ */
+//--------------------------------------------------------------------------------------------------
+static void ToneHandler
+(
+    dtmfDetect_Ref_t detectorRef,
+    char             dtmf,
+    void*            contextPtr
+)
+{
+    LE_ASSERT('5' == dtmf);
+    TonesCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode the channels with an implementation and report the measures
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunCase
+(
+    dtmfDetect_Impl_t impl,
+    uint32_t          sampleRate,
+    uint32_t          durationSec
+)
+{
+    uint32_t chunkSamples = (sampleRate * CHUNK_MS) / 1000;
+    uint64_t samplesCount = 0;
+    le_clk_Time_t startTime, elapsed;
+    uint64_t startCpuUs, cpuUs, elapsedUs;
+    uint32_t sec, offset;
+    int channel;
+
+    for (channel = 0; channel < CHANNELS_NB; channel++)
+    {
+        Detectors[channel] = dtmfDetect_Create(sampleRate, ToneHandler, NULL);
+        LE_ASSERT(NULL != Detectors[channel]);
+        LE_ASSERT_OK(dtmfDetect_SetImpl(Detectors[channel], impl));
+    }
+
+    TonesCount = 0;
+    startTime = le_clk_GetRelativeTime();
+    startCpuUs = GetCpuUs();
+
+    // Each chunk is given to every channel in turn, as done when decoding calls in real time
+    for (sec = 0; sec < durationSec; sec++)
+    {
+        for (offset = 0; offset < sampleRate; offset += chunkSamples)
+        {
+            for (channel = 0; channel < CHANNELS_NB; channel++)
+            {
+                dtmfDetect_Process(Detectors[channel], &Signal[offset], chunkSamples);
+            }
+            samplesCount += (uint64_t)chunkSamples * CHANNELS_NB;
+        }
+    }
+
+    cpuUs = GetCpuUs() - startCpuUs;
+    elapsed = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+    elapsedUs = (uint64_t)elapsed.sec * 1000000 + elapsed.usec;
+
+    // Five tones per second on every channel
+    LE_ASSERT(TonesCount == 5 * durationSec * CHANNELS_NB);
+
+    printf("%s    { \"suite\": \"dtmfDetect\", \"test\": \"%s\", \"ops\": %"PRIu64
+           ", \"elapsedUs\": %"PRIu64", \"opsPerSec\": %"PRIu64", \"sampleRate\": %"PRIu32
+           ", \"channels\": %d, \"channelsPerCore\": %"PRIu64" }",
+           (ReportCount ? ",\n" : ""),
+           (DTMFDETECT_IMPL_VECTOR == impl) ? "vector" : "scalar",
+           samplesCount,
+           elapsedUs,
+           elapsedUs ? (samplesCount * 1000000) / elapsedUs : 0,
+           sampleRate,
+           CHANNELS_NB,
+           cpuUs ? ((uint64_t)durationSec * CHANNELS_NB * 1000000) / cpuUs : 0);
+    fflush(stdout);
+    ReportCount++;
+
+    for (channel = 0; channel < CHANNELS_NB; channel++)
+    {
+        dtmfDetect_Delete(Detectors[channel]);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main of the benchmark
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    static const uint32_t sampleRates[] = { 8000, 16000, 48000 };
+    static const dtmfDetect_Impl_t impls[] = { DTMFDETECT_IMPL_VECTOR, DTMFDETECT_IMPL_SCALAR };
+    uint32_t durationSec = 10;
+    dtmfDetect_Ref_t probeRef;
+    int implsCount = NUM_ARRAY_MEMBERS(impls);
+    int rateIdx, implIdx;
+
+    // The vector implementation is not available in all the builds
+    probeRef = dtmfDetect_Create(8000, ToneHandler, NULL);
+    LE_ASSERT(NULL != probeRef);
+    if (LE_OK != dtmfDetect_SetImpl(probeRef, DTMFDETECT_IMPL_VECTOR))
+    {
+        LE_WARN("Vector implementation not available");
+        implsCount = 1;
+    }
+    dtmfDetect_Delete(probeRef);
+
+    if (le_arg_NumArgs() >= 1)
+    {
+        const char* durationPtr = le_arg_GetArg(0);
+
+        if ((NULL == durationPtr) || (atoi(durationPtr) <= 0))
+        {
+            fprintf(stderr, "Usage: dtmfDetectBench [duration in seconds]\n");
+            exit(EXIT_FAILURE);
+        }
+        durationSec = atoi(durationPtr);
+    }
+
+    printf("{\n  \"results\": [\n");
+
+    for (rateIdx = 0; rateIdx < NUM_ARRAY_MEMBERS(sampleRates); rateIdx++)
+    {
+        Synthesize(sampleRates[rateIdx]);
+
+        for (implIdx = NUM_ARRAY_MEMBERS(impls) - implsCount;
+             implIdx < NUM_ARRAY_MEMBERS(impls);
+             implIdx++)
+        {
+            RunCase(impls[implIdx], sampleRates[rateIdx], durationSec);
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,436 @@
+/**
+ * This module implements the unit tests of the DTMF detector.
+ *
+ * The tones are synthesized, so that the level, the twist, the frequency deviation and the noise
+ * can be controlled. Every test is run with both Goertzel bank implementations.
+ *
+ * Tested API:
+ * - dtmfDetect_Create
+ * - dtmfDetect_SetImpl
+ * - dtmfDetect_Process
+ * - dtmfDetect_Reset
+ * - dtmfDetect_Delete
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "dtmfDetect.h"
+
+#include <math.h>
+
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of samples of a test signal
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIGNAL_MAX_SAMPLES      (48000 * 2)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of tones detected in a test
+ */
+//--------------------------------------------------------------------------------------------------
+#define DETECTED_MAX_TONES      32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Nominal amplitude of each frequency: about -10 dBm0
+ */
+//--------------------------------------------------------------------------------------------------
+#define NOMINAL_AMPLITUDE       3000.0
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * All the tones
+ */
+//--------------------------------------------------------------------------------------------------
+#define ALL_TONES               "123A456B789C*0#D"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test signal parameters
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t    sampleRate;     ///< Sample rate
+    uint32_t    toneMs;         ///< Tone duration
+    uint32_t    pauseMs;        ///< Pause between tones
+    double      rowAmplitude;   ///< Amplitude of the row frequency
+    double      colAmplitude;   ///< Amplitude of the column frequency
+    double      deviation;      ///< Relative frequency deviation
+    double      extraFreq;      ///< Additional frequency at the column amplitude, 0 if none
+    double      noiseAmplitude; ///< Amplitude of the white noise
+}
+Signal_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test signal
+ */
+//--------------------------------------------------------------------------------------------------
+static int16_t Samples[SIGNAL_MAX_SAMPLES];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tones reported by the detector
+ */
+//--------------------------------------------------------------------------------------------------
+static char Detected[DETECTED_MAX_TONES + 1];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Implementation tested
+ */
+//--------------------------------------------------------------------------------------------------
+static dtmfDetect_Impl_t Impl;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the row and column frequencies of a tone
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetFrequencies
+(
+    char    tone,
+    double* rowFreqPtr,
+    double* colFreqPtr
+)
+{
+    static const double rowFreq[] = { 697.0, 770.0, 852.0, 941.0 };
+    static const double colFreq[] = { 1209.0, 1336.0, 1477.0, 1633.0 };
+    const char* posPtr = strchr(ALL_TONES, tone);
+    int idx;
+
+    LE_ASSERT(posPtr && tone);
+    idx = posPtr - ALL_TONES;
+
+    *rowFreqPtr = rowFreq[idx / 4];
+    *colFreqPtr = colFreq[idx % 4];
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Synthesize a sequence of tones, each one followed by a pause
+ *
+ * @return the number of samples
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t Synthesize
+(
+    const Signal_t* signalPtr,
+    const char*     tonesPtr
+)
+{
+    uint32_t toneSamples = (signalPtr->sampleRate * signalPtr->toneMs) / 1000;
+    uint32_t pauseSamples = (signalPtr->sampleRate * signalPtr->pauseMs) / 1000;
+    uint32_t seed = 12345;
+    size_t count = 0;
+
+    for (; *tonesPtr; tonesPtr++)
+    {
+        double rowFreq, colFreq;
+        uint32_t i;
+
+        GetFrequencies(*tonesPtr, &rowFreq, &colFreq);
+        rowFreq *= 1.0 + signalPtr->deviation;
+        colFreq *= 1.0 + signalPtr->deviation;
+
+        LE_ASSERT(count + toneSamples + pauseSamples <= SIGNAL_MAX_SAMPLES);
+
+        for (i = 0; i < toneSamples + pauseSamples; i++)
+        {
+            double t = (double)i / signalPtr->sampleRate;
+            double value = 0.0;
+
+            if (i < toneSamples)
+            {
+                value = signalPtr->rowAmplitude * sin(2.0 * M_PI * rowFreq * t) +
+                        signalPtr->colAmplitude * sin(2.0 * M_PI * colFreq * t) +
+                        signalPtr->colAmplitude * sin(2.0 * M_PI * signalPtr->extraFreq * t);
+            }
+
+            // Uniform white noise from a linear congruential generator
+            seed = seed * 1103515245 + 12345;
+            value += signalPtr->noiseAmplitude * ((double)(seed >> 16) / 32768.0 - 1.0);
+
+            Samples[count++] = (int16_t)lrint(value);
+        }
+    }
+
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tone handler: record the tone
+ */
+//--------------------------------------------------------------------------------------------------
+static void ToneHandler
+(
+    dtmfDetect_Ref_t detectorRef,
+    char             dtmf,
+    void*            contextPtr
+)
+{
+    size_t len = strlen(Detected);
+
+    LE_ASSERT(contextPtr == Detected);
+    LE_ASSERT(len < DETECTED_MAX_TONES);
+
+    Detected[len] = dtmf;
+    Detected[len + 1] = '\0';
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the detector on a signal, by chunks
+ *
+ * @return the detected tones
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* Detect
+(
+    const Signal_t* signalPtr,
+    const char*     tonesPtr,
+    size_t          chunkSize
+)
+{
+    dtmfDetect_Ref_t detectorRef;
+    size_t count = Synthesize(signalPtr, tonesPtr);
+    size_t offset;
+
+    detectorRef = dtmfDetect_Create(signalPtr->sampleRate, ToneHandler, Detected);
+    LE_ASSERT(NULL != detectorRef);
+    LE_ASSERT_OK(dtmfDetect_SetImpl(detectorRef, Impl));
+
+    Detected[0] = '\0';
+
+    for (offset = 0; offset < count; offset += chunkSize)
+    {
+        dtmfDetect_Process(detectorRef, &Samples[offset],
+                           (count - offset < chunkSize) ? (count - offset) : chunkSize);
+    }
+
+    dtmfDetect_Delete(detectorRef);
+
+    return Detected;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a nominal signal
+ */
+//--------------------------------------------------------------------------------------------------
+static Signal_t NominalSignal
+(
+    uint32_t sampleRate
+)
+{
+    Signal_t signal =
+    {
+        .sampleRate = sampleRate,
+        .toneMs = 50,
+        .pauseMs = 50,
+        .rowAmplitude = NOMINAL_AMPLITUDE,
+        .colAmplitude = NOMINAL_AMPLITUDE,
+    };
+
+    return signal;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the detection of all the tones at several sample rates, whatever the chunks size
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestAllTones
+(
+    void
+)
+{
+    static const uint32_t sampleRates[] = { 8000, 16000, 44100, 48000 };
+    static const size_t chunkSizes[] = { 1, 37, 160, 4096 };
+    int rateIdx, chunkIdx;
+
+    for (rateIdx = 0; rateIdx < NUM_ARRAY_MEMBERS(sampleRates); rateIdx++)
+    {
+        Signal_t signal = NominalSignal(sampleRates[rateIdx]);
+
+        for (chunkIdx = 0; chunkIdx < NUM_ARRAY_MEMBERS(chunkSizes); chunkIdx++)
+        {
+            LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, chunkSizes[chunkIdx])));
+        }
+    }
+
+    // Repeated tone, separated by pauses
+    {
+        Signal_t signal = NominalSignal(8000);
+
+        LE_ASSERT(0 == strcmp("1155", Detect(&signal, "1155", 160)));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the acceptance limits
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestLimits
+(
+    void
+)
+{
+    Signal_t signal;
+
+    // Minimal tone duration
+    signal = NominalSignal(8000);
+    signal.toneMs = 40;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+    signal.toneMs = 20;
+    LE_ASSERT(0 == strcmp("", Detect(&signal, ALL_TONES, 160)));
+
+    // Frequency deviation
+    signal = NominalSignal(8000);
+    signal.deviation = 0.015;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+    signal.deviation = -0.015;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+
+    // Normal twist: column frequency 6 dB stronger
+    signal = NominalSignal(8000);
+    signal.rowAmplitude = NOMINAL_AMPLITUDE / 2;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+
+    // Reverse twist: column frequency 3 dB weaker is accepted, 8 dB weaker is rejected
+    signal = NominalSignal(8000);
+    signal.colAmplitude = NOMINAL_AMPLITUDE / 1.41;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+    signal.colAmplitude = NOMINAL_AMPLITUDE / 2.5;
+    LE_ASSERT(0 == strcmp("", Detect(&signal, ALL_TONES, 160)));
+
+    // Level
+    signal = NominalSignal(8000);
+    signal.rowAmplitude = 300.0;
+    signal.colAmplitude = 300.0;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+    signal.rowAmplitude = 50.0;
+    signal.colAmplitude = 50.0;
+    LE_ASSERT(0 == strcmp("", Detect(&signal, ALL_TONES, 160)));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the noise and speech rejection
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRejection
+(
+    void
+)
+{
+    Signal_t signal;
+
+    // Tones in noise, 20 dB below
+    signal = NominalSignal(8000);
+    signal.noiseAmplitude = NOMINAL_AMPLITUDE / 10;
+    LE_ASSERT(0 == strcmp(ALL_TONES, Detect(&signal, ALL_TONES, 160)));
+
+    // Noise only
+    signal = NominalSignal(8000);
+    signal.rowAmplitude = 0.0;
+    signal.colAmplitude = 0.0;
+    signal.noiseAmplitude = NOMINAL_AMPLITUDE;
+    LE_ASSERT(0 == strcmp("", Detect(&signal, ALL_TONES, 160)));
+
+    // A third frequency, as found in speech or music
+    signal = NominalSignal(8000);
+    signal.extraFreq = 1100.0;
+    LE_ASSERT(0 == strcmp("", Detect(&signal, ALL_TONES, 160)));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the detector API
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestApi
+(
+    void
+)
+{
+    Signal_t signal = NominalSignal(8000);
+    dtmfDetect_Ref_t detectorRef;
+    size_t count;
+
+    LE_ASSERT(NULL == dtmfDetect_Create(7999, ToneHandler, Detected));
+    LE_ASSERT(NULL == dtmfDetect_Create(48001, ToneHandler, Detected));
+    LE_ASSERT(NULL == dtmfDetect_Create(8000, NULL, Detected));
+
+    detectorRef = dtmfDetect_Create(8000, ToneHandler, Detected);
+    LE_ASSERT(NULL != detectorRef);
+    LE_ASSERT_OK(dtmfDetect_SetImpl(detectorRef, DTMFDETECT_IMPL_SCALAR));
+
+    // The tone is reported again after a reset, and the partial block is dropped
+    signal.pauseMs = 0;
+    count = Synthesize(&signal, "7");
+    Detected[0] = '\0';
+    dtmfDetect_Process(detectorRef, Samples, count);
+    LE_ASSERT(0 == strcmp("7", Detected));
+    dtmfDetect_Reset(detectorRef);
+    dtmfDetect_Process(detectorRef, Samples, 10);
+    dtmfDetect_Reset(detectorRef);
+    dtmfDetect_Process(detectorRef, Samples, count);
+    LE_ASSERT(0 == strcmp("77", Detected));
+
+    dtmfDetect_Delete(detectorRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main of the test
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    static const dtmfDetect_Impl_t impls[] = { DTMFDETECT_IMPL_VECTOR, DTMFDETECT_IMPL_SCALAR };
+    dtmfDetect_Ref_t detectorRef;
+    bool hasVector;
+    int implIdx;
+
+    LE_INFO("======== Test DTMF detector API ========");
+    TestApi();
+
+    // The vector implementation is not available in all the builds
+    detectorRef = dtmfDetect_Create(8000, ToneHandler, Detected);
+    LE_ASSERT(NULL != detectorRef);
+    hasVector = (LE_OK == dtmfDetect_SetImpl(detectorRef, DTMFDETECT_IMPL_VECTOR));
+    dtmfDetect_Delete(detectorRef);
+
+    for (implIdx = 0; implIdx < NUM_ARRAY_MEMBERS(impls); implIdx++)
+    {
+        Impl = impls[implIdx];
+
+        if ((DTMFDETECT_IMPL_VECTOR == Impl) && !hasVector)
+        {
+            LE_WARN("Vector implementation not available");
+            continue;
+        }
+
+        LE_INFO("======== Test %s DTMF detector ========",
+                (DTMFDETECT_IMPL_VECTOR == Impl) ? "vector" : "scalar");
+
+        TestAllTones();
+        TestLimits();
+        TestRejection();
+    }
+
+    LE_INFO("======== DTMF detector tests PASSED ========");
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,812 @@
+/**
+ * @file pcmStream.c
+ *
+ * Implementation of the PCM samples transport used by the audio tests.
+ *
+ * The ring region starts with a header holding the geometry and the indexes, followed by the
+ * periods. The indexes are free running counters: the producer only updates the write index and
+ * the consumer only updates the read index, so no lock is needed between both sides.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "pcmStream.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Magic number identifying a ring region
+ */
+//--------------------------------------------------------------------------------------------------
+#define RING_MAGIC              0x50434d52
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache line size, used to keep the producer and consumer fields apart
+ */
+//--------------------------------------------------------------------------------------------------
+#define CACHE_LINE_BYTES        64
+
+//--------------------------------------------------------------------------------------------------
+// Data structures
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Header of a ring region, shared by the producer and the consumer
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t magic;                                 ///< RING_MAGIC
+    uint32_t periodBytes;                           ///< Period size
+    uint32_t periodCount;                           ///< Number of periods
+    uint32_t dataOffset;                            ///< Offset of the first period in the region
+    uint32_t length[PCMSTREAM_PERIOD_COUNT_MAX];    ///< Number of bytes in each period
+
+    /// Fields written by the producer only, on their own cache line
+    struct
+    {
+        uint32_t writeIdx;                          ///< Number of periods written
+        uint32_t overruns;                          ///< Number of overruns
+        uint32_t endOfStream;                       ///< No more periods will be written
+    }
+    producer __attribute__((aligned(CACHE_LINE_BYTES)));
+
+    /// Fields written by the consumer only, on their own cache line
+    struct
+    {
+        uint32_t readIdx;                           ///< Number of periods read
+        uint32_t underruns;                         ///< Number of underruns
+        uint64_t bytes;                             ///< Number of bytes read
+    }
+    consumer __attribute__((aligned(CACHE_LINE_BYTES)));
+}
+RingHeader_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Ring mapping in this process
+ */
+//--------------------------------------------------------------------------------------------------
+struct pcmStream_Ring
+{
+    int             fd;             ///< Region file descriptor
+    size_t          regionSize;     ///< Mapped size
+    RingHeader_t*   headerPtr;      ///< Region header
+    uint8_t*        dataPtr;        ///< First period
+    uint32_t        syscalls;       ///< System calls done through this reference
+};
+
+//--------------------------------------------------------------------------------------------------
+// Static declarations
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the ring references
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t RingPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the copy buffers, used when none of the file descriptors is a pipe
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t BufferPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the memory pools on first use
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitPools
+(
+    void
+)
+{
+    if (NULL == RingPool)
+    {
+        RingPool = le_mem_CreatePool("PcmStreamRingPool", sizeof(struct pcmStream_Ring));
+        BufferPool = le_mem_CreatePool("PcmStreamBufferPool", PCMSTREAM_PERIOD_MAX_BYTES);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if a file descriptor is a pipe
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsPipe
+(
+    int fd
+)
+{
+    struct stat st;
+
+    return ((0 == fstat(fd, &st)) && S_ISFIFO(st.st_mode));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Map a ring region and check its header
+ *
+ * @return the ring reference, NULL if the region is not a valid ring
+ */
+//--------------------------------------------------------------------------------------------------
+static pcmStream_RingRef_t MapRing
+(
+    int fd
+)
+{
+    struct pcmStream_Ring* ringPtr;
+    struct stat st;
+    RingHeader_t* headerPtr;
+
+    if ((0 != fstat(fd, &st)) || (st.st_size < (off_t)sizeof(RingHeader_t)))
+    {
+        LE_ERROR("Invalid ring region");
+        return NULL;
+    }
+
+    headerPtr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == headerPtr)
+    {
+        LE_ERROR("Unable to map the ring region: %m");
+        return NULL;
+    }
+
+    if ((RING_MAGIC != headerPtr->magic) ||
+        (0 == headerPtr->periodBytes) || (headerPtr->periodBytes > PCMSTREAM_PERIOD_MAX_BYTES) ||
+        (0 == headerPtr->periodCount) || (headerPtr->periodCount > PCMSTREAM_PERIOD_COUNT_MAX) ||
+        ((uint64_t)headerPtr->dataOffset +
+         (uint64_t)headerPtr->periodBytes * headerPtr->periodCount > (uint64_t)st.st_size))
+    {
+        LE_ERROR("Invalid ring header");
+        munmap(headerPtr, st.st_size);
+        return NULL;
+    }
+
+    ringPtr = le_mem_ForceAlloc(RingPool);
+    ringPtr->fd = fd;
+    ringPtr->regionSize = st.st_size;
+    ringPtr->headerPtr = headerPtr;
+    ringPtr->dataPtr = (uint8_t*)headerPtr + headerPtr->dataOffset;
+    ringPtr->syscalls = 0;
+
+    return ringPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the size of a period
+ *
+ * @return the period size in bytes, 0 if the parameters are invalid
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetPeriodBytes
+(
+    uint32_t sampleRate,        ///< [IN] Sample rate in Hz
+    uint32_t channelsCount,     ///< [IN] Number of channels
+    uint32_t bitsPerSample,     ///< [IN] Sample resolution
+    uint32_t periodMs           ///< [IN] Period duration in milliseconds
+)
+{
+    uint32_t frameBytes = channelsCount * ((bitsPerSample + 7) / 8);
+    uint64_t frames = ((uint64_t)sampleRate * periodMs) / 1000;
+    uint64_t periodBytes = frames * frameBytes;
+
+    if ((0 == periodBytes) || (periodBytes > PCMSTREAM_PERIOD_MAX_BYTES))
+    {
+        return 0;
+    }
+
+    return (uint32_t)periodBytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy the samples from a file descriptor to another one until the end of the input, through a
+ * period-sized buffer
+ *
+ * @return
+ *      - LE_OK at the end of the input
+ *      - LE_FAULT on a read or write error
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CopyThroughBuffer
+(
+    int                 inFd,           ///< [IN] Samples source
+    int                 outFd,          ///< [IN] Samples destination
+    uint8_t*            bufferPtr,      ///< [IN] Copy buffer
+    uint32_t            periodBytes,    ///< [IN] Period size
+    pcmStream_Stats_t*  statsPtr        ///< [OUT] Transfer statistics
+)
+{
+    while (1)
+    {
+        ssize_t readLen = read(inFd, bufferPtr, periodBytes);
+        ssize_t offset = 0;
+
+        statsPtr->syscalls++;
+
+        if (0 == readLen)
+        {
+            break;
+        }
+        if (readLen < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            LE_ERROR("read error: %m");
+            return LE_FAULT;
+        }
+
+        while (offset < readLen)
+        {
+            ssize_t writeLen = write(outFd, bufferPtr + offset, readLen - offset);
+
+            statsPtr->syscalls++;
+
+            if (writeLen < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                LE_ERROR("write error: %m");
+                return LE_FAULT;
+            }
+            offset += writeLen;
+        }
+
+        statsPtr->bytes += readLen;
+        statsPtr->periods++;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy the samples from a file descriptor to another one until the end of the input, by
+ * period-sized chunks.
+ *
+ * When one of the file descriptors is a pipe, the samples are moved with splice(), otherwise they
+ * are copied through a period-sized buffer. The statistics are updated during the copy, so that
+ * they can be read if the calling thread is cancelled.
+ *
+ * @return
+ *      - LE_OK at the end of the input
+ *      - LE_BAD_PARAMETER if the period size is invalid
+ *      - LE_FAULT on a read or write error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pcmStream_Copy
+(
+    int                 inFd,           ///< [IN] Samples source
+    int                 outFd,          ///< [IN] Samples destination
+    uint32_t            periodBytes,    ///< [IN] Period size
+    pcmStream_Stats_t*  statsPtr        ///< [OUT] Transfer statistics, can be NULL
+)
+{
+    pcmStream_Stats_t localStats;
+    le_result_t result;
+    bool useSplice = IsPipe(inFd) || IsPipe(outFd);
+    uint8_t* bufferPtr;
+
+    if ((0 == periodBytes) || (periodBytes > PCMSTREAM_PERIOD_MAX_BYTES))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    if (NULL == statsPtr)
+    {
+        statsPtr = &localStats;
+    }
+    memset(statsPtr, 0, sizeof(pcmStream_Stats_t));
+
+    while (useSplice)
+    {
+        ssize_t len = splice(inFd, NULL, outFd, NULL, periodBytes, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+        statsPtr->syscalls++;
+
+        if (len > 0)
+        {
+            statsPtr->bytes += len;
+            statsPtr->periods++;
+        }
+        else if (0 == len)
+        {
+            return LE_OK;
+        }
+        else if (EINTR == errno)
+        {
+            continue;
+        }
+        else if ((EINVAL == errno) && (0 == statsPtr->bytes))
+        {
+            // The file system doesn't support splice: copy through a buffer
+            LE_DEBUG("splice not supported, fall back to read/write");
+            useSplice = false;
+        }
+        else
+        {
+            LE_ERROR("splice error: %m");
+            return LE_FAULT;
+        }
+    }
+
+    InitPools();
+    bufferPtr = le_mem_ForceAlloc(BufferPool);
+
+    // read() and write() are cancellation points: release the buffer if the thread is cancelled
+    pthread_cleanup_push(le_mem_Release, bufferPtr);
+    result = CopyThroughBuffer(inFd, outFd, bufferPtr, periodBytes, statsPtr);
+    pthread_cleanup_pop(1);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a ring in a new shared memory region
+ *
+ * @return the ring reference, NULL if the parameters are invalid or the region can't be created
+ */
+//--------------------------------------------------------------------------------------------------
+pcmStream_RingRef_t pcmStream_CreateRing
+(
+    uint32_t periodBytes,       ///< [IN] Period size, at most PCMSTREAM_PERIOD_MAX_BYTES
+    uint32_t periodCount        ///< [IN] Number of periods, at most PCMSTREAM_PERIOD_COUNT_MAX
+)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    uint32_t dataOffset;
+    size_t regionSize;
+    RingHeader_t* headerPtr;
+    pcmStream_RingRef_t ringRef;
+    int fd;
+
+    if ((0 == periodBytes) || (periodBytes > PCMSTREAM_PERIOD_MAX_BYTES) ||
+        (0 == periodCount) || (periodCount > PCMSTREAM_PERIOD_COUNT_MAX))
+    {
+        LE_ERROR("Invalid ring geometry: %" PRIu32 " periods of %" PRIu32 " bytes",
+                 periodCount, periodBytes);
+        return NULL;
+    }
+
+    InitPools();
+
+    // The periods start on a page boundary
+    dataOffset = ((sizeof(RingHeader_t) + pageSize - 1) / pageSize) * pageSize;
+    regionSize = dataOffset + (size_t)periodBytes * periodCount;
+
+    fd = memfd_create("pcmStreamRing", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to create the ring region: %m");
+        return NULL;
+    }
+
+    if (0 != ftruncate(fd, regionSize))
+    {
+        LE_ERROR("Unable to size the ring region: %m");
+        close(fd);
+        return NULL;
+    }
+
+    // Initialize the header before the region is validated by MapRing()
+    headerPtr = mmap(NULL, sizeof(RingHeader_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == headerPtr)
+    {
+        LE_ERROR("Unable to map the ring region: %m");
+        close(fd);
+        return NULL;
+    }
+    headerPtr->magic = RING_MAGIC;
+    headerPtr->periodBytes = periodBytes;
+    headerPtr->periodCount = periodCount;
+    headerPtr->dataOffset = dataOffset;
+    munmap(headerPtr, sizeof(RingHeader_t));
+
+    ringRef = MapRing(fd);
+    if (NULL == ringRef)
+    {
+        close(fd);
+    }
+
+    return ringRef;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Map a ring created by another process or thread
+ *
+ * @return the ring reference, NULL if the region is not a valid ring
+ */
+//--------------------------------------------------------------------------------------------------
+pcmStream_RingRef_t pcmStream_OpenRing
+(
+    int fd                      ///< [IN] Region file descriptor, see pcmStream_GetRingFd()
+)
+{
+    int ownFd;
+    pcmStream_RingRef_t ringRef;
+
+    InitPools();
+
+    // The reference owns its file descriptor
+    ownFd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (ownFd < 0)
+    {
+        LE_ERROR("Unable to duplicate the ring file descriptor: %m");
+        return NULL;
+    }
+
+    ringRef = MapRing(ownFd);
+    if (NULL == ringRef)
+    {
+        close(ownFd);
+    }
+
+    return ringRef;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the file descriptor of the ring shared memory region, to be sent to the peer
+ *
+ * @return the file descriptor, owned by the ring
+ */
+//--------------------------------------------------------------------------------------------------
+int pcmStream_GetRingFd
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    return ringRef->fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the period size of a ring
+ *
+ * @return the period size in bytes
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetRingPeriodBytes
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    return ringRef->headerPtr->periodBytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of periods of a ring
+ *
+ * @return the number of periods
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetRingPeriodCount
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    return ringRef->headerPtr->periodCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Unmap a ring and close its file descriptor
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_DeleteRing
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    munmap(ringRef->headerPtr, ringRef->regionSize);
+    close(ringRef->fd);
+    le_mem_Release(ringRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next free period, to be filled in place by the producer
+ *
+ * @return the period address, NULL if the ring is full (an overrun is counted)
+ */
+//--------------------------------------------------------------------------------------------------
+uint8_t* pcmStream_AcquireWrite
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+    uint32_t writeIdx = headerPtr->producer.writeIdx;
+    uint32_t readIdx = __atomic_load_n(&headerPtr->consumer.readIdx, __ATOMIC_ACQUIRE);
+
+    if ((writeIdx - readIdx) >= headerPtr->periodCount)
+    {
+        __atomic_store_n(&headerPtr->producer.overruns, headerPtr->producer.overruns + 1,
+                         __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    return ringRef->dataPtr + (size_t)(writeIdx % headerPtr->periodCount) * headerPtr->periodBytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the period returned by pcmStream_AcquireWrite() to the consumer
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_CommitWrite
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    uint32_t            bytes       ///< [IN] Number of bytes written in the period
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+    uint32_t writeIdx = headerPtr->producer.writeIdx;
+
+    LE_ASSERT(bytes <= headerPtr->periodBytes);
+
+    headerPtr->length[writeIdx % headerPtr->periodCount] = bytes;
+    __atomic_store_n(&headerPtr->producer.writeIdx, writeIdx + 1, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next filled period, to be read in place by the consumer
+ *
+ * @return the period address, NULL if the ring is empty (an underrun is counted unless the end of
+ *         the stream is reached)
+ */
+//--------------------------------------------------------------------------------------------------
+const uint8_t* pcmStream_AcquireRead
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    uint32_t*           bytesPtr    ///< [OUT] Number of bytes in the period
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+    uint32_t readIdx = headerPtr->consumer.readIdx;
+    uint32_t endOfStream = __atomic_load_n(&headerPtr->producer.endOfStream, __ATOMIC_ACQUIRE);
+    uint32_t writeIdx = __atomic_load_n(&headerPtr->producer.writeIdx, __ATOMIC_ACQUIRE);
+    uint32_t slot = readIdx % headerPtr->periodCount;
+
+    if (writeIdx == readIdx)
+    {
+        if (!endOfStream)
+        {
+            __atomic_store_n(&headerPtr->consumer.underruns, headerPtr->consumer.underruns + 1,
+                             __ATOMIC_RELAXED);
+        }
+        return NULL;
+    }
+
+    *bytesPtr = headerPtr->length[slot];
+
+    return ringRef->dataPtr + (size_t)slot * headerPtr->periodBytes;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give the period returned by pcmStream_AcquireRead() back to the producer
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_ReleaseRead
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+    uint32_t readIdx = headerPtr->consumer.readIdx;
+    uint32_t bytes = headerPtr->length[readIdx % headerPtr->periodCount];
+
+    __atomic_store_n(&headerPtr->consumer.bytes, headerPtr->consumer.bytes + bytes,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&headerPtr->consumer.readIdx, readIdx + 1, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of periods written and not read yet
+ *
+ * @return the number of filled periods
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetFilledPeriods
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+
+    return (__atomic_load_n(&headerPtr->producer.writeIdx, __ATOMIC_ACQUIRE) -
+            __atomic_load_n(&headerPtr->consumer.readIdx, __ATOMIC_ACQUIRE));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mark the end of the stream: the consumer stops counting underruns once the ring is drained
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_SetEndOfStream
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    __atomic_store_n(&ringRef->headerPtr->producer.endOfStream, 1, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the end of the stream is reached and all the periods have been read
+ *
+ * @return true if the stream is completed
+ */
+//--------------------------------------------------------------------------------------------------
+bool pcmStream_IsCompleted
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+    uint32_t endOfStream = __atomic_load_n(&headerPtr->producer.endOfStream, __ATOMIC_ACQUIRE);
+
+    return (endOfStream &&
+            (__atomic_load_n(&headerPtr->producer.writeIdx, __ATOMIC_ACQUIRE) ==
+             __atomic_load_n(&headerPtr->consumer.readIdx, __ATOMIC_ACQUIRE)));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read one period from a file descriptor directly into the ring
+ *
+ * @return
+ *      - LE_OK if a period has been written in the ring
+ *      - LE_NO_MEMORY if the ring is full (an overrun is counted)
+ *      - LE_TERMINATED at the end of the input (the end of stream is set)
+ *      - LE_FAULT on a read error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pcmStream_FillFromFd
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    int                 fd          ///< [IN] Samples source
+)
+{
+    uint32_t periodBytes = ringRef->headerPtr->periodBytes;
+    uint8_t* periodPtr = pcmStream_AcquireWrite(ringRef);
+    uint32_t offset = 0;
+    bool endOfInput = false;
+
+    if (NULL == periodPtr)
+    {
+        return LE_NO_MEMORY;
+    }
+
+    // A pipe may return less than a period: complete it unless the input ends
+    while (offset < periodBytes)
+    {
+        ssize_t len = read(fd, periodPtr + offset, periodBytes - offset);
+
+        ringRef->syscalls++;
+
+        if (len > 0)
+        {
+            offset += len;
+        }
+        else if (0 == len)
+        {
+            endOfInput = true;
+            break;
+        }
+        else if (EINTR != errno)
+        {
+            LE_ERROR("read error: %m");
+            return LE_FAULT;
+        }
+    }
+
+    // The last partial period is committed before the end of stream is set, so that the reader
+    // never sees a completed stream without it
+    if (offset > 0)
+    {
+        pcmStream_CommitWrite(ringRef, offset);
+    }
+
+    if (endOfInput)
+    {
+        pcmStream_SetEndOfStream(ringRef);
+    }
+
+    return (0 == offset) ? LE_TERMINATED : LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write one period from the ring directly to a file descriptor
+ *
+ * @return
+ *      - LE_OK if a period has been read from the ring
+ *      - LE_WOULD_BLOCK if the ring is empty (an underrun is counted)
+ *      - LE_TERMINATED if the stream is completed
+ *      - LE_FAULT on a write error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pcmStream_DrainToFd
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    int                 fd          ///< [IN] Samples destination
+)
+{
+    uint32_t bytes = 0;
+    uint32_t offset = 0;
+    const uint8_t* periodPtr = pcmStream_AcquireRead(ringRef, &bytes);
+
+    if (NULL == periodPtr)
+    {
+        return (pcmStream_IsCompleted(ringRef) ? LE_TERMINATED : LE_WOULD_BLOCK);
+    }
+
+    while (offset < bytes)
+    {
+        ssize_t len = write(fd, periodPtr + offset, bytes - offset);
+
+        ringRef->syscalls++;
+
+        if (len >= 0)
+        {
+            offset += len;
+        }
+        else if (EINTR != errno)
+        {
+            LE_ERROR("write error: %m");
+            return LE_FAULT;
+        }
+    }
+
+    pcmStream_ReleaseRead(ringRef);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of a ring.
+ *
+ * The transferred periods and bytes and the xrun counters are shared by both sides, the system
+ * calls are the ones done through this reference.
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_GetRingStats
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    pcmStream_Stats_t*  statsPtr    ///< [OUT] Statistics
+)
+{
+    RingHeader_t* headerPtr = ringRef->headerPtr;
+
+    statsPtr->bytes = __atomic_load_n(&headerPtr->consumer.bytes, __ATOMIC_RELAXED);
+    statsPtr->periods = __atomic_load_n(&headerPtr->consumer.readIdx, __ATOMIC_RELAXED);
+    statsPtr->syscalls = ringRef->syscalls;
+    statsPtr->overruns = __atomic_load_n(&headerPtr->producer.overruns, __ATOMIC_RELAXED);
+    statsPtr->underruns = __atomic_load_n(&headerPtr->consumer.underruns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,300 @@
+/**
+ * @file pcmStream.h
+ *
+ * PCM samples transport used by the audio tests.
+ *
+ * Two transports are provided:
+ * - a copy between a file and the pipe exchanged with the audio service, done with splice() by
+ *   period-sized chunks so that the samples never go through a user space buffer,
+ * - a ring of periods in a shared memory region (memfd), which can be mapped by a producer and a
+ *   consumer in different processes. The producer and the consumer access the periods in place and
+ *   only exchange indexes. An attempt to write in a full ring is counted as an overrun and an
+ *   attempt to read an empty ring is counted as an underrun.
+ *
+ * The ring supports one producer and one consumer. The xrun counters are meant for the real-time
+ * side (the device, or the stub replacing it): the other side checks pcmStream_GetFilledPeriods()
+ * and waits instead of acquiring a period from a full or empty ring.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#ifndef PCMSTREAM_H_INCLUDE_GUARD
+#define PCMSTREAM_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of periods in a ring
+ */
+//--------------------------------------------------------------------------------------------------
+#define PCMSTREAM_PERIOD_COUNT_MAX      64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum size of a period, in bytes
+ */
+//--------------------------------------------------------------------------------------------------
+#define PCMSTREAM_PERIOD_MAX_BYTES      (64 * 1024)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a ring
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct pcmStream_Ring* pcmStream_RingRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transport statistics
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t bytes;             ///< Number of bytes transferred
+    uint32_t periods;           ///< Number of periods transferred
+    uint32_t syscalls;          ///< Number of read/write/splice calls done by this side
+    uint32_t overruns;          ///< Number of periods which could not be written: ring full
+    uint32_t underruns;         ///< Number of periods which could not be read: ring empty
+}
+pcmStream_Stats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the size of a period
+ *
+ * @return the period size in bytes, 0 if the parameters are invalid
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetPeriodBytes
+(
+    uint32_t sampleRate,        ///< [IN] Sample rate in Hz
+    uint32_t channelsCount,     ///< [IN] Number of channels
+    uint32_t bitsPerSample,     ///< [IN] Sample resolution
+    uint32_t periodMs           ///< [IN] Period duration in milliseconds
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy the samples from a file descriptor to another one until the end of the input, by
+ * period-sized chunks.
+ *
+ * When one of the file descriptors is a pipe, the samples are moved with splice(), otherwise they
+ * are copied through a period-sized buffer. The statistics are updated during the copy, so that
+ * they can be read if the calling thread is cancelled.
+ *
+ * @return
+ *      - LE_OK at the end of the input
+ *      - LE_BAD_PARAMETER if the period size is invalid
+ *      - LE_FAULT on a read or write error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pcmStream_Copy
+(
+    int                 inFd,           ///< [IN] Samples source
+    int                 outFd,          ///< [IN] Samples destination
+    uint32_t            periodBytes,    ///< [IN] Period size
+    pcmStream_Stats_t*  statsPtr        ///< [OUT] Transfer statistics, can be NULL
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a ring in a new shared memory region
+ *
+ * @return the ring reference, NULL if the parameters are invalid or the region can't be created
+ */
+//--------------------------------------------------------------------------------------------------
+pcmStream_RingRef_t pcmStream_CreateRing
+(
+    uint32_t periodBytes,       ///< [IN] Period size, at most PCMSTREAM_PERIOD_MAX_BYTES
+    uint32_t periodCount        ///< [IN] Number of periods, at most PCMSTREAM_PERIOD_COUNT_MAX
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Map a ring created by another process or thread
+ *
+ * @return the ring reference, NULL if the region is not a valid ring
+ */
+//--------------------------------------------------------------------------------------------------
+pcmStream_RingRef_t pcmStream_OpenRing
+(
+    int fd                      ///< [IN] Region file descriptor, see pcmStream_GetRingFd()
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the file descriptor of the ring shared memory region, to be sent to the peer
+ *
+ * @return the file descriptor, owned by the ring
+ */
+//--------------------------------------------------------------------------------------------------
+int pcmStream_GetRingFd
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the period size of a ring
+ *
+ * @return the period size in bytes
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetRingPeriodBytes
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of periods of a ring
+ *
+ * @return the number of periods
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetRingPeriodCount
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Unmap a ring and close its file descriptor
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_DeleteRing
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next free period, to be filled in place by the producer
+ *
+ * @return the period address, NULL if the ring is full (an overrun is counted)
+ */
+//--------------------------------------------------------------------------------------------------
+uint8_t* pcmStream_AcquireWrite
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the period returned by pcmStream_AcquireWrite() to the consumer
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_CommitWrite
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    uint32_t            bytes       ///< [IN] Number of bytes written in the period
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next filled period, to be read in place by the consumer
+ *
+ * @return the period address, NULL if the ring is empty (an underrun is counted unless the end of
+ *         the stream is reached)
+ */
+//--------------------------------------------------------------------------------------------------
+const uint8_t* pcmStream_AcquireRead
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    uint32_t*           bytesPtr    ///< [OUT] Number of bytes in the period
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give the period returned by pcmStream_AcquireRead() back to the producer
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_ReleaseRead
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of periods written and not read yet
+ *
+ * @return the number of filled periods
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t pcmStream_GetFilledPeriods
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mark the end of the stream: the consumer stops counting underruns once the ring is drained
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_SetEndOfStream
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check if the end of the stream is reached and all the periods have been read
+ *
+ * @return true if the stream is completed
+ */
+//--------------------------------------------------------------------------------------------------
+bool pcmStream_IsCompleted
+(
+    pcmStream_RingRef_t ringRef ///< [IN] Ring reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read one period from a file descriptor directly into the ring
+ *
+ * @return
+ *      - LE_OK if a period has been written in the ring
+ *      - LE_NO_MEMORY if the ring is full (an overrun is counted)
+ *      - LE_TERMINATED at the end of the input (the end of stream is set)
+ *      - LE_FAULT on a read error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pcmStream_FillFromFd
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    int                 fd          ///< [IN] Samples source
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write one period from the ring directly to a file descriptor
+ *
+ * @return
+ *      - LE_OK if a period has been read from the ring
+ *      - LE_WOULD_BLOCK if the ring is empty (an underrun is counted)
+ *      - LE_TERMINATED if the stream is completed
+ *      - LE_FAULT on a write error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pcmStream_DrainToFd
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    int                 fd          ///< [IN] Samples destination
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of a ring.
+ *
+ * The transferred periods and bytes and the xrun counters are shared by both sides, the system
+ * calls are the ones done through this reference.
+ */
+//--------------------------------------------------------------------------------------------------
+void pcmStream_GetRingStats
+(
+    pcmStream_RingRef_t ringRef,    ///< [IN] Ring reference
+    pcmStream_Stats_t*  statsPtr    ///< [OUT] Statistics
+);
+
+#endif // PCMSTREAM_H_INCLUDE_GUARD
@@ -0,0 +1,452 @@
+/**
+ * This module implements a benchmark of the PCM samples transports used for the file playback.
+ *
+ * A stereo 16-bit stream is played in real time for each sample rate by a stub device which
+ * consumes one period every period duration, while the application thread feeds it from a file:
+ * - pipe1024: 1024-byte read() and write() through a pipe, as done historically by the tests,
+ * - splice: period-sized splice() from the file to the pipe (pcmStream_Copy),
+ * - ring: period-sized read() directly into a shared ring (pcmStream_FillFromFd).
+ *
+ * For each case, the system calls and the CPU time of the application thread are measured, with
+ * the underruns seen by the device and the system calls it needs to get the samples (the pacing
+ * of the stub device is not counted, as it is done by the hardware). Results are written on the
+ * standard output as a JSON document, "opsPerSec" being the rate of system calls:
+ *
+ * @code
+ * {
+ *   "results": [
+ *     { "suite": "pcmStream", "test": "splice", "ops": 51, "elapsedUs": 1000412,
+ *       "opsPerSec": 50, "sampleRate": 8000, "periodBytes": 640, "cpuUs": 210,
+ *       "underruns": 0, "deviceSyscalls": 52 },
+ *     ...
+ *   ]
+ * }
+ * @endcode
+ *
+ * The stream duration in seconds can be given as argument (1 by default).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "pcmStream.h"
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stream format
+ */
+//--------------------------------------------------------------------------------------------------
+#define CHANNELS_COUNT          2
+#define BITS_PER_SAMPLE         16
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Period duration and number of periods of the ring
+ */
+//--------------------------------------------------------------------------------------------------
+#define PERIOD_MS               20
+#define PERIOD_COUNT            4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Chunk size of the historical read/write loop
+ */
+//--------------------------------------------------------------------------------------------------
+#define LEGACY_CHUNK_BYTES      1024
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transports measured
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    TRANSPORT_PIPE_1024,
+    TRANSPORT_SPLICE,
+    TRANSPORT_RING,
+    TRANSPORT_MAX
+}
+Transport_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Benchmark case context
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    Transport_t         transport;      ///< Transport measured
+    uint32_t            periodBytes;    ///< Period size
+    int                 sourceFd;       ///< Samples file
+    int                 pipeFd[2];      ///< Pipe to the device, for the pipe transports
+    pcmStream_RingRef_t ringRef;        ///< Ring shared with the device, for the ring transport
+    uint32_t            syscalls;       ///< System calls of the application thread
+    uint64_t            cpuNs;          ///< CPU time of the application thread
+    uint32_t            underruns;      ///< Underruns seen by the device
+    uint32_t            deviceSyscalls; ///< System calls of the device to get the samples
+}
+BenchCase_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transport names
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* TransportNames[TRANSPORT_MAX] = { "pipe1024", "splice", "ring" };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample rates measured
+ */
+//--------------------------------------------------------------------------------------------------
+static const uint32_t SampleRates[] = { 8000, 16000, 32000, 44100, 48000 };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Period buffer of the stub device
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t DevicePeriod[PCMSTREAM_PERIOD_MAX_BYTES];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the CPU time of the calling thread
+ *
+ * @return the CPU time in nanoseconds
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetThreadCpuNs
+(
+    void
+)
+{
+    struct timespec ts;
+
+    LE_ASSERT(0 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts));
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a duration to an absolute time
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddNs
+(
+    struct timespec* tsPtr,
+    long             ns
+)
+{
+    tsPtr->tv_nsec += ns;
+    while (tsPtr->tv_nsec >= 1000000000)
+    {
+        tsPtr->tv_nsec -= 1000000000;
+        tsPtr->tv_sec++;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub device: consume one period every period duration until the end of the stream
+ */
+//--------------------------------------------------------------------------------------------------
+static void* DeviceThread
+(
+    void* contextPtr
+)
+{
+    BenchCase_t* casePtr = contextPtr;
+    struct timespec wakeUp;
+    bool completed = false;
+
+    if (TRANSPORT_RING != casePtr->transport)
+    {
+        LE_ASSERT(0 == fcntl(casePtr->pipeFd[0], F_SETFL, O_NONBLOCK));
+    }
+
+    LE_ASSERT(0 == clock_gettime(CLOCK_MONOTONIC, &wakeUp));
+
+    while (!completed)
+    {
+        AddNs(&wakeUp, PERIOD_MS * 1000000L);
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL));
+
+        if (TRANSPORT_RING == casePtr->transport)
+        {
+            uint32_t bytes;
+            const uint8_t* periodPtr = pcmStream_AcquireRead(casePtr->ringRef, &bytes);
+
+            if (periodPtr)
+            {
+                // The hardware would read the period from the ring
+                memcpy(DevicePeriod, periodPtr, bytes);
+                pcmStream_ReleaseRead(casePtr->ringRef);
+            }
+            else
+            {
+                completed = pcmStream_IsCompleted(casePtr->ringRef);
+            }
+        }
+        else
+        {
+            uint32_t offset = 0;
+
+            while (offset < casePtr->periodBytes)
+            {
+                ssize_t len = read(casePtr->pipeFd[0], DevicePeriod + offset,
+                                   casePtr->periodBytes - offset);
+
+                casePtr->deviceSyscalls++;
+
+                if (len > 0)
+                {
+                    offset += len;
+                }
+                else
+                {
+                    completed = (0 == len);
+                    if ((len < 0) && (EAGAIN == errno) && (0 == offset))
+                    {
+                        casePtr->underruns++;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    if (TRANSPORT_RING == casePtr->transport)
+    {
+        pcmStream_Stats_t stats;
+
+        pcmStream_GetRingStats(casePtr->ringRef, &stats);
+        casePtr->underruns = stats.underruns;
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Application side: feed the device from the samples file
+ */
+//--------------------------------------------------------------------------------------------------
+static void FeedDevice
+(
+    BenchCase_t* casePtr
+)
+{
+    uint64_t startCpuNs = GetThreadCpuNs();
+
+    switch (casePtr->transport)
+    {
+        case TRANSPORT_PIPE_1024:
+        {
+            char data[LEGACY_CHUNK_BYTES];
+            ssize_t len;
+
+            while (casePtr->syscalls++, (len = read(casePtr->sourceFd, data, sizeof(data))) > 0)
+            {
+                casePtr->syscalls++;
+                LE_ASSERT(len == write(casePtr->pipeFd[1], data, len));
+            }
+            break;
+        }
+
+        case TRANSPORT_SPLICE:
+        {
+            pcmStream_Stats_t stats;
+
+            LE_ASSERT_OK(pcmStream_Copy(casePtr->sourceFd, casePtr->pipeFd[1],
+                                        casePtr->periodBytes, &stats));
+            casePtr->syscalls = stats.syscalls;
+            break;
+        }
+
+        case TRANSPORT_RING:
+        {
+            pcmStream_Stats_t stats;
+            le_result_t result;
+            struct timespec period = { 0, PERIOD_MS * 1000000L };
+
+            do
+            {
+                // Wait for a free period: the device is paced by the sample rate
+                while (PERIOD_COUNT == pcmStream_GetFilledPeriods(casePtr->ringRef))
+                {
+                    nanosleep(&period, NULL);
+                    casePtr->syscalls++;
+                }
+                result = pcmStream_FillFromFd(casePtr->ringRef, casePtr->sourceFd);
+            }
+            while (LE_OK == result);
+            LE_ASSERT(LE_TERMINATED == result);
+
+            pcmStream_GetRingStats(casePtr->ringRef, &stats);
+            casePtr->syscalls += stats.syscalls;
+            break;
+        }
+
+        default:
+            LE_FATAL("Unknown transport %d", casePtr->transport);
+    }
+
+    casePtr->cpuNs = GetThreadCpuNs() - startCpuNs;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the samples file of a stream
+ *
+ * @return the file descriptor
+ */
+//--------------------------------------------------------------------------------------------------
+static int CreateSourceFile
+(
+    uint32_t streamBytes
+)
+{
+    char path[] = "/tmp/pcmStreamBenchXXXXXX";
+    uint8_t chunk[4096];
+    uint32_t offset;
+    int fd = mkstemp(path);
+
+    LE_ASSERT(fd >= 0);
+    LE_ASSERT(0 == unlink(path));
+
+    memset(chunk, 0x55, sizeof(chunk));
+    for (offset = 0; offset < streamBytes; offset += sizeof(chunk))
+    {
+        uint32_t len = ((streamBytes - offset) < sizeof(chunk)) ? (streamBytes - offset)
+                                                                : sizeof(chunk);
+        LE_ASSERT(len == write(fd, chunk, len));
+    }
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Play a stream with a transport and report the measures
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunCase
+(
+    Transport_t transport,
+    uint32_t    sampleRate,
+    uint32_t    durationSec,
+    bool        isFirst
+)
+{
+    BenchCase_t benchCase = { 0 };
+    le_thread_Ref_t deviceThreadRef;
+    le_clk_Time_t startTime, elapsed;
+    uint64_t elapsedUs;
+    uint32_t streamBytes = sampleRate * CHANNELS_COUNT * (BITS_PER_SAMPLE / 8) * durationSec;
+
+    benchCase.transport = transport;
+    benchCase.periodBytes = pcmStream_GetPeriodBytes(sampleRate, CHANNELS_COUNT, BITS_PER_SAMPLE,
+                                                     PERIOD_MS);
+    LE_ASSERT(benchCase.periodBytes);
+
+    benchCase.sourceFd = CreateSourceFile(streamBytes);
+    LE_ASSERT(0 == lseek(benchCase.sourceFd, 0, SEEK_SET));
+
+    if (TRANSPORT_RING == transport)
+    {
+        benchCase.ringRef = pcmStream_CreateRing(benchCase.periodBytes, PERIOD_COUNT);
+        LE_ASSERT(benchCase.ringRef);
+    }
+    else
+    {
+        LE_ASSERT(0 == pipe(benchCase.pipeFd));
+    }
+
+    startTime = le_clk_GetRelativeTime();
+
+    deviceThreadRef = le_thread_Create("PcmDevice", DeviceThread, &benchCase);
+    le_thread_SetJoinable(deviceThreadRef);
+    le_thread_Start(deviceThreadRef);
+
+    FeedDevice(&benchCase);
+
+    if (TRANSPORT_RING != transport)
+    {
+        close(benchCase.pipeFd[1]);
+    }
+
+    LE_ASSERT_OK(le_thread_Join(deviceThreadRef, NULL));
+
+    elapsed = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+    elapsedUs = (uint64_t)elapsed.sec * 1000000 + elapsed.usec;
+
+    printf("%s    { \"suite\": \"pcmStream\", \"test\": \"%s\", \"ops\": %"PRIu32
+           ", \"elapsedUs\": %"PRIu64", \"opsPerSec\": %"PRIu64", \"sampleRate\": %"PRIu32
+           ", \"periodBytes\": %"PRIu32", \"cpuUs\": %"PRIu64", \"underruns\": %"PRIu32
+           ", \"deviceSyscalls\": %"PRIu32" }",
+           (isFirst ? "" : ",\n"),
+           TransportNames[transport],
+           benchCase.syscalls,
+           elapsedUs,
+           elapsedUs ? ((uint64_t)benchCase.syscalls * 1000000) / elapsedUs : 0,
+           sampleRate,
+           benchCase.periodBytes,
+           benchCase.cpuNs / 1000,
+           benchCase.underruns,
+           benchCase.deviceSyscalls);
+    fflush(stdout);
+
+    if (TRANSPORT_RING == transport)
+    {
+        pcmStream_DeleteRing(benchCase.ringRef);
+    }
+    else
+    {
+        close(benchCase.pipeFd[0]);
+    }
+    close(benchCase.sourceFd);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main of the benchmark
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    uint32_t durationSec = 1;
+    int rateIdx;
+    Transport_t transport;
+
+    if (le_arg_NumArgs() >= 1)
+    {
+        const char* durationPtr = le_arg_GetArg(0);
+
+        if ((NULL == durationPtr) || (atoi(durationPtr) <= 0))
+        {
+            fprintf(stderr, "Usage: pcmStreamBench [duration in seconds]\n");
+            exit(EXIT_FAILURE);
+        }
+        durationSec = atoi(durationPtr);
+    }
+
+    printf("{\n  \"results\": [\n");
+
+    for (rateIdx = 0; rateIdx < NUM_ARRAY_MEMBERS(SampleRates); rateIdx++)
+    {
+        for (transport = 0; transport < TRANSPORT_MAX; transport++)
+        {
+            RunCase(transport, SampleRates[rateIdx], durationSec,
+                    (0 == rateIdx) && (0 == transport));
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,609 @@
+/**
+ * This module implements the unit tests of the PCM samples transport.
+ *
+ * The audio hardware is replaced by a file-backed stub device: a thread which reads the played
+ * periods from the ring into a file, or writes the captured periods from a file into the ring.
+ *
+ * Tested API:
+ * - pcmStream_GetPeriodBytes
+ * - pcmStream_Copy
+ * - pcmStream ring API
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "pcmStream.h"
+
+#include <sys/mman.h>
+
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the samples file: not a multiple of the periods used by the tests
+ */
+//--------------------------------------------------------------------------------------------------
+#define SAMPLES_BYTES           (100 * 1024 + 123)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Period size used with the stub device
+ */
+//--------------------------------------------------------------------------------------------------
+#define STUB_PERIOD_BYTES       1920
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of periods used with the stub device
+ */
+//--------------------------------------------------------------------------------------------------
+#define STUB_PERIOD_COUNT       4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub device context
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pcmStream_RingRef_t ringRef;    ///< Ring mapped by the device
+    int                 fd;         ///< Backing file
+    uint32_t            xruns;      ///< Xruns seen by the device
+}
+StubDevice_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Directory of the test files
+ */
+//--------------------------------------------------------------------------------------------------
+static char TestDir[] = "/tmp/pcmStreamTestXXXXXX";
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a test file
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetTestPath
+(
+    const char* namePtr,
+    char*       pathPtr,
+    size_t      pathSize
+)
+{
+    LE_ASSERT(snprintf(pathPtr, pathSize, "%s/%s", TestDir, namePtr) < (int)pathSize);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the samples file
+ *
+ * @return the file descriptor, positioned at the beginning of the file
+ */
+//--------------------------------------------------------------------------------------------------
+static int CreateSamplesFile
+(
+    const char* namePtr
+)
+{
+    char path[PATH_MAX];
+    uint8_t samples[SAMPLES_BYTES];
+    int fd;
+    int i;
+
+    for (i = 0; i < SAMPLES_BYTES; i++)
+    {
+        samples[i] = (uint8_t)((i * 7) ^ (i >> 8));
+    }
+
+    GetTestPath(namePtr, path, sizeof(path));
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    LE_ASSERT(fd >= 0);
+    LE_ASSERT(SAMPLES_BYTES == write(fd, samples, sizeof(samples)));
+    LE_ASSERT(0 == lseek(fd, 0, SEEK_SET));
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an empty output file
+ *
+ * @return the file descriptor
+ */
+//--------------------------------------------------------------------------------------------------
+static int CreateOutputFile
+(
+    const char* namePtr
+)
+{
+    char path[PATH_MAX];
+    int fd;
+
+    GetTestPath(namePtr, path, sizeof(path));
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    LE_ASSERT(fd >= 0);
+
+    return fd;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that two files have the same content
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckSameContent
+(
+    int fd1,
+    int fd2
+)
+{
+    off_t size = lseek(fd1, 0, SEEK_END);
+    uint8_t* data1Ptr;
+    uint8_t* data2Ptr;
+
+    LE_ASSERT(size == lseek(fd2, 0, SEEK_END));
+
+    data1Ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd1, 0);
+    data2Ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd2, 0);
+    LE_ASSERT((MAP_FAILED != data1Ptr) && (MAP_FAILED != data2Ptr));
+    LE_ASSERT(0 == memcmp(data1Ptr, data2Ptr, size));
+
+    munmap(data1Ptr, size);
+    munmap(data2Ptr, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the period size computation
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestPeriodBytes
+(
+    void
+)
+{
+    LE_INFO("======== Test period size ========");
+
+    LE_ASSERT(320 == pcmStream_GetPeriodBytes(8000, 1, 16, 20));
+    LE_ASSERT(3840 == pcmStream_GetPeriodBytes(48000, 2, 16, 20));
+    LE_ASSERT(1764 == pcmStream_GetPeriodBytes(44100, 1, 16, 20));
+    LE_ASSERT(240 == pcmStream_GetPeriodBytes(8000, 1, 24, 10));
+    LE_ASSERT(0 == pcmStream_GetPeriodBytes(0, 1, 16, 20));
+    LE_ASSERT(0 == pcmStream_GetPeriodBytes(8000, 0, 16, 20));
+    LE_ASSERT(0 == pcmStream_GetPeriodBytes(48000, 2, 32, 1000));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the ring indexes, the wrap-around and the xrun counters
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRing
+(
+    void
+)
+{
+    pcmStream_RingRef_t ringRef;
+    pcmStream_Stats_t stats;
+    uint8_t* writePtr;
+    const uint8_t* readPtr;
+    uint32_t bytes;
+    int i;
+
+    LE_INFO("======== Test ring ========");
+
+    LE_ASSERT(NULL == pcmStream_CreateRing(0, 4));
+    LE_ASSERT(NULL == pcmStream_CreateRing(16, 0));
+    LE_ASSERT(NULL == pcmStream_CreateRing(PCMSTREAM_PERIOD_MAX_BYTES + 1, 4));
+    LE_ASSERT(NULL == pcmStream_CreateRing(16, PCMSTREAM_PERIOD_COUNT_MAX + 1));
+
+    ringRef = pcmStream_CreateRing(16, 4);
+    LE_ASSERT(NULL != ringRef);
+    LE_ASSERT(16 == pcmStream_GetRingPeriodBytes(ringRef));
+    LE_ASSERT(4 == pcmStream_GetRingPeriodCount(ringRef));
+
+    // Empty ring: underrun
+    LE_ASSERT(NULL == pcmStream_AcquireRead(ringRef, &bytes));
+
+    // Fill the ring: the next write is an overrun
+    for (i = 0; i < 4; i++)
+    {
+        writePtr = pcmStream_AcquireWrite(ringRef);
+        LE_ASSERT(NULL != writePtr);
+        memset(writePtr, i, 16);
+        pcmStream_CommitWrite(ringRef, 16);
+    }
+    LE_ASSERT(4 == pcmStream_GetFilledPeriods(ringRef));
+    LE_ASSERT(NULL == pcmStream_AcquireWrite(ringRef));
+
+    // Read two periods and write two more, partially filled, to wrap around
+    for (i = 0; i < 2; i++)
+    {
+        readPtr = pcmStream_AcquireRead(ringRef, &bytes);
+        LE_ASSERT(NULL != readPtr);
+        LE_ASSERT(16 == bytes);
+        LE_ASSERT((i == readPtr[0]) && (i == readPtr[15]));
+        pcmStream_ReleaseRead(ringRef);
+    }
+    for (i = 4; i < 6; i++)
+    {
+        writePtr = pcmStream_AcquireWrite(ringRef);
+        LE_ASSERT(NULL != writePtr);
+        memset(writePtr, i, 8);
+        pcmStream_CommitWrite(ringRef, 8);
+    }
+
+    // The remaining periods are read in order
+    for (i = 2; i < 6; i++)
+    {
+        readPtr = pcmStream_AcquireRead(ringRef, &bytes);
+        LE_ASSERT(NULL != readPtr);
+        LE_ASSERT(((i < 4) ? 16 : 8) == bytes);
+        LE_ASSERT(i == readPtr[0]);
+        pcmStream_ReleaseRead(ringRef);
+    }
+
+    // No underrun counted once the stream is completed
+    LE_ASSERT(!pcmStream_IsCompleted(ringRef));
+    pcmStream_SetEndOfStream(ringRef);
+    LE_ASSERT(pcmStream_IsCompleted(ringRef));
+    LE_ASSERT(NULL == pcmStream_AcquireRead(ringRef, &bytes));
+
+    pcmStream_GetRingStats(ringRef, &stats);
+    LE_ASSERT(6 == stats.periods);
+    LE_ASSERT((4 * 16 + 2 * 8) == stats.bytes);
+    LE_ASSERT(1 == stats.overruns);
+    LE_ASSERT(1 == stats.underruns);
+    LE_ASSERT(0 == stats.syscalls);
+
+    pcmStream_DeleteRing(ringRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test a ring mapped twice, as done by a producer and a consumer in different processes
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestSharedRing
+(
+    void
+)
+{
+    pcmStream_RingRef_t producerRef;
+    pcmStream_RingRef_t consumerRef;
+    pcmStream_Stats_t stats;
+    uint8_t* writePtr;
+    const uint8_t* readPtr;
+    uint32_t bytes;
+    int fd;
+
+    LE_INFO("======== Test shared ring ========");
+
+    producerRef = pcmStream_CreateRing(64, 2);
+    LE_ASSERT(NULL != producerRef);
+    consumerRef = pcmStream_OpenRing(pcmStream_GetRingFd(producerRef));
+    LE_ASSERT(NULL != consumerRef);
+    LE_ASSERT(pcmStream_GetRingFd(producerRef) != pcmStream_GetRingFd(consumerRef));
+
+    writePtr = pcmStream_AcquireWrite(producerRef);
+    LE_ASSERT(NULL != writePtr);
+    memcpy(writePtr, "samples", 8);
+    pcmStream_CommitWrite(producerRef, 8);
+
+    readPtr = pcmStream_AcquireRead(consumerRef, &bytes);
+    LE_ASSERT(NULL != readPtr);
+    LE_ASSERT(8 == bytes);
+    LE_ASSERT(0 == strcmp((const char*)readPtr, "samples"));
+    pcmStream_ReleaseRead(consumerRef);
+
+    // Statistics are shared
+    pcmStream_GetRingStats(producerRef, &stats);
+    LE_ASSERT(1 == stats.periods);
+    LE_ASSERT(8 == stats.bytes);
+
+    // The consumer mapping stays valid once the producer is gone
+    pcmStream_DeleteRing(producerRef);
+    LE_ASSERT(0 == pcmStream_GetFilledPeriods(consumerRef));
+    pcmStream_DeleteRing(consumerRef);
+
+    // A region which is not a ring is rejected
+    fd = memfd_create("notARing", MFD_CLOEXEC);
+    LE_ASSERT(fd >= 0);
+    LE_ASSERT(0 == ftruncate(fd, 4096));
+    LE_ASSERT(NULL == pcmStream_OpenRing(fd));
+    close(fd);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub playback device: drain the ring into the backing file
+ */
+//--------------------------------------------------------------------------------------------------
+static void* PlaybackDeviceThread
+(
+    void* contextPtr
+)
+{
+    StubDevice_t* devicePtr = contextPtr;
+    le_result_t result;
+
+    while (LE_TERMINATED != (result = pcmStream_DrainToFd(devicePtr->ringRef, devicePtr->fd)))
+    {
+        if (LE_WOULD_BLOCK == result)
+        {
+            devicePtr->xruns++;
+            sched_yield();
+        }
+        else
+        {
+            LE_ASSERT_OK(result);
+        }
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub capture device: fill the ring from the backing file
+ */
+//--------------------------------------------------------------------------------------------------
+static void* CaptureDeviceThread
+(
+    void* contextPtr
+)
+{
+    StubDevice_t* devicePtr = contextPtr;
+    le_result_t result;
+
+    while (LE_TERMINATED != (result = pcmStream_FillFromFd(devicePtr->ringRef, devicePtr->fd)))
+    {
+        if (LE_NO_MEMORY == result)
+        {
+            devicePtr->xruns++;
+            sched_yield();
+        }
+        else
+        {
+            LE_ASSERT_OK(result);
+        }
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the playback and the capture through a ring with the stub devices
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestStubDevice
+(
+    void
+)
+{
+    pcmStream_RingRef_t ringRef;
+    pcmStream_Stats_t stats;
+    StubDevice_t device;
+    le_thread_Ref_t deviceThreadRef;
+    int sourceFd, outFd;
+    le_result_t result;
+
+    LE_INFO("======== Test stub playback device ========");
+
+    sourceFd = CreateSamplesFile("source.pcm");
+    outFd = CreateOutputFile("played.pcm");
+
+    ringRef = pcmStream_CreateRing(STUB_PERIOD_BYTES, STUB_PERIOD_COUNT);
+    LE_ASSERT(NULL != ringRef);
+
+    device.ringRef = pcmStream_OpenRing(pcmStream_GetRingFd(ringRef));
+    LE_ASSERT(NULL != device.ringRef);
+    device.fd = outFd;
+    device.xruns = 0;
+
+    deviceThreadRef = le_thread_Create("PlaybackDevice", PlaybackDeviceThread, &device);
+    le_thread_SetJoinable(deviceThreadRef);
+    le_thread_Start(deviceThreadRef);
+
+    // Application side: wait for a free period instead of overrunning
+    do
+    {
+        while (STUB_PERIOD_COUNT == pcmStream_GetFilledPeriods(ringRef))
+        {
+            sched_yield();
+        }
+        result = pcmStream_FillFromFd(ringRef, sourceFd);
+    }
+    while (LE_OK == result);
+    LE_ASSERT(LE_TERMINATED == result);
+
+    LE_ASSERT_OK(le_thread_Join(deviceThreadRef, NULL));
+
+    pcmStream_GetRingStats(ringRef, &stats);
+    LE_ASSERT(SAMPLES_BYTES == stats.bytes);
+    LE_ASSERT(((SAMPLES_BYTES + STUB_PERIOD_BYTES - 1) / STUB_PERIOD_BYTES) == stats.periods);
+    LE_ASSERT(0 == stats.overruns);
+    LE_ASSERT(stats.underruns >= device.xruns);
+    // One read per period, plus the ones detecting the end of the file: one while completing the
+    // last partial period and one in the next call
+    LE_ASSERT(stats.periods + 2 == stats.syscalls);
+    LE_INFO("Playback: %"PRIu32" periods, %"PRIu32" underruns", stats.periods, stats.underruns);
+
+    CheckSameContent(sourceFd, outFd);
+
+    pcmStream_DeleteRing(device.ringRef);
+    pcmStream_DeleteRing(ringRef);
+    close(outFd);
+
+    LE_INFO("======== Test stub capture device ========");
+
+    LE_ASSERT(0 == lseek(sourceFd, 0, SEEK_SET));
+    outFd = CreateOutputFile("captured.pcm");
+
+    ringRef = pcmStream_CreateRing(STUB_PERIOD_BYTES, STUB_PERIOD_COUNT);
+    LE_ASSERT(NULL != ringRef);
+
+    device.ringRef = pcmStream_OpenRing(pcmStream_GetRingFd(ringRef));
+    LE_ASSERT(NULL != device.ringRef);
+    device.fd = sourceFd;
+    device.xruns = 0;
+
+    deviceThreadRef = le_thread_Create("CaptureDevice", CaptureDeviceThread, &device);
+    le_thread_SetJoinable(deviceThreadRef);
+    le_thread_Start(deviceThreadRef);
+
+    // Application side: wait for a filled period instead of underrunning
+    do
+    {
+        while ((0 == pcmStream_GetFilledPeriods(ringRef)) && !pcmStream_IsCompleted(ringRef))
+        {
+            sched_yield();
+        }
+        result = pcmStream_DrainToFd(ringRef, outFd);
+    }
+    while (LE_OK == result);
+    LE_ASSERT(LE_TERMINATED == result);
+
+    LE_ASSERT_OK(le_thread_Join(deviceThreadRef, NULL));
+
+    pcmStream_GetRingStats(ringRef, &stats);
+    LE_ASSERT(SAMPLES_BYTES == stats.bytes);
+    LE_ASSERT(0 == stats.underruns);
+    LE_ASSERT(device.xruns == stats.overruns);
+    LE_INFO("Capture: %"PRIu32" periods, %"PRIu32" overruns", stats.periods, stats.overruns);
+
+    CheckSameContent(sourceFd, outFd);
+
+    pcmStream_DeleteRing(device.ringRef);
+    pcmStream_DeleteRing(ringRef);
+    close(outFd);
+    close(sourceFd);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pipe reader used by the copy test, as done by the audio service
+ */
+//--------------------------------------------------------------------------------------------------
+static void* PipeReaderThread
+(
+    void* contextPtr
+)
+{
+    int* fdPtr = contextPtr;
+    pcmStream_Stats_t stats;
+
+    LE_ASSERT_OK(pcmStream_Copy(fdPtr[0], fdPtr[1], STUB_PERIOD_BYTES, &stats));
+    LE_ASSERT(SAMPLES_BYTES == stats.bytes);
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the copy between files and pipes
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestCopy
+(
+    void
+)
+{
+    pcmStream_Stats_t stats;
+    le_thread_Ref_t readerThreadRef;
+    int pipeFd[2];
+    int readerFd[2];
+    int sourceFd, outFd;
+
+    LE_INFO("======== Test copy ========");
+
+    sourceFd = CreateSamplesFile("copySource.pcm");
+    outFd = CreateOutputFile("copyPiped.pcm");
+
+    LE_ASSERT(LE_BAD_PARAMETER == pcmStream_Copy(sourceFd, outFd, 0, NULL));
+    LE_ASSERT(LE_BAD_PARAMETER ==
+              pcmStream_Copy(sourceFd, outFd, PCMSTREAM_PERIOD_MAX_BYTES + 1, NULL));
+
+    // File to pipe to file: spliced
+    LE_ASSERT(0 == pipe(pipeFd));
+    readerFd[0] = pipeFd[0];
+    readerFd[1] = outFd;
+    readerThreadRef = le_thread_Create("PipeReader", PipeReaderThread, readerFd);
+    le_thread_SetJoinable(readerThreadRef);
+    le_thread_Start(readerThreadRef);
+
+    LE_ASSERT_OK(pcmStream_Copy(sourceFd, pipeFd[1], STUB_PERIOD_BYTES, &stats));
+    close(pipeFd[1]);
+    LE_ASSERT_OK(le_thread_Join(readerThreadRef, NULL));
+    close(pipeFd[0]);
+
+    LE_ASSERT(SAMPLES_BYTES == stats.bytes);
+    LE_ASSERT(stats.periods + 1 == stats.syscalls);
+    LE_INFO("Spliced %"PRIu64" bytes with %"PRIu32" system calls", stats.bytes, stats.syscalls);
+
+    CheckSameContent(sourceFd, outFd);
+    close(outFd);
+
+    // File to file: copied through a buffer
+    LE_ASSERT(0 == lseek(sourceFd, 0, SEEK_SET));
+    outFd = CreateOutputFile("copyDirect.pcm");
+
+    LE_ASSERT_OK(pcmStream_Copy(sourceFd, outFd, STUB_PERIOD_BYTES, &stats));
+    LE_ASSERT(SAMPLES_BYTES == stats.bytes);
+    LE_ASSERT((2 * stats.periods) + 1 == stats.syscalls);
+
+    CheckSameContent(sourceFd, outFd);
+    close(outFd);
+    close(sourceFd);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the test files
+ */
+//--------------------------------------------------------------------------------------------------
+static void RemoveTestFiles
+(
+    void
+)
+{
+    const char* namesPtr[] = { "source.pcm", "played.pcm", "captured.pcm",
+                               "copySource.pcm", "copyPiped.pcm", "copyDirect.pcm" };
+    char path[PATH_MAX];
+    int i;
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(namesPtr); i++)
+    {
+        GetTestPath(namesPtr[i], path, sizeof(path));
+        LE_ASSERT(0 == unlink(path));
+    }
+
+    LE_ASSERT(0 == rmdir(TestDir));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main of the test
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    LE_ASSERT(NULL != mkdtemp(TestDir));
+
+    TestPeriodBytes();
+    TestRing();
+    TestSharedRing();
+    TestStubDevice();
+    TestCopy();
+
+    RemoveTestFiles();
+
+    LE_INFO("======== PCM stream tests PASSED ========");
+    exit(EXIT_SUCCESS);
+}
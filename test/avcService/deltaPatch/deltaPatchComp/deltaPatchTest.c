@@ -0,0 +1,438 @@
+/**
+ * This program tests the application of binary delta packages, on local files.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include <dirent.h>
+#include <openssl/sha.h>
+#include "deltaPatch.h"
+
+#define TEST_DIR            "/tmp/deltaPatchTest"
+#define BASE_DIR            TEST_DIR "/base"
+#define DELTA_PATH          TEST_DIR "/delta"
+#define TARGET_PATH         TEST_DIR "/target"
+#define PACKAGE_PATH        TEST_DIR "/package"
+
+#define BASE_SIZE           (100*1024)
+#define TARGET_SIZE         (BASE_SIZE + 3000)
+#define MAX_DELTA_SIZE      (TARGET_SIZE + 256)
+
+static uint8_t Base[BASE_SIZE];
+static uint8_t Target[TARGET_SIZE];
+static uint8_t Delta[MAX_DELTA_SIZE];
+static uint8_t ReadBuf[TARGET_SIZE + 1];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a big-endian integer
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t PutBe
+(
+    uint8_t* bufPtr,
+    uint64_t value,
+    size_t len
+)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        bufPtr[i] = (uint8_t)(value >> (8 * (len - 1 - i)));
+    }
+    return len;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a whole buffer to a file
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteFile
+(
+    const char* pathPtr,
+    const uint8_t* bufPtr,
+    size_t len
+)
+{
+    int fd = open(pathPtr, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+
+    LE_ASSERT(-1 != fd);
+    LE_ASSERT(len == write(fd, bufPtr, len));
+    close(fd);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a whole file
+ *
+ * @return the file size
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t ReadFile
+(
+    const char* pathPtr
+)
+{
+    ssize_t len;
+    int fd = open(pathPtr, O_RDONLY);
+
+    LE_ASSERT(-1 != fd);
+    len = read(fd, ReadBuf, sizeof(ReadBuf));
+    close(fd);
+
+    return len;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the base and the target: the target inserts, changes and removes bytes in the base
+ */
+//--------------------------------------------------------------------------------------------------
+static void MakePackages
+(
+    void
+)
+{
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    char path[sizeof(BASE_DIR) + 2 * SHA256_DIGEST_LENGTH + 1];
+    uint32_t seed = 12345;
+    int i;
+
+    for (i = 0; i < BASE_SIZE; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        Base[i] = (uint8_t)(seed >> 16);
+    }
+
+    // Target: base[0..40000), 4000 new bytes, base[40000..100000) with one changed byte at 70000,
+    // then 1400 bytes of base from 99000
+    memcpy(Target, Base, 40000);
+    memset(Target + 40000, 0xA5, 4000);
+    memcpy(Target + 44000, Base + 40000, 60000);
+    Target[44000 + 30000] ^= 0xFF;
+    memcpy(Target + 104000, Base + 99000, TARGET_SIZE - 104000);
+
+    LE_ASSERT(LE_OK == le_dir_MakePath(BASE_DIR, S_IRWXU));
+    SHA256(Base, sizeof(Base), hash);
+    snprintf(path, sizeof(path), "%s/", BASE_DIR);
+    for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+        snprintf(path + strlen(path), 3, "%02x", hash[i]);
+    }
+    WriteFile(path, Base, sizeof(Base));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the delta rebuilding the target from the base
+ *
+ * @return the delta size
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t MakeDelta
+(
+    void
+)
+{
+    uint8_t* ptr = Delta;
+
+    memcpy(ptr, DELTAPATCH_MAGIC, DELTAPATCH_MAGIC_LEN);
+    ptr += DELTAPATCH_MAGIC_LEN;
+    ptr += PutBe(ptr, BASE_SIZE, 8);
+    SHA256(Base, sizeof(Base), ptr);
+    ptr += SHA256_DIGEST_LENGTH;
+    ptr += PutBe(ptr, TARGET_SIZE, 8);
+    SHA256(Target, sizeof(Target), ptr);
+    ptr += SHA256_DIGEST_LENGTH;
+
+    *ptr++ = 0x01;
+    ptr += PutBe(ptr, 0, 8);
+    ptr += PutBe(ptr, 40000, 4);
+
+    *ptr++ = 0x02;
+    ptr += PutBe(ptr, 4000, 4);
+    memcpy(ptr, Target + 40000, 4000);
+    ptr += 4000;
+
+    *ptr++ = 0x01;
+    ptr += PutBe(ptr, 40000, 8);
+    ptr += PutBe(ptr, 30000, 4);
+
+    *ptr++ = 0x02;
+    ptr += PutBe(ptr, 1, 4);
+    *ptr++ = Target[74000];
+
+    *ptr++ = 0x01;
+    ptr += PutBe(ptr, 70001, 8);
+    ptr += PutBe(ptr, 29999, 4);
+
+    *ptr++ = 0x01;
+    ptr += PutBe(ptr, 99000, 8);
+    ptr += PutBe(ptr, TARGET_SIZE - 104000, 4);
+
+    *ptr++ = 0x00;
+
+    return ptr - Delta;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a delta file and check the target
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestApply
+(
+    size_t deltaSize
+)
+{
+    deltaPatch_Stats_t stats;
+
+    LE_INFO("======== Apply ========");
+
+    LE_TEST(deltaPatch_IsDelta(Delta, deltaSize));
+    LE_TEST(!deltaPatch_IsDelta(Base, sizeof(Base)));
+    LE_TEST(!deltaPatch_IsDelta(Delta, DELTAPATCH_MAGIC_LEN - 1));
+
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_OK == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, &stats));
+    LE_TEST(TARGET_SIZE == ReadFile(TARGET_PATH));
+    LE_TEST(0 == memcmp(ReadBuf, Target, TARGET_SIZE));
+
+    LE_TEST(deltaSize == stats.deltaBytes);
+    LE_TEST(TARGET_SIZE - 4001 == stats.copyBytes);
+    LE_TEST(4001 == stats.addBytes);
+    LE_TEST(6 == stats.commands);
+    LE_INFO("Delta of %zu bytes for a target of %d bytes", deltaSize, TARGET_SIZE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a delta one byte at a time, as it could be received from the network
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestStreaming
+(
+    size_t deltaSize
+)
+{
+    deltaPatch_Ref_t deltaRef;
+    le_result_t result = LE_OK;
+    size_t i;
+    int fd;
+
+    LE_INFO("======== Streaming ========");
+
+    fd = open(TARGET_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    LE_ASSERT(-1 != fd);
+
+    deltaRef = deltaPatch_Start(BASE_DIR, fd);
+    LE_ASSERT(NULL != deltaRef);
+
+    for (i = 0; (i < deltaSize - 1) && (LE_OK == result); i++)
+    {
+        result = deltaPatch_Write(deltaRef, Delta + i, 1);
+    }
+    LE_TEST(LE_OK == result);
+    LE_TEST(!deltaPatch_IsComplete(deltaRef));
+    LE_TEST(LE_OK == deltaPatch_Write(deltaRef, Delta + i, 1));
+    LE_TEST(deltaPatch_IsComplete(deltaRef));
+
+    // The end of the target is held back until it is verified
+    LE_TEST(TARGET_SIZE - DELTAPATCH_TAIL_BYTES == lseek(fd, 0, SEEK_CUR));
+    LE_TEST(LE_OK == deltaPatch_Finish(deltaRef));
+    close(fd);
+
+    LE_TEST(TARGET_SIZE == ReadFile(TARGET_PATH));
+    LE_TEST(0 == memcmp(ReadBuf, Target, TARGET_SIZE));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that the invalid deltas are rejected
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestReject
+(
+    size_t deltaSize
+)
+{
+    const size_t baseHashOffset = DELTAPATCH_MAGIC_LEN + 8;
+    const size_t targetHashOffset = baseHashOffset + SHA256_DIGEST_LENGTH + 8;
+    const size_t firstCopyOffset = targetHashOffset + SHA256_DIGEST_LENGTH;
+
+    LE_INFO("======== Reject ========");
+
+    // Unknown base
+    Delta[baseHashOffset] ^= 0xFF;
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_NOT_FOUND == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    Delta[baseHashOffset] ^= 0xFF;
+
+    // Base with a different size
+    PutBe(Delta + DELTAPATCH_MAGIC_LEN, BASE_SIZE + 1, 8);
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_NOT_FOUND == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    PutBe(Delta + DELTAPATCH_MAGIC_LEN, BASE_SIZE, 8);
+
+    // Target hash mismatch: the end of the target is never written
+    Delta[targetHashOffset] ^= 0xFF;
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    LE_TEST(TARGET_SIZE - DELTAPATCH_TAIL_BYTES == ReadFile(TARGET_PATH));
+    Delta[targetHashOffset] ^= 0xFF;
+
+    // Corrupted data
+    Delta[deltaSize - 100] ^= 0xFF;
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    Delta[deltaSize - 100] ^= 0xFF;
+
+    // Truncated delta
+    WriteFile(DELTA_PATH, Delta, deltaSize - 1);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    WriteFile(DELTA_PATH, Delta, deltaSize / 2);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+
+    // Bytes after the end
+    Delta[deltaSize] = 0x00;
+    WriteFile(DELTA_PATH, Delta, deltaSize + 1);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+
+    // COPY outside of the base
+    PutBe(Delta + firstCopyOffset + 1, BASE_SIZE - 100, 8);
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    PutBe(Delta + firstCopyOffset + 1, 0, 8);
+
+    // Unknown command
+    Delta[firstCopyOffset] = 0x7F;
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+    Delta[firstCopyOffset] = 0x01;
+
+    // Not a delta
+    WriteFile(DELTA_PATH, Target, sizeof(Target));
+    LE_TEST(LE_FORMAT_ERROR == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+
+    // The original delta still applies
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_OK == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep a downloaded package as a base, then store the next download at the same path: the base
+ * must still apply
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestNewDownload
+(
+    size_t deltaSize
+)
+{
+    char path[sizeof(BASE_DIR) + 2 * SHA256_DIGEST_LENGTH + 1];
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    struct stat st;
+    int fd;
+    int i;
+
+    LE_INFO("======== New download ========");
+
+    // Replace the initial base by a kept package
+    SHA256(Base, sizeof(Base), hash);
+    snprintf(path, sizeof(path), "%s/", BASE_DIR);
+    for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+        snprintf(path + strlen(path), 3, "%02x", hash[i]);
+    }
+    LE_ASSERT(0 == unlink(path));
+    WriteFile(PACKAGE_PATH, Base, sizeof(Base));
+    LE_TEST(LE_OK == deltaPatch_KeepBase(PACKAGE_PATH, BASE_DIR, 8));
+    LE_TEST((0 == stat(path, &st)) && (2 == st.st_nlink));
+
+    // Store the delta as the next download
+    fd = deltaPatch_CreateFile(PACKAGE_PATH, S_IRUSR | S_IWUSR);
+    LE_ASSERT(-1 != fd);
+    LE_ASSERT(deltaSize == write(fd, Delta, deltaSize));
+    close(fd);
+
+    LE_TEST((0 == stat(path, &st)) && (1 == st.st_nlink) && (BASE_SIZE == st.st_size));
+    LE_TEST(LE_OK == deltaPatch_ApplyFile(PACKAGE_PATH, TARGET_PATH, BASE_DIR, NULL));
+    LE_TEST(TARGET_SIZE == ReadFile(TARGET_PATH));
+    LE_TEST(0 == memcmp(ReadBuf, Target, TARGET_SIZE));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep packages as bases, and check the oldest ones are removed
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestKeepBase
+(
+    size_t deltaSize
+)
+{
+    struct timespec times[2] = { { 1000, 0 }, { 1000, 0 } };
+    char path[sizeof(BASE_DIR) + 2 * SHA256_DIGEST_LENGTH + 1];
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    DIR* dirPtr;
+    int count = 0;
+    int i;
+
+    LE_INFO("======== Keep base ========");
+
+    // Make the initial base the oldest one
+    SHA256(Base, sizeof(Base), hash);
+    snprintf(path, sizeof(path), "%s/", BASE_DIR);
+    for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+        snprintf(path + strlen(path), 3, "%02x", hash[i]);
+    }
+    LE_ASSERT(0 == utimensat(AT_FDCWD, path, times, 0));
+
+    // Keep the target twice, then another package
+    LE_TEST(LE_OK == deltaPatch_KeepBase(TARGET_PATH, BASE_DIR, 2));
+    LE_TEST(LE_OK == deltaPatch_KeepBase(TARGET_PATH, BASE_DIR, 2));
+    WriteFile(PACKAGE_PATH, Target, sizeof(Target) - 1);
+    LE_TEST(LE_OK == deltaPatch_KeepBase(PACKAGE_PATH, BASE_DIR, 2));
+
+    // The initial base was evicted
+    LE_TEST(-1 == access(path, F_OK));
+    WriteFile(DELTA_PATH, Delta, deltaSize);
+    LE_TEST(LE_NOT_FOUND == deltaPatch_ApplyFile(DELTA_PATH, TARGET_PATH, BASE_DIR, NULL));
+
+    // Two bases are left, besides "." and ".."
+    dirPtr = opendir(BASE_DIR);
+    LE_ASSERT(NULL != dirPtr);
+    while (NULL != readdir(dirPtr))
+    {
+        count++;
+    }
+    closedir(dirPtr);
+    LE_TEST(2 + 2 == count);
+}
+
+COMPONENT_INIT
+{
+    size_t deltaSize;
+
+    LE_TEST_INIT;
+
+    LE_ASSERT(LE_OK == le_dir_RemoveRecursive(TEST_DIR));
+    MakePackages();
+    deltaSize = MakeDelta();
+
+    TestApply(deltaSize);
+    TestStreaming(deltaSize);
+    TestReject(deltaSize);
+    TestNewDownload(deltaSize);
+    TestKeepBase(deltaSize);
+
+    le_dir_RemoveRecursive(TEST_DIR);
+
+    LE_TEST_EXIT;
+}
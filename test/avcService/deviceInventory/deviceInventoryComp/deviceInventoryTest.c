@@ -0,0 +1,440 @@
+/**
+ * This program tests the device inventory cache of the LWM2M device object, with modem service
+ * stubs: the identity and version values are read once, and again only after an event which can
+ * change them.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+#include <lwm2mcore/lwm2mcore.h>
+#include <lwm2mcore/device.h>
+#include "avcClient.h"
+#include "avcServer.h"
+
+#define BUF_SIZE                512
+#define FIRMWARE_VERSION_START  "MDM=SWI9X07Y_02.16.02.00,LK="
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Modem service stubs: the values are set by the test, each call is counted
+ */
+//--------------------------------------------------------------------------------------------------
+static char Iccid[LE_SIM_ICCID_BYTES] = "89330123456789012345";
+static char Msisdn[LE_MDMDEFS_PHONE_NUM_MAX_BYTES] = "+33612345678";
+static le_mrc_Rat_t Rat = LE_MRC_RAT_LTE;
+static le_result_t MsisdnResult = LE_OK;
+static int FirmwareVersionCount;
+static int ImeiCount;
+static int IccidCount;
+static int ImsiCount;
+static int EsnCount;
+static int MsisdnCount;
+static le_sim_NewStateHandlerFunc_t SimStateHandler;
+static le_mrc_RatChangeHandlerFunc_t RatChangeHandler;
+
+le_result_t le_info_GetFirmwareVersion
+(
+    char* versionPtr,
+    size_t versionNumElements
+)
+{
+    FirmwareVersionCount++;
+    return le_utf8_Copy(versionPtr, "SWI9X07Y_02.16.02.00 000000 jenkins", versionNumElements,
+                        NULL);
+}
+
+le_result_t le_info_GetPriId
+(
+    char* priIdPnPtr,
+    size_t priIdPnNumElements,
+    char* priIdRevPtr,
+    size_t priIdRevNumElements
+)
+{
+    le_utf8_Copy(priIdPnPtr, "9907344", priIdPnNumElements, NULL);
+    return le_utf8_Copy(priIdRevPtr, "002.001", priIdRevNumElements, NULL);
+}
+
+le_result_t le_info_GetCarrierPri
+(
+    char* capriNamePtr,
+    size_t capriNameNumElements,
+    char* capriRevPtr,
+    size_t capriRevNumElements
+)
+{
+    le_utf8_Copy(capriNamePtr, "GENERIC", capriNameNumElements, NULL);
+    return le_utf8_Copy(capriRevPtr, "002.020_000", capriRevNumElements, NULL);
+}
+
+le_result_t le_ulpm_GetFirmwareVersion
+(
+    char* versionPtr,
+    size_t versionNumElements
+)
+{
+    return le_utf8_Copy(versionPtr, "002.011", versionNumElements, NULL);
+}
+
+le_result_t le_info_GetImei
+(
+    char* imeiPtr,
+    size_t imeiNumElements
+)
+{
+    ImeiCount++;
+    return le_utf8_Copy(imeiPtr, "359377060000001", imeiNumElements, NULL);
+}
+
+le_result_t le_info_GetEsn
+(
+    char* esnPtr,
+    size_t esnNumElements
+)
+{
+    EsnCount++;
+    return le_utf8_Copy(esnPtr, "80123456", esnNumElements, NULL);
+}
+
+le_result_t le_info_GetMeid
+(
+    char* meidPtr,
+    size_t meidNumElements
+)
+{
+    return LE_FAULT;
+}
+
+le_result_t le_info_GetManufacturerName
+(
+    char* mfrNamePtr,
+    size_t mfrNameNumElements
+)
+{
+    return le_utf8_Copy(mfrNamePtr, "Sierra Wireless", mfrNameNumElements, NULL);
+}
+
+le_result_t le_info_GetDeviceModel
+(
+    char* modelPtr,
+    size_t modelNumElements
+)
+{
+    return le_utf8_Copy(modelPtr, "WP7607", modelNumElements, NULL);
+}
+
+le_result_t le_info_GetPlatformSerialNumber
+(
+    char* platformSerialNumberPtr,
+    size_t platformSerialNumberNumElements
+)
+{
+    return le_utf8_Copy(platformSerialNumberPtr, "VU0000000000", platformSerialNumberNumElements,
+                        NULL);
+}
+
+le_result_t le_info_GetExpectedResetsCount
+(
+    uint64_t* resetsCountPtrPtr
+)
+{
+    *resetsCountPtrPtr = 0;
+    return LE_OK;
+}
+
+le_result_t le_info_GetUnexpectedResetsCount
+(
+    uint64_t* resetsCountPtrPtr
+)
+{
+    *resetsCountPtrPtr = 0;
+    return LE_OK;
+}
+
+le_result_t le_ips_GetPowerSource
+(
+    le_ips_PowerSource_t* powerSourcePtr
+)
+{
+    *powerSourcePtr = LE_IPS_POWER_SOURCE_EXTERNAL;
+    return LE_OK;
+}
+
+le_result_t le_ips_GetBatteryLevel
+(
+    uint8_t* batteryLevelPtr
+)
+{
+    return LE_FAULT;
+}
+
+le_temp_SensorRef_t le_temp_Request
+(
+    const char* sensorPtr
+)
+{
+    return NULL;
+}
+
+le_result_t le_temp_GetTemperature
+(
+    le_temp_SensorRef_t sensorRef,
+    int32_t* temperaturePtr
+)
+{
+    return LE_FAULT;
+}
+
+le_sim_Id_t le_sim_GetSelectedCard
+(
+    void
+)
+{
+    return LE_SIM_EXTERNAL_SLOT_1;
+}
+
+le_result_t le_sim_GetICCID
+(
+    le_sim_Id_t simId,
+    char* iccidPtr,
+    size_t iccidNumElements
+)
+{
+    IccidCount++;
+    return le_utf8_Copy(iccidPtr, Iccid, iccidNumElements, NULL);
+}
+
+le_result_t le_sim_GetIMSI
+(
+    le_sim_Id_t simId,
+    char* imsiPtr,
+    size_t imsiNumElements
+)
+{
+    ImsiCount++;
+    return le_utf8_Copy(imsiPtr, "208011234567890", imsiNumElements, NULL);
+}
+
+le_result_t le_sim_GetSubscriberPhoneNumber
+(
+    le_sim_Id_t simId,
+    char* phoneNumberStr,
+    size_t phoneNumberStrNumElements
+)
+{
+    MsisdnCount++;
+    if (LE_OK != MsisdnResult)
+    {
+        return MsisdnResult;
+    }
+    return le_utf8_Copy(phoneNumberStr, Msisdn, phoneNumberStrNumElements, NULL);
+}
+
+le_sim_NewStateHandlerRef_t le_sim_AddNewStateHandler
+(
+    le_sim_NewStateHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    SimStateHandler = handlerPtr;
+    return (le_sim_NewStateHandlerRef_t)1;
+}
+
+le_result_t le_mrc_GetRadioAccessTechInUse
+(
+    le_mrc_Rat_t* ratPtr
+)
+{
+    *ratPtr = Rat;
+    return LE_OK;
+}
+
+le_mrc_RatChangeHandlerRef_t le_mrc_AddRatChangeHandler
+(
+    le_mrc_RatChangeHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    RatChangeHandler = handlerPtr;
+    return (le_mrc_RatChangeHandlerRef_t)1;
+}
+
+le_result_t avcServer_QueryReboot
+(
+    avcServer_RebootHandlerFunc_t handlerFunc
+)
+{
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a string resource of the device object and check its value
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckResource
+(
+    lwm2mcore_Sid_t (*getFunc)(char*, size_t*),     ///< [IN] Resource read function
+    const char* expectedPtr                         ///< [IN] Expected value
+)
+{
+    char buf[BUF_SIZE];
+    size_t len = sizeof(buf);
+
+    memset(buf, 0, sizeof(buf));
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == getFunc(buf, &len));
+    LE_TEST(strlen(expectedPtr) == len);
+    LE_TEST(0 == strncmp(buf, expectedPtr, len));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the whole device object
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadObject
+(
+    void
+)
+{
+    char buf[BUF_SIZE];
+    size_t len;
+    uint32_t resets;
+
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetDeviceManufacturer(buf, &len));
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetDeviceModelNumber(buf, &len));
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetDeviceSerialNumber(buf, &len));
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetDeviceFirmwareVersion(buf, &len));
+    LE_TEST(0 == strncmp(buf, FIRMWARE_VERSION_START, strlen(FIRMWARE_VERSION_START)));
+    LE_TEST(NULL != strstr(buf, ",CUPRI=9907344-002.001,CAPRI=GENERIC-002.020_000,MCU=002.011"));
+    LE_TEST(strlen(buf) == len);
+    CheckResource(lwm2mcore_GetDeviceImei, "359377060000001");
+    CheckResource(lwm2mcore_GetIccid, Iccid);
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetSubscriptionIdentity(buf, &len));
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetMsisdn(buf, &len));
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetDeviceTotalResets(&resets));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test that the inventory is collected at startup and that the object reads are served from it
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestCollect
+(
+    void
+)
+{
+    avcClient_InitDeviceInventory();
+    LE_TEST(NULL != SimStateHandler);
+    LE_TEST(NULL != RatChangeHandler);
+    LE_TEST(1 == FirmwareVersionCount);
+    LE_TEST(1 == ImeiCount);
+    LE_TEST(1 == IccidCount);
+    LE_TEST(1 == ImsiCount);
+    LE_TEST(1 == MsisdnCount);
+
+    ReadObject();
+    ReadObject();
+    LE_TEST(1 == FirmwareVersionCount);
+    LE_TEST(1 == ImeiCount);
+    LE_TEST(1 == IccidCount);
+    LE_TEST(1 == ImsiCount);
+    LE_TEST(1 == MsisdnCount);
+    CheckResource(lwm2mcore_GetSubscriptionIdentity, "208011234567890");
+    CheckResource(lwm2mcore_GetMsisdn, Msisdn);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the invalidation of the inventory entries by the events which can change them
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestInvalidate
+(
+    void
+)
+{
+    // SIM change: only the SIM related entries are read again
+    le_utf8_Copy(Iccid, "89330999999999999999", sizeof(Iccid), NULL);
+    SimStateHandler(LE_SIM_EXTERNAL_SLOT_1, LE_SIM_READY, NULL);
+    ReadObject();
+    CheckResource(lwm2mcore_GetIccid, "89330999999999999999");
+    LE_TEST(1 == FirmwareVersionCount);
+    LE_TEST(1 == ImeiCount);
+    LE_TEST(2 == IccidCount);
+    LE_TEST(2 == ImsiCount);
+    LE_TEST(2 == MsisdnCount);
+
+    // RAT change: the subscription identity of the new RAT is read
+    Rat = LE_MRC_RAT_CDMA;
+    RatChangeHandler(Rat, NULL);
+    CheckResource(lwm2mcore_GetSubscriptionIdentity, "80123456");
+    CheckResource(lwm2mcore_GetSubscriptionIdentity, "80123456");
+    LE_TEST(1 == EsnCount);
+    LE_TEST(2 == IccidCount);
+
+    // Package install: all the entries are read again
+    avcClient_InvalidateDeviceInventory();
+    ReadObject();
+    ReadObject();
+    LE_TEST(2 == FirmwareVersionCount);
+    LE_TEST(2 == ImeiCount);
+    LE_TEST(3 == IccidCount);
+    LE_TEST(2 == EsnCount);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test that the unavailable values are not cached, and that a too small buffer doesn't
+ * invalidate the cache
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestUnavailable
+(
+    void
+)
+{
+    char buf[BUF_SIZE];
+    size_t len;
+
+    MsisdnResult = LE_FAULT;
+    SimStateHandler(LE_SIM_EXTERNAL_SLOT_1, LE_SIM_ABSENT, NULL);
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_GENERAL_ERROR == lwm2mcore_GetMsisdn(buf, &len));
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_GENERAL_ERROR == lwm2mcore_GetMsisdn(buf, &len));
+    LE_TEST(5 == MsisdnCount);
+
+    MsisdnResult = LE_OK;
+    CheckResource(lwm2mcore_GetMsisdn, Msisdn);
+    CheckResource(lwm2mcore_GetMsisdn, Msisdn);
+    LE_TEST(6 == MsisdnCount);
+
+    len = 4;
+    LE_TEST(LWM2MCORE_ERR_OVERFLOW == lwm2mcore_GetDeviceImei(buf, &len));
+    len = 4;
+    LE_TEST(LWM2MCORE_ERR_OVERFLOW == lwm2mcore_GetDeviceFirmwareVersion(buf, &len));
+    CheckResource(lwm2mcore_GetDeviceImei, "359377060000001");
+    LE_TEST(2 == ImeiCount);
+    LE_TEST(2 == FirmwareVersionCount);
+}
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    TestCollect();
+    TestInvalidate();
+    TestUnavailable();
+
+    LE_TEST_EXIT;
+}
@@ -0,0 +1,268 @@
+/**
+ * This program tests the location snapshot of the LWM2M location object, with a GNSS stub: all
+ * the resources of an object read come from the same fix, and cost a single sample request.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+#include <lwm2mcore/location.h>
+
+// Snapshot validity of osPortLocation.c
+#define SNAPSHOT_VALIDITY_MS    1000
+
+#define BUF_SIZE                32
+#define SAMPLE_REF              ((le_gnss_SampleRef_t)0x1234)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * GNSS stub: each sample request returns a new fix, whose values are all derived from its number
+ */
+//--------------------------------------------------------------------------------------------------
+static int32_t FixId;
+static int SampleCount;
+static int GetterCount;
+static int ReleaseCount;
+static bool NoSample;
+static bool NoAltitude;
+
+le_gnss_SampleRef_t le_gnss_GetLastSampleRef
+(
+    void
+)
+{
+    SampleCount++;
+    if (NoSample)
+    {
+        return NULL;
+    }
+    FixId++;
+    return SAMPLE_REF;
+}
+
+void le_gnss_ReleaseSampleRef
+(
+    le_gnss_SampleRef_t positionSampleRef
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    ReleaseCount++;
+}
+
+le_result_t le_gnss_GetLocation
+(
+    le_gnss_SampleRef_t positionSampleRef,
+    int32_t* latitudePtr,
+    int32_t* longitudePtr,
+    int32_t* hAccuracyPtr
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    GetterCount++;
+    *latitudePtr = FixId * 1000000;
+    *longitudePtr = -FixId * 2000000;
+    *hAccuracyPtr = 100;
+    return LE_OK;
+}
+
+le_result_t le_gnss_GetAltitude
+(
+    le_gnss_SampleRef_t positionSampleRef,
+    int32_t* altitudePtr,
+    int32_t* vAccuracyPtr
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    GetterCount++;
+    if (NoAltitude)
+    {
+        *altitudePtr = INT32_MAX;
+        *vAccuracyPtr = INT32_MAX;
+        return LE_OUT_OF_RANGE;
+    }
+    *altitudePtr = FixId * 3000;
+    *vAccuracyPtr = 10;
+    return LE_OK;
+}
+
+le_result_t le_gnss_GetDirection
+(
+    le_gnss_SampleRef_t positionSampleRef,
+    uint32_t* directionPtr,
+    uint32_t* directionAccuracyPtr
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    GetterCount++;
+    *directionPtr = FixId * 40;
+    *directionAccuracyPtr = 10;
+    return LE_OK;
+}
+
+le_result_t le_gnss_GetHorizontalSpeed
+(
+    le_gnss_SampleRef_t positionSampleRef,
+    uint32_t* hspeedPtr,
+    uint32_t* hspeedAccuracyPtr
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    GetterCount++;
+    *hspeedPtr = FixId * 500;
+    *hspeedAccuracyPtr = 10;
+    return LE_OK;
+}
+
+le_result_t le_gnss_GetVerticalSpeed
+(
+    le_gnss_SampleRef_t positionSampleRef,
+    int32_t* vspeedPtr,
+    int32_t* vspeedAccuracyPtr
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    GetterCount++;
+    *vspeedPtr = -FixId * 600;
+    *vspeedAccuracyPtr = 10;
+    return LE_OK;
+}
+
+le_result_t le_gnss_GetEpochTime
+(
+    le_gnss_SampleRef_t positionSampleRef,
+    uint64_t* millisecondsPtr
+)
+{
+    LE_ASSERT(SAMPLE_REF == positionSampleRef);
+    GetterCount++;
+    *millisecondsPtr = (uint64_t)FixId * 7000;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the whole location object and check that all its resources come from the given fix
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadObject
+(
+    int32_t fixId
+)
+{
+    char buf[BUF_SIZE];
+    char expected[BUF_SIZE];
+    size_t len;
+    uint32_t value;
+    int32_t signedValue;
+    uint64_t timestamp;
+
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetLatitude(buf, &len));
+    snprintf(expected, sizeof(expected), "%d.000000", fixId);
+    LE_TEST(0 == strcmp(buf, expected));
+
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetLongitude(buf, &len));
+    snprintf(expected, sizeof(expected), "%d.000000", -2 * fixId);
+    LE_TEST(0 == strcmp(buf, expected));
+
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetAltitude(buf, &len));
+    snprintf(expected, sizeof(expected), "%d", 3 * fixId);
+    LE_TEST(0 == strcmp(buf, expected));
+
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetDirection(&value));
+    LE_TEST(4 * fixId == value);
+
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetHorizontalSpeed(&value));
+    LE_TEST(5 * fixId == value);
+
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetVerticalSpeed(&signedValue));
+    LE_TEST(-6 * fixId == signedValue);
+
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetLocationTimestamp(&timestamp));
+    LE_TEST(7 * (uint64_t)fixId == timestamp);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the end of the snapshot validity
+ */
+//--------------------------------------------------------------------------------------------------
+static void WaitSnapshotExpiry
+(
+    void
+)
+{
+    usleep((SNAPSHOT_VALIDITY_MS + 100) * 1000);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test that an object read costs a single sample request and is consistent
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestSnapshot
+(
+    void
+)
+{
+    ReadObject(1);
+    LE_TEST(1 == SampleCount);
+    LE_TEST(6 == GetterCount);
+    LE_TEST(1 == ReleaseCount);
+
+    // A second read in the validity window is served from the same snapshot
+    ReadObject(1);
+    LE_TEST(1 == SampleCount);
+
+    // The next read after the validity window gets a new fix
+    WaitSnapshotExpiry();
+    ReadObject(2);
+    LE_TEST(2 == SampleCount);
+    LE_TEST(12 == GetterCount);
+    LE_TEST(2 == ReleaseCount);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the unavailable values
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestUnavailable
+(
+    void
+)
+{
+    char buf[BUF_SIZE];
+    size_t len;
+    uint64_t timestamp;
+
+    WaitSnapshotExpiry();
+    NoAltitude = true;
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_NOT_YET_IMPLEMENTED == lwm2mcore_GetAltitude(buf, &len));
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_COMPLETED_OK == lwm2mcore_GetLatitude(buf, &len));
+    NoAltitude = false;
+
+    WaitSnapshotExpiry();
+    NoSample = true;
+    len = sizeof(buf);
+    LE_TEST(LWM2MCORE_ERR_GENERAL_ERROR == lwm2mcore_GetLatitude(buf, &len));
+    LE_TEST(LWM2MCORE_ERR_NOT_YET_IMPLEMENTED == lwm2mcore_GetLocationTimestamp(&timestamp));
+    NoSample = false;
+
+    LE_TEST(SampleCount == ReleaseCount + 1);
+}
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    TestSnapshot();
+    TestUnavailable();
+
+    LE_TEST_EXIT;
+}
@@ -0,0 +1,203 @@
+/**
+ * This program tests the LWM2M debug adaptation layer: packet trace ring, and cost of the packet
+ * logs when the debug messages are filtered out or logged.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+#include <lwm2mcore/lwm2mcore.h>
+#include "avcClient.h"
+#include <endian.h>
+
+// Trace configuration of osDebug.c
+#define PACKET_TRACE_KEYWORD    "lwm2mPackets"
+#define TRACE_RING_COUNT        64
+#define TRACE_DESC_LEN          32
+#define TRACE_DATA_LEN          1280
+#define TRACE_FILE_MAGIC        "LWM2MTR1"
+
+#define TRACE_FILE_PATH         "/tmp/lwm2mDebugTest.bin"
+#define LONG_PACKET_LEN         2000
+#define BENCH_PACKET_LEN        1024
+#define BENCH_COUNT_OFF         10000
+#define BENCH_COUNT_ON          20
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adaptation functions of osDebug.c
+ */
+//--------------------------------------------------------------------------------------------------
+void lwm2m_printf(const char * format, ...);
+void lwm2mcore_DataDump(char *descPtr, void *addrPtr, int len);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Saved trace record header, little-endian
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint64_t timeMs;
+    uint32_t len;
+    uint32_t dataLen;
+    char     desc[TRACE_DESC_LEN];
+}
+RecordHeader_t;
+
+static uint8_t Packet[LONG_PACKET_LEN];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill the packet with a pattern depending on its number
+ */
+//--------------------------------------------------------------------------------------------------
+static void FillPacket
+(
+    uint32_t packetId,
+    size_t len
+)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        Packet[i] = (uint8_t)(packetId + i);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the packet trace ring: the newest packets are saved from the oldest to the newest
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestPacketTrace
+(
+    void
+)
+{
+    le_log_TraceRef_t traceRef = le_log_GetTraceRef(PACKET_TRACE_KEYWORD);
+    uint32_t packetCount = TRACE_RING_COUNT + 4;
+    uint32_t header[2];
+    RecordHeader_t record;
+    char magic[sizeof(TRACE_FILE_MAGIC) - 1];
+    uint8_t data[TRACE_DATA_LEN];
+    char desc[TRACE_DESC_LEN];
+    struct stat st;
+    uint32_t i;
+    size_t len;
+    FILE* filePtr;
+
+    // Nothing is recorded while the trace is disabled
+    FillPacket(0, 16);
+    lwm2mcore_DataDump("disabled", Packet, 16);
+    LE_TEST(LE_NOT_FOUND == avcClient_SavePacketTrace(TRACE_FILE_PATH));
+
+    le_log_EnableTrace(traceRef);
+    for (i = 0; i < packetCount; i++)
+    {
+        len = (i == (packetCount - 1)) ? LONG_PACKET_LEN : (10 + i);
+        FillPacket(i, len);
+        snprintf(desc, sizeof(desc), "packet %u", i);
+        lwm2mcore_DataDump(desc, Packet, len);
+    }
+    le_log_DisableTrace(traceRef);
+
+    // A file left with wider permissions is restricted to the service
+    filePtr = fopen(TRACE_FILE_PATH, "w");
+    LE_ASSERT(NULL != filePtr);
+    fclose(filePtr);
+    LE_ASSERT(0 == chmod(TRACE_FILE_PATH, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+
+    LE_TEST(LE_OK == avcClient_SavePacketTrace(TRACE_FILE_PATH));
+    LE_ASSERT(0 == stat(TRACE_FILE_PATH, &st));
+    LE_TEST((S_IRUSR | S_IWUSR) == (st.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO)));
+
+    filePtr = fopen(TRACE_FILE_PATH, "r");
+    LE_ASSERT(NULL != filePtr);
+    LE_ASSERT(1 == fread(magic, sizeof(magic), 1, filePtr));
+    LE_TEST(0 == memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)));
+    LE_ASSERT(1 == fread(header, sizeof(header), 1, filePtr));
+    LE_TEST(TRACE_RING_COUNT == le32toh(header[0]));
+
+    for (i = packetCount - TRACE_RING_COUNT; i < packetCount; i++)
+    {
+        len = (i == (packetCount - 1)) ? LONG_PACKET_LEN : (10 + i);
+        LE_ASSERT(1 == fread(&record, sizeof(record), 1, filePtr));
+        snprintf(desc, sizeof(desc), "packet %u", i);
+        LE_TEST(0 == strcmp(record.desc, desc));
+        LE_TEST(len == le32toh(record.len));
+        record.dataLen = le32toh(record.dataLen);
+        LE_TEST(((len < TRACE_DATA_LEN) ? len : TRACE_DATA_LEN) == record.dataLen);
+        LE_ASSERT(1 == fread(data, record.dataLen, 1, filePtr));
+        FillPacket(i, record.dataLen);
+        LE_TEST(0 == memcmp(data, Packet, record.dataLen));
+    }
+    LE_TEST(0 == fread(data, 1, 1, filePtr));
+
+    fclose(filePtr);
+    unlink(TRACE_FILE_PATH);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Log a packet as the LWM2M core does on each received packet, and return the time per packet
+ * in ns
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t LogPackets
+(
+    uint32_t count
+)
+{
+    le_clk_Time_t start = le_clk_GetRelativeTime();
+    le_clk_Time_t duration;
+    uint32_t i;
+
+    FillPacket(0, BENCH_PACKET_LEN);
+    for (i = 0; i < count; i++)
+    {
+        lwm2m_printf("[%s:%d] %d bytes received from the server\r\n",
+                     __func__, __LINE__, BENCH_PACKET_LEN);
+        lwm2mcore_DataDump("received bytes", Packet, BENCH_PACKET_LEN);
+    }
+
+    duration = le_clk_Sub(le_clk_GetRelativeTime(), start);
+    return (((uint64_t)duration.sec * 1000000000) + ((uint64_t)duration.usec * 1000)) / count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the cost of the packet logs when the debug messages are filtered out and logged
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestLogCost
+(
+    void
+)
+{
+    uint64_t offNs;
+    uint64_t onNs;
+
+    le_log_SetFilterLevel(LE_LOG_INFO);
+    offNs = LogPackets(BENCH_COUNT_OFF);
+
+    le_log_SetFilterLevel(LE_LOG_DEBUG);
+    onNs = LogPackets(BENCH_COUNT_ON);
+    le_log_SetFilterLevel(LE_LOG_INFO);
+
+    LE_INFO("Log of a %d-byte packet: %"PRIu64" ns with debug off, %"PRIu64" ns with debug on",
+            BENCH_PACKET_LEN, offNs, onNs);
+    LE_TEST(offNs < onNs);
+}
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    TestPacketTrace();
+    TestLogCost();
+
+    LE_TEST_EXIT;
+}
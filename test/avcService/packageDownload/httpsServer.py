@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+#
+# HTTPS server for the package download test.
+#
+# It serves generated packages at /package/<size>, with Range requests and persistent connections,
+# and reports its counters at /stats. An emulated round-trip time is added to each new connection,
+# to each full TLS handshake and to each request, so that the time to first byte of the client
+# reflects the number of round trips it needs.
+#
+# Copyright (C) Sierra Wireless Inc.
+#
+
+import argparse
+import http.server
+import re
+import socketserver
+import ssl
+import sys
+import threading
+import time
+
+Stats = {"connections": 0, "handshakes": 0, "resumed": 0, "requests": 0}
+StatsLock = threading.Lock()
+
+
+def count(name):
+    with StatsLock:
+        Stats[name] += 1
+
+
+def package(size):
+    """Package content, the test client checks the same pattern."""
+    return bytes(((i * 31) + (i >> 10)) & 0xFF for i in range(size))
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    packages = {}
+
+    def setup(self):
+        count("connections")
+        time.sleep(self.server.rtt)
+        self.request.do_handshake()
+        count("handshakes")
+        if self.request.session_reused:
+            count("resumed")
+        else:
+            time.sleep(self.server.rtt)
+        super().setup()
+
+    def send_body(self, code, body, headers=()):
+        self.send_response(code)
+        for name, value in headers:
+            self.send_header(name, value)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        count("requests")
+        time.sleep(self.server.rtt)
+
+        if self.path == "/stats":
+            with StatsLock:
+                body = " ".join("%s=%d" % (k, Stats[k])
+                                for k in ("connections", "handshakes", "resumed", "requests"))
+            self.send_body(200, body.encode())
+            return
+
+        match = re.fullmatch(r"/package/(\d+)", self.path)
+        if not match:
+            self.send_body(404, b"")
+            return
+
+        size = int(match.group(1))
+        if size not in self.packages:
+            self.packages[size] = package(size)
+        data = self.packages[size]
+
+        match = re.fullmatch(r"bytes=(\d+)-", self.headers.get("Range", ""))
+        if match and int(match.group(1)) < size:
+            first = int(match.group(1))
+            self.send_body(206, data[first:],
+                           [("Content-Range", "bytes %d-%d/%d" % (first, size - 1, size))])
+        else:
+            self.send_body(200, data)
+
+    def log_message(self, format, *args):
+        pass
+
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+    def handle_error(self, request, client_address):
+        # Handshakes rejected by the client are expected by the test
+        if not isinstance(sys.exc_info()[1], ssl.SSLError):
+            super().handle_error(request, client_address)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTPS server for the package download test.")
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--cert", required=True, help="server certificate (PEM)")
+    parser.add_argument("--key", required=True, help="server private key (PEM)")
+    parser.add_argument("--rtt", type=int, default=50, help="emulated round-trip time in ms")
+    args = parser.parse_args()
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(args.cert, args.key)
+
+    server = Server(("localhost", args.port), Handler)
+    server.rtt = args.rtt / 1000.0
+    server.socket = context.wrap_socket(server.socket, server_side=True,
+                                        do_handshake_on_connect=False)
+    print("listening on port %d" % args.port, flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,458 @@
+/**
+ * This program tests the package download callbacks against the local HTTPS server of
+ * httpsServer.py: single GET request, connection and TLS session reuse, resume, in-memory trust
+ * anchors. It logs the time to first byte of each download.
+ *
+ * Usage: packageDownloadTest <server URL> <server certificate>
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include <curl/curl.h>
+#include <lwm2mcore/update.h>
+#include <lwm2mcorePackageDownloader.h>
+#include "packageDownloader.h"
+#include "packageDownloaderCallbacks.h"
+#include "sslUtilities.h"
+#include "avcServer.h"
+
+#define PACKAGE_SIZE        (1024*1024)
+#define MISMATCH_OFFSET     1000
+#define BUF_SIZE            256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Server counters
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int connections;
+    int handshakes;
+    int resumed;
+    int requests;
+}
+ServerStats_t;
+
+static const char* ServerUrlPtr;
+static char Cert[MAX_CERT_LEN];
+static size_t CertLen;
+static bool HasCert;
+
+static bool Suspend;
+static uint64_t SuspendAt;
+static uint64_t Received;
+static uint64_t Mismatches;
+static bool FirstByte;
+static le_clk_Time_t StartTime;
+static le_clk_Time_t FirstByteTime;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Package content, see httpsServer.py
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t PackageByte
+(
+    uint64_t offset
+)
+{
+    return (uint8_t)((offset * 31) + (offset >> 10));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stubs of the package downloader and LWM2MCore functions used by the callbacks
+ */
+//--------------------------------------------------------------------------------------------------
+bool packageDownloader_CurrentDownloadToAbort
+(
+    void
+)
+{
+    return false;
+}
+
+bool packageDownloader_CheckDownloadToSuspend
+(
+    void
+)
+{
+    return Suspend;
+}
+
+le_result_t packageDownloader_SetUpdatePackageSize
+(
+    uint64_t size
+)
+{
+    return LE_OK;
+}
+
+le_result_t packageDownloader_SetFwUpdateState
+(
+    lwm2mcore_FwUpdateState_t fwUpdateState
+)
+{
+    return LE_OK;
+}
+
+le_result_t packageDownloader_SetFwUpdateResult
+(
+    lwm2mcore_FwUpdateResult_t fwUpdateResult
+)
+{
+    return LE_OK;
+}
+
+le_result_t avcServer_QueryDownload
+(
+    avcServer_DownloadHandlerFunc_t handlerFunc,
+    uint64_t bytesToDownload
+)
+{
+    return LE_OK;
+}
+
+void lwm2mcore_PackageDownloaderAcceptDownload
+(
+    void
+)
+{
+}
+
+lwm2mcore_DwlResult_t lwm2mcore_PackageDownloaderReceiveData
+(
+    uint8_t* bufPtr,
+    size_t bufSize
+)
+{
+    size_t i;
+
+    if (!FirstByte)
+    {
+        FirstByteTime = le_clk_GetRelativeTime();
+        FirstByte = true;
+    }
+
+    for (i = 0; i < bufSize; i++)
+    {
+        if (bufPtr[i] != PackageByte(Received + i))
+        {
+            Mismatches++;
+        }
+    }
+    Received += bufSize;
+
+    if (SuspendAt && (Received >= SuspendAt))
+    {
+        Suspend = true;
+    }
+
+    return DWL_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Certificate file stubs used by ssl_CheckCertificate(): the saved certificate is the server one
+ * when HasCert is set, the default certificate is used otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t ExistsFs
+(
+    char* pathPtr
+)
+{
+    return HasCert ? LE_OK : LE_NOT_FOUND;
+}
+
+le_result_t ReadFs
+(
+    const char* pathPtr,
+    uint8_t* bufPtr,
+    size_t* sizePtr
+)
+{
+    LE_ASSERT(*sizePtr >= CertLen);
+    memcpy(bufPtr, Cert, CertLen);
+    *sizePtr = CertLen;
+    return LE_OK;
+}
+
+le_result_t WriteFs
+(
+    const char* pathPtr,
+    uint8_t* bufPtr,
+    size_t size
+)
+{
+    LE_ASSERT(size <= sizeof(Cert));
+    memcpy(Cert, bufPtr, size);
+    CertLen = size;
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the server certificate as the saved certificate
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadServerCertificate
+(
+    const char* pathPtr
+)
+{
+    FILE* filePtr = fopen(pathPtr, "r");
+
+    LE_ASSERT(filePtr);
+    CertLen = fread(Cert, 1, sizeof(Cert), filePtr);
+    fclose(filePtr);
+    LE_ASSERT(CertLen > 0);
+
+    HasCert = true;
+    LE_ASSERT(LE_OK == ssl_CheckCertificate());
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Collect the /stats response
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t WriteStats
+(
+    void* contentsPtr,
+    size_t size,
+    size_t nmemb,
+    void* contextPtr
+)
+{
+    char* bufPtr = (char*)contextPtr;
+    size_t len = strlen(bufPtr);
+    size_t count = size * nmemb;
+
+    if (len + count < BUF_SIZE)
+    {
+        memcpy(bufPtr + len, contentsPtr, count);
+    }
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the server counters. The request is sent on its own connection, and counts itself.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetStats
+(
+    ServerStats_t* statsPtr
+)
+{
+    char url[BUF_SIZE];
+    char buf[BUF_SIZE] = {0};
+    CURL* curlPtr = curl_easy_init();
+
+    LE_ASSERT(curlPtr);
+    snprintf(url, sizeof(url), "%s/stats", ServerUrlPtr);
+    curl_easy_setopt(curlPtr, CURLOPT_URL, url);
+    curl_easy_setopt(curlPtr, CURLOPT_CAINFO, le_arg_GetArg(1));
+    curl_easy_setopt(curlPtr, CURLOPT_WRITEFUNCTION, WriteStats);
+    curl_easy_setopt(curlPtr, CURLOPT_WRITEDATA, buf);
+    LE_ASSERT(CURLE_OK == curl_easy_perform(curlPtr));
+    curl_easy_cleanup(curlPtr);
+
+    LE_ASSERT(4 == sscanf(buf, "connections=%d handshakes=%d resumed=%d requests=%d",
+                          &statsPtr->connections, &statsPtr->handshakes,
+                          &statsPtr->resumed, &statsPtr->requests));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a download through the callbacks, the way the package downloader does
+ *
+ * @return the download result
+ */
+//--------------------------------------------------------------------------------------------------
+static lwm2mcore_DwlResult_t Download
+(
+    const char* pathPtr,            ///< [IN] Package path on the server
+    uint64_t initOffset,            ///< [IN] Offset expected by pkgDwlCb_InitDownload()
+    uint64_t startOffset,           ///< [IN] Offset given to pkgDwlCb_Download()
+    uint64_t* packageSizePtr,       ///< [OUT] Package size
+    uint32_t* ttfbMsPtr             ///< [OUT] Time to first byte in milliseconds
+)
+{
+    packageDownloader_DownloadCtx_t dwlCtx;
+    lwm2mcore_PackageDownloaderData_t data;
+    lwm2mcore_DwlResult_t result;
+    char url[BUF_SIZE];
+    le_clk_Time_t ttfb;
+
+    memset(&dwlCtx, 0, sizeof(dwlCtx));
+    dwlCtx.startOffset = initOffset;
+    memset(&data, 0, sizeof(data));
+    data.updateType = LWM2MCORE_SW_UPDATE_TYPE;
+
+    snprintf(url, sizeof(url), "%s%s", ServerUrlPtr, pathPtr);
+    Received = startOffset;
+    Mismatches = 0;
+    FirstByte = false;
+    StartTime = le_clk_GetRelativeTime();
+
+    result = pkgDwlCb_InitDownload(url, &dwlCtx);
+    if (DWL_OK == result)
+    {
+        LE_ASSERT(DWL_OK == pkgDwlCb_GetInfo(&data, &dwlCtx));
+        *packageSizePtr = data.packageSize;
+        result = pkgDwlCb_Download(startOffset, &dwlCtx);
+    }
+    pkgDwlCb_EndDownload(&dwlCtx);
+
+    ttfb = le_clk_Sub(FirstByteTime, StartTime);
+    *ttfbMsPtr = FirstByte ? (uint32_t)(ttfb.sec * 1000 + ttfb.usec / 1000) : 0;
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test a first download then a second one, on the same connection
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestDownload
+(
+    const char* pathPtr
+)
+{
+    ServerStats_t before;
+    ServerStats_t after;
+    uint64_t size = 0;
+    uint32_t firstTtfb;
+    uint32_t secondTtfb;
+
+    GetStats(&before);
+    LE_TEST(DWL_OK == Download(pathPtr, 0, 0, &size, &firstTtfb));
+    LE_TEST(PACKAGE_SIZE == size);
+    LE_TEST(PACKAGE_SIZE == Received);
+    LE_TEST(0 == Mismatches);
+    GetStats(&after);
+
+    // A single GET request, on a new connection
+    LE_TEST(2 == after.requests - before.requests);
+    LE_TEST(2 == after.connections - before.connections);
+
+    before = after;
+    LE_TEST(DWL_OK == Download(pathPtr, 0, 0, &size, &secondTtfb));
+    LE_TEST(PACKAGE_SIZE == Received);
+    LE_TEST(0 == Mismatches);
+    GetStats(&after);
+
+    // The connection is reused
+    LE_TEST(2 == after.requests - before.requests);
+    LE_TEST(1 == after.connections - before.connections);
+
+    LE_INFO("Time to first byte: first download %u ms, next download %u ms",
+            firstTtfb, secondTtfb);
+    LE_TEST(secondTtfb < firstTtfb);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test a suspended download and its resume, on a new connection resuming the TLS session
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestResume
+(
+    const char* pathPtr
+)
+{
+    ServerStats_t before;
+    ServerStats_t after;
+    uint64_t size = 0;
+    uint64_t offset;
+    uint32_t ttfb;
+
+    SuspendAt = PACKAGE_SIZE / 2;
+    LE_TEST(DWL_OK == Download(pathPtr, 0, 0, &size, &ttfb));
+    offset = Received;
+    LE_TEST((offset >= SuspendAt) && (offset < PACKAGE_SIZE));
+    LE_TEST(0 == Mismatches);
+    SuspendAt = 0;
+    Suspend = false;
+
+    GetStats(&before);
+    LE_TEST(DWL_OK == Download(pathPtr, offset, offset, &size, &ttfb));
+    LE_TEST(PACKAGE_SIZE == size);
+    LE_TEST(PACKAGE_SIZE == Received);
+    LE_TEST(0 == Mismatches);
+    GetStats(&after);
+
+    LE_TEST(2 == after.requests - before.requests);
+    LE_TEST(1 <= after.resumed - before.resumed);
+    LE_INFO("Time to first byte: resume at %"PRIu64" %u ms", offset, ttfb);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test a download started at another offset than the one expected at initialization
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestOffsetMismatch
+(
+    const char* pathPtr
+)
+{
+    ServerStats_t before;
+    ServerStats_t after;
+    uint64_t size = 0;
+    uint32_t ttfb;
+
+    GetStats(&before);
+    LE_TEST(DWL_OK == Download(pathPtr, 0, MISMATCH_OFFSET, &size, &ttfb));
+    LE_TEST(PACKAGE_SIZE == Received);
+    LE_TEST(0 == Mismatches);
+    GetStats(&after);
+
+    LE_TEST(3 == after.requests - before.requests);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the download errors: HTTP error, untrusted server after a certificate change
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestErrors
+(
+    const char* pathPtr
+)
+{
+    uint64_t size = 0;
+    uint32_t ttfb;
+
+    LE_TEST(DWL_FAULT == Download("/missing", 0, 0, &size, &ttfb));
+
+    // Back to the default certificate: the kept connection and TLS session must not be used
+    HasCert = false;
+    LE_ASSERT(LE_OK == ssl_CheckCertificate());
+    LE_TEST(DWL_OK != Download(pathPtr, 0, 0, &size, &ttfb));
+    LE_TEST(0 == Received);
+}
+
+COMPONENT_INIT
+{
+    char path[BUF_SIZE];
+
+    LE_TEST_INIT;
+
+    LE_ASSERT(2 == le_arg_NumArgs());
+    ServerUrlPtr = le_arg_GetArg(0);
+    LoadServerCertificate(le_arg_GetArg(1));
+
+    snprintf(path, sizeof(path), "/package/%d", PACKAGE_SIZE);
+    TestDownload(path);
+    TestResume(path);
+    TestOffsetMismatch(path);
+    TestErrors(path);
+
+    LE_TEST_EXIT;
+}
@@ -41,6 +41,7 @@
 
 #include "legato.h"
 #include "le_data_interface.h"
+#include "netConfig.h"
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -216,21 +217,16 @@ static void SetMdcDefaultRoute
     le_mdc_ProfileRef_t profileRef
 )
 {
-    char ipv4GwAddr[LE_MDC_IPV4_ADDR_MAX_BYTES] = {0};
-    char ipv6GwAddr[LE_MDC_IPV6_ADDR_MAX_BYTES] = {0};
-    char systemCmd[MAX_SYSTEM_CMD_LENGTH] = {0};
+    char gwAddr[LE_MDC_IPV6_ADDR_MAX_BYTES] = {0};
 
     // Get IP gateway for IPv4 or IPv6 connectivity
     if (le_mdc_IsIPv4(profileRef))
     {
-        LE_ASSERT_OK(le_mdc_GetIPv4GatewayAddress(profileRef, ipv4GwAddr, sizeof(ipv4GwAddr)));
-        snprintf(systemCmd, sizeof(systemCmd), "/sbin/route add default gw %s", ipv4GwAddr);
+        LE_ASSERT_OK(le_mdc_GetIPv4GatewayAddress(profileRef, gwAddr, sizeof(gwAddr)));
     }
     else if (le_mdc_IsIPv6(profileRef))
     {
-        LE_ASSERT_OK(le_mdc_GetIPv6GatewayAddress(profileRef, ipv6GwAddr, sizeof(ipv6GwAddr)));
-        snprintf(systemCmd, sizeof(systemCmd), "/sbin/route -A inet6 add default gw %s",
-                                                ipv6GwAddr);
+        LE_ASSERT_OK(le_mdc_GetIPv6GatewayAddress(profileRef, gwAddr, sizeof(gwAddr)));
     }
     else
     {
@@ -238,8 +234,9 @@ static void SetMdcDefaultRoute
         exit(EXIT_FAILURE);
     }
 
-    LE_DEBUG("Trying to execute '%s'", systemCmd);
-    LE_ASSERT(0 == system(systemCmd));
+    // The route is set over rtnetlink, without forking /sbin/route
+    LE_DEBUG("Setting default route through gateway '%s'", gwAddr);
+    LE_ASSERT_OK(netConfig_SetDefaultRoute(gwAddr, NULL));
 }
 //! [DefaultRoute]
 
@@ -255,8 +252,7 @@ static void SetMdcDefaultDns
 {
     char dns1Addr[LE_MDC_IPV6_ADDR_MAX_BYTES] = {0};
     char dns2Addr[LE_MDC_IPV6_ADDR_MAX_BYTES] = {0};
-    FILE* resolvFilePtr;
-    mode_t oldMask;
+    le_result_t result;
 
     // Get DNS addresses for IPv4 or IPv6 connectivity
     if (le_mdc_IsIPv4(profileRef))
@@ -277,28 +273,9 @@ static void SetMdcDefaultDns
         exit(EXIT_FAILURE);
     }
 
-    // Allow fopen to create file with mode=644
-    oldMask = umask(022);
-
-    // Open the resolver configuration
-    resolvFilePtr = fopen("/etc/resolv.conf", "w+");
-    if (!resolvFilePtr)
-    {
-        LE_ERROR("Unable to open resolv.conf: %m");
-        exit(EXIT_FAILURE);
-    }
-    if (dns1Addr[0] != '\0')
-    {
-        LE_ASSERT(fprintf(resolvFilePtr, "nameserver %s\n", dns1Addr) > 0);
-    }
-    if (dns2Addr[0] != '\0')
-    {
-        LE_ASSERT(fprintf(resolvFilePtr, "nameserver %s\n", dns2Addr) > 0);
-    }
-    LE_ASSERT(0 == fclose(resolvFilePtr));
-
-    // Restore old mask
-    umask(oldMask);
+    // The resolver configuration is only rewritten when the DNS servers change
+    result = netConfig_SetDns(NETCONFIG_RESOLV_CONF_PATH, dns1Addr, dns2Addr);
+    LE_ASSERT((LE_OK == result) || (LE_DUPLICATE == result));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -578,6 +555,9 @@ COMPONENT_INIT
 
     LE_INFO("Running data connection service route test");
 
+    // Open the rtnetlink socket used to set the default route
+    LE_ASSERT_OK(netConfig_Init(-1));
+
     // Check if the default route is deactivated in DCS
     if (le_data_GetDefaultRouteStatus())
     {
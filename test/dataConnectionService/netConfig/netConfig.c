@@ -0,0 +1,724 @@
+/**
+ * @file netConfig.c
+ *
+ * Network configuration of a data connection without spawning shell commands.
+ *
+ * The routes and the interface addresses are changed with rtnetlink requests, which are
+ * acknowledged by the kernel, instead of forking /sbin/route or /sbin/ip. The resolver
+ * configuration is written in a temporary file which is then renamed, so that readers never see a
+ * partial file, and it is left untouched if the DNS servers didn't change. The directory is synced
+ * after the rename, so that the new file survives a power loss. When the temporary file can't be
+ * created next to the resolver configuration, e.g. in a read-only directory, the file is rewritten
+ * in place.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+
+#include "legato.h"
+#include "netConfig.h"
+
+#include <net/if.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer receiving the rtnetlink acknowledgements
+ */
+//--------------------------------------------------------------------------------------------------
+#define NETLINK_RSP_BYTES       1024
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time to wait for an rtnetlink acknowledgement, in seconds
+ */
+//--------------------------------------------------------------------------------------------------
+#define NETLINK_RSP_TIMEOUT_SEC 5
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum size of the resolver configuration
+ */
+//--------------------------------------------------------------------------------------------------
+#define RESOLV_CONF_MAX_BYTES   256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Route request: rtnetlink header, route message and room for the gateway and interface
+ * attributes
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    struct nlmsghdr hdr;        ///< rtnetlink header
+    struct rtmsg    rt;         ///< Route message
+    uint8_t         attrs[64];  ///< Route attributes
+}
+RouteRequest_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Address request: rtnetlink header, address message and room for the address attributes
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    struct nlmsghdr  hdr;       ///< rtnetlink header
+    struct ifaddrmsg ifa;       ///< Address message
+    uint8_t          attrs[64]; ///< Address attributes
+}
+AddressRequest_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * IPv4 or IPv6 address
+ */
+//--------------------------------------------------------------------------------------------------
+typedef union
+{
+    struct in_addr  v4;         ///< IPv4 address
+    struct in6_addr v6;         ///< IPv6 address
+}
+IpAddr_t;
+
+//--------------------------------------------------------------------------------------------------
+// Static declarations
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Socket the rtnetlink requests are sent to
+ */
+//--------------------------------------------------------------------------------------------------
+static int NetlinkFd = -1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sequence number of the last rtnetlink request
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t NetlinkSeq = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append an attribute to an rtnetlink request
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddAttribute
+(
+    struct nlmsghdr* hdrPtr,    ///< [IN] Request header
+    size_t           maxSize,   ///< [IN] Size of the request buffer
+    unsigned short   type,      ///< [IN] Attribute type
+    const void*      dataPtr,   ///< [IN] Attribute data
+    size_t           dataSize   ///< [IN] Attribute data size
+)
+{
+    struct rtattr* rtaPtr = (struct rtattr*)((uint8_t*)hdrPtr + NLMSG_ALIGN(hdrPtr->nlmsg_len));
+
+    LE_ASSERT(NLMSG_ALIGN(hdrPtr->nlmsg_len) + RTA_SPACE(dataSize) <= maxSize);
+
+    rtaPtr->rta_type = type;
+    rtaPtr->rta_len = RTA_LENGTH(dataSize);
+    memcpy(RTA_DATA(rtaPtr), dataPtr, dataSize);
+
+    hdrPtr->nlmsg_len = NLMSG_ALIGN(hdrPtr->nlmsg_len) + RTA_SPACE(dataSize);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send an rtnetlink request and wait for its acknowledgement
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if the route or the address of the request doesn't exist
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SendRequest
+(
+    struct nlmsghdr* hdrPtr     ///< [IN] Request to send
+)
+{
+    uint8_t rspBuffer[NETLINK_RSP_BYTES];
+
+    if (NetlinkFd < 0)
+    {
+        LE_ERROR("Network configuration not initialized");
+        return LE_FAULT;
+    }
+
+    hdrPtr->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+    hdrPtr->nlmsg_seq = ++NetlinkSeq;
+
+    if (send(NetlinkFd, hdrPtr, hdrPtr->nlmsg_len, 0) < 0)
+    {
+        LE_ERROR("Unable to send rtnetlink request: %m");
+        return LE_FAULT;
+    }
+
+    // Wait for the acknowledgement of this request, skipping the other messages
+    while (1)
+    {
+        struct nlmsghdr* rspPtr;
+        int len = recv(NetlinkFd, rspBuffer, sizeof(rspBuffer), 0);
+
+        if (len < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+            {
+                LE_ERROR("No acknowledgement of rtnetlink request %d", hdrPtr->nlmsg_type);
+                return LE_FAULT;
+            }
+            LE_ERROR("Unable to receive rtnetlink acknowledgement: %m");
+            return LE_FAULT;
+        }
+
+        for (rspPtr = (struct nlmsghdr*)rspBuffer; NLMSG_OK(rspPtr, len);
+             rspPtr = NLMSG_NEXT(rspPtr, len))
+        {
+            struct nlmsgerr* errPtr;
+
+            if ((rspPtr->nlmsg_seq != hdrPtr->nlmsg_seq) || (NLMSG_ERROR != rspPtr->nlmsg_type))
+            {
+                continue;
+            }
+
+            errPtr = NLMSG_DATA(rspPtr);
+            if (0 == errPtr->error)
+            {
+                return LE_OK;
+            }
+
+            LE_ERROR("rtnetlink request %d failed: %s", hdrPtr->nlmsg_type,
+                     strerror(-errPtr->error));
+
+            return ((-ESRCH == errPtr->error) || (-EADDRNOTAVAIL == errPtr->error)) ?
+                   LE_NOT_FOUND : LE_FAULT;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse an IPv4 or IPv6 address
+ *
+ * @return the address family, AF_UNSPEC if the address is invalid
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t ParseAddress
+(
+    const char* addrStrPtr,     ///< [IN] Address string
+    IpAddr_t*   addrPtr,        ///< [OUT] Address
+    size_t*     addrSizePtr     ///< [OUT] Address size
+)
+{
+    if ((NULL == addrStrPtr) || ('\0' == addrStrPtr[0]))
+    {
+        return AF_UNSPEC;
+    }
+
+    if (1 == inet_pton(AF_INET, addrStrPtr, &addrPtr->v4))
+    {
+        *addrSizePtr = sizeof(addrPtr->v4);
+        return AF_INET;
+    }
+
+    if (1 == inet_pton(AF_INET6, addrStrPtr, &addrPtr->v6))
+    {
+        *addrSizePtr = sizeof(addrPtr->v6);
+        return AF_INET6;
+    }
+
+    return AF_UNSPEC;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build and send a default route request
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the gateway address or the interface is invalid
+ *      - LE_NOT_FOUND if the route doesn't exist
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DefaultRouteRequest
+(
+    uint16_t    type,       ///< [IN] RTM_NEWROUTE or RTM_DELROUTE
+    uint16_t    flags,      ///< [IN] Request flags
+    const char* gwAddrPtr,  ///< [IN] Gateway IPv4 or IPv6 address
+    const char* ifNamePtr   ///< [IN] Interface name, NULL to only use the gateway
+)
+{
+    RouteRequest_t request;
+    IpAddr_t gwAddr;
+    size_t gwAddrSize;
+
+    memset(&request, 0, sizeof(request));
+
+    request.rt.rtm_family = ParseAddress(gwAddrPtr, &gwAddr, &gwAddrSize);
+    if (AF_UNSPEC == request.rt.rtm_family)
+    {
+        LE_ERROR("Invalid gateway address '%s'", gwAddrPtr ? gwAddrPtr : "");
+        return LE_BAD_PARAMETER;
+    }
+
+    request.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    request.hdr.nlmsg_type = type;
+    request.hdr.nlmsg_flags = flags;
+
+    // Default route: no destination
+    request.rt.rtm_dst_len = 0;
+    request.rt.rtm_table = RT_TABLE_MAIN;
+    request.rt.rtm_protocol = RTPROT_BOOT;
+    request.rt.rtm_scope = (RTM_DELROUTE == type) ? RT_SCOPE_NOWHERE : RT_SCOPE_UNIVERSE;
+    request.rt.rtm_type = RTN_UNICAST;
+
+    AddAttribute(&request.hdr, sizeof(request), RTA_GATEWAY, &gwAddr, gwAddrSize);
+
+    if (ifNamePtr)
+    {
+        uint32_t ifIndex = if_nametoindex(ifNamePtr);
+
+        if (0 == ifIndex)
+        {
+            LE_ERROR("Unknown interface '%s'", ifNamePtr);
+            return LE_BAD_PARAMETER;
+        }
+
+        AddAttribute(&request.hdr, sizeof(request), RTA_OIF, &ifIndex, sizeof(ifIndex));
+    }
+
+    return SendRequest(&request.hdr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build and send an interface address request
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the address, the prefix length or the interface is invalid
+ *      - LE_NOT_FOUND if the address doesn't exist
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t AddressRequest
+(
+    uint16_t    type,       ///< [IN] RTM_NEWADDR or RTM_DELADDR
+    uint16_t    flags,      ///< [IN] Request flags
+    const char* ifNamePtr,  ///< [IN] Interface name
+    const char* addrPtr,    ///< [IN] IPv4 or IPv6 address
+    uint8_t     prefixLen   ///< [IN] Prefix length of the subnet
+)
+{
+    AddressRequest_t request;
+    IpAddr_t addr;
+    size_t addrSize;
+    uint32_t ifIndex;
+
+    memset(&request, 0, sizeof(request));
+
+    request.ifa.ifa_family = ParseAddress(addrPtr, &addr, &addrSize);
+    if (AF_UNSPEC == request.ifa.ifa_family)
+    {
+        LE_ERROR("Invalid address '%s'", addrPtr ? addrPtr : "");
+        return LE_BAD_PARAMETER;
+    }
+
+    if (prefixLen > (addrSize * 8))
+    {
+        LE_ERROR("Invalid prefix length %u for '%s'", prefixLen, addrPtr);
+        return LE_BAD_PARAMETER;
+    }
+
+    ifIndex = (NULL == ifNamePtr) ? 0 : if_nametoindex(ifNamePtr);
+    if (0 == ifIndex)
+    {
+        LE_ERROR("Unknown interface '%s'", ifNamePtr ? ifNamePtr : "");
+        return LE_BAD_PARAMETER;
+    }
+
+    request.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    request.hdr.nlmsg_type = type;
+    request.hdr.nlmsg_flags = flags;
+
+    request.ifa.ifa_prefixlen = prefixLen;
+    request.ifa.ifa_scope = RT_SCOPE_UNIVERSE;
+    request.ifa.ifa_index = ifIndex;
+
+    // IFA_LOCAL is the address of the interface, IFA_ADDRESS the one used for IPv6 and for the
+    // peer of point-to-point links: they are the same here.
+    AddAttribute(&request.hdr, sizeof(request), IFA_LOCAL, &addr, addrSize);
+    AddAttribute(&request.hdr, sizeof(request), IFA_ADDRESS, &addr, addrSize);
+
+    return SendRequest(&request.hdr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sync the directory of a file, so that a file renamed in it survives a power loss
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SyncDirectory
+(
+    const char* pathPtr         ///< [IN] Path of a file of the directory
+)
+{
+    char dirPath[PATH_MAX];
+    int fd;
+
+    LE_ASSERT_OK(le_utf8_Copy(dirPath, pathPtr, sizeof(dirPath), NULL));
+
+    fd = open(dirname(dirPath), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to open the directory of '%s': %m", pathPtr);
+        return LE_FAULT;
+    }
+
+    if (0 != fsync(fd))
+    {
+        LE_ERROR("Unable to sync the directory of '%s': %m", pathPtr);
+        close(fd);
+        return LE_FAULT;
+    }
+
+    close(fd);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the resolver configuration in an opened file and sync it. The file is closed.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteContent
+(
+    int         fd,             ///< [IN] Opened file
+    const char* pathPtr,        ///< [IN] File path, for the logs
+    const char* contentPtr,     ///< [IN] Content to write
+    size_t      contentLen      ///< [IN] Content length
+)
+{
+    ssize_t len;
+
+    do
+    {
+        len = write(fd, contentPtr, contentLen);
+    }
+    while ((len < 0) && (EINTR == errno));
+
+    if ((len != contentLen) || (0 != fsync(fd)))
+    {
+        LE_ERROR("Unable to write '%s': %m", pathPtr);
+        close(fd);
+        return LE_FAULT;
+    }
+
+    close(fd);
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rewrite the resolver configuration in place, following the symbolic links
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteInPlace
+(
+    const char* pathPtr,        ///< [IN] File path
+    const char* contentPtr,     ///< [IN] Content to write
+    size_t      contentLen      ///< [IN] Content length
+)
+{
+    int fd = open(pathPtr, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to open '%s': %m", pathPtr);
+        return LE_FAULT;
+    }
+
+    return WriteContent(fd, pathPtr, contentPtr, contentLen);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Public functions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the network configuration
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT if the rtnetlink socket can't be opened or configured
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_Init
+(
+    int netlinkFd       ///< [IN] Socket to send the rtnetlink requests to, -1 to open an
+                        ///<      rtnetlink socket. Used by the unit tests to stub the kernel.
+)
+{
+    struct timeval timeout = { .tv_sec = NETLINK_RSP_TIMEOUT_SEC, .tv_usec = 0 };
+    bool isOpened = false;
+
+    if (netlinkFd < 0)
+    {
+        netlinkFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (netlinkFd < 0)
+        {
+            LE_ERROR("Unable to open rtnetlink socket: %m");
+            return LE_FAULT;
+        }
+        isOpened = true;
+    }
+
+    // Don't wait forever for an acknowledgement which never comes
+    if (0 != setsockopt(netlinkFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)))
+    {
+        LE_ERROR("Unable to set the rtnetlink socket timeout: %m");
+        if (isOpened)
+        {
+            close(netlinkFd);
+        }
+        return LE_FAULT;
+    }
+
+    NetlinkFd = netlinkFd;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the default route, replacing the current one if any
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the gateway address or the interface is invalid
+ *      - LE_FAULT if the route can't be set
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_SetDefaultRoute
+(
+    const char* gwAddrPtr,  ///< [IN] Gateway IPv4 or IPv6 address
+    const char* ifNamePtr   ///< [IN] Interface name, NULL to only use the gateway
+)
+{
+    return DefaultRouteRequest(RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, gwAddrPtr, ifNamePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the default route
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the gateway address or the interface is invalid
+ *      - LE_NOT_FOUND if the route doesn't exist
+ *      - LE_FAULT if the route can't be deleted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_DeleteDefaultRoute
+(
+    const char* gwAddrPtr,  ///< [IN] Gateway IPv4 or IPv6 address
+    const char* ifNamePtr   ///< [IN] Interface name, NULL to only use the gateway
+)
+{
+    return DefaultRouteRequest(RTM_DELROUTE, 0, gwAddrPtr, ifNamePtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an address to an interface, replacing it if it already exists
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the address, the prefix length or the interface is invalid
+ *      - LE_FAULT if the address can't be added
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_AddAddress
+(
+    const char* ifNamePtr,  ///< [IN] Interface name
+    const char* addrPtr,    ///< [IN] IPv4 or IPv6 address
+    uint8_t     prefixLen   ///< [IN] Prefix length of the subnet
+)
+{
+    return AddressRequest(RTM_NEWADDR, NLM_F_CREATE | NLM_F_REPLACE, ifNamePtr, addrPtr,
+                          prefixLen);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete an address of an interface
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the address, the prefix length or the interface is invalid
+ *      - LE_NOT_FOUND if the interface doesn't have this address
+ *      - LE_FAULT if the address can't be deleted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_DeleteAddress
+(
+    const char* ifNamePtr,  ///< [IN] Interface name
+    const char* addrPtr,    ///< [IN] IPv4 or IPv6 address
+    uint8_t     prefixLen   ///< [IN] Prefix length of the subnet
+)
+{
+    return AddressRequest(RTM_DELADDR, 0, ifNamePtr, addrPtr, prefixLen);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the DNS servers in a resolver configuration file
+ *
+ * The file is replaced atomically, and only if its content changes, then its directory is synced.
+ * If the path is a symbolic link, the file it points to is replaced. If the temporary file can't
+ * be created in the directory of this file, e.g. because it is read-only, the file is rewritten in
+ * place.
+ *
+ * @return
+ *      - LE_OK if the file has been written
+ *      - LE_DUPLICATE if the file already has this content
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_SetDns
+(
+    const char* resolvPathPtr,  ///< [IN] Resolver configuration file
+    const char* dns1AddrPtr,    ///< [IN] First DNS server address, empty if none
+    const char* dns2AddrPtr     ///< [IN] Second DNS server address, empty if none
+)
+{
+    char content[RESOLV_CONF_MAX_BYTES];
+    char currentContent[RESOLV_CONF_MAX_BYTES];
+    char destPath[PATH_MAX];
+    char tmpPath[PATH_MAX];
+    struct stat linkStat;
+    size_t contentLen = 0;
+    ssize_t currentLen = 0;
+    ssize_t len;
+    int fd;
+
+    content[0] = '\0';
+    if (dns1AddrPtr && dns1AddrPtr[0])
+    {
+        contentLen += snprintf(content + contentLen, sizeof(content) - contentLen,
+                               "nameserver %s\n", dns1AddrPtr);
+    }
+    if (dns2AddrPtr && dns2AddrPtr[0])
+    {
+        contentLen += snprintf(content + contentLen, sizeof(content) - contentLen,
+                               "nameserver %s\n", dns2AddrPtr);
+    }
+    LE_ASSERT(contentLen < sizeof(content));
+
+    // Compare with the current content, the file is left untouched if it doesn't change
+    fd = open(resolvPathPtr, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        do
+        {
+            len = read(fd, currentContent + currentLen, sizeof(currentContent) - currentLen);
+            if (len > 0)
+            {
+                currentLen += len;
+            }
+        }
+        while (((len > 0) && (currentLen < sizeof(currentContent))) ||
+               ((len < 0) && (EINTR == errno)));
+        close(fd);
+
+        if ((len >= 0) && (currentLen == contentLen) &&
+            (0 == memcmp(content, currentContent, contentLen)))
+        {
+            LE_DEBUG("'%s' unchanged", resolvPathPtr);
+            return LE_DUPLICATE;
+        }
+    }
+
+    // Replace the file the path points to, a symbolic link must not be replaced by a regular file
+    if (NULL == realpath(resolvPathPtr, destPath))
+    {
+        if (0 == lstat(resolvPathPtr, &linkStat))
+        {
+            // Dangling symbolic link: create its target
+            return WriteInPlace(resolvPathPtr, content, contentLen);
+        }
+
+        if ((ENOENT != errno) ||
+            (LE_OK != le_utf8_Copy(destPath, resolvPathPtr, sizeof(destPath), NULL)))
+        {
+            LE_ERROR("Unable to resolve '%s': %m", resolvPathPtr);
+            return LE_FAULT;
+        }
+    }
+
+    // Write a temporary file next to the destination, then rename it over the destination
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", destPath) >= sizeof(tmpPath))
+    {
+        LE_ERROR("Path too long '%s'", destPath);
+        return LE_FAULT;
+    }
+
+    fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        if ((EROFS == errno) || (EACCES == errno) || (EPERM == errno))
+        {
+            LE_DEBUG("Unable to create '%s' (%m), rewriting '%s' in place", tmpPath, destPath);
+            return WriteInPlace(destPath, content, contentLen);
+        }
+
+        LE_ERROR("Unable to open '%s': %m", tmpPath);
+        return LE_FAULT;
+    }
+
+    if (LE_OK != WriteContent(fd, tmpPath, content, contentLen))
+    {
+        unlink(tmpPath);
+        return LE_FAULT;
+    }
+
+    if (0 != rename(tmpPath, destPath))
+    {
+        LE_ERROR("Unable to replace '%s': %m", destPath);
+        unlink(tmpPath);
+        return LE_FAULT;
+    }
+
+    // The rename is only durable once the directory entry is on disk
+    return SyncDirectory(destPath);
+}
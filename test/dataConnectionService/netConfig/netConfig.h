@@ -0,0 +1,129 @@
+/**
+ * @file netConfig.h
+ *
+ * Network configuration of a data connection without spawning shell commands: the routes and the
+ * interface addresses are set through an rtnetlink socket, and the resolver configuration is
+ * written atomically, only when its content changes.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ *
+ */
+
+#ifndef NETCONFIG_H_INCLUDE_GUARD
+#define NETCONFIG_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default resolver configuration file
+ */
+//--------------------------------------------------------------------------------------------------
+#define NETCONFIG_RESOLV_CONF_PATH  "/etc/resolv.conf"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the network configuration
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT if the rtnetlink socket can't be opened or configured
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_Init
+(
+    int netlinkFd       ///< [IN] Socket to send the rtnetlink requests to, -1 to open an
+                        ///<      rtnetlink socket. Used by the unit tests to stub the kernel.
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the default route, replacing the current one if any
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the gateway address or the interface is invalid
+ *      - LE_FAULT if the route can't be set
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_SetDefaultRoute
+(
+    const char* gwAddrPtr,  ///< [IN] Gateway IPv4 or IPv6 address
+    const char* ifNamePtr   ///< [IN] Interface name, NULL to only use the gateway
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the default route
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the gateway address or the interface is invalid
+ *      - LE_NOT_FOUND if the route doesn't exist
+ *      - LE_FAULT if the route can't be deleted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_DeleteDefaultRoute
+(
+    const char* gwAddrPtr,  ///< [IN] Gateway IPv4 or IPv6 address
+    const char* ifNamePtr   ///< [IN] Interface name, NULL to only use the gateway
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an address to an interface, replacing it if it already exists
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the address, the prefix length or the interface is invalid
+ *      - LE_FAULT if the address can't be added
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_AddAddress
+(
+    const char* ifNamePtr,  ///< [IN] Interface name
+    const char* addrPtr,    ///< [IN] IPv4 or IPv6 address
+    uint8_t     prefixLen   ///< [IN] Prefix length of the subnet
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete an address of an interface
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the address, the prefix length or the interface is invalid
+ *      - LE_NOT_FOUND if the interface doesn't have this address
+ *      - LE_FAULT if the address can't be deleted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_DeleteAddress
+(
+    const char* ifNamePtr,  ///< [IN] Interface name
+    const char* addrPtr,    ///< [IN] IPv4 or IPv6 address
+    uint8_t     prefixLen   ///< [IN] Prefix length of the subnet
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the DNS servers in a resolver configuration file
+ *
+ * The file is replaced atomically, and only if its content changes, then its directory is synced.
+ * If the path is a symbolic link, the file it points to is replaced. If the temporary file can't
+ * be created in the directory of this file, e.g. because it is read-only, the file is rewritten in
+ * place.
+ *
+ * @return
+ *      - LE_OK if the file has been written
+ *      - LE_DUPLICATE if the file already has this content
+ *      - LE_FAULT on failure
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t netConfig_SetDns
+(
+    const char* resolvPathPtr,  ///< [IN] Resolver configuration file
+    const char* dns1AddrPtr,    ///< [IN] First DNS server address, empty if none
+    const char* dns2AddrPtr     ///< [IN] Second DNS server address, empty if none
+);
+
+#endif // NETCONFIG_H_INCLUDE_GUARD
@@ -0,0 +1,467 @@
+/**
+ * This module implements the unit tests of the network configuration used by the data connection
+ * tests.
+ *
+ * The rtnetlink socket is replaced by a socket pair: a stub kernel thread receives the route and
+ * address requests, checks them and sends the acknowledgements.
+ *
+ * Tested API:
+ * - netConfig_Init
+ * - netConfig_SetDefaultRoute
+ * - netConfig_DeleteDefaultRoute
+ * - netConfig_AddAddress
+ * - netConfig_DeleteAddress
+ * - netConfig_SetDns
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "netConfig.h"
+
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of route requests sent to measure their latency
+ */
+//--------------------------------------------------------------------------------------------------
+#define ROUTE_REQUESTS_NB   1000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default route known by the stub kernel
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool            isSet;      ///< Default route set
+    uint8_t         family;     ///< AF_INET or AF_INET6
+    uint8_t         gwAddr[16]; ///< Gateway address
+    uint32_t        ifIndex;    ///< Output interface, 0 if none
+}
+StubRoute_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default route known by the stub kernel
+ */
+//--------------------------------------------------------------------------------------------------
+static StubRoute_t StubRoute;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Interface address known by the stub kernel
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool            isSet;      ///< Address set
+    uint8_t         family;     ///< AF_INET or AF_INET6
+    uint8_t         addr[16];   ///< Address
+    uint8_t         prefixLen;  ///< Prefix length of the subnet
+    uint32_t        ifIndex;    ///< Interface
+}
+StubAddress_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Interface address known by the stub kernel
+ */
+//--------------------------------------------------------------------------------------------------
+static StubAddress_t StubAddress;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub kernel: handle a route request
+ *
+ * @return 0 on success, a negative error code otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+static int HandleRouteRequest
+(
+    struct nlmsghdr* reqPtr
+)
+{
+    struct rtmsg* rtPtr = NLMSG_DATA(reqPtr);
+    struct rtattr* rtaPtr;
+    int attrLen;
+    StubRoute_t route = {0};
+
+    LE_ASSERT(0 == rtPtr->rtm_dst_len);
+    LE_ASSERT(RT_TABLE_MAIN == rtPtr->rtm_table);
+
+    route.family = rtPtr->rtm_family;
+
+    attrLen = RTM_PAYLOAD(reqPtr);
+    for (rtaPtr = RTM_RTA(rtPtr); RTA_OK(rtaPtr, attrLen); rtaPtr = RTA_NEXT(rtaPtr, attrLen))
+    {
+        switch (rtaPtr->rta_type)
+        {
+            case RTA_GATEWAY:
+                LE_ASSERT(RTA_PAYLOAD(rtaPtr) == ((AF_INET == route.family) ? 4 : 16));
+                memcpy(route.gwAddr, RTA_DATA(rtaPtr), RTA_PAYLOAD(rtaPtr));
+                break;
+
+            case RTA_OIF:
+                memcpy(&route.ifIndex, RTA_DATA(rtaPtr), sizeof(route.ifIndex));
+                break;
+
+            default:
+                LE_FATAL("Unexpected attribute %d", rtaPtr->rta_type);
+        }
+    }
+
+    if (RTM_NEWROUTE == reqPtr->nlmsg_type)
+    {
+        LE_ASSERT(reqPtr->nlmsg_flags & NLM_F_CREATE);
+        route.isSet = true;
+        StubRoute = route;
+        return 0;
+    }
+
+    if (StubRoute.isSet && (StubRoute.family == route.family) &&
+        (0 == memcmp(StubRoute.gwAddr, route.gwAddr, sizeof(route.gwAddr))))
+    {
+        StubRoute.isSet = false;
+        return 0;
+    }
+
+    return -ESRCH;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub kernel: handle an address request
+ *
+ * @return 0 on success, a negative error code otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+static int HandleAddressRequest
+(
+    struct nlmsghdr* reqPtr
+)
+{
+    struct ifaddrmsg* ifaPtr = NLMSG_DATA(reqPtr);
+    struct rtattr* rtaPtr;
+    int attrLen;
+    bool hasLocal = false;
+    StubAddress_t address = {0};
+
+    address.family = ifaPtr->ifa_family;
+    address.prefixLen = ifaPtr->ifa_prefixlen;
+    address.ifIndex = ifaPtr->ifa_index;
+    LE_ASSERT(0 != address.ifIndex);
+
+    attrLen = IFA_PAYLOAD(reqPtr);
+    for (rtaPtr = IFA_RTA(ifaPtr); RTA_OK(rtaPtr, attrLen); rtaPtr = RTA_NEXT(rtaPtr, attrLen))
+    {
+        LE_ASSERT(RTA_PAYLOAD(rtaPtr) == ((AF_INET == address.family) ? 4 : 16));
+
+        switch (rtaPtr->rta_type)
+        {
+            case IFA_LOCAL:
+                memcpy(address.addr, RTA_DATA(rtaPtr), RTA_PAYLOAD(rtaPtr));
+                hasLocal = true;
+                break;
+
+            case IFA_ADDRESS:
+                break;
+
+            default:
+                LE_FATAL("Unexpected attribute %d", rtaPtr->rta_type);
+        }
+    }
+    LE_ASSERT(hasLocal);
+
+    if (RTM_NEWADDR == reqPtr->nlmsg_type)
+    {
+        LE_ASSERT(reqPtr->nlmsg_flags & NLM_F_CREATE);
+        address.isSet = true;
+        StubAddress = address;
+        return 0;
+    }
+
+    if (StubAddress.isSet && (StubAddress.family == address.family) &&
+        (StubAddress.ifIndex == address.ifIndex) &&
+        (0 == memcmp(StubAddress.addr, address.addr, sizeof(address.addr))))
+    {
+        StubAddress.isSet = false;
+        return 0;
+    }
+
+    return -EADDRNOTAVAIL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stub kernel: receive the route and address requests, update the stub state and acknowledge them
+ */
+//--------------------------------------------------------------------------------------------------
+static void* StubKernelThread
+(
+    void* contextPtr
+)
+{
+    int fd = (int)(intptr_t)contextPtr;
+    uint8_t buffer[1024];
+
+    while (1)
+    {
+        struct nlmsghdr* reqPtr = (struct nlmsghdr*)buffer;
+        struct
+        {
+            struct nlmsghdr hdr;
+            struct nlmsgerr err;
+        }
+        ack;
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+
+        if (len <= 0)
+        {
+            break;
+        }
+
+        LE_ASSERT(NLMSG_OK(reqPtr, len));
+        LE_ASSERT(reqPtr->nlmsg_flags & NLM_F_REQUEST);
+        LE_ASSERT(reqPtr->nlmsg_flags & NLM_F_ACK);
+
+        memset(&ack, 0, sizeof(ack));
+        ack.hdr.nlmsg_len = sizeof(ack);
+        ack.hdr.nlmsg_type = NLMSG_ERROR;
+        ack.hdr.nlmsg_seq = reqPtr->nlmsg_seq;
+        ack.err.msg = *reqPtr;
+
+        switch (reqPtr->nlmsg_type)
+        {
+            case RTM_NEWROUTE:
+            case RTM_DELROUTE:
+                ack.err.error = HandleRouteRequest(reqPtr);
+                break;
+
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                ack.err.error = HandleAddressRequest(reqPtr);
+                break;
+
+            default:
+                LE_FATAL("Unexpected request %d", reqPtr->nlmsg_type);
+        }
+
+        LE_ASSERT(sizeof(ack) == send(fd, &ack, sizeof(ack), 0));
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the default route requests
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestDefaultRoute
+(
+    void
+)
+{
+    struct in_addr gwAddr4;
+    struct in6_addr gwAddr6;
+    le_clk_Time_t startTime, duration;
+    int i;
+
+    LE_INFO("======== Test default route ========");
+
+    LE_ASSERT(1 == inet_pton(AF_INET, "192.168.2.1", &gwAddr4));
+    LE_ASSERT(1 == inet_pton(AF_INET6, "fe80::1", &gwAddr6));
+
+    // IPv4 gateway
+    LE_ASSERT_OK(netConfig_SetDefaultRoute("192.168.2.1", NULL));
+    LE_ASSERT(StubRoute.isSet);
+    LE_ASSERT(AF_INET == StubRoute.family);
+    LE_ASSERT(0 == memcmp(StubRoute.gwAddr, &gwAddr4, sizeof(gwAddr4)));
+    LE_ASSERT(0 == StubRoute.ifIndex);
+
+    // IPv6 gateway on an interface, replacing the previous route
+    LE_ASSERT_OK(netConfig_SetDefaultRoute("fe80::1", "lo"));
+    LE_ASSERT(AF_INET6 == StubRoute.family);
+    LE_ASSERT(0 == memcmp(StubRoute.gwAddr, &gwAddr6, sizeof(gwAddr6)));
+    LE_ASSERT(if_nametoindex("lo") == StubRoute.ifIndex);
+
+    // Invalid parameters are not sent
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_SetDefaultRoute("192.168.2", NULL));
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_SetDefaultRoute("", NULL));
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_SetDefaultRoute("192.168.2.1", "noSuchItf0"));
+    LE_ASSERT(AF_INET6 == StubRoute.family);
+
+    // Deletion
+    LE_ASSERT(LE_NOT_FOUND == netConfig_DeleteDefaultRoute("192.168.2.1", NULL));
+    LE_ASSERT_OK(netConfig_DeleteDefaultRoute("fe80::1", "lo"));
+    LE_ASSERT(!StubRoute.isSet);
+    LE_ASSERT(LE_NOT_FOUND == netConfig_DeleteDefaultRoute("fe80::1", "lo"));
+
+    // Latency of a route change
+    startTime = le_clk_GetRelativeTime();
+    for (i = 0; i < ROUTE_REQUESTS_NB; i++)
+    {
+        LE_ASSERT_OK(netConfig_SetDefaultRoute("192.168.2.1", NULL));
+    }
+    duration = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    LE_INFO("%d route changes in %ld.%06ld s", ROUTE_REQUESTS_NB,
+            (long)duration.sec, (long)duration.usec);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the interface address requests
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestAddress
+(
+    void
+)
+{
+    struct in_addr addr4;
+    struct in6_addr addr6;
+
+    LE_INFO("======== Test interface address ========");
+
+    LE_ASSERT(1 == inet_pton(AF_INET, "10.1.2.3", &addr4));
+    LE_ASSERT(1 == inet_pton(AF_INET6, "2001:db8::3", &addr6));
+
+    // IPv4 address
+    LE_ASSERT_OK(netConfig_AddAddress("lo", "10.1.2.3", 24));
+    LE_ASSERT(StubAddress.isSet);
+    LE_ASSERT(AF_INET == StubAddress.family);
+    LE_ASSERT(0 == memcmp(StubAddress.addr, &addr4, sizeof(addr4)));
+    LE_ASSERT(24 == StubAddress.prefixLen);
+    LE_ASSERT(if_nametoindex("lo") == StubAddress.ifIndex);
+
+    // IPv6 address
+    LE_ASSERT_OK(netConfig_AddAddress("lo", "2001:db8::3", 64));
+    LE_ASSERT(AF_INET6 == StubAddress.family);
+    LE_ASSERT(0 == memcmp(StubAddress.addr, &addr6, sizeof(addr6)));
+    LE_ASSERT(64 == StubAddress.prefixLen);
+
+    // Invalid parameters are not sent
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_AddAddress("lo", "10.1.2", 24));
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_AddAddress("lo", "10.1.2.3", 33));
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_AddAddress("noSuchItf0", "10.1.2.3", 24));
+    LE_ASSERT(LE_BAD_PARAMETER == netConfig_AddAddress(NULL, "10.1.2.3", 24));
+    LE_ASSERT(AF_INET6 == StubAddress.family);
+
+    // Deletion
+    LE_ASSERT(LE_NOT_FOUND == netConfig_DeleteAddress("lo", "10.1.2.3", 24));
+    LE_ASSERT_OK(netConfig_DeleteAddress("lo", "2001:db8::3", 64));
+    LE_ASSERT(!StubAddress.isSet);
+    LE_ASSERT(LE_NOT_FOUND == netConfig_DeleteAddress("lo", "2001:db8::3", 64));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the resolver configuration update
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestDns
+(
+    void
+)
+{
+    char dirPath[] = "/tmp/netConfigTestXXXXXX";
+    char resolvPath[PATH_MAX];
+    char linkPath[PATH_MAX];
+    char tmpPath[PATH_MAX + sizeof(".tmp")];
+    char content[256];
+    struct stat before, after;
+    ssize_t len;
+    int fd;
+
+    LE_INFO("======== Test DNS ========");
+
+    LE_ASSERT(NULL != mkdtemp(dirPath));
+    snprintf(resolvPath, sizeof(resolvPath), "%s/resolv.conf", dirPath);
+    snprintf(linkPath, sizeof(linkPath), "%s/resolv.link", dirPath);
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", resolvPath);
+
+    // File created
+    LE_ASSERT_OK(netConfig_SetDns(resolvPath, "8.8.8.8", "8.8.4.4"));
+
+    fd = open(resolvPath, O_RDONLY);
+    LE_ASSERT(fd >= 0);
+    len = read(fd, content, sizeof(content) - 1);
+    close(fd);
+    LE_ASSERT(len > 0);
+    content[len] = '\0';
+    LE_ASSERT(0 == strcmp(content, "nameserver 8.8.8.8\nnameserver 8.8.4.4\n"));
+    LE_ASSERT(-1 == access(tmpPath, F_OK));
+
+    // Same servers: file not rewritten
+    LE_ASSERT(0 == stat(resolvPath, &before));
+    LE_ASSERT(LE_DUPLICATE == netConfig_SetDns(resolvPath, "8.8.8.8", "8.8.4.4"));
+    LE_ASSERT(0 == stat(resolvPath, &after));
+    LE_ASSERT(before.st_ino == after.st_ino);
+
+    // New servers: file replaced
+    LE_ASSERT_OK(netConfig_SetDns(resolvPath, "2001:4860:4860::8888", ""));
+    LE_ASSERT(0 == stat(resolvPath, &after));
+    LE_ASSERT(before.st_ino != after.st_ino);
+
+    fd = open(resolvPath, O_RDONLY);
+    LE_ASSERT(fd >= 0);
+    len = read(fd, content, sizeof(content) - 1);
+    close(fd);
+    LE_ASSERT(len > 0);
+    content[len] = '\0';
+    LE_ASSERT(0 == strcmp(content, "nameserver 2001:4860:4860::8888\n"));
+
+    // Symbolic link: the file it points to is replaced, the link is kept
+    LE_ASSERT(0 == symlink("resolv.conf", linkPath));
+    LE_ASSERT_OK(netConfig_SetDns(linkPath, "1.1.1.1", ""));
+    LE_ASSERT(0 == lstat(linkPath, &after));
+    LE_ASSERT(S_ISLNK(after.st_mode));
+
+    fd = open(resolvPath, O_RDONLY);
+    LE_ASSERT(fd >= 0);
+    len = read(fd, content, sizeof(content) - 1);
+    close(fd);
+    LE_ASSERT(len > 0);
+    content[len] = '\0';
+    LE_ASSERT(0 == strcmp(content, "nameserver 1.1.1.1\n"));
+    LE_ASSERT(-1 == access(tmpPath, F_OK));
+
+    LE_ASSERT(0 == unlink(linkPath));
+    LE_ASSERT(0 == unlink(resolvPath));
+    LE_ASSERT(0 == rmdir(dirPath));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main of the test
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    int fds[2];
+
+    // The datagram boundaries of the rtnetlink messages are kept by a sequenced packet socket
+    LE_ASSERT(0 == socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+    le_thread_Start(le_thread_Create("StubKernel", StubKernelThread, (void*)(intptr_t)fds[1]));
+
+    LE_ASSERT_OK(netConfig_Init(fds[0]));
+
+    TestDefaultRoute();
+    TestAddress();
+    TestDns();
+
+    LE_INFO("======== Network configuration tests PASSED ========");
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,1160 @@
+/**
+ * @file atomGroup.c
+ *
+ * Implementation of the group commit of atomic file updates.
+ *
+ * The journal is a text file, created with the group:
+ *  - a header line,
+ *  - a "S <path>" line per staged file, appended before its temporary file is created, so that
+ *    the temporary files of a group abandoned by a crash can be removed,
+ *  - on commit, once the temporary files are flushed, one line per update ("W <size> <checksum>
+ *    <path>" for a write, "D <path>" for a deletion) and an end line holding the number of lines
+ *    and a checksum of the previous lines.
+ *
+ * A journal without a valid end line was interrupted before the commit point: none of its updates
+ * was applied, it is discarded along with its temporary files. So is a complete journal whose
+ * temporary files don't match the size and checksum it recorded: they were not made durable
+ * before the journal, e.g. by a storage not honouring the flushes.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "atomGroup.h"
+
+#include <sys/file.h>
+#include <sys/stat.h>
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * First line of a journal
+ */
+//--------------------------------------------------------------------------------------------------
+#define JOURNAL_HEADER          "ATOMGROUP 2\n"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Suffix of the lock file of a journal
+ */
+//--------------------------------------------------------------------------------------------------
+#define LOCK_SUFFIX             ".lock"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of file systems flushed one by one. Beyond, all of them are flushed at once.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_FILE_SYSTEMS        4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of a journal line buffer: operation, size, checksum, path, separators, new line and null
+ * character
+ */
+//--------------------------------------------------------------------------------------------------
+#define LINE_BYTES              (PATH_MAX + 40)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the buffer used to check the checksum of a temporary file
+ */
+//--------------------------------------------------------------------------------------------------
+#define READ_BUFFER_BYTES       4096
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * FNV-1a hash parameters, for the journal checksum
+ */
+//--------------------------------------------------------------------------------------------------
+#define FNV_OFFSET_BASIS        2166136261u
+#define FNV_PRIME               16777619u
+
+//--------------------------------------------------------------------------------------------------
+// Data structures
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Staged update
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_dls_Link_t link;                 ///< Link in the group update list
+    bool          isDelete;             ///< True to delete the file, false to replace it
+    bool          isJournaled;          ///< True once the temporary file is in the journal
+    uint64_t      size;                 ///< Size of the staged content
+    uint32_t      hash;                 ///< Checksum of the staged content
+    char          path[PATH_MAX];       ///< Target path
+}
+Update_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Line read from a journal
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char          op;                   ///< 'S' staged, 'W' written or 'D' deleted
+    uint64_t      size;                 ///< Size of a written file
+    uint32_t      hash;                 ///< Checksum of a written file
+    char          path[LINE_BYTES];     ///< Target path
+}
+JournalLine_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Group
+ */
+//--------------------------------------------------------------------------------------------------
+struct atomGroup
+{
+    char          journalPath[PATH_MAX];        ///< Journal path
+    int           journalFd;                    ///< Journal, open for appending
+    uint32_t      journalLines;                 ///< Number of lines after the journal header
+    uint32_t      journalHash;                  ///< Checksum of the journal lines
+    int           lockFd;                       ///< Lock file, locked by the group
+    le_dls_List_t updateList;                   ///< Staged updates
+    uint32_t      updateCount;                  ///< Number of staged updates
+    int           fsFd[MAX_FILE_SYSTEMS];       ///< A file of each file system to flush
+    dev_t         fsDev[MAX_FILE_SYSTEMS];      ///< Device of each file system to flush
+    uint32_t      fsCount;                      ///< Number of file systems to flush
+    bool          syncAll;                      ///< Too many file systems: flush all of them
+};
+
+//--------------------------------------------------------------------------------------------------
+// Static declarations
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the groups
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t GroupPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the staged updates
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t UpdatePool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of the process
+ */
+//--------------------------------------------------------------------------------------------------
+static atomGroup_Stats_t Stats;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the memory pools on first use
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitPools
+(
+    void
+)
+{
+    if (NULL == GroupPool)
+    {
+        GroupPool = le_mem_CreatePool("AtomGroupPool", sizeof(struct atomGroup));
+        UpdatePool = le_mem_CreatePool("AtomGroupUpdatePool", sizeof(Update_t));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of the temporary file of a target
+ *
+ * @return LE_OK, or LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetTmpPath
+(
+    const char* pathPtr,
+    char*       tmpPathPtr      ///< Buffer of PATH_MAX bytes
+)
+{
+    int len = snprintf(tmpPathPtr, PATH_MAX, "%s" ATOMGROUP_TMP_SUFFIX, pathPtr);
+
+    return ((len < 0) || (len >= PATH_MAX)) ? LE_OVERFLOW : LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update a checksum with some data
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t HashData
+(
+    uint32_t    hash,
+    const void* dataPtr,
+    size_t      size
+)
+{
+    const uint8_t* bytePtr = dataPtr;
+
+    while (size-- > 0)
+    {
+        hash = (hash ^ *bytePtr++) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the journal checksum with a line
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t HashLine
+(
+    uint32_t    hash,
+    const char* linePtr
+)
+{
+    return HashData(hash, linePtr, strlen(linePtr));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a whole buffer
+ *
+ * @return LE_OK, or LE_FAULT on error
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteAll
+(
+    int         fd,
+    const void* bufPtr,
+    size_t      size
+)
+{
+    const uint8_t* dataPtr = bufPtr;
+
+    while (size > 0)
+    {
+        ssize_t count = write(fd, dataPtr, size);
+
+        if (-1 == count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return LE_FAULT;
+        }
+
+        dataPtr += count;
+        size -= count;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the file system of a file, to flush it on commit
+ *
+ * @return true if the file descriptor is kept by the group, false if it can be closed
+ */
+//--------------------------------------------------------------------------------------------------
+static bool AddFileSystem
+(
+    atomGroup_Ref_t groupRef,
+    int             fd
+)
+{
+    struct stat st;
+    uint32_t i;
+
+    if ((groupRef->syncAll) || (-1 == fstat(fd, &st)))
+    {
+        groupRef->syncAll = true;
+        return false;
+    }
+
+    for (i = 0; i < groupRef->fsCount; i++)
+    {
+        if (groupRef->fsDev[i] == st.st_dev)
+        {
+            return false;
+        }
+    }
+
+    if (MAX_FILE_SYSTEMS == groupRef->fsCount)
+    {
+        groupRef->syncAll = true;
+        return false;
+    }
+
+    groupRef->fsDev[groupRef->fsCount] = st.st_dev;
+    groupRef->fsFd[groupRef->fsCount] = fd;
+    groupRef->fsCount++;
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush the file systems of a group: this is the ordering point of a commit
+ */
+//--------------------------------------------------------------------------------------------------
+static void Flush
+(
+    atomGroup_Ref_t groupRef
+)
+{
+    uint32_t i;
+
+    if (groupRef->syncAll)
+    {
+        sync();
+        Stats.syncs++;
+        return;
+    }
+
+    for (i = 0; i < groupRef->fsCount; i++)
+    {
+        if (-1 == syncfs(groupRef->fsFd[i]))
+        {
+            LE_WARN("syncfs failed: %m, flushing all the file systems");
+            sync();
+        }
+        Stats.syncs++;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a staged update
+ *
+ * @return the update, NULL if the file has no staged update
+ */
+//--------------------------------------------------------------------------------------------------
+static Update_t* FindUpdate
+(
+    atomGroup_Ref_t groupRef,
+    const char*     pathPtr
+)
+{
+    le_dls_Link_t* linkPtr = le_dls_Peek(&groupRef->updateList);
+
+    while (NULL != linkPtr)
+    {
+        Update_t* updatePtr = CONTAINER_OF(linkPtr, Update_t, link);
+
+        if (0 == strcmp(updatePtr->path, pathPtr))
+        {
+            return updatePtr;
+        }
+
+        linkPtr = le_dls_PeekNext(&groupRef->updateList, linkPtr);
+    }
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the staged update of a file, creating it if needed
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetUpdate
+(
+    atomGroup_Ref_t groupRef,
+    const char*     pathPtr,
+    Update_t**      updatePtrPtr
+)
+{
+    char tmpPath[PATH_MAX];
+
+    // A new line would break the journal format.
+    if ((NULL == groupRef) || (NULL == pathPtr) || ('\0' == *pathPtr) ||
+        (NULL != strchr(pathPtr, '\n')))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    if (LE_OK != GetTmpPath(pathPtr, tmpPath))
+    {
+        return LE_OVERFLOW;
+    }
+
+    Update_t* updatePtr = FindUpdate(groupRef, pathPtr);
+
+    if (NULL == updatePtr)
+    {
+        updatePtr = le_mem_ForceAlloc(UpdatePool);
+        LE_ASSERT_OK(le_utf8_Copy(updatePtr->path, pathPtr, sizeof(updatePtr->path), NULL));
+        updatePtr->isDelete = false;
+        updatePtr->isJournaled = false;
+        updatePtr->size = 0;
+        updatePtr->hash = FNV_OFFSET_BASIS;
+        updatePtr->link = LE_DLS_LINK_INIT;
+        le_dls_Queue(&groupRef->updateList, &updatePtr->link);
+        groupRef->updateCount++;
+    }
+
+    *updatePtrPtr = updatePtr;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the temporary files of the staged updates and release them
+ */
+//--------------------------------------------------------------------------------------------------
+static void DropUpdates
+(
+    atomGroup_Ref_t groupRef,
+    bool            removeTmpFiles
+)
+{
+    char tmpPath[PATH_MAX];
+    le_dls_Link_t* linkPtr;
+
+    while (NULL != (linkPtr = le_dls_Pop(&groupRef->updateList)))
+    {
+        Update_t* updatePtr = CONTAINER_OF(linkPtr, Update_t, link);
+
+        if (removeTmpFiles && !updatePtr->isDelete &&
+            (LE_OK == GetTmpPath(updatePtr->path, tmpPath)))
+        {
+            unlink(tmpPath);
+        }
+
+        le_mem_Release(updatePtr);
+    }
+
+    groupRef->updateCount = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a group and its lock
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeleteGroup
+(
+    atomGroup_Ref_t groupRef
+)
+{
+    uint32_t i;
+
+    for (i = 0; i < groupRef->fsCount; i++)
+    {
+        close(groupRef->fsFd[i]);
+    }
+
+    close(groupRef->journalFd);
+
+    // Closing the lock file releases the lock.
+    close(groupRef->lockFd);
+    le_mem_Release(groupRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a line to the journal of a group. Nothing is flushed.
+ *
+ * @return LE_OK, or LE_FAULT if the line can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t AppendJournalLine
+(
+    atomGroup_Ref_t groupRef,
+    const char*     linePtr
+)
+{
+    if (LE_OK != WriteAll(groupRef->journalFd, linePtr, strlen(linePtr)))
+    {
+        LE_ERROR("Can't write journal '%s': %m", groupRef->journalPath);
+        return LE_FAULT;
+    }
+
+    groupRef->journalHash = HashLine(groupRef->journalHash, linePtr);
+    groupRef->journalLines++;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the journal of a group with its updates and its end line, and flush it: this is the
+ * commit point. The temporary files must have been flushed before.
+ *
+ * @return LE_OK, or LE_FAULT if the journal can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CompleteJournal
+(
+    atomGroup_Ref_t groupRef
+)
+{
+    char line[LINE_BYTES];
+    le_dls_Link_t* linkPtr = le_dls_Peek(&groupRef->updateList);
+
+    while (NULL != linkPtr)
+    {
+        Update_t* updatePtr = CONTAINER_OF(linkPtr, Update_t, link);
+
+        if (updatePtr->isDelete)
+        {
+            snprintf(line, sizeof(line), "D %s\n", updatePtr->path);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "W %"PRIu64" %08"PRIx32" %s\n",
+                     updatePtr->size, updatePtr->hash, updatePtr->path);
+        }
+
+        if (LE_OK != AppendJournalLine(groupRef, line))
+        {
+            return LE_FAULT;
+        }
+
+        linkPtr = le_dls_PeekNext(&groupRef->updateList, linkPtr);
+    }
+
+    snprintf(line, sizeof(line), "END %"PRIu32" %08"PRIx32"\n",
+             groupRef->journalLines, groupRef->journalHash);
+
+    if (   (LE_OK != WriteAll(groupRef->journalFd, line, strlen(line)))
+        || (-1 == fdatasync(groupRef->journalFd)))
+    {
+        LE_ERROR("Can't write journal '%s': %m", groupRef->journalPath);
+        return LE_FAULT;
+    }
+    Stats.syncs++;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that the temporary file of a journaled write holds the content recorded in the journal
+ *
+ * @return true if it does, or if it was already renamed
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsTmpFileComplete
+(
+    const JournalLine_t* linePtr
+)
+{
+    char tmpPath[PATH_MAX];
+    uint8_t buffer[READ_BUFFER_BYTES];
+    uint32_t hash = FNV_OFFSET_BASIS;
+    uint64_t size = 0;
+    ssize_t count;
+
+    if (LE_OK != GetTmpPath(linePtr->path, tmpPath))
+    {
+        return false;
+    }
+
+    int fd = open(tmpPath, O_RDONLY | O_CLOEXEC);
+
+    if (-1 == fd)
+    {
+        return (ENOENT == errno);
+    }
+
+    while (0 != (count = read(fd, buffer, sizeof(buffer))))
+    {
+        if (-1 == count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+
+        hash = HashData(hash, buffer, count);
+        size += count;
+    }
+
+    close(fd);
+
+    if ((size != linePtr->size) || (hash != linePtr->hash))
+    {
+        LE_ERROR("'%s' doesn't hold the content of the journal", tmpPath);
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply an update of a journal. Applying it again has no effect, so that a journal can be replayed
+ * after a crash in the middle of its application.
+ *
+ * @return LE_OK, or LE_FAULT if the update can't be applied
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ApplyUpdate
+(
+    bool        isDelete,
+    const char* pathPtr
+)
+{
+    char tmpPath[PATH_MAX];
+
+    if (isDelete)
+    {
+        if ((-1 == unlink(pathPtr)) && (ENOENT != errno))
+        {
+            LE_ERROR("Can't delete '%s': %m", pathPtr);
+            return LE_FAULT;
+        }
+        return LE_OK;
+    }
+
+    if (LE_OK != GetTmpPath(pathPtr, tmpPath))
+    {
+        return LE_FAULT;
+    }
+
+    // A missing temporary file was already renamed.
+    if ((-1 == rename(tmpPath, pathPtr)) && (ENOENT != errno))
+    {
+        LE_ERROR("Can't rename '%s': %m", tmpPath);
+        return LE_FAULT;
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the next line of a journal
+ *
+ * @return
+ *      - LE_OK if a line was read
+ *      - LE_TERMINATED at the end line, if the journal is complete
+ *      - LE_FORMAT_ERROR if the journal is incomplete or invalid
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadLine
+(
+    FILE*          filePtr,
+    JournalLine_t* linePtr,     ///< Line read
+    uint32_t*      countPtr,    ///< Number of lines read
+    uint32_t*      hashPtr      ///< Checksum of the lines read
+)
+{
+    char line[LINE_BYTES];
+    const char* pathPtr;
+    char* endPtr;
+    uint32_t count;
+    uint32_t hash;
+    size_t len;
+
+    if (NULL == fgets(line, sizeof(line), filePtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    len = strlen(line);
+
+    if ((len < 3) || ('\n' != line[len - 1]))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (2 == sscanf(line, "END %"SCNu32" %"SCNx32, &count, &hash))
+    {
+        return ((count == *countPtr) && (hash == *hashPtr)) ? LE_TERMINATED : LE_FORMAT_ERROR;
+    }
+
+    if ((NULL == strchr("SWD", line[0])) || (' ' != line[1]))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    linePtr->op = line[0];
+    pathPtr = line + 2;
+
+    if ('W' == linePtr->op)
+    {
+        linePtr->size = strtoull(pathPtr, &endPtr, 10);
+        if (' ' != *endPtr)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        linePtr->hash = strtoul(endPtr + 1, &endPtr, 16);
+        if (' ' != *endPtr)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        pathPtr = endPtr + 1;
+    }
+
+    *hashPtr = HashLine(*hashPtr, line);
+    (*countPtr)++;
+
+    // Keep the path only.
+    line[len - 1] = '\0';
+    LE_ASSERT_OK(le_utf8_Copy(linePtr->path, pathPtr, sizeof(linePtr->path), NULL));
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete or discard the commit interrupted by a crash, if any
+ *
+ * @return
+ *      - LE_OK if there was nothing to do or the commit was completed
+ *      - LE_NOT_FOUND if an incomplete journal was discarded, with its temporary files: no update
+ *        was applied
+ *      - LE_FAULT if the journal can't be read or an update can't be applied
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Recover
+(
+    const char* journalPathPtr      ///< [IN] Journal path
+)
+{
+    JournalLine_t line;
+    char header[sizeof(JOURNAL_HEADER)];
+    char tmpPath[PATH_MAX];
+    uint32_t count = 0;
+    uint32_t hash = FNV_OFFSET_BASIS;
+    le_result_t result;
+
+    LE_ASSERT(journalPathPtr != NULL);
+
+    FILE* filePtr = fopen(journalPathPtr, "re");
+
+    if (NULL == filePtr)
+    {
+        if (ENOENT == errno)
+        {
+            return LE_OK;
+        }
+
+        LE_ERROR("Can't open journal '%s': %m", journalPathPtr);
+        return LE_FAULT;
+    }
+
+    // First pass: check that the journal is complete, and that the temporary files it lists were
+    // durable before it.
+    if (   (NULL == fgets(header, sizeof(header), filePtr))
+        || (0 != strcmp(header, JOURNAL_HEADER)))
+    {
+        result = LE_FORMAT_ERROR;
+    }
+    else
+    {
+        hash = HashLine(hash, header);
+        do
+        {
+            result = ReadLine(filePtr, &line, &count, &hash);
+
+            if ((LE_OK == result) && ('W' == line.op) && !IsTmpFileComplete(&line))
+            {
+                result = LE_FORMAT_ERROR;
+            }
+        }
+        while (LE_OK == result);
+    }
+
+    // Second pass: apply the updates of a complete journal, or drop the temporary files of an
+    // incomplete one.
+    rewind(filePtr);
+    fgets(header, sizeof(header), filePtr);
+
+    bool isComplete = (LE_TERMINATED == result);
+    uint32_t total = count;
+    le_result_t applyResult = LE_OK;
+
+    count = 0;
+    hash = FNV_OFFSET_BASIS;
+
+    while ((count < total) && (LE_OK == ReadLine(filePtr, &line, &count, &hash)))
+    {
+        if (isComplete)
+        {
+            if (('S' != line.op) && (LE_OK != ApplyUpdate('D' == line.op, line.path)))
+            {
+                applyResult = LE_FAULT;
+            }
+        }
+        else if (('D' != line.op) && (LE_OK == GetTmpPath(line.path, tmpPath)))
+        {
+            unlink(tmpPath);
+        }
+    }
+
+    fclose(filePtr);
+
+    if (LE_OK != applyResult)
+    {
+        // Keep the journal to try again.
+        return LE_FAULT;
+    }
+
+    if (isComplete)
+    {
+        sync();
+        Stats.syncs++;
+        Stats.replays++;
+        LE_INFO("Replayed journal '%s' (%"PRIu32" lines)", journalPathPtr, total);
+    }
+    else
+    {
+        Stats.discards++;
+        LE_INFO("Discarded journal '%s'", journalPathPtr);
+    }
+
+    unlink(journalPathPtr);
+    sync();
+    Stats.syncs++;
+
+    return isComplete ? LE_OK : LE_NOT_FOUND;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a group. Blocks until the journal is not used by another group, then recovers the
+ * previous commit if it was interrupted.
+ *
+ * @return the group reference, NULL if the journal can't be locked or recovered
+ */
+//--------------------------------------------------------------------------------------------------
+atomGroup_Ref_t atomGroup_Create
+(
+    const char* journalPathPtr      ///< [IN] Journal path
+)
+{
+    char lockPath[PATH_MAX];
+    int len;
+
+    LE_ASSERT(journalPathPtr != NULL);
+
+    InitPools();
+
+    len = snprintf(lockPath, sizeof(lockPath), "%s" LOCK_SUFFIX, journalPathPtr);
+    if ((len < 0) || (len >= (int)sizeof(lockPath)))
+    {
+        LE_ERROR("Journal path too long: '%s'", journalPathPtr);
+        return NULL;
+    }
+
+    int lockFd = open(lockPath, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (-1 == lockFd)
+    {
+        LE_ERROR("Can't open '%s': %m", lockPath);
+        return NULL;
+    }
+
+    int rc;
+    do
+    {
+        rc = flock(lockFd, LOCK_EX);
+    }
+    while ((-1 == rc) && (EINTR == errno));
+
+    if (-1 == rc)
+    {
+        LE_ERROR("Can't lock '%s': %m", lockPath);
+        close(lockFd);
+        return NULL;
+    }
+
+    if (LE_FAULT == atomGroup_Recover(journalPathPtr))
+    {
+        close(lockFd);
+        return NULL;
+    }
+
+    atomGroup_Ref_t groupRef = le_mem_ForceAlloc(GroupPool);
+    memset(groupRef, 0, sizeof(struct atomGroup));
+
+    LE_ASSERT_OK(le_utf8_Copy(groupRef->journalPath,
+                              journalPathPtr,
+                              sizeof(groupRef->journalPath),
+                              NULL));
+    groupRef->lockFd = lockFd;
+    groupRef->updateList = LE_DLS_LIST_INIT;
+    groupRef->journalHash = HashLine(FNV_OFFSET_BASIS, JOURNAL_HEADER);
+
+    // The journal lists the temporary files from the start: a crash doesn't leave any behind.
+    groupRef->journalFd = open(journalPathPtr,
+                               O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                               S_IRUSR | S_IWUSR);
+
+    if (   (-1 == groupRef->journalFd)
+        || (LE_OK != WriteAll(groupRef->journalFd, JOURNAL_HEADER, strlen(JOURNAL_HEADER))))
+    {
+        LE_ERROR("Can't create journal '%s': %m", journalPathPtr);
+        if (-1 != groupRef->journalFd)
+        {
+            close(groupRef->journalFd);
+            unlink(journalPathPtr);
+        }
+        close(lockFd);
+        le_mem_Release(groupRef);
+        return NULL;
+    }
+
+    // The file system of the journal is flushed with the ones of the temporary files.
+    int fd = dup(groupRef->journalFd);
+
+    if ((-1 != fd) && !AddFileSystem(groupRef, fd))
+    {
+        close(fd);
+    }
+
+    return groupRef;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stage the new content of a file. The mode of an existing file is kept.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the path is too long
+ *      - LE_FAULT if the temporary file can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Write
+(
+    atomGroup_Ref_t groupRef,       ///< [IN] Group
+    const char*     pathPtr,        ///< [IN] File path
+    const void*     bufPtr,         ///< [IN] New content
+    size_t          size,           ///< [IN] Content size
+    mode_t          mode            ///< [IN] Mode of a new file
+)
+{
+    char tmpPath[PATH_MAX];
+    Update_t* updatePtr;
+    struct stat st;
+
+    if ((NULL == bufPtr) && (size > 0))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    le_result_t result = GetUpdate(groupRef, pathPtr, &updatePtr);
+    if (LE_OK != result)
+    {
+        return result;
+    }
+
+    updatePtr->isDelete = false;
+    LE_ASSERT_OK(GetTmpPath(pathPtr, tmpPath));
+
+    if (!updatePtr->isJournaled)
+    {
+        char line[LINE_BYTES];
+
+        snprintf(line, sizeof(line), "S %s\n", pathPtr);
+        if (LE_OK != AppendJournalLine(groupRef, line))
+        {
+            return LE_FAULT;
+        }
+        updatePtr->isJournaled = true;
+    }
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (-1 == fd)
+    {
+        LE_ERROR("Can't create '%s': %m", tmpPath);
+        return LE_FAULT;
+    }
+
+    if (0 == stat(pathPtr, &st))
+    {
+        fchmod(fd, st.st_mode & (S_ISUID | S_ISGID | S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO));
+    }
+
+    if (LE_OK != WriteAll(fd, bufPtr, size))
+    {
+        LE_ERROR("Can't write '%s': %m", tmpPath);
+        close(fd);
+        return LE_FAULT;
+    }
+
+    updatePtr->size = size;
+    updatePtr->hash = HashData(FNV_OFFSET_BASIS, bufPtr, size);
+
+    if (!AddFileSystem(groupRef, fd))
+    {
+        close(fd);
+    }
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stage the deletion of a file
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Delete
+(
+    atomGroup_Ref_t groupRef,       ///< [IN] Group
+    const char*     pathPtr         ///< [IN] File path
+)
+{
+    char tmpPath[PATH_MAX];
+    Update_t* updatePtr;
+
+    le_result_t result = GetUpdate(groupRef, pathPtr, &updatePtr);
+    if (LE_OK != result)
+    {
+        return result;
+    }
+
+    if (!updatePtr->isDelete)
+    {
+        // Drop the content staged before, if any.
+        LE_ASSERT_OK(GetTmpPath(pathPtr, tmpPath));
+        unlink(tmpPath);
+    }
+
+    updatePtr->isDelete = true;
+
+    return LE_OK;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply all the staged updates atomically, and delete the group
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the group reference is invalid
+ *      - LE_FAULT if the journal can't be written, in which case no update was applied, or if an
+ *        update can't be applied, in which case the journal is kept to be replayed by the next
+ *        recovery
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Commit
+(
+    atomGroup_Ref_t groupRef        ///< [IN] Group
+)
+{
+    le_result_t result = LE_OK;
+
+    if (NULL == groupRef)
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    // Nothing to write: don't flush anything.
+    if (0 == groupRef->updateCount)
+    {
+        atomGroup_Cancel(groupRef);
+        return LE_OK;
+    }
+
+    // The new contents must be on disk before the journal is complete: a complete journal is
+    // replayed, and a temporary file it lists must not be lost or truncated.
+    Flush(groupRef);
+
+    if (LE_OK != CompleteJournal(groupRef))
+    {
+        atomGroup_Cancel(groupRef);
+        return LE_FAULT;
+    }
+
+    le_dls_Link_t* linkPtr = le_dls_Peek(&groupRef->updateList);
+
+    while (NULL != linkPtr)
+    {
+        Update_t* updatePtr = CONTAINER_OF(linkPtr, Update_t, link);
+
+        if (LE_OK != ApplyUpdate(updatePtr->isDelete, updatePtr->path))
+        {
+            result = LE_FAULT;
+        }
+
+        linkPtr = le_dls_PeekNext(&groupRef->updateList, linkPtr);
+    }
+
+    // The renames must be on disk before the journal disappears, and the journal must be gone
+    // before a later update of the same files, which it would undo if replayed.
+    Flush(groupRef);
+
+    if (LE_OK == result)
+    {
+        unlink(groupRef->journalPath);
+        Flush(groupRef);
+
+        Stats.commits++;
+        Stats.files += groupRef->updateCount;
+    }
+    else
+    {
+        LE_ERROR("Commit of journal '%s' incomplete, kept for recovery", groupRef->journalPath);
+    }
+
+    DropUpdates(groupRef, false);
+    DeleteGroup(groupRef);
+
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the staged updates, and delete the group
+ */
+//--------------------------------------------------------------------------------------------------
+void atomGroup_Cancel
+(
+    atomGroup_Ref_t groupRef        ///< [IN] Group
+)
+{
+    if (NULL == groupRef)
+    {
+        return;
+    }
+
+    DropUpdates(groupRef, true);
+    unlink(groupRef->journalPath);
+    DeleteGroup(groupRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the group commit statistics of the process
+ */
+//--------------------------------------------------------------------------------------------------
+void atomGroup_GetStats
+(
+    atomGroup_Stats_t* statsPtr     ///< [OUT] Statistics
+)
+{
+    LE_ASSERT(statsPtr != NULL);
+
+    *statsPtr = Stats;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file atomGroup.h
+ *
+ * Group commit of several atomic file updates.
+ *
+ * Each le_atomFile commit flushes its own temporary file and directory, so persisting many small
+ * files costs a flush pair per file. A group stages the new content of several files, and of the
+ * files to delete, then commits all of them together: either all the updates are visible after a
+ * crash, or none of them.
+ *
+ * The new contents are written to temporary files next to their targets, without any flush, and
+ * listed in an intent journal as they are staged. On commit:
+ *  -# the file systems holding the temporary files and the journal are flushed (syncfs),
+ *  -# the updates, with the size and checksum of each new content, and an end line are appended
+ *     to the journal, which is flushed (fdatasync): this is the commit point,
+ *  -# the temporary files are renamed over their targets and the deleted files are removed,
+ *  -# the file systems are flushed again,
+ *  -# the journal is removed and the file systems are flushed a last time.
+ *
+ * The number of flushes only depends on the number of file systems involved, not on the number of
+ * files. A journal left by a crash is replayed by atomGroup_Recover(), which is also done when a
+ * group is created. A journal interrupted before the commit point, or whose temporary files don't
+ * hold the recorded contents, is discarded along with all its temporary files.
+ *
+ * A group holds an exclusive lock on its journal from its creation to its commit or cancellation.
+ * It doesn't take the le_atomFile locks of its targets: the files updated through a group must not
+ * be written through le_atomFile at the same time.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#ifndef ATOMGROUP_H_INCLUDE_GUARD
+#define ATOMGROUP_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Suffix of the temporary files holding the staged contents
+ */
+//--------------------------------------------------------------------------------------------------
+#define ATOMGROUP_TMP_SUFFIX        ".grp~"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a group
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct atomGroup* atomGroup_Ref_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Group commit statistics, for all the groups of the process
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t commits;           ///< Number of groups committed
+    uint32_t files;             ///< Number of files updated or deleted by the commits
+    uint32_t syncs;             ///< Number of file system flushes
+    uint32_t replays;           ///< Number of journals replayed by a recovery
+    uint32_t discards;          ///< Number of journals discarded by a recovery
+}
+atomGroup_Stats_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete or discard the commit interrupted by a crash, if any
+ *
+ * @return
+ *      - LE_OK if there was nothing to do or the commit was completed
+ *      - LE_NOT_FOUND if an incomplete journal was discarded, with its temporary files: no update
+ *        was applied
+ *      - LE_FAULT if the journal can't be read or an update can't be applied
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Recover
+(
+    const char* journalPathPtr      ///< [IN] Journal path
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a group. Blocks until the journal is not used by another group, then recovers the
+ * previous commit if it was interrupted.
+ *
+ * @return the group reference, NULL if the journal can't be locked or recovered
+ */
+//--------------------------------------------------------------------------------------------------
+atomGroup_Ref_t atomGroup_Create
+(
+    const char* journalPathPtr      ///< [IN] Journal path
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stage the new content of a file. The mode of an existing file is kept.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the path is too long
+ *      - LE_FAULT if the temporary file can't be written
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Write
+(
+    atomGroup_Ref_t groupRef,       ///< [IN] Group
+    const char*     pathPtr,        ///< [IN] File path
+    const void*     bufPtr,         ///< [IN] New content
+    size_t          size,           ///< [IN] Content size
+    mode_t          mode            ///< [IN] Mode of a new file
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stage the deletion of a file
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if a parameter is invalid
+ *      - LE_OVERFLOW if the path is too long
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Delete
+(
+    atomGroup_Ref_t groupRef,       ///< [IN] Group
+    const char*     pathPtr         ///< [IN] File path
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply all the staged updates atomically, and delete the group
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_BAD_PARAMETER if the group reference is invalid
+ *      - LE_FAULT if the journal can't be written, in which case no update was applied, or if an
+ *        update can't be applied, in which case the journal is kept to be replayed by the next
+ *        recovery
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t atomGroup_Commit
+(
+    atomGroup_Ref_t groupRef        ///< [IN] Group
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the staged updates, and delete the group
+ */
+//--------------------------------------------------------------------------------------------------
+void atomGroup_Cancel
+(
+    atomGroup_Ref_t groupRef        ///< [IN] Group
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the group commit statistics of the process
+ */
+//--------------------------------------------------------------------------------------------------
+void atomGroup_GetStats
+(
+    atomGroup_Stats_t* statsPtr     ///< [OUT] Statistics
+);
+
+#endif // ATOMGROUP_H_INCLUDE_GUARD
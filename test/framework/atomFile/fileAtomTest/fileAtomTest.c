@@ -1,6 +1,10 @@
 #include "legato.h"
 #include "file.h"
 #include "fileDescriptor.h"
+#include "atomGroup.h"
+
+#include <sys/wait.h>
+#include <dlfcn.h>
 
 
 const char* TestFileList[][3] =
@@ -19,6 +23,91 @@ const char* TestFileList[][3] =
 
 static const char WriteStr[] = "This string is for atomic writing";
 
+// Number of files updated together by the group commit tests
+#define GROUP_FILE_COUNT        32
+
+// Number of times a process committing groups is killed
+#define GROUP_CRASH_COUNT       20
+
+// Number of flushes done by the process, counted by the C library wrappers below, which le_atomFile
+// and atomGroup call instead of the C library functions.
+static uint32_t FlushCount = 0;
+
+// Kill the process on its next rename, i.e. right after the commit point of a group.
+static bool KillOnRename = false;
+
+static void* GetLibcFunction(const char* namePtr)
+{
+    void* functionPtr = dlsym(RTLD_NEXT, namePtr);
+
+    LE_ASSERT(functionPtr != NULL);
+    return functionPtr;
+}
+
+int fsync(int fd)
+{
+    static int (*realFsync)(int) = NULL;
+
+    if (NULL == realFsync)
+    {
+        realFsync = GetLibcFunction("fsync");
+    }
+    FlushCount++;
+    return realFsync(fd);
+}
+
+int fdatasync(int fd)
+{
+    static int (*realFdatasync)(int) = NULL;
+
+    if (NULL == realFdatasync)
+    {
+        realFdatasync = GetLibcFunction("fdatasync");
+    }
+    FlushCount++;
+    return realFdatasync(fd);
+}
+
+int syncfs(int fd)
+{
+    static int (*realSyncfs)(int) = NULL;
+
+    if (NULL == realSyncfs)
+    {
+        realSyncfs = GetLibcFunction("syncfs");
+    }
+    FlushCount++;
+    return realSyncfs(fd);
+}
+
+void sync(void)
+{
+    static void (*realSync)(void) = NULL;
+
+    if (NULL == realSync)
+    {
+        realSync = GetLibcFunction("sync");
+    }
+    FlushCount++;
+    realSync();
+}
+
+int rename(const char* oldPathPtr, const char* newPathPtr)
+{
+    static int (*realRename)(const char*, const char*) = NULL;
+
+    if (KillOnRename)
+    {
+        kill(getpid(), SIGKILL);
+    }
+
+    if (NULL == realRename)
+    {
+        realRename = GetLibcFunction("rename");
+    }
+    return realRename(oldPathPtr, newPathPtr);
+}
+
 char* AccessModeToString
 (
     le_flock_AccessMode_t accessMode
@@ -816,6 +905,248 @@ static void CheckFlags
     le_atomFile_CloseStream(filePtr);
 }
 
+static void GetGroupFilePath(const char* filePath, int index, char* pathPtr, size_t size)
+{
+    snprintf(pathPtr, size, "%s.group%d", filePath, index);
+}
+
+
+// Commit a generation number to all the files of a group.
+static void CommitGeneration(const char* filePath, const char* journalPath, int generation)
+{
+    char path[PATH_MAX];
+    char content[32];
+    int i;
+
+    atomGroup_Ref_t groupRef = atomGroup_Create(journalPath);
+    LE_ASSERT(groupRef != NULL);
+
+    int len = snprintf(content, sizeof(content), "%d\n", generation);
+
+    for (i = 0; i < GROUP_FILE_COUNT; i++)
+    {
+        GetGroupFilePath(filePath, i, path, sizeof(path));
+        LE_ASSERT_OK(atomGroup_Write(groupRef, path, content, len, S_IRUSR | S_IWUSR));
+    }
+
+    LE_ASSERT_OK(atomGroup_Commit(groupRef));
+}
+
+
+// Check that no temporary file of a group is left.
+static void CheckNoTmpFile(const char* filePath)
+{
+    char path[PATH_MAX];
+    int i;
+
+    for (i = 0; i < GROUP_FILE_COUNT; i++)
+    {
+        GetGroupFilePath(filePath, i, path, sizeof(path));
+        LE_ASSERT(le_utf8_Append(path, ATOMGROUP_TMP_SUFFIX, sizeof(path), NULL) == LE_OK);
+        PRINT_ERR_IF(file_Exists(path), "Failed. Temporary file '%s' left", path);
+    }
+}
+
+
+// Commit a generation number to all the files of a group in a child process, which is killed
+// right after the commit point: the journal is complete and the temporary files are all there.
+static void CommitGenerationAndKill(const char* filePath, const char* journalPath, int generation)
+{
+    pid_t childPID = fork();
+
+    LE_ASSERT(childPID >= 0);
+
+    if (childPID == 0)
+    {
+        KillOnRename = true;
+        CommitGeneration(filePath, journalPath, generation);
+        exit(EXIT_FAILURE);
+    }
+
+    int status;
+    LE_ASSERT(waitpid(childPID, &status, 0) == childPID);
+    LE_ASSERT(WIFSIGNALED(status) && (WTERMSIG(status) == SIGKILL));
+    LE_ASSERT(file_Exists(journalPath));
+}
+
+
+// Check that all the files of a group hold the same generation number, and return it.
+static int CheckGeneration(const char* filePath)
+{
+    char path[PATH_MAX];
+    int expected = -1;
+    int i;
+
+    for (i = 0; i < GROUP_FILE_COUNT; i++)
+    {
+        int generation = -1;
+
+        GetGroupFilePath(filePath, i, path, sizeof(path));
+        FILE* file = fopen(path, "r");
+        LE_ASSERT(file != NULL);
+        LE_ASSERT(fscanf(file, "%d", &generation) == 1);
+        fclose(file);
+
+        if (0 == i)
+        {
+            expected = generation;
+        }
+
+        PRINT_ERR_IF(generation != expected,
+                     "Failed. Group not atomic: '%s' holds %d, '%s0' holds %d",
+                     path, generation, filePath, expected);
+    }
+
+    return expected;
+}
+
+
+static int64_t GetElapsedUs(le_clk_Time_t startTime)
+{
+    le_clk_Time_t elapsed = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    return (int64_t)elapsed.sec * 1000000 + elapsed.usec;
+}
+
+
+// Kill processes committing groups at random points, and check that the recovery always leaves
+// the files of a group all updated or all unchanged. Then compare the group commit with one
+// le_atomFile commit per file.
+static void TestGroupCommit
+(
+    const char* filePath
+)
+{
+    char journalPath[PATH_MAX];
+    char path[PATH_MAX];
+    atomGroup_Stats_t startStats;
+    atomGroup_Stats_t endStats;
+    le_clk_Time_t startTime;
+    uint32_t startFlushCount;
+    int i;
+
+    snprintf(journalPath, sizeof(journalPath), "%s.journal", filePath);
+
+    CommitGeneration(filePath, journalPath, 0);
+    LE_ASSERT(CheckGeneration(filePath) == 0);
+
+    // A group staged then abandoned by a crash leaves the files unchanged, and no temporary file.
+    pid_t childPID = fork();
+
+    if (childPID == 0)
+    {
+        atomGroup_Ref_t groupRef = atomGroup_Create(journalPath);
+        for (i = 0; i < GROUP_FILE_COUNT; i++)
+        {
+            GetGroupFilePath(filePath, i, path, sizeof(path));
+            LE_ASSERT_OK(atomGroup_Write(groupRef, path, "-1\n", 3, S_IRUSR | S_IWUSR));
+        }
+        sleep(2000);
+        atomGroup_Cancel(groupRef);
+    }
+    else if (childPID > 0)
+    {
+        sleep(1);
+        kill(childPID, SIGKILL);
+        waitpid(childPID, NULL, 0);
+        LE_ASSERT(atomGroup_Recover(journalPath) == LE_NOT_FOUND);
+        LE_ASSERT(CheckGeneration(filePath) == 0);
+        CheckNoTmpFile(filePath);
+    }
+
+    // A commit interrupted after its commit point is completed by the recovery.
+    CommitGenerationAndKill(filePath, journalPath, 1);
+    LE_ASSERT(CheckGeneration(filePath) == 0);
+    LE_ASSERT(atomGroup_Recover(journalPath) == LE_OK);
+    LE_ASSERT(CheckGeneration(filePath) == 1);
+    CheckNoTmpFile(filePath);
+
+    // Unless a temporary file doesn't hold what the journal recorded, e.g. truncated by a crash
+    // because it was not on disk before the journal: the whole group is discarded.
+    CommitGenerationAndKill(filePath, journalPath, 2);
+    GetGroupFilePath(filePath, GROUP_FILE_COUNT / 2, path, sizeof(path));
+    LE_ASSERT(le_utf8_Append(path, ATOMGROUP_TMP_SUFFIX, sizeof(path), NULL) == LE_OK);
+    LE_ASSERT(truncate(path, 1) == 0);
+    LE_ASSERT(atomGroup_Recover(journalPath) == LE_NOT_FOUND);
+    LE_ASSERT(CheckGeneration(filePath) == 1);
+    CheckNoTmpFile(filePath);
+
+    // Groups committed in a loop, interrupted anywhere.
+    srand(getpid());
+
+    for (i = 0; i < GROUP_CRASH_COUNT; i++)
+    {
+        childPID = fork();
+
+        if (childPID == 0)
+        {
+            int generation = 1;
+            while (true)
+            {
+                CommitGeneration(filePath, journalPath, generation++);
+            }
+        }
+        else if (childPID > 0)
+        {
+            usleep(1000 + rand() % 50000);
+            kill(childPID, SIGKILL);
+            waitpid(childPID, NULL, 0);
+            LE_ASSERT(atomGroup_Recover(journalPath) != LE_FAULT);
+            LE_INFO("Child killed at generation %d", CheckGeneration(filePath));
+            CheckNoTmpFile(filePath);
+        }
+    }
+
+    // One le_atomFile commit per file.
+    startFlushCount = FlushCount;
+    startTime = le_clk_GetRelativeTime();
+    for (i = 0; i < GROUP_FILE_COUNT; i++)
+    {
+        GetGroupFilePath(filePath, i, path, sizeof(path));
+        int fd = le_atomFile_Create(path, LE_FLOCK_WRITE, LE_FLOCK_REPLACE_IF_EXIST, S_IRWXU);
+        LE_ASSERT(fd > 0);
+        WriteString(fd, 1);
+        le_atomFile_Close(fd);
+    }
+    int64_t atomFileUs = GetElapsedUs(startTime);
+    uint32_t atomFileFlushes = FlushCount - startFlushCount;
+
+    // All the files in one group.
+    atomGroup_GetStats(&startStats);
+    startFlushCount = FlushCount;
+    startTime = le_clk_GetRelativeTime();
+    CommitGeneration(filePath, journalPath, 0);
+    int64_t groupUs = GetElapsedUs(startTime);
+    uint32_t groupFlushes = FlushCount - startFlushCount;
+    atomGroup_GetStats(&endStats);
+
+    LE_ASSERT(CheckGeneration(filePath) == 0);
+
+    // Every flush counted by the group statistics went through the wrappers.
+    LE_ASSERT(groupFlushes >= endStats.syncs - startStats.syncs);
+    LE_ASSERT(groupFlushes < atomFileFlushes);
+
+    LE_INFO("%d files in '%s': le_atomFile %"PRIu32" flushes in %"PRId64" us,"
+            " group %"PRIu32" flushes in %"PRId64" us",
+            GROUP_FILE_COUNT,
+            filePath,
+            atomFileFlushes,
+            atomFileUs,
+            groupFlushes,
+            groupUs);
+
+    for (i = 0; i < GROUP_FILE_COUNT; i++)
+    {
+        GetGroupFilePath(filePath, i, path, sizeof(path));
+        unlink(path);
+    }
+
+    snprintf(path, sizeof(path), "%s.lock", journalPath);
+    unlink(path);
+    LE_ASSERT(file_Exists(journalPath) == false);
+}
+
+
 void TestMultiProcessAccess
 (
     const char* filePath
@@ -1041,6 +1372,11 @@ void TestMultiProcessAccess
         le_result_t result = le_atomFile_Delete(filePath);
         LE_ASSERT(result == LE_NOT_FOUND);
     }
+
+    // Now check the group commit of several files.
+
+    LE_INFO("Doing group commit test");
+    TestGroupCommit(filePath);
 }
 
 
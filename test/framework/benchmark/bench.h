@@ -0,0 +1,58 @@
+/**
+ * bench.h
+ *
+ * Shared definitions of the framework micro-benchmarks.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current time, to be passed to bench_Report() once the measured operations are done.
+ */
+//--------------------------------------------------------------------------------------------------
+#define bench_Start()   le_clk_GetRelativeTime()
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a benchmark result as a JSON object in the results array.
+ *
+ * The parameters format describes the additional members of the object, e.g. "\"keys\": %d".
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Report
+(
+    const char*   suitePtr,         ///< [IN] Benchmark suite, i.e. module measured
+    const char*   testPtr,          ///< [IN] Operation measured
+    uint64_t      opsCount,         ///< [IN] Number of operations done
+    le_clk_Time_t startTime,        ///< [IN] Time returned by bench_Start()
+    const char*   paramsFmtPtr,     ///< [IN] Format of the test parameters
+    ...                             ///< [IN] Test parameters
+) __attribute__ ((format (printf, 5, 6)));
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the memory pool benchmarks.
+ */
+//--------------------------------------------------------------------------------------------------
+void memPoolBench_Run
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the hashmap benchmarks.
+ */
+//--------------------------------------------------------------------------------------------------
+void hashmapBench_Run
+(
+    void
+);
+
+#endif // _BENCH_H
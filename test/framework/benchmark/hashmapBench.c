@@ -0,0 +1,174 @@
+/**
+ * Hashmap micro-benchmarks: put, get, iterate and remove rates, and collision chains, for several
+ * key counts and map capacities.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "bench.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of keys put in a map.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_KEYS            10000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of times the lookups are repeated, so that small maps are measured over a significant
+ * number of operations.
+ */
+//--------------------------------------------------------------------------------------------------
+#define GET_OPS             1000000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the string keys, like the asset paths used by the avcDaemon.
+ */
+//--------------------------------------------------------------------------------------------------
+#define KEY_BYTES           32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maps, one per capacity. 31 is the capacity of the avcDaemon asset map.
+ *
+ * A hashmap can't be deleted: each map is created once, emptied at the end of each run and reused
+ * by the next key count.
+ */
+//--------------------------------------------------------------------------------------------------
+static struct
+{
+    const char*      name;
+    size_t           capacity;
+    le_hashmap_Ref_t mapRef;
+}
+Maps[] =
+{
+    { "BenchMap31",    31,       NULL },
+    { "BenchMap200",   200,      NULL },
+    { "BenchMap1024",  1024,     NULL },
+    { "BenchMap10000", MAX_KEYS, NULL },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of keys put in the maps.
+ */
+//--------------------------------------------------------------------------------------------------
+static const size_t KeyCounts[] = { 100, 1000, MAX_KEYS };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keys, and missing keys used for lookup misses.
+ */
+//--------------------------------------------------------------------------------------------------
+static char Keys[MAX_KEYS][KEY_BYTES];
+static char MissingKeys[MAX_KEYS][KEY_BYTES];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the benchmarks on one map configuration. The map is empty when the run ends.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchMap
+(
+    le_hashmap_Ref_t mapRef,
+    size_t capacity,
+    size_t keysCount
+)
+{
+    le_hashmap_It_Ref_t itRef;
+    le_clk_Time_t startTime;
+    size_t collisions;
+    size_t i;
+    size_t count;
+
+    LE_ASSERT(le_hashmap_isEmpty(mapRef));
+
+    startTime = bench_Start();
+    for (i = 0; i < keysCount; i++)
+    {
+        le_hashmap_Put(mapRef, Keys[i], Keys[i]);
+    }
+    bench_Report("hashmap", "put", keysCount, startTime,
+                 "\"capacity\": %zu, \"keys\": %zu", capacity, keysCount);
+
+    startTime = bench_Start();
+    for (i = 0; i < GET_OPS; i++)
+    {
+        LE_ASSERT(le_hashmap_Get(mapRef, Keys[i % keysCount]) != NULL);
+    }
+    bench_Report("hashmap", "getHit", GET_OPS, startTime,
+                 "\"capacity\": %zu, \"keys\": %zu", capacity, keysCount);
+
+    startTime = bench_Start();
+    for (i = 0; i < GET_OPS; i++)
+    {
+        LE_ASSERT(le_hashmap_Get(mapRef, MissingKeys[i % keysCount]) == NULL);
+    }
+    bench_Report("hashmap", "getMiss", GET_OPS, startTime,
+                 "\"capacity\": %zu, \"keys\": %zu", capacity, keysCount);
+
+    startTime = bench_Start();
+    itRef = le_hashmap_GetIterator(mapRef);
+    count = 0;
+    while (le_hashmap_NextNode(itRef) == LE_OK)
+    {
+        count++;
+    }
+    LE_ASSERT(count == keysCount);
+    bench_Report("hashmap", "iterate", keysCount, startTime,
+                 "\"capacity\": %zu, \"keys\": %zu", capacity, keysCount);
+
+    collisions = le_hashmap_CountCollisions(mapRef);
+
+    startTime = bench_Start();
+    for (i = 0; i < keysCount; i++)
+    {
+        LE_ASSERT(le_hashmap_Remove(mapRef, Keys[i]) != NULL);
+    }
+    bench_Report("hashmap", "remove", keysCount, startTime,
+                 "\"capacity\": %zu, \"keys\": %zu, \"collisions\": %zu",
+                 capacity, keysCount, collisions);
+
+    LE_ASSERT(le_hashmap_isEmpty(mapRef));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the hashmap benchmarks.
+ */
+//--------------------------------------------------------------------------------------------------
+void hashmapBench_Run
+(
+    void
+)
+{
+    int c;
+    int k;
+    int i;
+
+    for (i = 0; i < MAX_KEYS; i++)
+    {
+        snprintf(Keys[i], KEY_BYTES, "/app/asset%d/%d", i % 16, i);
+        snprintf(MissingKeys[i], KEY_BYTES, "/app/missing%d/%d", i % 16, i);
+    }
+
+    for (c = 0; c < NUM_ARRAY_MEMBERS(Maps); c++)
+    {
+        if (NULL == Maps[c].mapRef)
+        {
+            Maps[c].mapRef = le_hashmap_Create(Maps[c].name,
+                                               Maps[c].capacity,
+                                               le_hashmap_HashString,
+                                               le_hashmap_EqualsString);
+        }
+
+        for (k = 0; k < NUM_ARRAY_MEMBERS(KeyCounts); k++)
+        {
+            BenchMap(Maps[c].mapRef, Maps[c].capacity, KeyCounts[k]);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * This module implements micro-benchmarks of the le_mem and le_hashmap modules in the legato
+ * runtime library (liblegato.so).
+ *
+ * Results are written on the standard output as a JSON document:
+ *
+ * @code
+ * {
+ *   "results": [
+ *     { "suite": "memPool", "test": "allocRelease", "ops": 1000000, "elapsedUs": 41000,
+ *       "opsPerSec": 24390243, "threads": 1 },
+ *     ...
+ *   ]
+ * }
+ * @endcode
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "bench.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Serializes the results output, as some benchmarks run on several threads.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t ReportMutex;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of results reported so far.
+ */
+//--------------------------------------------------------------------------------------------------
+static unsigned int ReportCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a benchmark result as a JSON object in the results array.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Report
+(
+    const char*   suitePtr,         ///< [IN] Benchmark suite, i.e. module measured
+    const char*   testPtr,          ///< [IN] Operation measured
+    uint64_t      opsCount,         ///< [IN] Number of operations done
+    le_clk_Time_t startTime,        ///< [IN] Time returned by bench_Start()
+    const char*   paramsFmtPtr,     ///< [IN] Format of the test parameters
+    ...                             ///< [IN] Test parameters
+)
+{
+    le_clk_Time_t elapsed = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+    uint64_t elapsedUs = (uint64_t)elapsed.sec * 1000000 + elapsed.usec;
+    va_list args;
+
+    le_mutex_Lock(ReportMutex);
+
+    printf("%s    { \"suite\": \"%s\", \"test\": \"%s\", \"ops\": %"PRIu64", \"elapsedUs\": %"PRIu64
+           ", \"opsPerSec\": %"PRIu64,
+           (ReportCount ? ",\n" : ""),
+           suitePtr,
+           testPtr,
+           opsCount,
+           elapsedUs,
+           elapsedUs ? (opsCount * 1000000) / elapsedUs : 0);
+
+    if (paramsFmtPtr && *paramsFmtPtr)
+    {
+        printf(", ");
+        va_start(args, paramsFmtPtr);
+        vprintf(paramsFmtPtr, args);
+        va_end(args);
+    }
+
+    printf(" }");
+    ReportCount++;
+
+    le_mutex_Unlock(ReportMutex);
+}
+
+COMPONENT_INIT
+{
+    ReportMutex = le_mutex_CreateNonRecursive("BenchReportMutex");
+
+    printf("{\n  \"results\": [\n");
+
+    memPoolBench_Run();
+    hashmapBench_Run();
+
+    printf("\n  ]\n}\n");
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,198 @@
+/**
+ * Memory pool micro-benchmarks: allocation/release throughput on a single thread and on several
+ * threads sharing the same pool, and the cost of allocating from a sub-pool.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "bench.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of allocation/release cycles done by each thread.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ALLOC_CYCLES        1000000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of blocks held at the same time by each thread, so that the pool free list is actually
+ * walked instead of always returning the same block.
+ */
+//--------------------------------------------------------------------------------------------------
+#define BLOCKS_HELD         64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of threads sharing a pool.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_THREADS         8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the objects allocated, close to the avcDaemon asset data objects.
+ */
+//--------------------------------------------------------------------------------------------------
+#define OBJECT_SIZE         64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Context of an allocating thread.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_mem_PoolRef_t poolRef;       ///< Pool to allocate from
+    le_sem_Ref_t     startSem;      ///< Released when all the threads are ready
+}
+AllocContext_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate and release blocks from a pool.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AllocReleaseLoop
+(
+    le_mem_PoolRef_t poolRef
+)
+{
+    void* blocksPtr[BLOCKS_HELD];
+    int i;
+    int j;
+
+    for (i = 0; i < ALLOC_CYCLES / BLOCKS_HELD; i++)
+    {
+        for (j = 0; j < BLOCKS_HELD; j++)
+        {
+            blocksPtr[j] = le_mem_TryAlloc(poolRef);
+            LE_ASSERT(blocksPtr[j] != NULL);
+        }
+
+        for (j = 0; j < BLOCKS_HELD; j++)
+        {
+            le_mem_Release(blocksPtr[j]);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocating thread main function.
+ */
+//--------------------------------------------------------------------------------------------------
+static void* AllocThread
+(
+    void* contextPtr
+)
+{
+    AllocContext_t* ctxPtr = contextPtr;
+
+    le_sem_Wait(ctxPtr->startSem);
+    AllocReleaseLoop(ctxPtr->poolRef);
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the allocation/release throughput of a pool shared by several threads.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchAllocRelease
+(
+    le_mem_PoolRef_t poolRef,
+    const char*      testPtr,
+    int              threadsCount
+)
+{
+    le_thread_Ref_t threads[MAX_THREADS];
+    AllocContext_t ctx;
+    le_clk_Time_t startTime;
+    int i;
+
+    LE_ASSERT(threadsCount <= MAX_THREADS);
+
+    ctx.poolRef = poolRef;
+    ctx.startSem = le_sem_Create("AllocStartSem", 0);
+
+    for (i = 0; i < threadsCount; i++)
+    {
+        threads[i] = le_thread_Create("AllocThread", AllocThread, &ctx);
+        le_thread_SetJoinable(threads[i]);
+        le_thread_Start(threads[i]);
+    }
+
+    startTime = bench_Start();
+
+    for (i = 0; i < threadsCount; i++)
+    {
+        le_sem_Post(ctx.startSem);
+    }
+
+    for (i = 0; i < threadsCount; i++)
+    {
+        LE_ASSERT_OK(le_thread_Join(threads[i], NULL));
+    }
+
+    bench_Report("memPool", testPtr, (uint64_t)threadsCount * ALLOC_CYCLES, startTime,
+                 "\"threads\": %d, \"objectSize\": %d", threadsCount, OBJECT_SIZE);
+
+    le_sem_Delete(ctx.startSem);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the cost of expanding a pool.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchExpand
+(
+    void
+)
+{
+    le_mem_PoolRef_t poolRef = le_mem_CreatePool("BenchExpandPool", OBJECT_SIZE);
+    le_clk_Time_t startTime = bench_Start();
+
+    le_mem_ExpandPool(poolRef, ALLOC_CYCLES);
+
+    bench_Report("memPool", "expand", ALLOC_CYCLES, startTime,
+                 "\"objectSize\": %d", OBJECT_SIZE);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the memory pool benchmarks.
+ */
+//--------------------------------------------------------------------------------------------------
+void memPoolBench_Run
+(
+    void
+)
+{
+    le_mem_PoolRef_t poolRef;
+    le_mem_PoolRef_t subPoolRef;
+    int threadsCount;
+
+    poolRef = le_mem_CreatePool("BenchPool", OBJECT_SIZE);
+    le_mem_ExpandPool(poolRef, MAX_THREADS * BLOCKS_HELD);
+
+    for (threadsCount = 1; threadsCount <= MAX_THREADS; threadsCount *= 2)
+    {
+        BenchAllocRelease(poolRef, "allocRelease", threadsCount);
+    }
+
+    // Same measure through a sub-pool, carved out of the pool measured above
+    subPoolRef = le_mem_CreateSubPool(poolRef, "BenchSubPool", MAX_THREADS * BLOCKS_HELD);
+
+    for (threadsCount = 1; threadsCount <= MAX_THREADS; threadsCount *= 2)
+    {
+        BenchAllocRelease(subPoolRef, "subPoolAllocRelease", threadsCount);
+    }
+
+    le_mem_DeleteSubPool(subPoolRef);
+
+    BenchExpand();
+}
@@ -1,6 +1,7 @@
 
 #include "legato.h"
 #include "interfaces.h"
+#include "cfgBatch.h"
 
 
 
@@ -18,6 +19,20 @@ static char TestRootDir[LE_CFG_STR_LEN_BYTES] = "";
 // 2 bytes + null ; small string
 #define TEST_PATTERN_SMALL_STRING   "12"
 
+// Name of the instance running the batch and cache benchmark
+#define BENCH_INSTANCE_NAME         "bench"
+
+// Number of nodes written and read one by one then in a batch
+#define BENCH_NODE_COUNT            2000
+
+// Number of nodes read through the cache, and number of times they are read
+#define BENCH_CACHED_NODE_COUNT     200
+#define BENCH_CACHE_ROUNDS          50
+
+// Number of stems of the subtree exported and imported in bulk, and number of nodes per stem
+#define BENCH_STEM_COUNT            100
+#define BENCH_STEM_NODE_COUNT       100
+
 static const char* NodeTypeStr
 (
     le_cfg_IteratorRef_t iterRef
@@ -827,6 +842,346 @@ static void TestStringOverwrite
                 strBuffer);
 }
 
+static unsigned int BenchReportCount = 0;
+
+static void BenchReport
+(
+    const char* testPtr,
+    uint32_t opsCount,
+    le_clk_Time_t startTime
+)
+{
+    le_clk_Time_t elapsed = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+    uint64_t elapsedUs = (uint64_t)elapsed.sec * 1000000 + elapsed.usec;
+
+    printf("%s    { \"suite\": \"configTree\", \"test\": \"%s\", \"ops\": %"PRIu32
+           ", \"elapsedUs\": %"PRIu64", \"opsPerSec\": %"PRIu64" }",
+           (BenchReportCount ? ",\n" : ""),
+           testPtr,
+           opsCount,
+           elapsedUs,
+           elapsedUs ? ((uint64_t)opsCount * 1000000) / elapsedUs : 0);
+
+    BenchReportCount++;
+}
+
+
+static void CheckBenchValue
+(
+    const cfgBatch_ReadEntry_t* entryPtr,
+    int32_t expected
+)
+{
+    LE_FATAL_IF((entryPtr->result != LE_OK) || (entryPtr->intValue != expected),
+                "Test: %s - Expected %d for '%s' but got %d (%s).",
+                TestRootDir,
+                expected,
+                entryPtr->path,
+                entryPtr->intValue,
+                LE_RESULT_TXT(entryPtr->result));
+}
+
+
+// Compare thousands of reads and writes done one transaction at a time with the same accesses
+// done through cfgBatch, in a single transaction or from its client-side cache.
+static void BatchBenchmark()
+{
+    static char paths[BENCH_NODE_COUNT][TEST_NAME_SIZE];
+    static cfgBatch_ReadEntry_t entries[BENCH_NODE_COUNT];
+    static char pathBuffer[LE_CFG_STR_LEN_BYTES] = "";
+    le_clk_Time_t startTime;
+    int i;
+    int round;
+
+    LE_INFO("---- Batch And Cache Benchmark -----------------------------------------------------");
+
+    snprintf(pathBuffer, LE_CFG_STR_LEN_BYTES, "%s/batch", TestRootDir);
+
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        snprintf(paths[i], sizeof(paths[i]), "node%d", i);
+    }
+
+    // One write transaction per node.
+    startTime = le_clk_GetRelativeTime();
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        le_cfg_IteratorRef_t iterRef = le_cfg_CreateWriteTxn(pathBuffer);
+        le_cfg_SetInt(iterRef, paths[i], i);
+        le_cfg_CommitTxn(iterRef);
+    }
+    BenchReport("writeTxnPerNode", BENCH_NODE_COUNT, startTime);
+
+    // All the nodes in one write transaction.
+    startTime = le_clk_GetRelativeTime();
+    cfgBatch_WriteRef_t writeRef;
+    LE_ASSERT_OK(cfgBatch_CreateWrite(pathBuffer, &writeRef));
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        LE_ASSERT_OK(cfgBatch_SetInt(writeRef, paths[i], i + 1));
+    }
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
+    BenchReport("writeBatch", BENCH_NODE_COUNT, startTime);
+
+    // One read transaction per node.
+    startTime = le_clk_GetRelativeTime();
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(pathBuffer);
+        int32_t value = le_cfg_GetInt(iterRef, paths[i], -1);
+        le_cfg_CancelTxn(iterRef);
+
+        LE_FATAL_IF(value != i + 1,
+                    "Test: %s - Expected %d for '%s' but got %d.",
+                    TestRootDir, i + 1, paths[i], value);
+    }
+    BenchReport("readTxnPerNode", BENCH_NODE_COUNT, startTime);
+
+    // All the nodes in one read transaction.
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        entries[i] = (cfgBatch_ReadEntry_t){ .path = paths[i], .type = LE_CFG_TYPE_INT };
+    }
+
+    startTime = le_clk_GetRelativeTime();
+    LE_ASSERT_OK(cfgBatch_Read(pathBuffer, entries, BENCH_NODE_COUNT));
+    BenchReport("readBatch", BENCH_NODE_COUNT, startTime);
+
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        CheckBenchValue(&entries[i], i + 1);
+    }
+
+    // The same nodes read again and again, one at a time, through the cache.
+    cfgBatch_CacheRef_t cacheRef;
+    LE_ASSERT_OK(cfgBatch_CreateCache(pathBuffer, &cacheRef));
+
+    startTime = le_clk_GetRelativeTime();
+    for (round = 0; round < BENCH_CACHE_ROUNDS; round++)
+    {
+        for (i = 0; i < BENCH_CACHED_NODE_COUNT; i++)
+        {
+            LE_ASSERT_OK(cfgBatch_CacheRead(cacheRef, &entries[i], 1));
+        }
+    }
+    BenchReport("readCached", BENCH_CACHED_NODE_COUNT * BENCH_CACHE_ROUNDS, startTime);
+
+    for (i = 0; i < BENCH_CACHED_NODE_COUNT; i++)
+    {
+        CheckBenchValue(&entries[i], i + 1);
+    }
+
+    // And without the cache.
+    startTime = le_clk_GetRelativeTime();
+    for (round = 0; round < BENCH_CACHE_ROUNDS; round++)
+    {
+        for (i = 0; i < BENCH_CACHED_NODE_COUNT; i++)
+        {
+            LE_ASSERT_OK(cfgBatch_Read(pathBuffer, &entries[i], 1));
+        }
+    }
+    BenchReport("readUncached", BENCH_CACHED_NODE_COUNT * BENCH_CACHE_ROUNDS, startTime);
+
+    cfgBatch_CacheStats_t stats;
+    cfgBatch_GetCacheStats(cacheRef, &stats);
+
+    LE_FATAL_IF(stats.misses != BENCH_CACHED_NODE_COUNT,
+                "Test: %s - Expected %d cache misses but got %u.",
+                TestRootDir, BENCH_CACHED_NODE_COUNT, stats.misses);
+
+    // A batch committed under the cached path must not leave outdated values in the cache.
+    LE_ASSERT_OK(cfgBatch_CreateWrite(pathBuffer, &writeRef));
+    LE_ASSERT_OK(cfgBatch_SetInt(writeRef, paths[0], -42));
+    LE_ASSERT_OK(cfgBatch_DeleteNode(writeRef, paths[1]));
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
+
+    entries[1].intValue = -1;
+    LE_ASSERT_OK(cfgBatch_CacheRead(cacheRef, entries, 2));
+    CheckBenchValue(&entries[0], -42);
+    LE_FATAL_IF((entries[1].result != LE_NOT_FOUND) || (entries[1].intValue != -1),
+                "Test: %s - '%s' should have been deleted.", TestRootDir, paths[1]);
+
+    // An integer read as a boolean is reported, not replaced by the default value, both from the
+    // config tree and from the cache.
+    cfgBatch_ReadEntry_t boolEntry = { .path = paths[2], .type = LE_CFG_TYPE_BOOL,
+                                       .boolValue = true };
+    for (round = 0; round < 2; round++)
+    {
+        LE_ASSERT_OK(cfgBatch_CacheRead(cacheRef, &boolEntry, 1));
+        LE_FATAL_IF((boolEntry.result != LE_FORMAT_ERROR) || (!boolEntry.boolValue),
+                    "Test: %s - '%s' read as a boolean: %s.",
+                    TestRootDir, paths[2], LE_RESULT_TXT(boolEntry.result));
+    }
+
+    // A full cache evicts its least recently used nodes, one at a time.
+    for (i = 0; i < BENCH_NODE_COUNT; i++)
+    {
+        LE_ASSERT_OK(cfgBatch_CacheRead(cacheRef, &entries[i], 1));
+    }
+    cfgBatch_GetCacheStats(cacheRef, &stats);
+    LE_INFO("Cache: %u hits, %u misses, %u flushes, %u evictions",
+            stats.hits, stats.misses, stats.flushes, stats.evictions);
+    LE_ASSERT(stats.evictions > 0);
+
+    cfgBatch_DeleteCache(cacheRef);
+
+    // Base paths too long for the config tree are rejected.
+    static char longPath[LE_CFG_STR_LEN_BYTES + 1];
+    memset(longPath, 'x', LE_CFG_STR_LEN_BYTES);
+    LE_ASSERT(LE_OVERFLOW == cfgBatch_CreateWrite(longPath, &writeRef));
+    LE_ASSERT(LE_OVERFLOW == cfgBatch_CreateCache(longPath, &cacheRef));
+    LE_ASSERT(LE_OVERFLOW == cfgBatch_Read(longPath, entries, 1));
+
+    le_cfg_QuickDeleteNode(pathBuffer);
+}
+
+
+// Check the count and the sum of the values read from the benchmark subtree.
+static void CheckSubtreeSum
+(
+    const char* methodPtr,
+    int count,
+    int64_t sum
+)
+{
+    const int expectedCount = BENCH_STEM_COUNT * BENCH_STEM_NODE_COUNT;
+    const int64_t expectedSum = ((int64_t)expectedCount * (expectedCount + 1)) / 2;
+
+    LE_FATAL_IF((count != expectedCount) || (sum != expectedSum),
+                "Test: %s - %s: expected %d nodes summing to %"PRId64
+                " but got %d nodes summing to %"PRId64".",
+                TestRootDir, methodPtr, expectedCount, expectedSum, count, sum);
+}
+
+
+// Compare a subtree of ten thousand nodes walked and written one node at a time with the same
+// subtree exported and imported in a single request.
+static void SubtreeBenchmark()
+{
+    static char pathBuffer[LE_CFG_STR_LEN_BYTES] = "";
+    char nodePath[TEST_NAME_SIZE * 2];
+    le_clk_Time_t startTime;
+    int stem;
+    int node;
+    int count = 0;
+    int64_t sum = 0;
+
+    LE_INFO("---- Subtree Export And Import Benchmark -------------------------------------------");
+
+    snprintf(pathBuffer, LE_CFG_STR_LEN_BYTES, "%s/subtree", TestRootDir);
+
+    // Node by node, in a single write transaction.
+    startTime = le_clk_GetRelativeTime();
+    cfgBatch_WriteRef_t writeRef;
+    LE_ASSERT_OK(cfgBatch_CreateWrite(pathBuffer, &writeRef));
+    for (stem = 0; stem < BENCH_STEM_COUNT; stem++)
+    {
+        for (node = 0; node < BENCH_STEM_NODE_COUNT; node++)
+        {
+            snprintf(nodePath, sizeof(nodePath), "stem%d/node%d", stem, node);
+            LE_ASSERT_OK(cfgBatch_SetInt(writeRef, nodePath, -1));
+        }
+    }
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
+    BenchReport("subtreeWriteBatch", BENCH_STEM_COUNT * BENCH_STEM_NODE_COUNT, startTime);
+
+    // The whole subtree in one import. It replaces the subtree: the extra node must go.
+    LE_ASSERT_OK(cfgBatch_CreateWrite(pathBuffer, &writeRef));
+    LE_ASSERT_OK(cfgBatch_SetInt(writeRef, "extra", 1));
+    LE_ASSERT_OK(cfgBatch_Commit(writeRef));
+
+    startTime = le_clk_GetRelativeTime();
+    cfgBatch_SnapshotRef_t snapshotRef = cfgBatch_CreateSnapshot();
+    for (stem = 0; stem < BENCH_STEM_COUNT; stem++)
+    {
+        for (node = 0; node < BENCH_STEM_NODE_COUNT; node++)
+        {
+            snprintf(nodePath, sizeof(nodePath), "stem%d/node%d", stem, node);
+            LE_ASSERT_OK(cfgBatch_SnapshotSetInt(snapshotRef,
+                                                 nodePath,
+                                                 stem * BENCH_STEM_NODE_COUNT + node + 1));
+        }
+    }
+
+    // A failed set doesn't leave behind the stems it would have created.
+    char longPath[LE_CFG_NAME_LEN_BYTES + sizeof("partial/")] = "partial/";
+    memset(longPath + strlen(longPath), 'x', LE_CFG_NAME_LEN_BYTES);
+    LE_ASSERT(LE_OVERFLOW == cfgBatch_SnapshotSetInt(snapshotRef, longPath, 0));
+    LE_ASSERT(LE_BAD_PARAMETER == cfgBatch_SnapshotSetInt(snapshotRef, "stem0/node0/child", 0));
+    LE_ASSERT(NULL == cfgBatch_GetSnapshotNode(snapshotRef, "partial"));
+    LE_ASSERT(LE_CFG_TYPE_INT ==
+              cfgBatch_GetNodeType(cfgBatch_GetSnapshotNode(snapshotRef, "stem0/node0")));
+
+    LE_ASSERT_OK(cfgBatch_ImportSubtree(pathBuffer, snapshotRef));
+    BenchReport("subtreeImport", BENCH_STEM_COUNT * BENCH_STEM_NODE_COUNT, startTime);
+    cfgBatch_DeleteSnapshot(snapshotRef);
+
+    le_cfg_IteratorRef_t iterRef = le_cfg_CreateReadTxn(pathBuffer);
+    bool extraExists = le_cfg_NodeExists(iterRef, "extra");
+    le_cfg_CancelTxn(iterRef);
+
+    LE_FATAL_IF(extraExists, "Test: %s - The import didn't replace the subtree.", TestRootDir);
+
+    // Walked one node at a time.
+    startTime = le_clk_GetRelativeTime();
+    iterRef = le_cfg_CreateReadTxn(pathBuffer);
+    le_result_t stemResult = le_cfg_GoToFirstChild(iterRef);
+
+    while (LE_OK == stemResult)
+    {
+        le_result_t nodeResult = le_cfg_GoToFirstChild(iterRef);
+
+        while (LE_OK == nodeResult)
+        {
+            sum += le_cfg_GetInt(iterRef, "", 0);
+            count++;
+            nodeResult = le_cfg_GoToNextSibling(iterRef);
+        }
+
+        le_cfg_GoToParent(iterRef);
+        stemResult = le_cfg_GoToNextSibling(iterRef);
+    }
+
+    le_cfg_CancelTxn(iterRef);
+    BenchReport("subtreeWalkIterator", count, startTime);
+    CheckSubtreeSum("iterator", count, sum);
+
+    // Exported in one request, then walked locally.
+    count = 0;
+    sum = 0;
+
+    startTime = le_clk_GetRelativeTime();
+    LE_ASSERT_OK(cfgBatch_ExportSubtree(pathBuffer, &snapshotRef));
+
+    cfgBatch_SnapshotNodeRef_t stemRef;
+    cfgBatch_SnapshotNodeRef_t nodeRef;
+
+    for (stemRef = cfgBatch_GetFirstChild(cfgBatch_GetSnapshotNode(snapshotRef, ""));
+         NULL != stemRef;
+         stemRef = cfgBatch_GetNextSibling(stemRef))
+    {
+        for (nodeRef = cfgBatch_GetFirstChild(stemRef);
+             NULL != nodeRef;
+             nodeRef = cfgBatch_GetNextSibling(nodeRef))
+        {
+            sum += cfgBatch_GetNodeInt(nodeRef, 0);
+            count++;
+        }
+    }
+    BenchReport("subtreeExport", count, startTime);
+    CheckSubtreeSum("export", count, sum);
+
+    nodeRef = cfgBatch_GetSnapshotNode(snapshotRef, "stem1/node2");
+    LE_FATAL_IF((NULL == nodeRef) ||
+                (cfgBatch_GetNodeInt(nodeRef, 0) != BENCH_STEM_NODE_COUNT + 3),
+                "Test: %s - Wrong value exported for 'stem1/node2'.", TestRootDir);
+
+    cfgBatch_DeleteSnapshot(snapshotRef);
+
+    le_cfg_QuickDeleteNode(pathBuffer);
+}
+
+
 COMPONENT_INIT
 {
     strncpy(TestRootDir, "/configTest", LE_CFG_STR_LEN_BYTES);
@@ -852,6 +1207,15 @@ COMPONENT_INIT
     MultiTreeTest();
     ExistAndEmptyTest();
     ListTreeTest();
+
+    if (strcmp(TestRootDir, "/configTest_" BENCH_INSTANCE_NAME) == 0)
+    {
+        printf("{\n  \"results\": [\n");
+        BatchBenchmark();
+        SubtreeBenchmark();
+        printf("\n  ]\n}\n");
+    }
+
     CallbackTest();
 
     // overwrite a large string with a small string and vice-versa
@@ -9,6 +9,7 @@
 #include "limit.h"
 #include "thread.h"
 #include "mutex.h" // just for MAX_NAME_BYTES. TODO: move MAX_NAME_BYTES to limit.h
+#include "statsRegion.h"
 
 
 // Arguments
@@ -174,6 +175,10 @@ static void* ThreadCreateMutex
         mra.mutexRefArray[cnt] = le_mutex_CreateNonRecursive(mutexNameBuffer);
         le_mutex_Lock(mra.mutexRefArray[cnt]);
 
+        const statsRegion_Delta_t created[] = { { STATSREGION_MUTEXES, 1 },
+                                                { STATSREGION_LOCKED_MUTEXES, 1 } };
+        statsRegion_Update(created, NUM_ARRAY_MEMBERS(created));
+
         MutexCreateIdx++;
         cnt++;
     }
@@ -259,6 +264,7 @@ static void DelMutexes
     {
         nanosleep(&sleepTime, NULL);
         le_mutex_Unlock(mraRef->mutexRefArray[idx]);
+        statsRegion_Add(STATSREGION_LOCKED_MUTEXES, -1);
         idx++;
     }
 }
@@ -403,6 +409,11 @@ static void Init
     void
 )
 {
+    if (statsRegion_Publish() != LE_OK)
+    {
+        LE_WARN("The statistics region is not published");
+    }
+
     // Create the key for thread specific data; ie. mutex refs.
     (void) pthread_key_create(&TsdMutexRefKey, NULL);
 
@@ -6,6 +6,7 @@
 #include "legato.h"
 #include "limit.h"
 #include "thread.h"
+#include "statsRegion.h"
 
 
 // Arguments
@@ -107,10 +108,15 @@ static void* ThreadCreateSem
 
     LE_INFO("In thread [%s], about to wait sem", le_thread_GetMyName());
 
+    const statsRegion_Delta_t waiting[] = { { STATSREGION_SEMAPHORES, 1 },
+                                            { STATSREGION_SEM_WAITERS, 1 } };
+    statsRegion_Update(waiting, NUM_ARRAY_MEMBERS(waiting));
+
     // notify the calling thread that this thread is about to wait on its sema.
     le_sem_Post(SemaRef);
 
     le_sem_Wait(sem);
+    statsRegion_Add(STATSREGION_SEM_WAITERS, -1);
     LE_INFO("In thread [%s], sema is posted", le_thread_GetMyName());
 
     le_event_RunLoop();
@@ -267,6 +273,11 @@ static void Init
     void
 )
 {
+    if (statsRegion_Publish() != LE_OK)
+    {
+        LE_WARN("The statistics region is not published");
+    }
+
     // mutex for accessing the sem index variable.
     SemIndexMutexRef = le_mutex_CreateNonRecursive("SemIndexMutex");
 
@@ -0,0 +1,131 @@
+/*
+ * This app samples the statistics region published by a process at a fixed rate, and prints each
+ * snapshot on stdout.
+ *
+ * At the end, it prints the achieved sampling rate and the cost of a read, which are checked by
+ * testInspectStats.sh.
+ */
+
+#include "legato.h"
+#include "statsRegion.h"
+
+// This is the key phrase printed for each sample.
+#define SAMPLE_KEY_PHRASE "Legato Stats Sample"
+
+
+// Print a snapshot on one line.
+static void PrintSnapshot
+(
+    long sampleIdx,
+    const statsRegion_Snapshot_t* snapshotPtr
+)
+{
+    int i;
+
+    printf("%s %ld updates=%" PRIu32, SAMPLE_KEY_PHRASE, sampleIdx, snapshotPtr->updates);
+    for (i = 0; i < STATSREGION_COUNTER_COUNT; i++)
+    {
+        printf(" %s=%" PRId64, statsRegion_GetCounterName(i), snapshotPtr->counters[i]);
+    }
+    printf("\n");
+}
+
+
+// Add a number of nanoseconds to a time.
+static void AddNs
+(
+    struct timespec* timePtr,
+    long ns
+)
+{
+    timePtr->tv_nsec += ns;
+    while (timePtr->tv_nsec >= 1000000000)
+    {
+        timePtr->tv_nsec -= 1000000000;
+        timePtr->tv_sec++;
+    }
+}
+
+
+// Get the time elapsed since a start time, in nanoseconds.
+static uint64_t GetElapsedNs
+(
+    const struct timespec* startPtr
+)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)(now.tv_sec - startPtr->tv_sec) * 1000000000) +
+           (now.tv_nsec - startPtr->tv_nsec);
+}
+
+
+COMPONENT_INIT
+{
+    statsRegion_Snapshot_t snapshot;
+    statsRegion_ReaderRef_t readerRef;
+    struct timespec startTime;
+    struct timespec deadline;
+    struct timespec readStart;
+    uint64_t readNs = 0;
+    uint64_t retries = 0;
+    uint64_t elapsedNs;
+    long rateHz;
+    long sampleNum;
+    long sampleIdx;
+    pid_t pid;
+
+    if (le_arg_NumArgs() != 3)
+    {
+        LE_ERROR("Usage: StatsSampler [pid] [sampling rate in Hz] [number of samples]");
+        exit(EXIT_FAILURE);
+    }
+
+    pid = strtol(le_arg_GetArg(0), NULL, 0);
+    rateHz = strtol(le_arg_GetArg(1), NULL, 0);
+    sampleNum = strtol(le_arg_GetArg(2), NULL, 0);
+    if ((pid <= 0) || (rateHz <= 0) || (rateHz > 1000000) || (sampleNum <= 0))
+    {
+        LE_ERROR("Bad parameters");
+        exit(EXIT_FAILURE);
+    }
+
+    readerRef = statsRegion_Open(pid);
+    if (NULL == readerRef)
+    {
+        printf("No statistics region published by process %d\n", (int)pid);
+        exit(EXIT_FAILURE);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    deadline = startTime;
+
+    for (sampleIdx = 0; sampleIdx < sampleNum; sampleIdx++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &readStart);
+        if (statsRegion_Read(readerRef, &snapshot) != LE_OK)
+        {
+            printf("No consistent snapshot of process %d\n", (int)pid);
+            exit(EXIT_FAILURE);
+        }
+        readNs += GetElapsedNs(&readStart);
+        retries += snapshot.retries;
+
+        PrintSnapshot(sampleIdx, &snapshot);
+
+        // Sample on absolute deadlines, so that the printing time does not lower the rate.
+        AddNs(&deadline, 1000000000 / rateHz);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    }
+
+    elapsedNs = GetElapsedNs(&startTime);
+    statsRegion_Close(readerRef);
+
+    printf("Sampled %ld times in %" PRIu64 " ms: %" PRIu64 " Hz, %" PRIu64 " ns per read,"
+           " %" PRIu64 " retries\n",
+           sampleNum, elapsedNs / 1000000, ((uint64_t)sampleNum * 1000000000) / elapsedNs,
+           readNs / sampleNum, retries);
+
+    exit(EXIT_SUCCESS);
+}
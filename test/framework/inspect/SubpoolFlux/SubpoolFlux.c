@@ -7,6 +7,7 @@
 // TODO: use usleep instead of nanosleep for delete interval
 
 #include "legato.h"
+#include "statsRegion.h"
 
 #define SubpoolNameBufferSize 50 // 50 characters for a subpool name should be plenty
 
@@ -24,6 +25,7 @@ void createSubPools
 {
     // SuperPool contains 10-byte blocks
     SuperPoolRef = le_mem_CreatePool("SuperPool", 10);
+    statsRegion_Add(STATSREGION_POOLS, 1);
 
     // Create N sub-pools
     long subpoolCnt = 0;
@@ -37,6 +39,12 @@ void createSubPools
         // Alloc the subpool's free block, just to increase the stat count
         BlockRefArray[subpoolCnt] = le_mem_TryAlloc(SubpoolRefArray[subpoolCnt]);
 
+        // The subpool and its block are published together, so that an inspector always sees
+        // one block in use per subpool.
+        const statsRegion_Delta_t created[] = { { STATSREGION_POOLS, 1 },
+                                                { STATSREGION_POOL_BLOCKS, 1 } };
+        statsRegion_Update(created, NUM_ARRAY_MEMBERS(created));
+
         subpoolCnt++;
     }
 
@@ -64,6 +72,10 @@ void deleteSubPool
     le_mem_Release(BlockRefArray[subPoolIndex]);
 
     le_mem_DeleteSubPool(SubpoolRefArray[subPoolIndex]);
+
+    const statsRegion_Delta_t deleted[] = { { STATSREGION_POOLS, -1 },
+                                            { STATSREGION_POOL_BLOCKS, -1 } };
+    statsRegion_Update(deleted, NUM_ARRAY_MEMBERS(deleted));
 }
 
 
@@ -155,6 +167,11 @@ COMPONENT_INIT
         exit(EXIT_FAILURE);
     }
 
+    if (statsRegion_Publish() != LE_OK)
+    {
+        LE_WARN("The statistics region is not published");
+    }
+
     strcpy(argDeleteStrat, argDeleteStratPtr);
     argSleepIntervalNano = strtol(argSleepIntervalNanoPtr, NULL, 0);
     SubpoolNum = strtol(subpoolNumPtr, NULL, 0);
@@ -6,6 +6,7 @@
 // TODO: use usleep instead of nanosleep for delete interval
 
 #include "legato.h"
+#include "statsRegion.h"
 
 #define ThreadNameBufferSize 50
 
@@ -42,6 +43,7 @@ void createThreads
         ThreadRefArray[threadCnt] = le_thread_Create(ThreadNameBuffer, ThreadMain, NULL);
 
         le_thread_Start(ThreadRefArray[threadCnt]);
+        statsRegion_Add(STATSREGION_THREADS, 1);
 
         threadCnt++;
     }
@@ -63,6 +65,7 @@ void deleteThread
     nanosleep(sleepTimeRef, NULL);
 
     le_thread_Cancel(ThreadRefArray[threadIndex]);
+    statsRegion_Add(STATSREGION_THREADS, -1);
 }
 
 
@@ -117,6 +120,11 @@ COMPONENT_INIT
         exit(EXIT_FAILURE);
     }
 
+    if (statsRegion_Publish() != LE_OK)
+    {
+        LE_WARN("The statistics region is not published");
+    }
+
     strcpy(argDeleteStrat, argDeleteStratPtr);
     argSleepIntervalNano = strtol(argSleepIntervalNanoPtr, NULL, 0);
     ThreadNum = strtol(threadNumPtr, NULL, 0);
@@ -12,6 +12,7 @@
 #include "legato.h"
 #include "limit.h"
 #include "thread.h"
+#include "statsRegion.h"
 
 static long SleepIntervalNano;
 static long ThreadNum;
@@ -132,6 +133,7 @@ static le_timer_Ref_t CreateTimer
     le_timer_SetInterval(timerRef, timerAttrRef->interval);
     le_timer_SetRepeat(timerRef, timerAttrRef->repeatCount);
     le_timer_SetContextPtr(timerRef, timerAttrRef->contextPtr);
+    statsRegion_Add(STATSREGION_TIMERS, 1);
 
     return timerRef;
 }
@@ -256,6 +258,7 @@ static void DelTimers
     {
         nanosleep(&sleepTime, NULL);
         le_timer_Delete(traRef->timerRefArray[idx]);
+        statsRegion_Add(STATSREGION_TIMERS, -1);
         idx++;
     }
 }
@@ -364,6 +367,11 @@ COMPONENT_INIT
         LE_ERROR("threadNumPtr is NULL");
         exit(EXIT_FAILURE);
     }
+    if (statsRegion_Publish() != LE_OK)
+    {
+        LE_WARN("The statistics region is not published");
+    }
+
     strcpy(argDeleteStrat, argDeleteStratPtr);
     SleepIntervalNano = strtol(sleepIntervalNanoPtr, NULL, 0);
     TimerNum = strtol(timerNumPtr, NULL, 0);
@@ -25,6 +25,7 @@ targetTestApps=(
     TimerFlux
     MutexFlux
     SemaphoreFlux
+    StatsSampler
 )
 
 ashScriptPath=targetAshScripts
@@ -42,6 +43,7 @@ targetTestScripts=(
     testInspectMutexColumns.sh
     testInspectSemaWaitingList.sh
     testInspectSemaColumns.sh
+    testInspectStats.sh
 )
 
 targetFileDir=__InspectTargetTestsDir_deleteme
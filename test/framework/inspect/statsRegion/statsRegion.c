@@ -0,0 +1,410 @@
+/**
+ * @file statsRegion.c
+ *
+ * Implementation of the statistics region published by a process for the inspection tools.
+ *
+ * The region is a single page holding a header and the counters. The header magic is written
+ * last when the region is created, so that a reader never sees a partially initialized region.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "statsRegion.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Magic number identifying a statistics region
+ */
+//--------------------------------------------------------------------------------------------------
+#define REGION_MAGIC            0x53544154
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Path of the region of a process, in its own file system view and from outside of its sandbox
+ */
+//--------------------------------------------------------------------------------------------------
+#define REGION_PATH_FORMAT      "/tmp/legatoStats.%d"
+#define REGION_PROC_PATH_FORMAT "/proc/%d/root/tmp/legatoStats.%d"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of attempts to read a consistent snapshot
+ */
+//--------------------------------------------------------------------------------------------------
+#define READ_MAX_RETRIES        1000
+
+//--------------------------------------------------------------------------------------------------
+// Data structures
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics region, shared by the inspected process and the readers
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t magic;                                 ///< REGION_MAGIC
+    uint32_t counterCount;                          ///< STATSREGION_COUNTER_COUNT
+    int32_t  pid;                                   ///< Publishing process
+    uint32_t sequence;                              ///< Odd while an update is in progress
+    int64_t  counters[STATSREGION_COUNTER_COUNT];   ///< Counter values
+}
+Region_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Region mapping in a reader
+ */
+//--------------------------------------------------------------------------------------------------
+struct statsRegion_Reader
+{
+    const Region_t* regionPtr;      ///< Read-only mapping of the region
+};
+
+//--------------------------------------------------------------------------------------------------
+// Static declarations
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Counter names, in the statsRegion_Counter_t order
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* CounterNames[STATSREGION_COUNTER_COUNT] =
+{
+    "pools",
+    "poolBlocks",
+    "threads",
+    "timers",
+    "mutexes",
+    "lockedMutexes",
+    "semaphores",
+    "semWaiters",
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Region published by this process, NULL until statsRegion_Publish() succeeds
+ */
+//--------------------------------------------------------------------------------------------------
+static Region_t* PublishedRegionPtr = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Serialization of the writers of this process.
+ *
+ * A POSIX mutex is used rather than a Legato one, so that the statistics do not appear in the
+ * mutex lists they are describing.
+ */
+//--------------------------------------------------------------------------------------------------
+static pthread_mutex_t WriterMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the reader references
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t ReaderPool = NULL;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the region file of this process when it exits
+ */
+//--------------------------------------------------------------------------------------------------
+static void RemoveRegion
+(
+    void
+)
+{
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), REGION_PATH_FORMAT, (int)getpid());
+    unlink(path);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the statistics region of the calling process. All the counters start at 0.
+ *
+ * Until this function succeeds, the updates are ignored.
+ *
+ * @return
+ *  - LE_OK on success, or if the region is already published
+ *  - LE_FAULT if the region could not be created
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t statsRegion_Publish
+(
+    void
+)
+{
+    char path[PATH_MAX];
+    Region_t* regionPtr;
+    le_result_t result = LE_OK;
+    int fd;
+
+    LE_ASSERT(0 == pthread_mutex_lock(&WriterMutex));
+
+    if (NULL != PublishedRegionPtr)
+    {
+        goto end;
+    }
+
+    // A region left by a previous process with the same pid must not be reused by its readers
+    snprintf(path, sizeof(path), REGION_PATH_FORMAT, (int)getpid());
+    unlink(path);
+
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to create the statistics region %s: %m", path);
+        result = LE_FAULT;
+        goto end;
+    }
+
+    if (0 != ftruncate(fd, sizeof(Region_t)))
+    {
+        LE_ERROR("Unable to size the statistics region: %m");
+        close(fd);
+        unlink(path);
+        result = LE_FAULT;
+        goto end;
+    }
+
+    regionPtr = mmap(NULL, sizeof(Region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == regionPtr)
+    {
+        LE_ERROR("Unable to map the statistics region: %m");
+        unlink(path);
+        result = LE_FAULT;
+        goto end;
+    }
+
+    regionPtr->counterCount = STATSREGION_COUNTER_COUNT;
+    regionPtr->pid = getpid();
+    __atomic_store_n(&regionPtr->magic, REGION_MAGIC, __ATOMIC_RELEASE);
+
+    atexit(RemoveRegion);
+    PublishedRegionPtr = regionPtr;
+
+end:
+    LE_ASSERT(0 == pthread_mutex_unlock(&WriterMutex));
+    return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update several counters at once: a reader sees either none or all of the updates.
+ */
+//--------------------------------------------------------------------------------------------------
+void statsRegion_Update
+(
+    const statsRegion_Delta_t* deltasPtr,   ///< [IN] Counter updates
+    size_t                     deltaCount   ///< [IN] Number of counter updates
+)
+{
+    Region_t* regionPtr;
+    uint32_t sequence;
+    int64_t value;
+    size_t i;
+
+    LE_ASSERT(0 == pthread_mutex_lock(&WriterMutex));
+
+    regionPtr = PublishedRegionPtr;
+    if (NULL != regionPtr)
+    {
+        // Only the writers modify the sequence number, and they are serialized
+        sequence = regionPtr->sequence;
+        __atomic_store_n(&regionPtr->sequence, sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        for (i = 0; i < deltaCount; i++)
+        {
+            LE_ASSERT(deltasPtr[i].counter < STATSREGION_COUNTER_COUNT);
+            value = regionPtr->counters[deltasPtr[i].counter] + deltasPtr[i].delta;
+            __atomic_store_n(&regionPtr->counters[deltasPtr[i].counter], value,
+                             __ATOMIC_RELAXED);
+        }
+
+        __atomic_store_n(&regionPtr->sequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+
+    LE_ASSERT(0 == pthread_mutex_unlock(&WriterMutex));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a value to a counter
+ */
+//--------------------------------------------------------------------------------------------------
+void statsRegion_Add
+(
+    statsRegion_Counter_t counter,          ///< [IN] Updated counter
+    int64_t               delta             ///< [IN] Value added to the counter
+)
+{
+    statsRegion_Delta_t update = { .counter = counter, .delta = delta };
+
+    statsRegion_Update(&update, 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the statistics region of a process
+ *
+ * @return the reader reference, NULL if the process has not published a valid region
+ */
+//--------------------------------------------------------------------------------------------------
+statsRegion_ReaderRef_t statsRegion_Open
+(
+    pid_t pid                               ///< [IN] Inspected process
+)
+{
+    struct statsRegion_Reader* readerPtr;
+    const Region_t* regionPtr;
+    char path[PATH_MAX];
+    struct stat st;
+    int fd;
+
+    snprintf(path, sizeof(path), REGION_PROC_PATH_FORMAT, (int)pid, (int)pid);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_ERROR("Unable to open the statistics region %s: %m", path);
+        return NULL;
+    }
+
+    if ((0 != fstat(fd, &st)) || (st.st_size < (off_t)sizeof(Region_t)))
+    {
+        LE_ERROR("Invalid statistics region %s", path);
+        close(fd);
+        return NULL;
+    }
+
+    regionPtr = mmap(NULL, sizeof(Region_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == regionPtr)
+    {
+        LE_ERROR("Unable to map the statistics region %s: %m", path);
+        return NULL;
+    }
+
+    if ((REGION_MAGIC != __atomic_load_n(&regionPtr->magic, __ATOMIC_ACQUIRE)) ||
+        (STATSREGION_COUNTER_COUNT != regionPtr->counterCount) || (pid != regionPtr->pid))
+    {
+        LE_ERROR("Invalid statistics region header in %s", path);
+        munmap((void*)regionPtr, sizeof(Region_t));
+        return NULL;
+    }
+
+    if (NULL == ReaderPool)
+    {
+        ReaderPool = le_mem_CreatePool("StatsRegionReaders", sizeof(struct statsRegion_Reader));
+    }
+
+    readerPtr = le_mem_ForceAlloc(ReaderPool);
+    readerPtr->regionPtr = regionPtr;
+
+    return readerPtr;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a consistent snapshot of the counters of a process
+ *
+ * @return
+ *  - LE_OK on success
+ *  - LE_BUSY if no consistent snapshot could be read, e.g. because the process died in the middle
+ *    of an update
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t statsRegion_Read
+(
+    statsRegion_ReaderRef_t readerRef,      ///< [IN] Reader reference
+    statsRegion_Snapshot_t* snapshotPtr     ///< [OUT] Counters snapshot
+)
+{
+    const Region_t* regionPtr;
+    uint32_t startSequence;
+    uint32_t endSequence;
+    uint32_t retries;
+    int i;
+
+    LE_ASSERT(NULL != readerRef);
+    LE_ASSERT(NULL != snapshotPtr);
+    regionPtr = readerRef->regionPtr;
+
+    for (retries = 0; retries < READ_MAX_RETRIES; retries++)
+    {
+        startSequence = __atomic_load_n(&regionPtr->sequence, __ATOMIC_ACQUIRE);
+        if (startSequence & 1)
+        {
+            // Let the writer complete its update
+            sched_yield();
+            continue;
+        }
+
+        for (i = 0; i < STATSREGION_COUNTER_COUNT; i++)
+        {
+            snapshotPtr->counters[i] = __atomic_load_n(&regionPtr->counters[i], __ATOMIC_RELAXED);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        endSequence = __atomic_load_n(&regionPtr->sequence, __ATOMIC_RELAXED);
+        if (startSequence == endSequence)
+        {
+            snapshotPtr->updates = startSequence / 2;
+            snapshotPtr->retries = retries;
+            return LE_OK;
+        }
+    }
+
+    return LE_BUSY;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the statistics region of a process
+ */
+//--------------------------------------------------------------------------------------------------
+void statsRegion_Close
+(
+    statsRegion_ReaderRef_t readerRef       ///< [IN] Reader reference
+)
+{
+    LE_ASSERT(NULL != readerRef);
+
+    munmap((void*)readerRef->regionPtr, sizeof(Region_t));
+    le_mem_Release(readerRef);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a counter
+ *
+ * @return the counter name, "unknown" for an invalid counter
+ */
+//--------------------------------------------------------------------------------------------------
+const char* statsRegion_GetCounterName
+(
+    statsRegion_Counter_t counter           ///< [IN] Counter
+)
+{
+    if (counter >= STATSREGION_COUNTER_COUNT)
+    {
+        return "unknown";
+    }
+
+    return CounterNames[counter];
+}
@@ -0,0 +1,165 @@
+/**
+ * @file statsRegion.h
+ *
+ * Statistics region published by a process for the inspection tools.
+ *
+ * A process publishes its pool, thread, timer, mutex and semaphore counters in a small shared
+ * memory region: a file in the /tmp directory of the process, which is also visible from outside
+ * of its sandbox through /proc/<pid>/root. The counters are protected by a sequence lock:
+ * - the writers increment the sequence number before and after each update, so that it is odd
+ *   while an update is in progress,
+ * - a reader copies the counters between two reads of the sequence number, and retries if an
+ *   update was in progress or happened during the copy.
+ *
+ * A reader therefore gets a consistent snapshot of all the counters without stopping or blocking
+ * the inspected process, and a writer never waits for a reader. The writers of a process are
+ * serialized by a local mutex, which is only contended between the threads of that process.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#ifndef STATSREGION_H_INCLUDE_GUARD
+#define STATSREGION_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Published counters
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    STATSREGION_POOLS = 0,          ///< Number of memory pools and sub-pools
+    STATSREGION_POOL_BLOCKS,        ///< Number of memory pool blocks in use
+    STATSREGION_THREADS,            ///< Number of threads
+    STATSREGION_TIMERS,             ///< Number of timers
+    STATSREGION_MUTEXES,            ///< Number of mutexes
+    STATSREGION_LOCKED_MUTEXES,     ///< Number of locked mutexes
+    STATSREGION_SEMAPHORES,         ///< Number of semaphores
+    STATSREGION_SEM_WAITERS,        ///< Number of threads waiting on a semaphore
+    STATSREGION_COUNTER_COUNT       ///< Number of counters, must be the last one
+}
+statsRegion_Counter_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update of one counter
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    statsRegion_Counter_t counter;  ///< Updated counter
+    int64_t               delta;    ///< Value added to the counter
+}
+statsRegion_Delta_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consistent snapshot of the counters of a process
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t updates;                               ///< Number of updates done by the process
+    uint32_t retries;                               ///< Retries needed to get this snapshot
+    int64_t  counters[STATSREGION_COUNTER_COUNT];   ///< Counter values
+}
+statsRegion_Snapshot_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to the statistics region of a process, opened by a reader
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct statsRegion_Reader* statsRegion_ReaderRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the statistics region of the calling process. All the counters start at 0.
+ *
+ * Until this function succeeds, the updates are ignored.
+ *
+ * @return
+ *  - LE_OK on success, or if the region is already published
+ *  - LE_FAULT if the region could not be created
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t statsRegion_Publish
+(
+    void
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update several counters at once: a reader sees either none or all of the updates.
+ */
+//--------------------------------------------------------------------------------------------------
+void statsRegion_Update
+(
+    const statsRegion_Delta_t* deltasPtr,   ///< [IN] Counter updates
+    size_t                     deltaCount   ///< [IN] Number of counter updates
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a value to a counter
+ */
+//--------------------------------------------------------------------------------------------------
+void statsRegion_Add
+(
+    statsRegion_Counter_t counter,          ///< [IN] Updated counter
+    int64_t               delta             ///< [IN] Value added to the counter
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the statistics region of a process
+ *
+ * @return the reader reference, NULL if the process has not published a valid region
+ */
+//--------------------------------------------------------------------------------------------------
+statsRegion_ReaderRef_t statsRegion_Open
+(
+    pid_t pid                               ///< [IN] Inspected process
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a consistent snapshot of the counters of a process
+ *
+ * @return
+ *  - LE_OK on success
+ *  - LE_BUSY if no consistent snapshot could be read, e.g. because the process died in the middle
+ *    of an update
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t statsRegion_Read
+(
+    statsRegion_ReaderRef_t readerRef,      ///< [IN] Reader reference
+    statsRegion_Snapshot_t* snapshotPtr     ///< [OUT] Counters snapshot
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the statistics region of a process
+ */
+//--------------------------------------------------------------------------------------------------
+void statsRegion_Close
+(
+    statsRegion_ReaderRef_t readerRef       ///< [IN] Reader reference
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a counter
+ *
+ * @return the counter name, "unknown" for an invalid counter
+ */
+//--------------------------------------------------------------------------------------------------
+const char* statsRegion_GetCounterName
+(
+    statsRegion_Counter_t counter           ///< [IN] Counter
+);
+
+#endif // STATSREGION_H_INCLUDE_GUARD
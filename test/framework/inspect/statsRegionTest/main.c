@@ -0,0 +1,230 @@
+/**
+ * This module implements the unit tests of the statistics region read by the inspection tools.
+ *
+ * Several writer threads update pairs of counters which must always be equal, while the main
+ * thread reads the region as fast as it can: every snapshot must be consistent, and the reads
+ * must never block the writers.
+ *
+ * Tested API:
+ * - statsRegion_Publish
+ * - statsRegion_Update / statsRegion_Add
+ * - statsRegion_Open / statsRegion_Read / statsRegion_Close
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "statsRegion.h"
+
+
+//--------------------------------------------------------------------------------------------------
+// Symbol and Enum definitions
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of writer threads
+ */
+//--------------------------------------------------------------------------------------------------
+#define WRITER_COUNT            4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of create/delete cycles done by each writer
+ */
+//--------------------------------------------------------------------------------------------------
+#define WRITER_CYCLES           100000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimum sampling rate expected from a reader, in Hz
+ */
+//--------------------------------------------------------------------------------------------------
+#define MIN_SAMPLING_RATE_HZ    100
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of writer threads still running
+ */
+//--------------------------------------------------------------------------------------------------
+static int RunningWriters = WRITER_COUNT;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time elapsed since a start time, in nanoseconds
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetElapsedNs
+(
+    le_clk_Time_t startTime
+)
+{
+    le_clk_Time_t duration = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    return ((uint64_t)duration.sec * 1000000000) + ((uint64_t)duration.usec * 1000);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Writer thread: creates and deletes a pool with one block in use, as SubpoolFlux does
+ */
+//--------------------------------------------------------------------------------------------------
+static void* WriterThread
+(
+    void* contextPtr
+)
+{
+    const statsRegion_Delta_t created[] = { { STATSREGION_POOLS, 1 },
+                                            { STATSREGION_POOL_BLOCKS, 1 } };
+    const statsRegion_Delta_t deleted[] = { { STATSREGION_POOLS, -1 },
+                                            { STATSREGION_POOL_BLOCKS, -1 } };
+    le_clk_Time_t startTime = le_clk_GetRelativeTime();
+    int i;
+
+    for (i = 0; i < WRITER_CYCLES; i++)
+    {
+        statsRegion_Update(created, NUM_ARRAY_MEMBERS(created));
+        statsRegion_Update(deleted, NUM_ARRAY_MEMBERS(deleted));
+    }
+
+    LE_INFO("Writer: %" PRIu64 " ns per update",
+            GetElapsedNs(startTime) / (2 * WRITER_CYCLES));
+
+    __atomic_sub_fetch(&RunningWriters, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the counter updates done by a single thread
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestUpdates
+(
+    statsRegion_ReaderRef_t readerRef
+)
+{
+    statsRegion_Snapshot_t snapshot;
+    int i;
+
+    LE_ASSERT(LE_OK == statsRegion_Read(readerRef, &snapshot));
+    LE_ASSERT(0 == snapshot.updates);
+    LE_ASSERT(0 == snapshot.retries);
+    for (i = 0; i < STATSREGION_COUNTER_COUNT; i++)
+    {
+        LE_ASSERT(0 == snapshot.counters[i]);
+    }
+
+    statsRegion_Add(STATSREGION_THREADS, 3);
+    statsRegion_Add(STATSREGION_THREADS, -1);
+    statsRegion_Add(STATSREGION_TIMERS, 5);
+
+    const statsRegion_Delta_t deltas[] = { { STATSREGION_MUTEXES, 2 },
+                                           { STATSREGION_LOCKED_MUTEXES, 1 },
+                                           { STATSREGION_SEM_WAITERS, 4 } };
+    statsRegion_Update(deltas, NUM_ARRAY_MEMBERS(deltas));
+
+    LE_ASSERT(LE_OK == statsRegion_Read(readerRef, &snapshot));
+    LE_ASSERT(4 == snapshot.updates);
+    LE_ASSERT(2 == snapshot.counters[STATSREGION_THREADS]);
+    LE_ASSERT(5 == snapshot.counters[STATSREGION_TIMERS]);
+    LE_ASSERT(2 == snapshot.counters[STATSREGION_MUTEXES]);
+    LE_ASSERT(1 == snapshot.counters[STATSREGION_LOCKED_MUTEXES]);
+    LE_ASSERT(4 == snapshot.counters[STATSREGION_SEM_WAITERS]);
+    LE_ASSERT(0 == snapshot.counters[STATSREGION_POOLS]);
+
+    LE_ASSERT(0 == strcmp("pools", statsRegion_GetCounterName(STATSREGION_POOLS)));
+    LE_ASSERT(0 == strcmp("semWaiters", statsRegion_GetCounterName(STATSREGION_SEM_WAITERS)));
+    LE_ASSERT(0 == strcmp("unknown", statsRegion_GetCounterName(STATSREGION_COUNTER_COUNT)));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the consistency of the snapshots read while several threads update the counters
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestConcurrentReads
+(
+    statsRegion_ReaderRef_t readerRef
+)
+{
+    le_thread_Ref_t writers[WRITER_COUNT];
+    statsRegion_Snapshot_t snapshot;
+    statsRegion_Snapshot_t initial;
+    le_clk_Time_t startTime;
+    uint64_t readCount = 0;
+    uint64_t retries = 0;
+    uint64_t elapsedNs;
+    char name[32];
+    int i;
+
+    LE_ASSERT(LE_OK == statsRegion_Read(readerRef, &initial));
+
+    for (i = 0; i < WRITER_COUNT; i++)
+    {
+        snprintf(name, sizeof(name), "Writer%d", i);
+        writers[i] = le_thread_Create(name, WriterThread, NULL);
+        le_thread_SetJoinable(writers[i]);
+        le_thread_Start(writers[i]);
+    }
+
+    startTime = le_clk_GetRelativeTime();
+    while (__atomic_load_n(&RunningWriters, __ATOMIC_ACQUIRE) > 0)
+    {
+        LE_ASSERT(LE_OK == statsRegion_Read(readerRef, &snapshot));
+        LE_ASSERT(snapshot.counters[STATSREGION_POOLS] ==
+                  snapshot.counters[STATSREGION_POOL_BLOCKS]);
+        LE_ASSERT(snapshot.counters[STATSREGION_POOLS] >= 0);
+        LE_ASSERT(snapshot.counters[STATSREGION_POOLS] <= WRITER_COUNT);
+        LE_ASSERT(snapshot.counters[STATSREGION_THREADS] == initial.counters[STATSREGION_THREADS]);
+        readCount++;
+        retries += snapshot.retries;
+    }
+    elapsedNs = GetElapsedNs(startTime);
+
+    for (i = 0; i < WRITER_COUNT; i++)
+    {
+        LE_ASSERT(LE_OK == le_thread_Join(writers[i], NULL));
+    }
+
+    LE_ASSERT(LE_OK == statsRegion_Read(readerRef, &snapshot));
+    LE_ASSERT(0 == snapshot.counters[STATSREGION_POOLS]);
+    LE_ASSERT(0 == snapshot.counters[STATSREGION_POOL_BLOCKS]);
+    LE_ASSERT((initial.updates + (2 * WRITER_COUNT * WRITER_CYCLES)) == snapshot.updates);
+
+    LE_ASSERT(readCount > 0);
+    LE_INFO("Reader: %" PRIu64 " consistent snapshots, %" PRIu64 " ns per read, %" PRIu64
+            " retries", readCount, elapsedNs / readCount, retries);
+
+    // A reader must be able to sample much faster than the inspect refresh rate
+    LE_ASSERT((elapsedNs / readCount) < (1000000000 / MIN_SAMPLING_RATE_HZ));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * main of the test
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    statsRegion_ReaderRef_t readerRef;
+
+    // The updates are ignored until the region is published
+    statsRegion_Add(STATSREGION_THREADS, 1);
+
+    LE_ASSERT(LE_OK == statsRegion_Publish());
+    LE_ASSERT(LE_OK == statsRegion_Publish());
+
+    readerRef = statsRegion_Open(getpid());
+    LE_ASSERT(NULL != readerRef);
+
+    TestUpdates(readerRef);
+    TestConcurrentReads(readerRef);
+
+    statsRegion_Close(readerRef);
+
+    LE_INFO("======== Statistics region tests PASSED ========");
+    exit(EXIT_SUCCESS);
+}
@@ -79,6 +79,14 @@ testInspectPoolsInterval()
     ./testInspectInterval.sh flux || Fail
 }
 
+# Test Case: Sample the statistics region at 100 Hz while mem pools are deleted.
+testInspectPoolsStats()
+{
+    # Delete a subpool every 1 ms, so that the pool list keeps changing during the whole sampling.
+    runInspectPools "1toN" 1000000 100000
+    ./testInspectStats.sh || Fail
+}
+
 
 ########################################
 # Inspect Timers Tests #################
@@ -350,6 +358,7 @@ testInspectSemaphoresWaitingList()
 testInspectPoolsInterrupted
 testInspectPoolsComplete
 testInspectPoolsInterval
+testInspectPoolsStats
 
 # This test is very long (20+ minutes).
 #testInspectPoolsRaceCondition
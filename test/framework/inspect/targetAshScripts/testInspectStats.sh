@@ -0,0 +1,85 @@
+#!/bin/sh
+
+
+if [ $# -ne 0 ]
+then
+    echo "Usage: $0"
+    exit 1
+fi
+
+
+# Sample the statistics region of SubpoolFlux while it is deleting subpools, at a rate that
+# inspect cannot reach by walking the pool list.
+samplingRate=100
+sampleNum=500
+minSamplingRate=90
+
+logFileName=__InspectStats_log_deleteme
+appName=SubpoolFlux
+
+# This is the key phrase printed for each sample.
+sampleKeyPhrase="Legato Stats Sample"
+
+
+pid=`ps -ef | grep $appName | grep -v grep | awk '{print $2}'`
+if [ -z "$pid" ]
+then
+    echo "[FAILED] $appName is not running"
+    exit 1
+fi
+
+# Let the process publish its statistics region.
+sleep 1
+
+app runProc StatsSampler StatsSampler -- $pid $samplingRate $sampleNum > $logFileName
+if [ $? -ne 0 ]
+then
+    cat $logFileName
+    echo "[FAILED] StatsSampler failed to sample process [$pid]"
+    exit 1
+fi
+
+
+actualSampleNum=`grep "$sampleKeyPhrase" $logFileName | wc -l`
+if [ $actualSampleNum -ne $sampleNum ]
+then
+    echo "[FAILED] Got [$actualSampleNum] samples, expected [$sampleNum]"
+    exit 1
+fi
+
+# Each subpool is published with its block, and the super pool has no block in use: every
+# consistent snapshot has exactly one more pool than blocks in use.
+inconsistentSampleNum=`grep "$sampleKeyPhrase" $logFileName | \
+    sed 's/.* pools=\([0-9]*\) poolBlocks=\([0-9]*\) .*/\1 \2/' | \
+    awk '{ if ($1 != $2 + 1) n++ } END { print n + 0 }'`
+if [ $inconsistentSampleNum -ne 0 ]
+then
+    echo "[FAILED] [$inconsistentSampleNum] inconsistent samples"
+    exit 1
+fi
+
+# The process must not be stopped while it is sampled.
+updatesPattern='s/.* updates=\([0-9]*\) .*/\1/'
+firstUpdates=`grep "$sampleKeyPhrase" $logFileName | head -n 1 | sed "$updatesPattern"`
+lastUpdates=`grep "$sampleKeyPhrase" $logFileName | tail -n 1 | sed "$updatesPattern"`
+if [ $lastUpdates -le $firstUpdates ]
+then
+    echo "[FAILED] $appName made no progress while it was sampled"
+    exit 1
+fi
+
+actualSamplingRate=`grep "^Sampled" $logFileName | sed 's/.*: \([0-9]*\) Hz.*/\1/'`
+if [ -z "$actualSamplingRate" ] || [ $actualSamplingRate -lt $minSamplingRate ]
+then
+    echo "[FAILED] Sampling rate is [$actualSamplingRate] Hz," \
+         "expected at least [$minSamplingRate] Hz"
+    exit 1
+fi
+
+grep "^Sampled" $logFileName
+
+# clean up
+rm $logFileName
+
+echo "[PASSED] Sampled [$sampleNum] consistent snapshots of the statistics of $appName"
+exit 0
@@ -181,6 +181,60 @@ RunSecStoreTestGlobal()
     CheckRet
 }
 
+# This test measures the write, read, list and delete throughput of certificate-sized items, then
+# provisions items in a single secstore session with the import command.
+RunSecStoreTestThroughput()
+{
+    # Install test apps
+    echo "Install test apps"
+    instapp secStoreTestThroughput.$targetType.update $targetAddr
+
+    # Clear logs
+    echo "Clear the logs."
+    ClearTargetLog
+
+    # Run test apps
+    echo "Starting secStoreTestThroughput."
+    ssh root@$targetAddr  "$BIN_PATH/app start secStoreTestThroughput"
+    CheckRet
+
+    # Wait for app to finish
+    IsAppRunning "secStoreTestThroughput"
+    while [ $? -eq 0 ]; do
+        IsAppRunning "secStoreTestThroughput"
+    done
+
+    # Cleanup
+    echo "Uninstall all apps."
+    ssh root@$targetAddr "$BIN_PATH/app remove secStoreTestThroughput"
+
+    # Verification
+    echo "Grepping the logs to check the results."
+    CheckLogStr "==" 1 "============ SecStoreTestThroughput PASSED ============="
+
+    # Import
+    echo "Importing items."
+    ssh root@$targetAddr "mkdir -p /tmp/secStoreImport && cd /tmp/secStoreImport && \
+                          for i in 0 1 2 3 4 5 6 7; do \
+                              echo cert\$i > cert\$i; \
+                              echo \"cert\$i /global/importTest/cert\$i\" >> manifest; \
+                          done"
+    CheckRet
+    ssh root@$targetAddr "cd /tmp/secStoreImport && $BIN_PATH/secstore import manifest"
+    CheckRet
+    for i in 0 1 2 3 4 5 6 7; do
+        KEY=/global/importTest/cert$i
+        VALUE=$(ssh root@$targetAddr "$BIN_PATH/secstore read $KEY")
+        CheckRet
+        if [[ "$VALUE" != "cert$i" ]]; then
+            echo "Unexpected value for entry $KEY: '$VALUE'"
+            exit 1
+        fi
+    done
+    ssh root@$targetAddr "$BIN_PATH/secstore rm /global/importTest; rm -rf /tmp/secStoreImport"
+    CheckRet
+}
+
 
 ##################################
 ##  Main Script Body  ############
@@ -191,6 +245,7 @@ SetUp
 RunSecStoreTest1
 RunSecStoreTest2
 RunSecStoreTestGlobal
+RunSecStoreTestThroughput
 
 echo "Secure Storage Test Passed!"
 exit 0
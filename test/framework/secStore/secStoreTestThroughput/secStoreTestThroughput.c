@@ -0,0 +1,239 @@
+#include "legato.h"
+#include "interfaces.h"
+
+
+// Bulk provisioning of certificate-sized items, as done by the secstore import command and by
+// the credential rotations.
+#define TEST_DIR            "/global/throughputTest"
+#define ITEM_SIZE           2048
+#define MAX_ITEM_COUNT      200
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of items used by the test, limited by the free secure storage space.
+ */
+//--------------------------------------------------------------------------------------------------
+static int ItemCount;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start time of the current measure.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_clk_Time_t StartTime;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the secure storage path and the value of an item.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetItem
+(
+    int itemId,
+    char* pathPtr,
+    size_t pathSize,
+    uint8_t* dataPtr
+)
+{
+    int i;
+
+    snprintf(pathPtr, pathSize, TEST_DIR "/cert%d", itemId);
+
+    for (i = 0; i < ITEM_SIZE; i++)
+    {
+        dataPtr[i] = (uint8_t)(itemId + i);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a measure.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartMeasure
+(
+    void
+)
+{
+    StartTime = le_clk_GetRelativeTime();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * End a measure and report the throughput of the operation.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndMeasure
+(
+    const char* operationPtr
+)
+{
+    le_clk_Time_t duration = le_clk_Sub(le_clk_GetRelativeTime(), StartTime);
+    uint64_t durationUs = ((uint64_t)duration.sec * 1000000) + duration.usec;
+
+    if (durationUs == 0)
+    {
+        durationUs = 1;
+    }
+
+    LE_INFO("%s of %d items: %"PRIu64" ms, %"PRIu64" items/s",
+            operationPtr, ItemCount, durationUs / 1000,
+            ((uint64_t)ItemCount * 1000000) / durationUs);
+}
+
+
+// Write the items one by one, and read them back.
+static void TestWriteRead
+(
+    void
+)
+{
+    LE_INFO("###################################################################################");
+    LE_INFO("#################### TestWriteRead ################################################");
+    LE_INFO("###################################################################################");
+
+    char path[SECSTOREADMIN_MAX_PATH_BYTES];
+    uint8_t dataBuffer[ITEM_SIZE];
+    uint8_t outBuffer[ITEM_SIZE];
+    size_t outBufferSize;
+    le_result_t result;
+    int i;
+
+    StartMeasure();
+    for (i = 0; i < ItemCount; i++)
+    {
+        GetItem(i, path, sizeof(path), dataBuffer);
+        result = secStoreAdmin_Write(path, dataBuffer, sizeof(dataBuffer));
+        LE_FATAL_IF(result != LE_OK, "write of %s failed: [%s]", path, LE_RESULT_TXT(result));
+    }
+    EndMeasure("Write");
+
+    StartMeasure();
+    for (i = 0; i < ItemCount; i++)
+    {
+        GetItem(i, path, sizeof(path), dataBuffer);
+        outBufferSize = sizeof(outBuffer);
+        result = secStoreAdmin_Read(path, outBuffer, &outBufferSize);
+        LE_FATAL_IF(result != LE_OK, "read of %s failed: [%s]", path, LE_RESULT_TXT(result));
+        LE_FATAL_IF(outBufferSize != sizeof(dataBuffer),
+                    "unexpected data size %zu for %s", outBufferSize, path);
+        LE_FATAL_IF(0 != memcmp(outBuffer, dataBuffer, outBufferSize),
+                    "unexpected item contents for %s", path);
+    }
+    EndMeasure("Read");
+
+    LE_INFO("#################### END OF TestWriteRead ################################");
+    LE_INFO(" ");
+}
+
+
+// List the items with their sizes, as done by 'secstore ls -s'.
+static void TestList
+(
+    void
+)
+{
+    LE_INFO("###################################################################################");
+    LE_INFO("#################### TestList #####################################################");
+    LE_INFO("###################################################################################");
+
+    char entryName[SECSTOREADMIN_MAX_PATH_BYTES];
+    char path[SECSTOREADMIN_MAX_PATH_BYTES];
+    bool isDir;
+    uint64_t size;
+    uint64_t totalSize = 0;
+    int entryCount = 0;
+    le_result_t result;
+
+    StartMeasure();
+    secStoreAdmin_IterRef_t iterRef = secStoreAdmin_CreateIter(TEST_DIR);
+    LE_FATAL_IF(iterRef == NULL, "could not create an iterator for %s", TEST_DIR);
+
+    while (secStoreAdmin_Next(iterRef) == LE_OK)
+    {
+        result = secStoreAdmin_GetEntry(iterRef, entryName, sizeof(entryName), &isDir);
+        LE_FATAL_IF(result != LE_OK, "get entry failed: [%s]", LE_RESULT_TXT(result));
+        LE_FATAL_IF(isDir, "unexpected directory %s", entryName);
+
+        snprintf(path, sizeof(path), TEST_DIR "/%s", entryName);
+        result = secStoreAdmin_GetSize(path, &size);
+        LE_FATAL_IF(result != LE_OK, "getsize of %s failed: [%s]", path, LE_RESULT_TXT(result));
+
+        totalSize += size;
+        entryCount++;
+    }
+
+    secStoreAdmin_DeleteIter(iterRef);
+    EndMeasure("List with sizes");
+
+    LE_FATAL_IF(entryCount != ItemCount, "unexpected entry count %d", entryCount);
+    LE_FATAL_IF(totalSize != ((uint64_t)ItemCount * ITEM_SIZE),
+                "unexpected total size %"PRIu64, totalSize);
+
+    LE_INFO("#################### END OF TestList #####################################");
+    LE_INFO(" ");
+}
+
+
+// Delete all the items at once.
+static void TestDelete
+(
+    void
+)
+{
+    LE_INFO("###################################################################################");
+    LE_INFO("#################### TestDelete ###################################################");
+    LE_INFO("###################################################################################");
+
+    char path[SECSTOREADMIN_MAX_PATH_BYTES];
+    uint8_t dataBuffer[ITEM_SIZE];
+    uint8_t outBuffer[ITEM_SIZE];
+    size_t outBufferSize = sizeof(outBuffer);
+    le_result_t result;
+
+    StartMeasure();
+    result = secStoreAdmin_Delete(TEST_DIR);
+    LE_FATAL_IF(result != LE_OK, "delete failed: [%s]", LE_RESULT_TXT(result));
+    EndMeasure("Delete");
+
+    GetItem(0, path, sizeof(path), dataBuffer);
+    result = secStoreAdmin_Read(path, outBuffer, &outBufferSize);
+    LE_FATAL_IF(result != LE_NOT_FOUND, "unexpected read result: [%s]", LE_RESULT_TXT(result));
+
+    LE_INFO("#################### END OF TestDelete ###################################");
+    LE_INFO(" ");
+}
+
+
+COMPONENT_INIT
+{
+    LE_INFO("=====================================================================");
+    LE_INFO("==================== SecStoreTestThroughput BEGIN ===================");
+    LE_INFO("=====================================================================");
+
+    uint64_t totalSize;
+    uint64_t freeSize;
+    le_result_t result = secStoreAdmin_GetTotalSpace(&totalSize, &freeSize);
+    LE_FATAL_IF(result != LE_OK, "get total space failed: [%s]", LE_RESULT_TXT(result));
+
+    // Only use half of the free space, to leave room for the storage metadata.
+    ItemCount = MAX_ITEM_COUNT;
+    if (((uint64_t)ItemCount * ITEM_SIZE) > (freeSize / 2))
+    {
+        ItemCount = freeSize / 2 / ITEM_SIZE;
+    }
+    LE_FATAL_IF(ItemCount == 0, "not enough free space: %"PRIu64" bytes", freeSize);
+
+    TestWriteRead();
+    TestList();
+    TestDelete();
+
+    LE_INFO("============ SecStoreTestThroughput PASSED =============");
+
+    exit(EXIT_SUCCESS);
+}
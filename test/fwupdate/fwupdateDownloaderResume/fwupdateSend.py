@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+# Send an update package to the fwupdateDownloaderResume application.
+#
+# The application sends the position where the download resumes: the package is only sent from
+# that position, instead of being sent whole and partly discarded by the target.
+#
+# Copyright (C) Sierra Wireless Inc.
+#
+
+import argparse
+import os
+import socket
+import sys
+
+BUF_SIZE = 64 * 1024
+
+
+def read_line(sock):
+    line = b""
+    while not line.endswith(b"\n"):
+        data = sock.recv(1)
+        if not data:
+            raise ConnectionError("connection closed before the resume position")
+        line += data
+    return line.decode().strip()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Send an update package with resume support.")
+    parser.add_argument("target", help="target IP address")
+    parser.add_argument("package", help="update package (.cwe)")
+    parser.add_argument("--port", type=int, default=5001)
+    args = parser.parse_args()
+
+    size = os.path.getsize(args.package)
+
+    with socket.create_connection((args.target, args.port)) as sock:
+        keyword, _, value = read_line(sock).partition(" ")
+        if keyword != "OFFSET" or not value.isdigit():
+            print("unexpected resume position: %s %s" % (keyword, value))
+            return 1
+        offset = int(value)
+        if offset > size:
+            print("resume position %d is beyond the package size %d" % (offset, size))
+            return 1
+
+        sock.sendall(b"START %d\n" % offset)
+        with open(args.package, "rb") as f:
+            f.seek(offset)
+            while True:
+                data = f.read(BUF_SIZE)
+                if not data:
+                    break
+                sock.sendall(data)
+        sock.shutdown(socket.SHUT_WR)
+
+        print("sent %d bytes from position %d: %d bytes (%.1f%%) not sent again"
+              % (size - offset, offset, offset, 100.0 * offset / size if size else 0.0))
+
+        # The target closes the connection at the end of the download
+        while sock.recv(BUF_SIZE):
+            pass
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
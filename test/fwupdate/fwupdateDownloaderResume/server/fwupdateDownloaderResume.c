@@ -23,6 +23,23 @@
  * @note If the download is interrupted before the end for any reason, you can resume it by relaunch
  *  the command.
  *
+ * Resume protocol: once connected, the server sends the position where the download resumes, as a
+ * text line:
+ * @verbatim
+ * OFFSET <resume position>\n
+ * @endverbatim
+ * A client aware of the protocol answers with the position it sends the package from, followed
+ * by the package data from that position, so the bytes already downloaded are not sent again:
+ * @verbatim
+ * START <position>\n<package data from position>
+ * @endverbatim
+ * The fwupdateSend.py script next to this application does it:
+ * @verbatim
+ * fwupdateSend.py <target_ip> <spkg_name.cwe>
+ * @endverbatim
+ * Other clients, like netcat, always send the whole package: the server then reads and discards
+ * the bytes before the resume position.
+ *
  * <HR>
  *
  * Copyright (C) Sierra Wireless Inc.
@@ -52,6 +69,21 @@
 //--------------------------------------------------------------------------------------------------
 #define BUF_SIZE 1024
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resume protocol: line sent by the server, and tag starting the line sent back by the client
+ */
+//--------------------------------------------------------------------------------------------------
+#define RESUME_OFFSET_FORMAT    "OFFSET %zu\n"
+#define RESUME_START_TAG        "START "
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum length of the resume protocol lines
+ */
+//--------------------------------------------------------------------------------------------------
+#define RESUME_LINE_MAX_LEN     32
+
 //--------------------------------------------------------------------------------------------------
 /**
  * This function checks the systems synchronization, and synchronized them if necessary
@@ -103,6 +135,70 @@ static le_result_t CheckSystemState
     return LE_OK;
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * This function sends the resume position to the client, and returns the number of bytes of the
+ * incoming stream to discard before the data expected by the firmware update service.
+ *
+ * @return
+ *      - LE_OK if succeed
+ *      - LE_FAULT if the client answer is incorrect
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t NegotiateResume
+(
+    int     connFd,                 ///< connection file descriptor
+    size_t  resumePosition,         ///< resume position expected by the service
+    size_t* skipCountPtr            ///< number of bytes to discard
+)
+{
+    char line[RESUME_LINE_MAX_LEN];
+    size_t startPosition;
+    ssize_t count;
+    int len;
+
+    // A client which doesn't know the protocol may already have sent everything and closed the
+    // connection: don't get a SIGPIPE
+    len = snprintf(line, sizeof(line), RESUME_OFFSET_FORMAT, resumePosition);
+    if (send(connFd, line, len, MSG_NOSIGNAL) != len)
+    {
+        LE_WARN("failed to send resume position: %m");
+    }
+
+    count = recv(connFd, line, strlen(RESUME_START_TAG), MSG_PEEK | MSG_WAITALL);
+    if (   (count != (ssize_t)strlen(RESUME_START_TAG))
+        || (0 != memcmp(line, RESUME_START_TAG, strlen(RESUME_START_TAG))))
+    {
+        // The whole package is sent
+        LE_INFO("client sends the whole package: %zu bytes to discard", resumePosition);
+        *skipCountPtr = resumePosition;
+        return LE_OK;
+    }
+
+    // Read the START line one byte at a time, not to consume any package data
+    for (len = 0; len < (int)sizeof(line) - 1; len++)
+    {
+        if ((1 != read(connFd, &line[len], 1)) || ('\n' == line[len]))
+        {
+            break;
+        }
+    }
+    line[len] = '\0';
+
+    if (   (1 != sscanf(line + strlen(RESUME_START_TAG), "%zu", &startPosition))
+        || (startPosition > resumePosition))
+    {
+        LE_ERROR("incorrect start line '%s' for resume position %zu", line, resumePosition);
+        return LE_FAULT;
+    }
+
+    *skipCountPtr = resumePosition - startPosition;
+    LE_INFO("client sends the package from %zu: %zu bytes not transferred, %zu to discard",
+            startPosition, startPosition, *skipCountPtr);
+
+    return LE_OK;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * This function wait for a connection and perform the download of the image when
@@ -131,23 +227,28 @@ static void SocketEventHandler
     else
     {
         size_t resumePosition;
+        size_t skipCount = 0;
 
         LE_INFO("Connected ...");
 
         result = CheckSystemState(&resumePosition);
+        if (result == LE_OK)
+        {
+            result = NegotiateResume(connFd, resumePosition, &skipCount);
+        }
 
         if (result == LE_OK)
         {
             if (resumePosition)
             {// we are doing a resume download
 
-                LE_INFO("resumePosition = %d", resumePosition);
+                LE_INFO("resumePosition = %zu", resumePosition);
 
-                while (resumePosition)
+                while (skipCount)
                 {
                     ssize_t readCount;
                     uint32_t buf[BUF_SIZE];
-                    size_t length = (resumePosition > BUF_SIZE) ? BUF_SIZE : resumePosition;
+                    size_t length = (skipCount > BUF_SIZE) ? BUF_SIZE : skipCount;
 
                     readCount = read(connFd, buf, length);
                     if (readCount == -1)
@@ -159,7 +260,7 @@ static void SocketEventHandler
                     {
                         if (readCount)
                         {
-                            resumePosition -= readCount;
+                            skipCount -= readCount;
                         }
                         else
                         {
@@ -170,9 +271,9 @@ static void SocketEventHandler
                 }
             }
 
-            if (resumePosition)
+            if (skipCount)
             {// error
-                LE_ERROR("end of file with resumePosition != 0 (%d)", resumePosition);
+                LE_ERROR("end of file with %zu bytes left to discard", skipCount);
                 le_fwupdate_InitDownload();
             }
             else
@@ -0,0 +1,143 @@
+/**
+ * Implement the IPC benchmark API in C, with asynchronous responses: the echo response is sent
+ * from a function queued to the event loop, after the request handler has returned.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pending echo request
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    ipcBench_ServerCmdRef_t cmdRef;                             ///< Request to respond to
+    char                    payload[IPCBENCH_PAYLOAD_MAX + 1];  ///< Payload to echo
+}
+PendingEcho_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool for the pending echo requests
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t PendingEchoPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tick event
+ */
+//--------------------------------------------------------------------------------------------------
+static le_event_Id_t TickEventId;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call the client handler for a tick
+ *
+ * The tick is timestamped here, right before it is sent to the client, so that the measured
+ * latency doesn't include the time spent in the event queue behind the previous ticks.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FirstLayerTickHandler
+(
+    void* reportPtr,
+    void* secondLayerHandlerFunc
+)
+{
+    uint32_t* seqPtr = reportPtr;
+    ipcBench_TickHandlerFunc_t clientHandlerFunc = secondLayerHandlerFunc;
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    clientHandlerFunc(*seqPtr, (uint64_t)now.sec * 1000000 + now.usec, le_event_GetContextPtr());
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send the response of a pending echo request
+ */
+//--------------------------------------------------------------------------------------------------
+static void RespondEcho
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    PendingEcho_t* echoPtr = param1Ptr;
+
+    ipcBench_EchoRespond(echoPtr->cmdRef, echoPtr->payload);
+    le_mem_Release(echoPtr);
+}
+
+ipcBench_TickHandlerRef_t ipcBench_AddTickHandler
+(
+    ipcBench_TickHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    le_event_HandlerRef_t handlerRef;
+
+    handlerRef = le_event_AddLayeredHandler("TickHandler",
+                                            TickEventId,
+                                            FirstLayerTickHandler,
+                                            (le_event_HandlerFunc_t)handlerPtr);
+
+    le_event_SetContextPtr(handlerRef, contextPtr);
+
+    return (ipcBench_TickHandlerRef_t)handlerRef;
+}
+
+void ipcBench_RemoveTickHandler
+(
+    ipcBench_TickHandlerRef_t handlerRef
+)
+{
+    le_event_RemoveHandler((le_event_HandlerRef_t)handlerRef);
+}
+
+void ipcBench_Echo
+(
+    ipcBench_ServerCmdRef_t cmdRef,
+    const char* InPayload,
+    size_t OutPayloadSize
+)
+{
+    PendingEcho_t* echoPtr = le_mem_ForceAlloc(PendingEchoPool);
+
+    echoPtr->cmdRef = cmdRef;
+    le_utf8_Copy(echoPtr->payload,
+                 InPayload,
+                 (OutPayloadSize < sizeof(echoPtr->payload)) ? OutPayloadSize
+                                                             : sizeof(echoPtr->payload),
+                 NULL);
+
+    le_event_QueueFunction(RespondEcho, echoPtr, NULL);
+}
+
+void ipcBench_FireTicks
+(
+    ipcBench_ServerCmdRef_t cmdRef,
+    uint32_t Count
+)
+{
+    uint32_t seq;
+
+    // Respond first, the ticks are reported while the client waits for them.
+    ipcBench_FireTicksRespond(cmdRef);
+
+    for (seq = 0; seq < Count; seq++)
+    {
+        le_event_Report(TickEventId, &seq, sizeof(seq));
+    }
+}
+
+COMPONENT_INIT
+{
+    PendingEchoPool = le_mem_CreatePool("PendingEchoPool", sizeof(PendingEcho_t));
+    TickEventId = le_event_CreateId("TickEvent", sizeof(uint32_t));
+}
@@ -0,0 +1,487 @@
+/**
+ * IPC benchmark client.
+ *
+ * Measures the round-trip time percentiles and the calls per second of echo calls to:
+ *  - a C server responding synchronously (ipcBench),
+ *  - a C server responding asynchronously (ipcBenchAsync),
+ *  - the ipcTest server, which is the C or the Java server depending on the app bindings. The
+ *    name of this server is given as the first argument of the process.
+ *
+ * Each echo case is run with several payload sizes and several concurrent client sessions. The
+ * event fan-out is measured by reporting ticks to several listening client sessions.
+ *
+ * Results are written on the standard output as a JSON document:
+ *
+ * @code
+ * {
+ *   "results": [
+ *     { "suite": "ipc", "test": "echo", "ops": 2000, "elapsedUs": 152000, "opsPerSec": 13157,
+ *       "server": "c-sync", "payload": 16, "sessions": 1, "p50Us": 74, "p90Us": 81, "p99Us": 120,
+ *       "maxUs": 410 },
+ *     ...
+ *   ]
+ * }
+ * @endcode
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of echo calls done by each client session.
+ */
+//--------------------------------------------------------------------------------------------------
+#define ECHO_CALLS          2000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of ticks reported to each listening client session.
+ */
+//--------------------------------------------------------------------------------------------------
+#define TICKS_COUNT         2000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of concurrent client sessions.
+ */
+//--------------------------------------------------------------------------------------------------
+#define MAX_SESSIONS        4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum payload of the ipcTest echo.
+ */
+//--------------------------------------------------------------------------------------------------
+#define IPCTEST_PAYLOAD_MAX 256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Server measured by the echo benchmark.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                                ///< Name reported in the results
+    le_result_t (*tryConnectFunc)(void);                ///< Connect the current thread
+    void (*disconnectFunc)(void);                       ///< Disconnect the current thread
+    void (*echoFunc)(const char*, char*, size_t);       ///< Echo function
+    size_t payloadMax;                                  ///< Largest payload
+}
+Server_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Servers measured by the echo benchmark.
+ */
+//--------------------------------------------------------------------------------------------------
+static Server_t Servers[] =
+{
+    { "c-sync",  ipcBench_TryConnectService,      ipcBench_DisconnectService,
+      ipcBench_Echo,      IPCBENCH_PAYLOAD_MAX },
+    { "c-async", ipcBenchAsync_TryConnectService, ipcBenchAsync_DisconnectService,
+      ipcBenchAsync_Echo, IPCBENCH_PAYLOAD_MAX },
+    { NULL,      ipcTest_TryConnectService,       ipcTest_DisconnectService,
+      ipcTest_EchoString, IPCTEST_PAYLOAD_MAX },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Payload sizes of the echo calls.
+ */
+//--------------------------------------------------------------------------------------------------
+static const size_t PayloadSizes[] = { 0, 16, 64, 256, IPCBENCH_PAYLOAD_MAX };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Numbers of concurrent client sessions.
+ */
+//--------------------------------------------------------------------------------------------------
+static const int SessionCounts[] = { 1, 2, MAX_SESSIONS };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Latency samples of all the sessions of a case, in microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t Samples[MAX_SESSIONS * (ECHO_CALLS > TICKS_COUNT ? ECHO_CALLS : TICKS_COUNT)];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of results reported so far.
+ */
+//--------------------------------------------------------------------------------------------------
+static unsigned int ReportCount = 0;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Context of an echo client session.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const Server_t* serverPtr;      ///< Server to call
+    size_t          payloadSize;    ///< Size of the echoed payload
+    uint32_t*       samplesPtr;     ///< Latency of each call
+    le_sem_Ref_t    readySem;       ///< Posted once the session is opened
+    le_sem_Ref_t    startSem;       ///< Released when all the sessions are opened
+}
+EchoSession_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Context of a listening client session.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    ipcBench_TickHandlerRef_t handlerRef;   ///< Tick handler
+    uint32_t*                 samplesPtr;   ///< Latency of each tick
+    uint32_t                  received;     ///< Number of ticks received
+    bool                      stopped;      ///< All the ticks are received, ignore the others
+    le_sem_Ref_t              readySem;     ///< Posted once the handler is registered
+    le_sem_Ref_t              doneSem;      ///< Posted once all the ticks are received
+}
+Listener_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative time in microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetTimeUs
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (uint64_t)now.sec * 1000000 + now.usec;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two latency samples, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareSamples
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    uint32_t a = *(const uint32_t*)aPtr;
+    uint32_t b = *(const uint32_t*)bPtr;
+
+    return (a > b) - (a < b);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a benchmark result, with the latency percentiles of the samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Report
+(
+    const char* testPtr,        ///< [IN] Operation measured
+    const char* serverPtr,      ///< [IN] Server measured
+    size_t      payloadSize,    ///< [IN] Payload size
+    int         sessions,       ///< [IN] Number of concurrent client sessions
+    uint64_t    elapsedUs,      ///< [IN] Time taken by all the operations
+    uint32_t    samplesCount    ///< [IN] Number of samples, i.e. operations done
+)
+{
+    qsort(Samples, samplesCount, sizeof(Samples[0]), CompareSamples);
+
+    printf("%s    { \"suite\": \"ipc\", \"test\": \"%s\", \"ops\": %"PRIu32
+           ", \"elapsedUs\": %"PRIu64", \"opsPerSec\": %"PRIu64", \"server\": \"%s\""
+           ", \"payload\": %zu, \"sessions\": %d"
+           ", \"p50Us\": %"PRIu32", \"p90Us\": %"PRIu32", \"p99Us\": %"PRIu32", \"maxUs\": %"PRIu32
+           " }",
+           (ReportCount ? ",\n" : ""),
+           testPtr,
+           samplesCount,
+           elapsedUs,
+           elapsedUs ? ((uint64_t)samplesCount * 1000000) / elapsedUs : 0,
+           serverPtr,
+           payloadSize,
+           sessions,
+           Samples[(samplesCount - 1) * 50 / 100],
+           Samples[(samplesCount - 1) * 90 / 100],
+           Samples[(samplesCount - 1) * 99 / 100],
+           Samples[samplesCount - 1]);
+    fflush(stdout);
+
+    ReportCount++;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Echo client session thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void* EchoThread
+(
+    void* contextPtr
+)
+{
+    EchoSession_t* sessionPtr = contextPtr;
+    char inPayload[IPCBENCH_PAYLOAD_MAX + 1];
+    char outPayload[IPCBENCH_PAYLOAD_MAX + 1];
+    int i;
+
+    memset(inPayload, 'x', sessionPtr->payloadSize);
+    inPayload[sessionPtr->payloadSize] = '\0';
+
+    LE_ASSERT(LE_OK == sessionPtr->serverPtr->tryConnectFunc());
+
+    le_sem_Post(sessionPtr->readySem);
+    le_sem_Wait(sessionPtr->startSem);
+
+    for (i = 0; i < ECHO_CALLS; i++)
+    {
+        uint64_t startUs = GetTimeUs();
+
+        sessionPtr->serverPtr->echoFunc(inPayload,
+                                        outPayload,
+                                        sessionPtr->serverPtr->payloadMax + 1);
+        sessionPtr->samplesPtr[i] = GetTimeUs() - startUs;
+    }
+
+    LE_ASSERT(0 == strcmp(inPayload, outPayload));
+
+    sessionPtr->serverPtr->disconnectFunc();
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure echo calls from concurrent client sessions.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchmarkEcho
+(
+    const Server_t* serverPtr,
+    size_t          payloadSize,
+    int             sessions
+)
+{
+    EchoSession_t sessionsCtx[MAX_SESSIONS];
+    le_thread_Ref_t threads[MAX_SESSIONS];
+    le_sem_Ref_t readySem = le_sem_Create("EchoReadySem", 0);
+    le_sem_Ref_t startSem = le_sem_Create("EchoStartSem", 0);
+    uint64_t startUs;
+    int i;
+
+    for (i = 0; i < sessions; i++)
+    {
+        sessionsCtx[i].serverPtr = serverPtr;
+        sessionsCtx[i].payloadSize = payloadSize;
+        sessionsCtx[i].samplesPtr = &Samples[i * ECHO_CALLS];
+        sessionsCtx[i].readySem = readySem;
+        sessionsCtx[i].startSem = startSem;
+
+        threads[i] = le_thread_Create("EchoSession", EchoThread, &sessionsCtx[i]);
+        le_thread_SetJoinable(threads[i]);
+        le_thread_Start(threads[i]);
+    }
+
+    for (i = 0; i < sessions; i++)
+    {
+        le_sem_Wait(readySem);
+    }
+
+    startUs = GetTimeUs();
+
+    for (i = 0; i < sessions; i++)
+    {
+        le_sem_Post(startSem);
+    }
+
+    for (i = 0; i < sessions; i++)
+    {
+        le_thread_Join(threads[i], NULL);
+    }
+
+    Report("echo", serverPtr->namePtr, payloadSize, sessions, GetTimeUs() - startUs,
+           sessions * ECHO_CALLS);
+
+    le_sem_Delete(readySem);
+    le_sem_Delete(startSem);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tick handler of a listening client session.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TickHandler
+(
+    uint32_t seq,
+    uint64_t sentUs,
+    void*    contextPtr
+)
+{
+    Listener_t* listenerPtr = contextPtr;
+
+    if (listenerPtr->stopped)
+    {
+        return;
+    }
+
+    listenerPtr->samplesPtr[listenerPtr->received++] = GetTimeUs() - sentUs;
+
+    if (TICKS_COUNT == listenerPtr->received)
+    {
+        listenerPtr->stopped = true;
+        ipcBench_RemoveTickHandler(listenerPtr->handlerRef);
+        ipcBench_DisconnectService();
+        le_sem_Post(listenerPtr->doneSem);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Listening client session thread.
+ */
+//--------------------------------------------------------------------------------------------------
+static void* ListenerThread
+(
+    void* contextPtr
+)
+{
+    Listener_t* listenerPtr = contextPtr;
+
+    ipcBench_ConnectService();
+    listenerPtr->handlerRef = ipcBench_AddTickHandler(TickHandler, listenerPtr);
+
+    le_sem_Post(listenerPtr->readySem);
+
+    le_event_RunLoop();
+
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure ticks reported to several listening client sessions.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BenchmarkFanOut
+(
+    int sessions
+)
+{
+    static Listener_t listeners[MAX_SESSIONS];
+    le_thread_Ref_t threads[MAX_SESSIONS];
+    le_sem_Ref_t readySem = le_sem_Create("ListenerReadySem", 0);
+    le_sem_Ref_t doneSem = le_sem_Create("ListenerDoneSem", 0);
+    uint64_t startUs;
+    int i;
+
+    for (i = 0; i < sessions; i++)
+    {
+        listeners[i].samplesPtr = &Samples[i * TICKS_COUNT];
+        listeners[i].received = 0;
+        listeners[i].stopped = false;
+        listeners[i].readySem = readySem;
+        listeners[i].doneSem = doneSem;
+
+        threads[i] = le_thread_Create("Listener", ListenerThread, &listeners[i]);
+        le_thread_SetJoinable(threads[i]);
+        le_thread_Start(threads[i]);
+    }
+
+    for (i = 0; i < sessions; i++)
+    {
+        le_sem_Wait(readySem);
+    }
+
+    startUs = GetTimeUs();
+
+    ipcBench_FireTicks(TICKS_COUNT);
+
+    for (i = 0; i < sessions; i++)
+    {
+        le_sem_Wait(doneSem);
+    }
+
+    Report("eventFanOut", "c-sync", 0, sessions, GetTimeUs() - startUs, sessions * TICKS_COUNT);
+
+    // The listeners are disconnected and only run their event loop: stop them
+    for (i = 0; i < sessions; i++)
+    {
+        le_thread_Cancel(threads[i]);
+        le_thread_Join(threads[i], NULL);
+    }
+
+    le_sem_Delete(readySem);
+    le_sem_Delete(doneSem);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run all the benchmarks, then exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void* BenchmarkThread
+(
+    void* contextPtr
+)
+{
+    size_t server;
+    size_t payload;
+    size_t sessions;
+
+    printf("{\n  \"results\": [\n");
+
+    for (server = 0; server < NUM_ARRAY_MEMBERS(Servers); server++)
+    {
+        // Check the server is reachable before starting the sessions
+        if (LE_OK != Servers[server].tryConnectFunc())
+        {
+            LE_WARN("Server '%s' not available, skipped", Servers[server].namePtr);
+            continue;
+        }
+        Servers[server].disconnectFunc();
+
+        for (payload = 0; payload < NUM_ARRAY_MEMBERS(PayloadSizes); payload++)
+        {
+            if (PayloadSizes[payload] > Servers[server].payloadMax)
+            {
+                continue;
+            }
+
+            for (sessions = 0; sessions < NUM_ARRAY_MEMBERS(SessionCounts); sessions++)
+            {
+                BenchmarkEcho(&Servers[server], PayloadSizes[payload], SessionCounts[sessions]);
+            }
+        }
+    }
+
+    // The ticks are fired from this thread
+    ipcBench_ConnectService();
+
+    for (sessions = 0; sessions < NUM_ARRAY_MEMBERS(SessionCounts); sessions++)
+    {
+        BenchmarkFanOut(SessionCounts[sessions]);
+    }
+
+    printf("\n  ]\n}\n");
+
+    exit(EXIT_SUCCESS);
+}
+
+COMPONENT_INIT
+{
+    // The ipcTest server is the C or the Java server, depending on the app.
+    Servers[NUM_ARRAY_MEMBERS(Servers) - 1].namePtr = (le_arg_NumArgs() >= 1) ? le_arg_GetArg(0)
+                                                                               : "ipcTest";
+
+    le_thread_Start(le_thread_Create("ipcBench", BenchmarkThread, NULL));
+}
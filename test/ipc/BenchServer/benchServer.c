@@ -0,0 +1,96 @@
+/**
+ * Implement the IPC benchmark API in C, with synchronous responses.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tick event
+ */
+//--------------------------------------------------------------------------------------------------
+static le_event_Id_t TickEventId;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call the client handler for a tick
+ *
+ * The tick is timestamped here, right before it is sent to the client, so that the measured
+ * latency doesn't include the time spent in the event queue behind the previous ticks.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FirstLayerTickHandler
+(
+    void* reportPtr,
+    void* secondLayerHandlerFunc
+)
+{
+    uint32_t* seqPtr = reportPtr;
+    ipcBench_TickHandlerFunc_t clientHandlerFunc = secondLayerHandlerFunc;
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    clientHandlerFunc(*seqPtr, (uint64_t)now.sec * 1000000 + now.usec, le_event_GetContextPtr());
+}
+
+ipcBench_TickHandlerRef_t ipcBench_AddTickHandler
+(
+    ipcBench_TickHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    le_event_HandlerRef_t handlerRef;
+
+    handlerRef = le_event_AddLayeredHandler("TickHandler",
+                                            TickEventId,
+                                            FirstLayerTickHandler,
+                                            (le_event_HandlerFunc_t)handlerPtr);
+
+    le_event_SetContextPtr(handlerRef, contextPtr);
+
+    return (ipcBench_TickHandlerRef_t)handlerRef;
+}
+
+void ipcBench_RemoveTickHandler
+(
+    ipcBench_TickHandlerRef_t handlerRef
+)
+{
+    le_event_RemoveHandler((le_event_HandlerRef_t)handlerRef);
+}
+
+void ipcBench_Echo
+(
+    const char* InPayload,
+    char* OutPayload,
+    size_t OutPayloadSize
+)
+{
+    if (OutPayload)
+    {
+        strncpy(OutPayload, InPayload, OutPayloadSize);
+        OutPayload[OutPayloadSize-1] = '\0';
+    }
+}
+
+void ipcBench_FireTicks
+(
+    uint32_t Count
+)
+{
+    uint32_t seq;
+
+    for (seq = 0; seq < Count; seq++)
+    {
+        le_event_Report(TickEventId, &seq, sizeof(seq));
+    }
+}
+
+COMPONENT_INIT
+{
+    TickEventId = le_event_CreateId("TickEvent", sizeof(uint32_t));
+}
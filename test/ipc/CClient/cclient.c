@@ -7,6 +7,7 @@
 
 #include <setjmp.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include <CUnit/Console.h>
 #include <CUnit/Basic.h>
@@ -171,6 +172,91 @@ static void TestEchoArrayNull(void)
 }
 #endif
 
+/*
+ * Bulk transfer tests -- the payload goes through a memory region shared once per session, and
+ * only offsets and lengths go through the messages.
+ */
+
+// Bulk region shared with the server: input payloads in the first half, echoed payloads in the
+// second half.
+static uint8_t* BulkRegionPtr = NULL;
+static bool BulkSupported = true;
+
+static void TestSetBulkRegion(void)
+{
+    int fd = memfd_create("ipcTestBulk", 0);
+    le_result_t result;
+
+    CU_ASSERT_FATAL(fd >= 0);
+    CU_ASSERT_FATAL(0 == ftruncate(fd, IPCTEST_BULK_REGION_MAX_SIZE));
+
+    BulkRegionPtr = mmap(NULL, IPCTEST_BULK_REGION_MAX_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+    CU_ASSERT_FATAL(MAP_FAILED != BulkRegionPtr);
+
+    // The file descriptor is closed when it is sent, so give the server a duplicate.
+    result = ipcTest_SetBulkRegion(dup(fd), IPCTEST_BULK_REGION_MAX_SIZE);
+    close(fd);
+
+    if (LE_NOT_IMPLEMENTED == result)
+    {
+        munmap(BulkRegionPtr, IPCTEST_BULK_REGION_MAX_SIZE);
+        BulkRegionPtr = NULL;
+        BulkSupported = false;
+        CU_PASS("Bulk transfer not supported by server");
+        return;
+    }
+
+    CU_ASSERT(LE_OK == result);
+}
+
+static void TestEchoBulkArray(void)
+{
+    static const uint32_t sizes[] = { 4*1024, 64*1024, 1024*1024, 4*1024*1024,
+                                      IPCTEST_BULK_REGION_MAX_SIZE/2 };
+    const uint32_t outOffset = IPCTEST_BULK_REGION_MAX_SIZE/2;
+    size_t i;
+
+    if (!BulkSupported)
+    {
+        CU_PASS("Bulk transfer not supported by server");
+        return;
+    }
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(sizes); i++)
+    {
+        uint32_t j;
+        le_clk_Time_t startTime, duration;
+
+        for (j = 0; j < sizes[i]; j++)
+        {
+            BulkRegionPtr[j] = (uint8_t)(j * 31 + i);
+        }
+        memset(BulkRegionPtr + outOffset, 0, sizes[i]);
+
+        startTime = le_clk_GetRelativeTime();
+        CU_ASSERT(LE_OK == ipcTest_EchoBulkArray(0, sizes[i], outOffset));
+        duration = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+        CU_ASSERT(0 == memcmp(BulkRegionPtr, BulkRegionPtr + outOffset, sizes[i]));
+
+        LE_INFO("Bulk echo of %" PRIu32 " bytes in %ld us", sizes[i],
+                (long)(duration.sec * 1000000 + duration.usec));
+    }
+}
+
+static void TestEchoBulkArrayOutOfRange(void)
+{
+    if (!BulkSupported)
+    {
+        CU_PASS("Bulk transfer not supported by server");
+        return;
+    }
+
+    CU_ASSERT(LE_OUT_OF_RANGE == ipcTest_EchoBulkArray(IPCTEST_BULK_REGION_MAX_SIZE - 16, 32, 0));
+    CU_ASSERT(LE_OUT_OF_RANGE == ipcTest_EchoBulkArray(0, 32, UINT32_MAX));
+}
+
 // Server exit handler.
 static jmp_buf ServerExitJump;
 
@@ -223,6 +309,9 @@ static void* run_test(void* context)
 //              { "EchoArray", TestEchoSmallArray },
 //              { "EchoArray with max size array", TestEchoMaxArray },
 //              { "EchoArray with NULL output", TestEchoArrayNull },
+              { "SetBulkRegion", TestSetBulkRegion },
+              { "EchoBulkArray from 4 KB to 8 MB", TestEchoBulkArray },
+              { "EchoBulkArray out of the region", TestEchoBulkArrayOutOfRange },
               { "Server exit", TestServerExit},
               CU_TEST_INFO_NULL
         };
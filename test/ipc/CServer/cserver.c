@@ -8,6 +8,22 @@
 #include "interfaces.h"
 
 #include <string.h>
+#include <sys/mman.h>
+
+/*
+ * Bulk region shared by a client session.
+ */
+typedef struct
+{
+    uint8_t* basePtr;
+    size_t   size;
+}
+BulkRegion_t;
+
+static le_mem_PoolRef_t BulkRegionPool;
+
+// Bulk regions, indexed by client session reference.
+static le_hashmap_Ref_t BulkRegionMap;
 
 void ipcTest_EchoSimple
 (
@@ -120,6 +136,95 @@ void ipcTest_EchoArray
 }
 #endif
 
+le_result_t ipcTest_SetBulkRegion
+(
+    int RegionFd,
+    uint32_t RegionSize
+)
+{
+    le_msg_SessionRef_t sessionRef = ipcTest_GetClientSessionRef();
+    BulkRegion_t* regionPtr;
+    void* basePtr;
+
+    if ((RegionFd < 0) || (0 == RegionSize) || (RegionSize > IPCTEST_BULK_REGION_MAX_SIZE))
+    {
+        if (RegionFd >= 0)
+        {
+            close(RegionFd);
+        }
+        return LE_BAD_PARAMETER;
+    }
+
+    basePtr = mmap(NULL, RegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, RegionFd, 0);
+    close(RegionFd);
+
+    if (MAP_FAILED == basePtr)
+    {
+        LE_ERROR("Unable to map bulk region: %m");
+        return LE_FAULT;
+    }
+
+    // A session replaces its region by setting a new one.
+    regionPtr = le_hashmap_Remove(BulkRegionMap, sessionRef);
+    if (regionPtr)
+    {
+        munmap(regionPtr->basePtr, regionPtr->size);
+    }
+    else
+    {
+        regionPtr = le_mem_ForceAlloc(BulkRegionPool);
+    }
+
+    regionPtr->basePtr = basePtr;
+    regionPtr->size = RegionSize;
+    le_hashmap_Put(BulkRegionMap, sessionRef, regionPtr);
+
+    return LE_OK;
+}
+
+le_result_t ipcTest_EchoBulkArray
+(
+    uint32_t InOffset,
+    uint32_t Length,
+    uint32_t OutOffset
+)
+{
+    BulkRegion_t* regionPtr = le_hashmap_Get(BulkRegionMap, ipcTest_GetClientSessionRef());
+
+    if (!regionPtr)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    if (((uint64_t)InOffset + Length > regionPtr->size) ||
+        ((uint64_t)OutOffset + Length > regionPtr->size))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    memmove(regionPtr->basePtr + OutOffset, regionPtr->basePtr + InOffset, Length);
+
+    return LE_OK;
+}
+
+/*
+ * Release the bulk region of a closed client session.
+ */
+static void SessionCloseHandler
+(
+    le_msg_SessionRef_t sessionRef,
+    void* contextPtr
+)
+{
+    BulkRegion_t* regionPtr = le_hashmap_Remove(BulkRegionMap, sessionRef);
+
+    if (regionPtr)
+    {
+        munmap(regionPtr->basePtr, regionPtr->size);
+        le_mem_Release(regionPtr);
+    }
+}
+
 void ipcTest_ExitServer
 (
     void
@@ -130,4 +235,11 @@ void ipcTest_ExitServer
 
 COMPONENT_INIT
 {
+    BulkRegionPool = le_mem_CreatePool("BulkRegionPool", sizeof(BulkRegion_t));
+    BulkRegionMap = le_hashmap_Create("BulkRegionMap",
+                                      31,
+                                      le_hashmap_HashVoidPointer,
+                                      le_hashmap_EqualsVoidPointer);
+
+    le_msg_AddServiceCloseHandler(ipcTest_GetServiceRef(), SessionCloseHandler, NULL);
 }
@@ -6,13 +6,19 @@ package io.legato.test;
 
 import java.util.logging.Logger;
 import java.math.BigInteger;
+import java.io.FileDescriptor;
+import java.io.FileInputStream;
+import java.io.IOException;
 
 import io.legato.Ref;
+import io.legato.Result;
 import io.legato.Component;
 import io.legato.api.ipcTest;
 
 public class JavaServer implements ipcTest, Component
 {
+    private Logger logger;
+
     @Override
     public void EchoSimple
     (
@@ -104,6 +110,38 @@ public class JavaServer implements ipcTest, Component
         }
     }
 
+    @Override
+    public Result SetBulkRegion
+    (
+        FileDescriptor RegionFd,
+        BigInteger RegionSize
+    )
+    {
+        // Shared memory regions can't be mapped from Java, but the file descriptor received with
+        // the message is owned by the server and must still be closed.
+        try
+        {
+            new FileInputStream(RegionFd).close();
+        }
+        catch (IOException e)
+        {
+            logger.warning("Failed to close bulk region: " + e.getMessage());
+        }
+
+        return Result.NOT_IMPLEMENTED;
+    }
+
+    @Override
+    public Result EchoBulkArray
+    (
+        BigInteger InOffset,
+        BigInteger Length,
+        BigInteger OutOffset
+    )
+    {
+        return Result.NOT_IMPLEMENTED;
+    }
+
     @Override
     public void ExitServer()
     {
@@ -118,5 +156,6 @@ public class JavaServer implements ipcTest, Component
     @Override
     public void setLogger(Logger logger)
     {
+        this.logger = logger;
     }
 }
@@ -17,10 +17,13 @@ uint8_t NbConnection = 1;
 #define NB_CONNECTION_MAX 4
 
 le_mdc_ProfileRef_t ProfileRef[NB_CONNECTION_MAX];
-bool TaskStarted[NB_CONNECTION_MAX];
 
 static le_mdc_MtPdpSessionStateHandlerRef_t MtPdpSessionStateHandlerRef;
 
+/// Parallel bring-up of all the profiles, the per-profile test threads are started once it is done.
+static uint8_t BringUpResultCount;
+static le_clk_Time_t BringUpStartTime;
+
 
 static pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;   // POSIX "Fast" mutex.
 
@@ -33,8 +36,8 @@ static pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;   // POSIX "Fast" mute
 
 static le_result_t UpdateResolvConf
 (
-    char* dns1AddrPtr,
-    char* dns2AddrPtr
+    const char* dns1AddrPtr,
+    const char* dns2AddrPtr
 )
 {
     FILE*  resolvFilePtr;
@@ -80,57 +83,114 @@ static le_result_t UpdateResolvConf
 }
 
 
-static bool TestIpv4Connectivity
+//--------------------------------------------------------------------------------------------------
+/**
+ * Network configuration of a data session, collected once when the session is connected.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char interfaceName[LE_MDC_INTERFACE_NAME_MAX_BYTES];
+    bool isIpv4;
+    bool isIpv6;
+    char ipv4Addr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char ipv4GatewayAddr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char ipv4Dns1Addr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char ipv4Dns2Addr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char ipv6Addr[LE_MDC_IPV6_ADDR_MAX_BYTES];
+    char ipv6GatewayAddr[LE_MDC_IPV6_ADDR_MAX_BYTES];
+    char ipv6Dns1Addr[LE_MDC_IPV6_ADDR_MAX_BYTES];
+    char ipv6Dns2Addr[LE_MDC_IPV6_ADDR_MAX_BYTES];
+}
+SessionInfo_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the whole network configuration of a connected data session.
+ *
+ * This is a test-side convenience, not an le_mdc API: it still makes one le_mdc request per field.
+ *
+ * @return
+ *  - LE_OK on success
+ *  - LE_FAULT if the interface name or one of the addresses of a supported IP family can't be
+ *    retrieved
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetSessionInfo
 (
-    le_mdc_ProfileRef_t ProfileRef
+    le_mdc_ProfileRef_t profileRef,
+    SessionInfo_t* infoPtr
 )
 {
-    char interfaceName[100];
-    char gatewayAddr[100];
-    char ipAddr[100];
-    char dns1Addr[100];
-    char dns2Addr[100];
-    char system_cmd[200];
+    memset(infoPtr, 0, sizeof(*infoPtr));
 
-    if ( !le_mdc_IsIPv4(ProfileRef) )
+    if (le_mdc_GetInterfaceName(profileRef, infoPtr->interfaceName,
+                                sizeof(infoPtr->interfaceName)) != LE_OK)
     {
-        LE_INFO("The interface do not provide the Ipv4 connectivity");
-        return false;
+        LE_INFO("le_mdc_GetInterfaceName failed");
+        return LE_FAULT;
     }
 
-    if ( le_mdc_GetInterfaceName(ProfileRef, interfaceName, sizeof(interfaceName)) != LE_OK )
+    infoPtr->isIpv4 = le_mdc_IsIPv4(profileRef);
+    infoPtr->isIpv6 = le_mdc_IsIPv6(profileRef);
+
+    if (infoPtr->isIpv4)
     {
-        LE_INFO("le_mdc_GetInterfaceName failed");
-        return false;
+        if ((le_mdc_GetIPv4Address(profileRef, infoPtr->ipv4Addr,
+                                   sizeof(infoPtr->ipv4Addr)) != LE_OK) ||
+            (le_mdc_GetIPv4GatewayAddress(profileRef, infoPtr->ipv4GatewayAddr,
+                                          sizeof(infoPtr->ipv4GatewayAddr)) != LE_OK) ||
+            (le_mdc_GetIPv4DNSAddresses(profileRef,
+                                        infoPtr->ipv4Dns1Addr, sizeof(infoPtr->ipv4Dns1Addr),
+                                        infoPtr->ipv4Dns2Addr, sizeof(infoPtr->ipv4Dns2Addr))
+                                                                                    != LE_OK))
+        {
+            LE_INFO("IPv4 configuration of %s failed", infoPtr->interfaceName);
+            return LE_FAULT;
+        }
     }
 
-    LE_INFO("le_mdc_GetInterfaceName called");
-
-    if (le_mdc_GetIPv4Address (ProfileRef, ipAddr, sizeof(ipAddr)) != LE_OK)
+    if (infoPtr->isIpv6)
     {
-        LE_INFO("le_mdc_GetIPv4Address failed");
-        return false;
+        if ((le_mdc_GetIPv6Address(profileRef, infoPtr->ipv6Addr,
+                                   sizeof(infoPtr->ipv6Addr)) != LE_OK) ||
+            (le_mdc_GetIPv6GatewayAddress(profileRef, infoPtr->ipv6GatewayAddr,
+                                          sizeof(infoPtr->ipv6GatewayAddr)) != LE_OK) ||
+            (le_mdc_GetIPv6DNSAddresses(profileRef,
+                                        infoPtr->ipv6Dns1Addr, sizeof(infoPtr->ipv6Dns1Addr),
+                                        infoPtr->ipv6Dns2Addr, sizeof(infoPtr->ipv6Dns2Addr))
+                                                                                    != LE_OK))
+        {
+            LE_INFO("IPv6 configuration of %s failed", infoPtr->interfaceName);
+            return LE_FAULT;
+        }
     }
 
-    LE_INFO("le_mdc_GetIPv4Address called");
+    return LE_OK;
+}
 
-    LE_INFO("%s %s", interfaceName, ipAddr);
+static bool TestIpv4Connectivity
+(
+    const SessionInfo_t* infoPtr
+)
+{
+    char system_cmd[200];
 
-    if ( le_mdc_GetIPv4GatewayAddress(ProfileRef, gatewayAddr, sizeof(gatewayAddr)) != LE_OK )
+    if ( !infoPtr->isIpv4 )
     {
-        LE_INFO("le_mdc_GetGatewayAddress failed");
+        LE_INFO("The interface do not provide the Ipv4 connectivity");
         return false;
     }
 
-    LE_INFO("le_mdc_GetGatewayAddress called");
-    LE_PRINT_VALUE("%s", gatewayAddr);
+    LE_INFO("%s %s", infoPtr->interfaceName, infoPtr->ipv4Addr);
+    LE_PRINT_VALUE("%s", infoPtr->ipv4GatewayAddr);
 
     LE_INFO("waiting a few seconds before setting the route for the default gateway");
     sleep(5);
 
     LOCK
     snprintf(system_cmd, sizeof(system_cmd), "route add default gateway %s dev %s",
-                                                                        gatewayAddr, interfaceName);
+                                            infoPtr->ipv4GatewayAddr, infoPtr->interfaceName);
     if ( system(system_cmd) != 0 )
     {
         LE_INFO("system '%s' failed", system_cmd);
@@ -139,21 +199,10 @@ static bool TestIpv4Connectivity
     }
     LE_INFO("system '%s' called", system_cmd);
 
+    LE_PRINT_VALUE("%s", infoPtr->ipv4Dns1Addr);
+    LE_PRINT_VALUE("%s", infoPtr->ipv4Dns2Addr);
 
-    if ( le_mdc_GetIPv4DNSAddresses(ProfileRef,
-                                    dns1Addr, sizeof(dns1Addr),
-                                    dns2Addr, sizeof(dns2Addr)) != LE_OK )
-    {
-        LE_INFO("le_mdc_GetDNSAddresses failed");
-        UNLOCK
-        return false;
-    }
-
-    LE_INFO("le_mdc_GetDNSAddresses called");
-    LE_PRINT_VALUE("%s", dns1Addr);
-    LE_PRINT_VALUE("%s", dns2Addr);
-
-    if (UpdateResolvConf(dns1Addr, dns2Addr) != LE_OK)
+    if (UpdateResolvConf(infoPtr->ipv4Dns1Addr, infoPtr->ipv4Dns2Addr) != LE_OK)
     {
         UNLOCK
         return false;
@@ -184,55 +233,26 @@ static bool TestIpv4Connectivity
 
 static bool TestIpv6Connectivity
 (
-    le_mdc_ProfileRef_t ProfileRef
+    const SessionInfo_t* infoPtr
 )
 {
-    char interfaceName[100];
-    char gatewayAddr[100];
-    char ipAddr[100];
-    char dns1Addr[100];
-    char dns2Addr[100];
     char system_cmd[200];
 
-    if ( !le_mdc_IsIPv6(ProfileRef) )
+    if ( !infoPtr->isIpv6 )
     {
         LE_INFO("The interface do not provide the Ipv6 connectivity");
         return false;
     }
 
-    if ( le_mdc_GetInterfaceName(ProfileRef, interfaceName, sizeof(interfaceName)) != LE_OK )
-    {
-        LE_INFO("le_mdc_GetInterfaceName failed");
-        return false;
-    }
-
-    LE_INFO("le_mdc_GetInterfaceName called");
-
-    if (le_mdc_GetIPv6Address (ProfileRef, ipAddr, sizeof(ipAddr)) != LE_OK)
-    {
-        LE_INFO("le_mdc_GetIPv6Address failed");
-        return false;
-    }
-
-    LE_INFO("le_mdc_GetIPv6Address called");
-
-    LE_INFO("%s %s", interfaceName, ipAddr);
-
-
-    if ( le_mdc_GetIPv6GatewayAddress(ProfileRef, gatewayAddr, sizeof(gatewayAddr)) != LE_OK )
-    {
-        LE_INFO("le_mdc_GetGatewayAddress failed");
-        return false;
-    }
-
-    LE_INFO("le_mdc_GetGatewayAddress called");
-    LE_PRINT_VALUE("%s", gatewayAddr);
+    LE_INFO("%s %s", infoPtr->interfaceName, infoPtr->ipv6Addr);
+    LE_PRINT_VALUE("%s", infoPtr->ipv6GatewayAddr);
 
     LE_INFO("waiting a few seconds before setting the route for the default gateway");
     sleep(5);
 
     LOCK
-    snprintf(system_cmd, sizeof(system_cmd), "route -A inet6 add default gw %s", gatewayAddr);
+    snprintf(system_cmd, sizeof(system_cmd), "route -A inet6 add default gw %s",
+                                                                    infoPtr->ipv6GatewayAddr);
     if ( system(system_cmd) != 0 )
     {
         LE_INFO("system '%s' failed", system_cmd);
@@ -241,19 +261,10 @@ static bool TestIpv6Connectivity
     }
     LE_INFO("system '%s' called", system_cmd);
 
-    if ( le_mdc_GetIPv6DNSAddresses(ProfileRef,
-                                    dns1Addr, sizeof(dns1Addr),
-                                    dns2Addr, sizeof(dns2Addr)) != LE_OK )
-    {
-        LE_INFO("le_mdc_GetDNSAddresses failed");
-        UNLOCK
-        return false;
-    }
-    LE_INFO("le_mdc_GetDNSAddresses called");
-    LE_PRINT_VALUE("%s", dns1Addr);
-    LE_PRINT_VALUE("%s", dns2Addr);
+    LE_PRINT_VALUE("%s", infoPtr->ipv6Dns1Addr);
+    LE_PRINT_VALUE("%s", infoPtr->ipv6Dns2Addr);
 
-    if (UpdateResolvConf(dns1Addr, dns2Addr) != LE_OK)
+    if (UpdateResolvConf(infoPtr->ipv6Dns1Addr, infoPtr->ipv6Dns2Addr) != LE_OK)
     {
         UNLOCK
         return false;
@@ -268,7 +279,8 @@ static bool TestIpv6Connectivity
     }
     LE_INFO("system ping called");
 
-    snprintf(system_cmd, sizeof(system_cmd), "route -A inet6 del default gw %s", gatewayAddr);
+    snprintf(system_cmd, sizeof(system_cmd), "route -A inet6 del default gw %s",
+                                                                    infoPtr->ipv6GatewayAddr);
 
     if ( system(system_cmd) != 0 )
     {
@@ -287,72 +299,33 @@ static bool TestIpv6Connectivity
 static void* TestThread(void* contextPtr)
 {
     le_mdc_ProfileRef_t profileRef = (le_mdc_ProfileRef_t) contextPtr;
+    le_mdc_ConState_t state;
+    SessionInfo_t info;
 
     le_mdc_ConnectService();
 
-    le_mdc_ConState_t state;
-
     LOCK
 
-    if ((le_mdc_GetSessionState(profileRef, &state) != LE_OK) || (state != LE_MDC_DISCONNECTED))
+    // The session was started by the parallel bring-up
+    if ((le_mdc_GetSessionState(profileRef, &state) != LE_OK) || (state != LE_MDC_CONNECTED))
     {
         LE_INFO("le_mdc_GetSessionState failed (%d)", state);
         UNLOCK
         return NULL;
     }
 
-    if ( le_mdc_StartSession(profileRef) != LE_OK )
-    {
-        LE_INFO("Start failed");
-        UNLOCK
-        return NULL;
-    }
-
-    UNLOCK
-
-    LE_INFO("Start called");
-
-    LE_INFO("waiting a few seconds");
-    sleep(20*NbConnection);
-
-    LOCK
     // Check returned error code if Data session is already started
     LE_INFO("Restart tested as duplicated");
     LE_ASSERT(le_mdc_StartSession(profileRef)== LE_DUPLICATE);
 
-    if ( le_mdc_StopSession(profileRef) != LE_OK )
-    {
-        LE_INFO("Stop failed");
-        UNLOCK
-        return NULL;
-    }
-
     UNLOCK
 
-    LE_INFO("Stop called");
-
-    // Wait a bit and then restart the data session and configure the network interface.
-
-    LE_INFO("waiting a few more seconds");
-    sleep(10*NbConnection);
-
-    LOCK
-
-    if ( le_mdc_StartSession(profileRef) != LE_OK )
+    if (GetSessionInfo(profileRef, &info) == LE_OK)
     {
-        LE_INFO("Start failed");
-        return NULL;
-    }
+        TestIpv4Connectivity(&info);
 
-    LE_INFO("Start called");
-
-    UNLOCK
-
-    sleep(10*NbConnection);
-
-    TestIpv4Connectivity(profileRef);
-
-    TestIpv6Connectivity(profileRef);
+        TestIpv6Connectivity(&info);
+    }
 
     if ( le_mdc_StopSession(profileRef) != LE_OK )
     {
@@ -452,8 +425,6 @@ static void StateChangeHandler
     void* contextPtr
 )
 {
-    intptr_t profileIndex = (intptr_t) contextPtr;
-
     char name[LE_MDC_INTERFACE_NAME_MAX_BYTES];
 
     le_mdc_GetInterfaceName(profileRef, name, sizeof(name));
@@ -469,18 +440,6 @@ static void StateChangeHandler
         LE_PRINT_VALUE("%d", le_mdc_GetPlatformSpecificDisconnectionCode(profileRef));
     }
     LE_DEBUG("\n================================================");
-
-    if ((ConnectionStatus == LE_MDC_CONNECTED) &&
-        !(TaskStarted[profileIndex+1]) && (profileIndex < (NbConnection-1)))
-    {
-        char string[50]="\0";
-        snprintf(string,50,"MDC%d_Test", (int) profileIndex+2);
-
-        LE_INFO("Start %s", string);
-
-        le_thread_Start(le_thread_Create(string, TestThread, ProfileRef[profileIndex+1]));
-        TaskStarted[profileIndex+1] = true;
-    }
 }
 
 static void StateChangeHandlerMtPdp
@@ -545,6 +504,48 @@ static void* HandlerThreadMtPdP(void* contextPtr)
     le_event_RunLoop();
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called when a profile is started by the parallel bring-up. Once all the profiles are
+ * connected, the bring-up time is logged and a test thread is started for each session.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BringUpHandler
+(
+    le_mdc_ProfileRef_t profileRef,
+    le_result_t result,
+    void* contextPtr
+)
+{
+    intptr_t i;
+
+    if (result != LE_OK)
+    {
+        LE_ERROR("Start of profile %d failed", le_mdc_GetProfileIndex(profileRef));
+        exit(EXIT_FAILURE);
+    }
+
+    if (++BringUpResultCount < NbConnection)
+    {
+        return;
+    }
+
+    le_clk_Time_t duration = le_clk_Sub(le_clk_GetRelativeTime(), BringUpStartTime);
+
+    LE_INFO("%d sessions started in parallel in %ld ms", NbConnection,
+            (long) (duration.sec * 1000 + duration.usec / 1000));
+
+    for (i = 0; i < NbConnection; i++)
+    {
+        char string[50]="\0";
+        snprintf(string,50,"MDC%d_Test", (int) (i+1));
+
+        LE_INFO("Start %s", string);
+
+        le_thread_Start(le_thread_Create(string, TestThread, ProfileRef[i]));
+    }
+}
+
 COMPONENT_INIT
 {
 
@@ -568,8 +569,6 @@ COMPONENT_INIT
 
     for (i=0; i < NbConnection; i++)
     {
-        TaskStarted[i] = false;
-
         if (i==0)
         {
             ProfileRef[0]  = le_mdc_GetProfile(LE_MDC_DEFAULT_PROFILE);
@@ -598,9 +597,13 @@ COMPONENT_INIT
 
     sleep(1);
 
-    // Start the first test thread.
-    le_thread_Start(le_thread_Create("MDC1_Test", TestThread, ProfileRef[0]));
-    TaskStarted[0] = true;
+    // Start all the profiles at once. The test threads are started when they are all connected.
+    BringUpResultCount = 0;
+    BringUpStartTime = le_clk_GetRelativeTime();
+    for (i=0; i < NbConnection; i++)
+    {
+        le_mdc_StartSessionAsync(ProfileRef[i], BringUpHandler, NULL);
+    }
 
 }
 
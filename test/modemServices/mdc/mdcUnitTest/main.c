@@ -21,6 +21,8 @@
 typedef void (*StartStopAsyncFunc_t) (le_mdc_ProfileRef_t,le_mdc_SessionHandlerFunc_t,void*);
 
 static le_sem_Ref_t    ThreadSemaphore;
+static le_sem_Ref_t    AllSessionsSemaphore;
+static int             AllSessionsResultCount[NB_PROFILE];
 static le_mdc_ProfileRef_t ProfileRef[NB_PROFILE];
 static le_mdc_SessionStateHandlerRef_t SessionStateHandler[NB_PROFILE];
 static le_mdc_ProfileRef_t ProfileRefReceivedByHandler = NULL;
@@ -783,6 +785,179 @@ static void TestMdc_StartStopAsync
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler subscribed for the start and stop session status of all the profiles at once. It uses
+ * its own semaphore: the session state handlers still subscribed post ThreadSemaphore too.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void AllSessionsHandlerFunc
+(
+    le_mdc_ProfileRef_t profileRef,
+    le_result_t result,
+    void* contextPtr
+)
+{
+    int index = (int)(intptr_t)contextPtr;
+
+    LE_ASSERT(result == LE_OK);
+    LE_ASSERT(profileRef == ProfileRef[index]);
+    AllSessionsResultCount[index]++;
+
+    le_sem_Post(AllSessionsSemaphore);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Thread used to start or stop all the profiles at once with the asynchronous APIs
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void* AsyncStartStopAllSessionsThread
+(
+    void* contextPtr
+)
+{
+    StartStopAsyncFunc_t startStopAsyncFunc = contextPtr;
+    int i;
+
+    for (i = 0; i < NB_PROFILE; i++)
+    {
+        startStopAsyncFunc(ProfileRef[i], AllSessionsHandlerFunc, (void*)(intptr_t)i);
+    }
+
+    // Run the event loop
+    le_event_RunLoop();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start or stop all the profiles at once, wait for all the results and check the session states
+ *
+ * @return the time needed to get all the results
+ */
+//--------------------------------------------------------------------------------------------------
+static le_clk_Time_t StartStopAllSessions
+(
+    StartStopAsyncFunc_t startStopAsyncFunc,
+    le_mdc_ConState_t expectedState
+)
+{
+    le_clk_Time_t timeToWait = { .sec = 1, .usec = 0 };
+    le_clk_Time_t extraTimeToWait = { .sec = 0, .usec = 100000 };
+    le_clk_Time_t startTime;
+    le_mdc_ConState_t state;
+    int i;
+
+    if (NULL == AllSessionsSemaphore)
+    {
+        AllSessionsSemaphore = le_sem_Create("AllSessionsSem", 0);
+    }
+    memset(AllSessionsResultCount, 0, sizeof(AllSessionsResultCount));
+
+    startTime = le_clk_GetRelativeTime();
+    le_thread_Ref_t testThread = le_thread_Create("AsyncStartStopAllSessionsThread",
+                                                  AsyncStartStopAllSessionsThread,
+                                                  startStopAsyncFunc);
+    le_thread_Start(testThread);
+
+    for (i = 0; i < NB_PROFILE; i++)
+    {
+        LE_ASSERT(le_sem_WaitWithTimeOut(AllSessionsSemaphore, timeToWait) == LE_OK);
+    }
+
+    le_clk_Time_t duration = le_clk_Sub(le_clk_GetRelativeTime(), startTime);
+
+    /* Each profile reports its result exactly once */
+    LE_ASSERT(le_sem_WaitWithTimeOut(AllSessionsSemaphore, extraTimeToWait) == LE_TIMEOUT);
+
+    le_thread_Cancel(testThread);
+
+    for (i = 0; i < NB_PROFILE; i++)
+    {
+        LE_ASSERT(AllSessionsResultCount[i] == 1);
+        LE_ASSERT(le_mdc_GetSessionState(ProfileRef[i], &state) == LE_OK);
+        LE_ASSERT(state == expectedState);
+    }
+
+    return duration;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the bring-up of several profiles in parallel: all the sessions are started at once, and the
+ * network configuration of each one is retrieved while they are all connected
+ *
+ * API tested:
+ * - le_mdc_StartSessionAsync / le_mdc_StopSessionAsync on all the profiles
+ * - le_mdc_GetInterfaceName / le_mdc_GetIPv4Address on concurrent sessions
+ * - le_mdc_GetIPv4GatewayAddress / le_mdc_GetIPv4DNSAddresses on concurrent sessions
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestMdc_ParallelStart
+(
+    void
+)
+{
+    char interfaceName[LE_MDC_INTERFACE_NAME_MAX_BYTES];
+    char ipAddr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char gatewayAddr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char dns1Addr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char dns2Addr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char name[LE_MDC_INTERFACE_NAME_MAX_BYTES];
+    char addr[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    char addr2[LE_MDC_IPV4_ADDR_MAX_BYTES];
+    le_clk_Time_t duration;
+    int i;
+
+    for (i = 0; i < NB_PROFILE; i++)
+    {
+        LE_ASSERT(le_mdc_SetPDP(ProfileRef[i], LE_MDC_PDP_IPV4) == LE_OK);
+
+        snprintf(interfaceName, sizeof(interfaceName), "rmnet%d", i);
+        pa_mdcSimu_SetInterfaceName(i+1, interfaceName);
+        snprintf(ipAddr, sizeof(ipAddr), "192.168.1.%d", 100 + i);
+        pa_mdcSimu_SetIPAddress(i+1, LE_MDMDEFS_IPV4, ipAddr);
+        snprintf(gatewayAddr, sizeof(gatewayAddr), "192.168.1.%d", i + 1);
+        pa_mdcSimu_SetGatewayAddress(i+1, LE_MDMDEFS_IPV4, gatewayAddr);
+        snprintf(dns1Addr, sizeof(dns1Addr), "10.0.%d.1", i);
+        snprintf(dns2Addr, sizeof(dns2Addr), "10.0.%d.2", i);
+        pa_mdcSimu_SetDNSAddresses(i+1, LE_MDMDEFS_IPV4, dns1Addr, dns2Addr);
+    }
+
+    duration = StartStopAllSessions(le_mdc_StartSessionAsync, LE_MDC_CONNECTED);
+    LE_INFO("%d sessions started in %ld ms", NB_PROFILE,
+            (long) (duration.sec * 1000 + duration.usec / 1000));
+
+    // Each session keeps its own network configuration
+    for (i = 0; i < NB_PROFILE; i++)
+    {
+        snprintf(interfaceName, sizeof(interfaceName), "rmnet%d", i);
+        snprintf(ipAddr, sizeof(ipAddr), "192.168.1.%d", 100 + i);
+        snprintf(gatewayAddr, sizeof(gatewayAddr), "192.168.1.%d", i + 1);
+        snprintf(dns1Addr, sizeof(dns1Addr), "10.0.%d.1", i);
+        snprintf(dns2Addr, sizeof(dns2Addr), "10.0.%d.2", i);
+
+        LE_ASSERT(le_mdc_GetInterfaceName(ProfileRef[i], name, sizeof(name)) == LE_OK);
+        LE_ASSERT(strcmp(name, interfaceName) == 0);
+        LE_ASSERT(le_mdc_IsIPv4(ProfileRef[i]) == true);
+        LE_ASSERT(le_mdc_GetIPv4Address(ProfileRef[i], addr, sizeof(addr)) == LE_OK);
+        LE_ASSERT(strcmp(addr, ipAddr) == 0);
+        LE_ASSERT(le_mdc_GetIPv4GatewayAddress(ProfileRef[i], addr, sizeof(addr)) == LE_OK);
+        LE_ASSERT(strcmp(addr, gatewayAddr) == 0);
+        LE_ASSERT(le_mdc_GetIPv4DNSAddresses(ProfileRef[i], addr, sizeof(addr),
+                                             addr2, sizeof(addr2)) == LE_OK);
+        LE_ASSERT(strcmp(addr, dns1Addr) == 0);
+        LE_ASSERT(strcmp(addr2, dns2Addr) == 0);
+    }
+
+    duration = StartStopAllSessions(le_mdc_StopSessionAsync, LE_MDC_DISCONNECTED);
+    LE_INFO("%d sessions stopped in %ld ms", NB_PROFILE,
+            (long) (duration.sec * 1000 + duration.usec / 1000));
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * main of the test
@@ -820,6 +995,9 @@ COMPONENT_INIT
     /* Test asynchronous start and stop session */
     TestMdc_StartStopAsync();
 
+    /* Test parallel start and stop of all the profiles */
+    TestMdc_ParallelStart();
+
     /* Test statistics */
     TestMdc_Stat();
 
@@ -0,0 +1,377 @@
+/**
+ * This program tests the outbound SMS queue of the textLoc sample with a modem stub: splitting of
+ * long texts, per-message results, number of SMS in flight, and caller latency compared to SMS
+ * sent one after the other. Like a modem, the stub transmits one SMS at a time: the queue can't
+ * send faster than the modem, it only keeps it busy.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+
+#include "legato.h"
+#include "interfaces.h"
+#include "smsQueue.h"
+
+#define DEST_OK             "+33600000001"
+#define DEST_FAIL           "+33600000002"
+#define DEST_REJECTED       "+33600000003"
+
+#define ACK_DELAY_MS        10
+#define BENCH_COUNT         100
+#define MAX_SENT_TEXTS      32
+#define PART_NUMBER_LEN     4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Modem stub: the submitted SMS are transmitted one after the other, each one is acknowledged
+ * ACK_DELAY_MS after the previous one. SMS sent to DEST_FAIL fail and SMS sent to DEST_REJECTED
+ * are not submitted.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    le_sms_CallbackResultFunc_t handlerPtr;
+    void*                       contextPtr;
+    le_sms_Status_t             status;
+}
+StubSms_t;
+
+static char SentTexts[MAX_SENT_TEXTS][LE_SMS_TEXT_MAX_BYTES];
+static int SentCount;
+static StubSms_t* InFlightSms[SMS_QUEUE_MAX_IN_FLIGHT];
+static int InFlightCount;
+static int MaxInFlightCount;
+static le_timer_Ref_t ModemTimerRef;
+
+static void AckTimerHandler
+(
+    le_timer_Ref_t timerRef
+)
+{
+    StubSms_t* smsPtr = InFlightSms[0];
+
+    LE_ASSERT(InFlightCount > 0);
+    InFlightCount--;
+    memmove(InFlightSms, InFlightSms + 1, InFlightCount * sizeof(InFlightSms[0]));
+
+    // Transmit the next SMS
+    if (InFlightCount > 0)
+    {
+        le_timer_Start(ModemTimerRef);
+    }
+
+    smsPtr->handlerPtr((le_sms_MsgRef_t)smsPtr, smsPtr->status, smsPtr->contextPtr);
+}
+
+le_sms_MsgRef_t le_sms_SendText
+(
+    const char* destStr,
+    const char* textStr,
+    le_sms_CallbackResultFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    StubSms_t* smsPtr;
+
+    LE_ASSERT(strlen(textStr) <= LE_SMS_TEXT_MAX_LEN);
+    if (0 == strcmp(destStr, DEST_REJECTED))
+    {
+        return NULL;
+    }
+
+    if (SentCount < MAX_SENT_TEXTS)
+    {
+        strcpy(SentTexts[SentCount], textStr);
+    }
+    SentCount++;
+
+    // The queue never submits more SMS than its limit
+    LE_ASSERT(InFlightCount < SMS_QUEUE_MAX_IN_FLIGHT);
+
+    smsPtr = calloc(1, sizeof(StubSms_t));
+    LE_ASSERT(NULL != smsPtr);
+    smsPtr->handlerPtr = handlerPtr;
+    smsPtr->contextPtr = contextPtr;
+    smsPtr->status = (0 == strcmp(destStr, DEST_FAIL)) ? LE_SMS_SENDING_FAILED : LE_SMS_SENT;
+
+    InFlightSms[InFlightCount++] = smsPtr;
+    if (InFlightCount > MaxInFlightCount)
+    {
+        MaxInFlightCount = InFlightCount;
+    }
+
+    if (NULL == ModemTimerRef)
+    {
+        ModemTimerRef = le_timer_Create("ModemTimer");
+        le_timer_SetMsInterval(ModemTimerRef, ACK_DELAY_MS);
+        le_timer_SetHandler(ModemTimerRef, AckTimerHandler);
+    }
+
+    // The modem is idle: transmit this SMS now
+    if (!le_timer_IsRunning(ModemTimerRef))
+    {
+        le_timer_Start(ModemTimerRef);
+    }
+
+    return (le_sms_MsgRef_t)smsPtr;
+}
+
+void le_sms_Delete
+(
+    le_sms_MsgRef_t msgRef
+)
+{
+    StubSms_t* smsPtr = (StubSms_t*)msgRef;
+    int i;
+
+    // An SMS is only deleted once acknowledged
+    for (i = 0; i < InFlightCount; i++)
+    {
+        LE_ASSERT(InFlightSms[i] != smsPtr);
+    }
+    free(smsPtr);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Message results
+ */
+//--------------------------------------------------------------------------------------------------
+static int OkCount;
+static int FaultCount;
+static le_clk_Time_t StartTime;
+static void (*NextTestPtr)(void);
+
+static void TestFailure(void);
+static void TestThroughput(void);
+
+static void ResultHandler
+(
+    const char* destPtr,
+    le_result_t result,
+    void*       contextPtr
+)
+{
+    if (LE_OK == result)
+    {
+        OkCount++;
+    }
+    else
+    {
+        FaultCount++;
+    }
+
+    if (0 == smsQueue_GetPendingCount())
+    {
+        NextTestPtr();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a test from the event loop, once the previous one is done
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunTest
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    void (*testPtr)(void) = param1Ptr;
+
+    testPtr();
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of septets of a text
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetSeptetCount
+(
+    const char* textPtr
+)
+{
+    size_t count = 0;
+
+    for (; '\0' != *textPtr; textPtr++)
+    {
+        count += (NULL != strchr("^{}\\[~]|", *textPtr)) ? 2 : 1;
+    }
+    return count;
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Long text test: the text is split into numbered parts which fit in one SMS each
+ */
+//--------------------------------------------------------------------------------------------------
+static char LongText[400];
+
+static void EndSplit
+(
+    void
+)
+{
+    char text[sizeof(LongText)] = "";
+    char prefix[16];
+    int i;
+
+    LE_TEST(2 == OkCount);
+    LE_TEST(0 == FaultCount);
+    LE_TEST(4 == SentCount);
+
+    // The short text is sent as is
+    LE_TEST(0 == strcmp(SentTexts[0], "Loc:unknown"));
+
+    for (i = 1; i < SentCount; i++)
+    {
+        snprintf(prefix, sizeof(prefix), "%d/3 ", i);
+        LE_TEST(0 == strncmp(SentTexts[i], prefix, PART_NUMBER_LEN));
+        LE_TEST(GetSeptetCount(SentTexts[i]) <= LE_SMS_TEXT_MAX_LEN);
+        strcat(text, SentTexts[i] + PART_NUMBER_LEN);
+    }
+    LE_TEST(0 == strcmp(text, LongText));
+
+    le_event_QueueFunction(RunTest, TestFailure, NULL);
+}
+
+static void TestSplit
+(
+    void
+)
+{
+    size_t len = 0;
+
+    while (len < (sizeof(LongText) - 8))
+    {
+        len += snprintf(LongText + len, sizeof(LongText) - len, "word%03zu ", len);
+    }
+    LongText[len - 1] = '{';
+
+    NextTestPtr = EndSplit;
+    LE_TEST(LE_OK == smsQueue_Send(DEST_OK, "Loc:unknown", ResultHandler, NULL));
+    LE_TEST(LE_OK == smsQueue_Send(DEST_OK, LongText, ResultHandler, NULL));
+
+    // Nothing is submitted from the caller context
+    LE_TEST(0 == SentCount);
+    LE_TEST(2 == smsQueue_GetPendingCount());
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Invalid messages test
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestInvalid
+(
+    void
+)
+{
+    char text[(SMS_QUEUE_MAX_PARTS + 1) * LE_SMS_TEXT_MAX_LEN];
+
+    memset(text, 'a', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+
+    LE_TEST(LE_BAD_PARAMETER == smsQueue_Send("", "text", ResultHandler, NULL));
+    LE_TEST(LE_BAD_PARAMETER == smsQueue_Send(DEST_OK, "", ResultHandler, NULL));
+    LE_TEST(LE_OVERFLOW == smsQueue_Send(DEST_OK, text, ResultHandler, NULL));
+    LE_TEST(0 == smsQueue_GetPendingCount());
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Failure test: a message fails if one of its SMS fails or cannot be submitted
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndFailure
+(
+    void
+)
+{
+    LE_TEST(1 == OkCount);
+    LE_TEST(2 == FaultCount);
+
+    le_event_QueueFunction(RunTest, TestThroughput, NULL);
+}
+
+static void TestFailure
+(
+    void
+)
+{
+    OkCount = 0;
+    FaultCount = 0;
+
+    NextTestPtr = EndFailure;
+    LE_TEST(LE_OK == smsQueue_Send(DEST_FAIL, LongText, ResultHandler, NULL));
+    LE_TEST(LE_OK == smsQueue_Send(DEST_REJECTED, LongText, ResultHandler, NULL));
+    LE_TEST(LE_OK == smsQueue_Send(DEST_OK, "Loc:unknown", ResultHandler, NULL));
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Throughput test: caller latency for a fan-out to many recipients, and messages per second
+ * against the rate of the modem
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndThroughput
+(
+    void
+)
+{
+    le_clk_Time_t duration = le_clk_Sub(le_clk_GetRelativeTime(), StartTime);
+    uint64_t durationUs = ((uint64_t)duration.sec * 1000000) + duration.usec;
+    uint64_t msgPerSec = ((uint64_t)BENCH_COUNT * 1000000) / durationUs;
+    uint64_t modemMsgPerSec = 1000 / ACK_DELAY_MS;
+
+    LE_INFO("%d messages: %"PRIu64" messages/s, the modem sends %"PRIu64" messages/s",
+            BENCH_COUNT, msgPerSec, modemMsgPerSec);
+    LE_TEST(BENCH_COUNT == OkCount);
+    LE_TEST(SMS_QUEUE_MAX_IN_FLIGHT == MaxInFlightCount);
+
+    // The modem is never left idle while messages are queued
+    LE_TEST(msgPerSec <= modemMsgPerSec);
+    LE_TEST(msgPerSec >= ((9 * modemMsgPerSec) / 10));
+
+    LE_TEST_EXIT;
+}
+
+static void TestThroughput
+(
+    void
+)
+{
+    char dest[LE_MDMDEFS_PHONE_NUM_MAX_BYTES];
+    le_clk_Time_t latency;
+    int i;
+
+    OkCount = 0;
+    FaultCount = 0;
+    MaxInFlightCount = 0;
+
+    NextTestPtr = EndThroughput;
+    StartTime = le_clk_GetRelativeTime();
+    for (i = 0; i < BENCH_COUNT; i++)
+    {
+        snprintf(dest, sizeof(dest), "+337%08d", i);
+        LE_ASSERT(LE_OK == smsQueue_Send(dest, "Loc:4512345,-7312345", ResultHandler, NULL));
+    }
+    latency = le_clk_Sub(le_clk_GetRelativeTime(), StartTime);
+
+    // Sent one by one, the caller would be blocked until the last acknowledgement
+    LE_INFO("Caller latency: %"PRIu64" us for %d messages, %d us when sent one by one",
+            ((uint64_t)latency.sec * 1000000) + latency.usec, BENCH_COUNT,
+            BENCH_COUNT * ACK_DELAY_MS * 1000);
+    LE_TEST(latency.sec < 1);
+}
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    smsQueue_Init();
+
+    TestInvalid();
+    TestSplit();
+}
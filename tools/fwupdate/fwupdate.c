@@ -11,6 +11,7 @@
 #include "le_print.h"
 
 #include <sys/utsname.h>
+#include <sys/stat.h>
 
 //--------------------------------------------------------------------------------------------------
 /**
@@ -42,12 +43,12 @@ NAME:\n\
 \n\
 SYNOPSIS:\n\
     fwupdate help\n\
-    fwupdate downloadOnly FILE\n\
+    fwupdate downloadOnly FILE [--resume]\n\
     fwupdate query\n\
     fwupdate install\n\
     fwupdate checkStatus\n\
     fwupdate markGood\n\
-    fwupdate download FILE\n\
+    fwupdate download FILE [--resume]\n\
 \n\
 DESCRIPTION:\n\
     fwupdate help\n\
@@ -61,6 +62,10 @@ DESCRIPTION:\n\
     fwupdate downloadOnly FILE\n\
       - Download the given CWE file; if '-' is given as the FILE, then use stdin.\n\
         Waits for another command after a successful download.\n\
+        With --resume, FILE must be the file of an interrupted download: the download is\n\
+        resumed without being initialized, and the beginning of FILE, already downloaded,\n\
+        is skipped. If the resumed download fails, FILE is downloaded again from its\n\
+        beginning. Without --resume, any interrupted download is discarded.\n\
 \n\
     fwupdate checkStatus\n\
       - Check the status of the downloaded package (DualSys platform only)\n\
@@ -78,6 +83,7 @@ DESCRIPTION:\n\
     fwupdate download FILE\n\
       - do download, install and markGood in one time\n\
         After a successful download, the modem will reset\n\
+        --resume resumes an interrupted download as with downloadOnly.\n\
 ";
 
 
@@ -153,14 +159,12 @@ static void TryConnect
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Process the download firmware command
+ * Open the firmware image file
  *
- * @return
- *      - LE_OK if the download was successful
- *      - LE_FAULT if there was an issue during the download process
+ * @return the file descriptor, or -1 on error
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t DownloadFirmware
+static int OpenFirmware
 (
     const char* fileNamePtr    ///< Name of file containing firmware image
 )
@@ -170,20 +174,88 @@ static le_result_t DownloadFirmware
     if ( strcmp(fileNamePtr, "-") == 0 )
     {
         // Use stdin
-        fd = STDIN_FILENO;
+        return STDIN_FILENO;
     }
-    else
+
+    // Open the file
+    fd = open( fileNamePtr, O_RDONLY);
+    LE_PRINT_VALUE("%d", fd);
+
+    if ( fd == -1 )
     {
-        // Open the file
-        fd = open( fileNamePtr, O_RDONLY);
-        LE_PRINT_VALUE("%d", fd);
+        // Inform the user of the error; it's also useful to log this info
+        printf("Can't open file '%s' : %m\n", fileNamePtr);
+    }
 
-        if ( fd == -1 )
-        {
-            // Inform the user of the error; it's also useful to log this info
-            printf("Can't open file '%s' : %m\n", fileNamePtr);
-            return LE_FAULT;
-        }
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Move a firmware image file to the position where an interrupted download resumes, so that the
+ * bytes already downloaded are not read and sent again.
+ *
+ * @return the resume position, 0 for a download from the beginning of the file
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t SeekResumePosition
+(
+    int fd                     ///< Firmware image file descriptor
+)
+{
+    struct stat fileStat;
+    size_t resumePosition = 0;
+
+    // stdin and pipes can't be moved: their whole content is downloaded
+    if ((-1 == fstat(fd, &fileStat)) || (!S_ISREG(fileStat.st_mode)))
+    {
+        return 0;
+    }
+
+    if (   (LE_OK != le_fwupdate_GetResumePosition(&resumePosition))
+        || (0 == resumePosition)
+        || (resumePosition >= (size_t)fileStat.st_size))
+    {
+        return 0;
+    }
+
+    if (-1 == lseek(fd, (off_t)resumePosition, SEEK_SET))
+    {
+        printf("Can't resume the download: %m\n");
+        return 0;
+    }
+
+    printf("Resuming download at position %zu: %zu of %zu bytes not sent again\n",
+           resumePosition, resumePosition, (size_t)fileStat.st_size);
+    fflush(stdout);
+
+    return resumePosition;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Process the download firmware command
+ *
+ * @return
+ *      - LE_OK if the download was successful
+ *      - LE_FAULT if there was an issue during the download process
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DownloadFirmware
+(
+    const char* fileNamePtr,   ///< Name of file containing firmware image
+    bool isResume              ///< Resume the interrupted download of this file
+)
+{
+    int fd;
+    size_t resumePosition = 0;
+
+    fd = OpenFirmware(fileNamePtr);
+    if ( fd == -1 )
+    {
+        return LE_FAULT;
     }
 
     TryConnect(le_fwupdate_ConnectService, "fwupdateService");
@@ -192,23 +264,58 @@ static le_result_t DownloadFirmware
     printf("Download started ...\n");
     fflush(stdout);
 
-    // force a fresh download on dualsys platform
-    le_fwupdate_InitDownload();
+    // The service can't tell whether the file is the one of the interrupted download: only the
+    // user can, by asking for a resume
+    if (isResume)
+    {
+        resumePosition = SeekResumePosition(fd);
+        if (0 == resumePosition)
+        {
+            printf("No interrupted download to resume, downloading the whole file ...\n");
+            fflush(stdout);
+        }
+    }
+
+    if (0 == resumePosition)
+    {
+        // force a fresh download on dualsys platform
+        le_fwupdate_InitDownload();
+    }
 
     LE_PRINT_VALUE("%d", fd);
     if ( le_fwupdate_Download(fd) == LE_OK )
     {
         printf("Download successful\n");
+        close(fd);
+        return LE_OK;
     }
-    else
+
+    if (resumePosition)
     {
-        printf("Error in download\n");
-        return LE_FAULT;
+        // The file may not be the one of the interrupted download: download it whole. The file
+        // descriptor was handed over to the service, open the file again.
+        printf("Resumed download failed, downloading the whole file ...\n");
+        fflush(stdout);
+        close(fd);
+
+        fd = OpenFirmware(fileNamePtr);
+        if ( fd == -1 )
+        {
+            return LE_FAULT;
+        }
+
+        le_fwupdate_InitDownload();
+        if ( le_fwupdate_Download(fd) == LE_OK )
+        {
+            printf("Download successful\n");
+            close(fd);
+            return LE_OK;
+        }
     }
 
+    printf("Error in download\n");
     close(fd);
-
-    return LE_OK;
+    return LE_FAULT;
 }
 
 
@@ -359,14 +466,15 @@ static le_result_t MarkGoodFirmware
 //--------------------------------------------------------------------------------------------------
 static le_result_t FullInstallFirmware
 (
-    const char* fileNamePtr    ///< Name of file containing firmware image
+    const char* fileNamePtr,   ///< Name of file containing firmware image
+    bool isResume              ///< Resume the interrupted download of this file
 )
 {
     le_result_t result;
 
     TryConnect(le_fwupdate_ConnectService, "fwupdateService");
 
-    result = DownloadFirmware(fileNamePtr);
+    result = DownloadFirmware(fileNamePtr, isResume);
     if (result != LE_OK)
     {
         return result;
@@ -375,6 +483,40 @@ static le_result_t FullInstallFirmware
     return le_fwupdate_InstallAndMarkGood();
 }
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the download options following FILE
+ *
+ * @return
+ *      - LE_OK if the options are valid
+ *      - LE_BAD_PARAMETER if an option is unknown
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetDownloadOptions
+(
+    bool* isResumePtr          ///< [OUT] Resume the interrupted download
+)
+{
+    size_t i;
+
+    *isResumePtr = false;
+
+    for (i = 2; i < le_arg_NumArgs(); i++)
+    {
+        const char* optionPtr = le_arg_GetArg(i);
+
+        if ((NULL == optionPtr) || (0 != strcmp(optionPtr, "--resume")))
+        {
+            printf("Invalid option '%s'\n\n", (NULL == optionPtr) ? "" : optionPtr);
+            return LE_BAD_PARAMETER;
+        }
+
+        *isResumePtr = true;
+    }
+
+    return LE_OK;
+}
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Program init
@@ -400,17 +542,19 @@ COMPONENT_INIT
 
         else if ( 0 == strcmp(command, "downloadOnly") )
         {
+            bool isResume;
+
             // Get the filename of the firmware image; could be '-' if stdin
-            if (le_arg_NumArgs() > 1)
+            if ((le_arg_NumArgs() > 1) && (LE_OK == GetDownloadOptions(&isResume)))
             {
-                if (DownloadFirmware(le_arg_GetArg(1)) == LE_OK)
+                if (DownloadFirmware(le_arg_GetArg(1), isResume) == LE_OK)
                 {
                     exit(EXIT_SUCCESS);
                 }
 
                 exit(EXIT_FAILURE);
             }
-            else
+            else if (le_arg_NumArgs() <= 1)
             {
                 printf("Missing FILE\n\n");
             }
@@ -458,17 +602,19 @@ COMPONENT_INIT
 
         else if ( 0 == strcmp(command, "download") )
         {
+            bool isResume;
+
             // Get the filename of the firmware image; could be '-' if stdin
-            if (le_arg_NumArgs() > 1)
+            if ((le_arg_NumArgs() > 1) && (LE_OK == GetDownloadOptions(&isResume)))
             {
-                if ( FullInstallFirmware(le_arg_GetArg(1)) == LE_OK )
+                if ( FullInstallFirmware(le_arg_GetArg(1), isResume) == LE_OK )
                 {
                     exit(EXIT_SUCCESS);
                 }
 
                 exit(EXIT_FAILURE);
             }
-            else
+            else if (le_arg_NumArgs() <= 1)
             {
                 printf("Missing FILE\n\n");
             }
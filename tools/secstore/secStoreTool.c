@@ -52,6 +52,20 @@ static const char* InputFilePtr = NULL;
 static bool ListSizeFlag = false;
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Item of an import manifest.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char path[SECSTOREADMIN_MAX_PATH_BYTES];    ///< Secure storage path of the item.
+    uint8_t* dataPtr;                           ///< Value to write.
+    size_t dataSize;                            ///< Size of the value to write.
+}
+ImportItem_t;
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Prints help to stdout.
@@ -83,6 +97,14 @@ static void PrintHelp
         "       the <inputFile> is reached or the maximum secure storage item size is reached.\n"
         "       Note that this write will not respect an application's secure storage limit.\n"
         "\n"
+        "    secstore import <manifestFile>\n"
+        "       Writes all the items listed in <manifestFile> in a single session.  Each line\n"
+        "       of <manifestFile> is an '<inputFile> <path>' pair, as for the write command;\n"
+        "       empty lines and lines starting with '#' are ignored.  All the input files are\n"
+        "       read before secure storage is modified.  Items are written in manifest order and\n"
+        "       the import stops at the first item that cannot be written; the items before it\n"
+        "       keep their new values.\n"
+        "\n"
         "    secstore rm <path>\n"
         "       Deletes <path> and all items under it.  <path> is assumed to be absolute.\n"
         "\n"
@@ -256,6 +278,86 @@ static void PrintEntry
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the contents of an input file, up to the maximum secure storage item size.  Exits on error.
+ *
+ * @return
+ *      Number of bytes read.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t ReadInputFile
+(
+    const char* filePathPtr,            ///< [IN] Input file path.
+    uint8_t* bufPtr,                    ///< [OUT] Buffer to store the contents in.
+    size_t bufSize                      ///< [IN] Buffer size.
+)
+{
+    // Open input file.
+    int fd;
+
+    do
+    {
+        fd = open(filePathPtr, O_RDONLY);
+    }
+    while ( (fd == -1) && (errno == EINTR) );
+
+    if (fd == -1)
+    {
+        fprintf(stderr, "Could not open file %s.  %m.\n", filePathPtr);
+        exit(EXIT_FAILURE);
+    }
+
+    // Read the contents of the input file.
+    ssize_t numBytes;
+
+    do
+    {
+        numBytes = read(fd, bufPtr, bufSize);
+    }
+    while ( (numBytes == -1) && (errno == EINTR) );
+
+    if (numBytes == -1)
+    {
+        fprintf(stderr, "Could not read from %s.  %m.\n", filePathPtr);
+        exit(EXIT_FAILURE);
+    }
+
+    close(fd);
+
+    return (size_t)numBytes;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Prints the message corresponding to a secure storage write error and exits.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteErr
+(
+    const char* pathPtr,                ///< [IN] Secure storage path.
+    le_result_t result                  ///< [IN] Write result.
+)
+{
+    if (result == LE_NO_MEMORY)
+    {
+        fprintf(stderr, "Out of secure storage space.\n");
+        exit(EXIT_FAILURE);
+    }
+    else if (result == LE_BAD_PARAMETER)
+    {
+        fprintf(stderr, "Cannot write to the specified path.\n");
+        exit(EXIT_FAILURE);
+    }
+    else
+    {
+        INTERNAL_ERR("Could not write to item %s.  Result code %s.",
+                     pathPtr, LE_RESULT_TXT(result));
+    }
+}
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Write entry value into secure storage.
@@ -273,59 +375,156 @@ static void WriteEntry
         exit(EXIT_FAILURE);
     }
 
-    // Open input file.
-    int fd;
+    // Read the contents of the input file.
+    uint8_t buf[LE_SECSTORE_MAX_ITEM_SIZE];
+    size_t numBytes = ReadInputFile(InputFilePtr, buf, sizeof(buf));
+
+    // Write the buffer to secure storage.
+    le_result_t result = secStoreAdmin_Write(Path, buf, numBytes);
+
+    if (result != LE_OK)
+    {
+        WriteErr(Path, result);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Loads an import manifest and the contents of all its input files.  Exits on error.
+ *
+ * @return
+ *      Array of items, to be freed by the caller.
+ */
+//--------------------------------------------------------------------------------------------------
+static ImportItem_t* LoadManifest
+(
+    const char* manifestPathPtr,        ///< [IN] Manifest file path.
+    size_t* numItemsPtr                 ///< [OUT] Number of items.
+)
+{
+    FILE* manifestPtr;
 
     do
     {
-        fd = open(InputFilePtr, O_RDONLY);
+        manifestPtr = fopen(manifestPathPtr, "r");
     }
-    while ( (fd == -1) && (errno == EINTR) );
+    while ( (manifestPtr == NULL) && (errno == EINTR) );
 
-    if (fd == -1)
+    if (manifestPtr == NULL)
     {
-        fprintf(stderr, "Could not open file %s.  %m.\n", Path);
+        fprintf(stderr, "Could not open file %s.  %m.\n", manifestPathPtr);
         exit(EXIT_FAILURE);
     }
 
-    // Read the contents of the input file.
+    ImportItem_t* itemsPtr = NULL;
+    size_t numItems = 0;
+    size_t maxItems = 0;
+    char lineBuf[2 * SECSTOREADMIN_MAX_PATH_BYTES + PATH_MAX];
     uint8_t buf[LE_SECSTORE_MAX_ITEM_SIZE];
-    ssize_t numBytes;
+    int lineNum = 0;
 
-    do
+    while (fgets(lineBuf, sizeof(lineBuf), manifestPtr) != NULL)
     {
-        numBytes = read(fd, buf, sizeof(buf));
-    }
-    while ( (numBytes == -1) && (errno == EINTR) );
+        char* savePtr;
+        char* filePtr = strtok_r(lineBuf, " \t\r\n", &savePtr);
+        char* pathPtr = strtok_r(NULL, " \t\r\n", &savePtr);
 
-    if (numBytes >= 0)
-    {
-        // Write the buffer to secure storage.
-        le_result_t result = secStoreAdmin_Write(Path, buf, numBytes);
+        lineNum++;
+
+        if ((filePtr == NULL) || (filePtr[0] == '#'))
+        {
+            continue;
+        }
 
-        if (result == LE_NO_MEMORY)
+        if ((pathPtr == NULL) || (strtok_r(NULL, " \t\r\n", &savePtr) != NULL))
         {
-            fprintf(stderr, "Out of secure storage space.\n");
+            fprintf(stderr, "%s:%d: expected '<inputFile> <path>'.\n", manifestPathPtr, lineNum);
             exit(EXIT_FAILURE);
         }
-        else if (result == LE_BAD_PARAMETER)
+
+        if (numItems == maxItems)
+        {
+            maxItems = (maxItems == 0) ? 64 : (2 * maxItems);
+            itemsPtr = realloc(itemsPtr, maxItems * sizeof(ImportItem_t));
+            INTERNAL_ERR_IF(itemsPtr == NULL, "Could not allocate %zu import items.", maxItems);
+        }
+
+        ImportItem_t* itemPtr = &itemsPtr[numItems];
+        memset(itemPtr, 0, sizeof(*itemPtr));
+
+        itemPtr->path[0] = '/';
+        if (le_path_Concat("/", itemPtr->path, sizeof(itemPtr->path), pathPtr, NULL) != LE_OK)
         {
-            fprintf(stderr, "Cannot write to the specified path.\n");
+            fprintf(stderr, "%s:%d: path is too long.\n", manifestPathPtr, lineNum);
             exit(EXIT_FAILURE);
         }
-        else if (result != LE_OK)
+
+        if (itemPtr->path[strlen(itemPtr->path)-1] == '/')
         {
-            INTERNAL_ERR("Could not write to item %s.  Result code %s.",
-                         Path, LE_RESULT_TXT(result));
+            fprintf(stderr, "%s:%d: path must not end with a separator.\n",
+                    manifestPathPtr, lineNum);
+            exit(EXIT_FAILURE);
         }
+
+        itemPtr->dataSize = ReadInputFile(filePtr, buf, sizeof(buf));
+        itemPtr->dataPtr = malloc(itemPtr->dataSize + 1);
+        INTERNAL_ERR_IF(itemPtr->dataPtr == NULL,
+                        "Could not allocate %zu bytes.", itemPtr->dataSize);
+        memcpy(itemPtr->dataPtr, buf, itemPtr->dataSize);
+
+        numItems++;
     }
-    else if (numBytes == -1)
+
+    if (ferror(manifestPtr))
     {
-        fprintf(stderr, "Could not read from %s.  %m.\n", InputFilePtr);
+        fprintf(stderr, "Error reading file %s.  %m.\n", manifestPathPtr);
         exit(EXIT_FAILURE);
     }
 
-    close(fd);
+    fclose(manifestPtr);
+
+    *numItemsPtr = numItems;
+    return itemsPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Imports all the items of a manifest into secure storage, in manifest order.  Stops at the first
+ * item that cannot be written.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ImportItems
+(
+    void
+)
+{
+    size_t numItems;
+    ImportItem_t* itemsPtr = LoadManifest(InputFilePtr, &numItems);
+    size_t i;
+
+    for (i = 0; i < numItems; i++)
+    {
+        ImportItem_t* itemPtr = &itemsPtr[i];
+        le_result_t result = secStoreAdmin_Write(itemPtr->path, itemPtr->dataPtr,
+                                                 itemPtr->dataSize);
+
+        if (result != LE_OK)
+        {
+            fprintf(stderr, "Could not write item %s, %zu of %zu items imported.\n",
+                    itemPtr->path, i, numItems);
+            WriteErr(itemPtr->path, result);
+        }
+    }
+
+    for (i = 0; i < numItems; i++)
+    {
+        free(itemsPtr[i].dataPtr);
+    }
+    free(itemsPtr);
+
+    printf("%zu items imported.\n", numItems);
 }
 
 
@@ -586,6 +785,11 @@ static void SetCommandHandler
         le_arg_AddPositionalCallback(SetInputFile);
         le_arg_AddPositionalCallback(SetPath);
     }
+    else if (strcmp(argPtr, "import") == 0)
+    {
+        CommandHandler = ImportItems;
+        le_arg_AddPositionalCallback(SetInputFile);
+    }
     else if (strcmp(argPtr, "rm") == 0)
     {
         CommandHandler = DeletePath;